@@ -0,0 +1,45 @@
+#ifndef ALLOCATION_HPP
+#define ALLOCATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * How an incoming order's quantity is shared among the orders resting at
+ * one price level. Levels are still taken best price first; only the split
+ * within a level differs.
+ */
+enum class MatchingAlgorithm : uint8_t {
+    Fifo,              // strict time priority
+    ProRata,           // in proportion to resting quantity
+    PriceTimeProRata   // a share in time priority, the rest pro rata
+};
+
+// Parses "fifo", "pro-rata", "price-time-pro-rata"
+bool parseMatchingAlgorithm(const std::string &name, MatchingAlgorithm &algorithm);
+
+struct AllocationRules {
+    MatchingAlgorithm algorithm = MatchingAlgorithm::Fifo;
+    uint64_t topOrderSlice = 0;   // oldest order at the level is filled up to this first; 0 = none
+    uint32_t fifoPercent = 50;    // PriceTimeProRata: share of each level's fill in time priority
+    uint64_t minAllocation = 0;   // pro-rata shares below this are dropped
+};
+
+/**
+ * Splits min(qty, levelTotal) across the count orders of one level, given
+ * their resting quantities in time priority and their sum levelTotal (the
+ * level aggregate the ladder already maintains). out[i] receives order
+ * i's allocation; returns the total allocated.
+ *
+ * In order: the top-order slice; the time-priority share (PriceTimeProRata);
+ * then floor(pool * q / Q) to every order, where pool is what is left and
+ * q and Q are the quantities still unallocated, in one pass with exact
+ * integer arithmetic. Shares under minAllocation are dropped, and the units
+ * rounding and the minimum leave over go out in time priority, so the sum
+ * is exact and no order gets more than it has.
+ */
+uint64_t allocateLevel(const AllocationRules &rules, uint64_t qty, const uint64_t *resting,
+                       size_t count, uint64_t levelTotal, uint64_t *out);
+
+#endif // ALLOCATION_HPP
@@ -0,0 +1,30 @@
+#ifndef AUCTION_HPP
+#define AUCTION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Equilibrium price search for a call auction. Each side is given as its
+ * price levels best first (bids descending, asks ascending) with the total
+ * quantity resting at each, hidden iceberg reserve included.
+ */
+struct AuctionLevel {
+    int64_t ticks;
+    uint64_t quantity;
+};
+
+struct AuctionEquilibrium {
+    bool crossed = false;   // false: the sides don't overlap, nothing trades
+    int64_t ticks = 0;      // uncross price
+    uint64_t volume = 0;    // quantity executable at that price
+    int64_t surplus = 0;    // bid minus ask quantity willing to trade there
+};
+
+// Picks the price that executes the most quantity; ties go to the smallest
+// surplus, then to the highest price if buyers are in surplus and the
+// lowest otherwise. One pass down the crossed range of both curves.
+AuctionEquilibrium findEquilibrium(const AuctionLevel *bids, size_t bidCount,
+                                   const AuctionLevel *asks, size_t askCount);
+
+#endif // AUCTION_HPP
@@ -0,0 +1,176 @@
+#ifndef AUDIT_LOG_HPP
+#define AUDIT_LOG_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "order.hpp"
+#include "orderbook.hpp"
+#include "spsc_ring.hpp"
+
+enum class AuditEventType : uint8_t {
+    Order = 0,  // an order finished processing (detail = status code)
+    Reject,     // an order was refused (detail = status code)
+    Trade,      // orderId traded with counterpartyId
+    Cancel      // a resting order lost quantity without trading (detail = CancelReason)
+};
+
+/**
+ * One audit record. Fixed size and trivially copyable so it can travel
+ * through the ring by value.
+ */
+struct AuditEvent {
+    uint64_t timestampNs = 0;       // wall clock, nanoseconds since the Unix epoch
+    uint64_t sequence = 0;          // arrival sequence of the order the event belongs to
+    uint64_t orderId = 0;
+    uint64_t counterpartyId = 0;    // resting order id (Trade)
+    int64_t priceTicks = 0;         // order price, or trade price
+    uint64_t quantity = 0;          // order, traded or cancelled quantity
+    uint64_t filledQuantity = 0;
+    uint64_t remainingQuantity = 0;
+    uint32_t ownerId = 0;
+    AuditEventType type = AuditEventType::Order;
+    OrderKind kind = OrderKind::Unknown;
+    Side side = Side::Unknown;
+    uint8_t detail = 0;
+};
+
+const char* auditEventTypeName(AuditEventType type);
+const char* cancelReasonName(CancelReason reason);
+
+// Order outcomes are stored as their status codes (orderStatusCode)
+uint8_t auditStatusCode(OrderStatus status);
+const char* auditStatusName(uint8_t code);
+
+/**
+ * Block codec. Each record is stored as four tag bytes followed by
+ * varints: ids, sequence, timestamp and price as zigzag deltas from the
+ * previous record in the block, quantities as plain varints. Blocks are
+ * self-contained so a reader can start at any block boundary.
+ */
+void encodeAuditBlock(const AuditEvent *events, size_t count, std::string &out);
+bool decodeAuditBlock(const uint8_t *data, size_t size, size_t count, std::vector<AuditEvent> &out);
+
+// What the matching thread does when the writer's ring is full
+enum class AuditBackpressure {
+    Block,  // wait for the writer (matching stalls with the disk)
+    Spill,  // chain a spare ring segment and keep going; drop once none is left
+    Drop    // discard the event and count it
+};
+
+bool parseAuditBackpressure(const std::string &name, AuditBackpressure &mode);
+
+struct AuditConfig {
+    std::string directory;
+    std::string prefix = "audit";
+    uint64_t maxFileBytes = 64ULL << 20;  // rotate once a file reaches this size
+    size_t ringCapacity = 65536;          // events per ring segment
+    size_t spillSegments = 8;             // spare segments preallocated for Spill
+    AuditBackpressure backpressure = AuditBackpressure::Spill;
+};
+
+/**
+ * Audit trail writer. Attached to an OrderBook as its event listener, it
+ * turns every order, trade, cancel and reject into an AuditEvent and hands
+ * it to a background thread through a lock-free SPSC ring; the book lock
+ * serialises the callers, so they act as the single producer. The thread
+ * writes compressed blocks to rotating files named
+ * <prefix>-<start time>-<index>.bin in the configured directory.
+ *
+ * Spill segments come from a pool allocated up front, so the producer
+ * never allocates under the book lock. The writer hands each segment back
+ * through a second ring once it has drained it.
+ */
+class AuditWriter : public BookEventListener {
+public:
+    explicit AuditWriter(const AuditConfig &config);
+    ~AuditWriter() override;
+
+    AuditWriter(const AuditWriter&) = delete;
+    AuditWriter& operator=(const AuditWriter&) = delete;
+
+    // Opens the first file and starts the writer thread; false if the file can't be created
+    bool start();
+
+    // Writes everything queued so far and closes the current file
+    void stop();
+
+    void onOrder(const Order &o) override;
+    void onTrade(const Order &incoming, const Order &resting, double price, uint64_t quantity) override;
+    void onCancel(const Order &resting, uint64_t quantity, CancelReason reason) override;
+
+    uint64_t eventsWritten() const { return m_eventsWritten.load(std::memory_order_relaxed); }
+    uint64_t eventsDropped() const { return m_eventsDropped.load(std::memory_order_relaxed); }
+    uint64_t segmentsSpilled() const { return m_segmentsSpilled.load(std::memory_order_relaxed); }
+    uint64_t writeErrors() const { return m_writeErrors.load(std::memory_order_relaxed); }
+    uint32_t filesOpened() const { return m_fileIndex.load(std::memory_order_relaxed); }
+
+private:
+    struct Segment {
+        explicit Segment(size_t capacity) : ring(capacity) {}
+        SpscRing<AuditEvent> ring;
+        std::atomic<Segment*> next{nullptr};
+    };
+
+    static constexpr size_t kBlockEvents = 1024;
+
+    void push(const AuditEvent &e);     // producer side
+    bool pop(AuditEvent &e);            // writer thread
+    void run();
+    void writeBlock(const std::vector<AuditEvent> &events);
+    bool openNextFile();
+
+    AuditConfig m_config;
+    uint64_t m_startTimeSec = 0;
+
+    std::vector<std::unique_ptr<Segment>> m_segments;  // owns them all
+    SpscRing<Segment*> m_spareSegments;  // writer -> producer
+    Segment *m_head;                    // consumer-owned
+    Segment *m_tail;                    // producer-owned
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    // Writer-thread state
+    std::FILE *m_file = nullptr;
+    uint64_t m_fileBytes = 0;
+    std::atomic<uint32_t> m_fileIndex{0};
+    std::string m_encoded;
+
+    std::atomic<uint64_t> m_eventsWritten{0};
+    std::atomic<uint64_t> m_eventsDropped{0};
+    std::atomic<uint64_t> m_segmentsSpilled{0};
+    std::atomic<uint64_t> m_writeErrors{0};
+};
+
+/**
+ * Sequential reader for one audit file.
+ */
+class AuditReader {
+public:
+    explicit AuditReader(const std::string &path);
+    ~AuditReader();
+
+    AuditReader(const AuditReader&) = delete;
+    AuditReader& operator=(const AuditReader&) = delete;
+
+    // False if the file could not be opened or has no valid header
+    bool ok() const { return m_file != nullptr; }
+
+    // False at end of file or on a truncated/corrupt block
+    bool next(AuditEvent &e);
+
+private:
+    bool readBlock();
+
+    std::FILE *m_file = nullptr;
+    std::vector<AuditEvent> m_block;
+    size_t m_pos = 0;
+};
+
+#endif // AUDIT_LOG_HPP
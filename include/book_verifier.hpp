@@ -0,0 +1,276 @@
+#ifndef BOOK_VERIFIER_HPP
+#define BOOK_VERIFIER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "allocation.hpp"
+#include "order.hpp"
+#include "orderbook.hpp"
+#include "spsc_ring.hpp"
+
+enum class VerifierEventType : uint8_t {
+    OrderInput = 0,  // processOrder was called (the order as submitted)
+    ClockInput,      // expiry clock advanced
+    PhaseInput,      // call auction began or uncrossed (detail = TradingPhase)
+    Rest,            // an order joined the book
+    Trade,           // orderId traded with otherId (the resting order, or the ask in an uncross)
+    Cancel,          // a resting order lost quantity without trading (detail = CancelReason)
+    Outcome          // processOrder finished (detail = status code)
+};
+
+/**
+ * One input or book event as the verifier sees it. Fixed size and
+ * trivially copyable so it can travel through the ring by value.
+ */
+struct VerifierEvent {
+    uint64_t sequence = 0;       // arrival sequence of the input's order
+    uint64_t orderId = 0;
+    uint64_t otherId = 0;
+    uint64_t quantity = 0;       // submitted, open, traded or cancelled quantity
+    uint64_t filledQuantity = 0;
+    uint64_t remainingQuantity = 0;
+    uint64_t displayQuantity = 0;
+    uint64_t expireTimeMs = 0;
+    uint64_t nowMs = 0;          // inputs: the clock they were applied at
+    int64_t priceTicks = 0;
+    double stopPrice = 0.0;
+    uint32_t ownerId = 0;
+    VerifierEventType type = VerifierEventType::OrderInput;
+    OrderKind kind = OrderKind::Unknown;
+    Side side = Side::Unknown;
+    uint8_t detail = 0;
+};
+
+// A broken invariant or a disagreement with the reference matcher
+struct VerifierAlert {
+    uint64_t input = 0;     // inputs checked before this one
+    uint64_t sequence = 0;  // arrival sequence of the order being processed (0 for clock/phase inputs)
+    uint64_t orderId = 0;
+    std::string message;
+};
+
+// Book settings the reference matcher must share with the book it checks
+struct VerifierConfig {
+    SelfTradePrevention stp = SelfTradePrevention::None;
+    AllocationRules allocation;
+    PostOnlyMode postOnly = PostOnlyMode::Reject;
+    double tickSize = 0.01;
+    size_t ringCapacity = 65536;  // events queued for the checker
+};
+
+/**
+ * Reference model of one book, checked against the book's own event
+ * stream an input at a time.
+ *
+ * Each input is first run through a deliberately simple matcher (a map of
+ * price levels holding lists of orders) to predict its trades and outcome;
+ * the book's events are then applied to the model, checking as they go:
+ *   - every trade is with the best level of the other side, at the
+ *     resting order's price and within the incoming order's limit, and
+ *     under FIFO allocation with the front order of that level;
+ *   - quantities are conserved: no order trades or loses more than it has
+ *     open, and an order's fills and remainder add up to its quantity;
+ *   - after every input, the book is not crossed (outside a call auction)
+ *     and holds no order past its expiry.
+ * The prediction must match the book's trades and outcome exactly. Since
+ * the model follows the book's events rather than its own prediction, one
+ * bug raises alerts for the inputs it affects instead of every one after.
+ *
+ * Orders whose matching depends on self-trade prevention (a tagged order
+ * with a mode set) or on pro-rata allocation are not predicted; their
+ * events are still checked.
+ *
+ * Single-threaded: feed it events in the order the book made them.
+ */
+class ShadowMatcher {
+public:
+    using AlertFn = std::function<void(const VerifierAlert &alert)>;
+
+    ShadowMatcher(const VerifierConfig &config, AlertFn onAlert);
+
+    void process(const VerifierEvent &e);
+
+    // Checks the input still open (a clock or phase input is only closed
+    // by the next input)
+    void finish();
+
+    uint64_t inputsChecked() const { return m_inputs; }
+    uint64_t alertsRaised() const { return m_alerts; }
+    size_t restingOrders() const { return m_index.size(); }
+
+private:
+    struct ShadowOrder {
+        uint64_t id;
+        uint32_t ownerId;
+        Side side;
+        OrderKind kind;
+        int64_t ticks;
+        uint64_t slice;    // displayed
+        uint64_t hidden;   // iceberg reserve
+        uint64_t display;
+        uint64_t expireTimeMs;
+        uint64_t filled;
+    };
+    using Level = std::list<ShadowOrder>;
+    // Keyed so that begin() is the best level on either side
+    using Ladder = std::map<int64_t, Level>;
+
+    struct Fill {
+        uint64_t restingId;
+        uint64_t quantity;
+        int64_t ticks;
+    };
+
+    // What the reference expects of one input
+    struct Prediction {
+        bool valid = false;         // false: only the invariants are checked
+        Side side = Side::Unknown;  // of the order that may trade
+        int64_t limitTicks = 0;
+        bool passiveOnly = false;   // a post-only order, which must never trade
+        std::vector<Fill> fills;
+        OrderStatus status = OrderStatus::Other;
+        uint64_t filled = 0;
+        uint64_t remaining = 0;
+        uint64_t filledBefore = 0;  // a replaced order's fills before the replace
+        bool rests = false;
+        int64_t restTicks = 0;
+        bool checkQuantity = false; // kills: the number of orders cancelled
+        uint64_t quantity = 0;
+    };
+
+    // A new (or re-entered) order as execute() sees it
+    struct Entry {
+        OrderKind kind;
+        Side side;
+        int64_t limitTicks;
+        uint64_t quantity;
+        uint64_t expireTimeMs;
+        uint32_t ownerId;
+    };
+
+    int64_t keyOf(Side side, int64_t ticks) const { return side == Side::Buy ? -ticks : ticks; }
+    static int64_t ticksOf(Side side, int64_t key) { return side == Side::Buy ? -key : key; }
+    Ladder& ladder(Side side) { return m_sides[side == Side::Buy ? 0 : 1]; }
+    const Ladder& ladder(Side side) const { return m_sides[side == Side::Buy ? 0 : 1]; }
+    static Side opposite(Side side) { return side == Side::Buy ? Side::Sell : Side::Buy; }
+
+    // Whether an order on side `side` limited at limitTicks may trade at ticks
+    static bool withinLimit(Side side, int64_t ticks, int64_t limitTicks) {
+        return side == Side::Buy ? ticks <= limitTicks : ticks >= limitTicks;
+    }
+
+    bool bestTicks(Side side, int64_t &ticks) const;
+    ShadowOrder* find(uint64_t id);
+
+    void predict(Prediction &p);
+    void predictEntry(const Entry &entry, Prediction &p) const;
+    void restForAuction(const Entry &entry, Prediction &p) const;
+    bool stpApplies(uint32_t ownerId) const;
+
+    void beginInput(const VerifierEvent &e);
+    void endInput();
+    void checkOutcome(const VerifierEvent &e);
+    void applyTrade(const VerifierEvent &e);
+    void applyUncrossTrade(const VerifierEvent &e);
+    void applyCancel(const VerifierEvent &e);
+    void applyRest(const VerifierEvent &e);
+    void checkBook();
+
+    // Takes qty off the displayed slice; an exhausted slice is refilled
+    // from the reserve at the back of the level, or the order leaves
+    void consume(ShadowOrder &o, uint64_t qty);
+    void remove(uint64_t id);
+
+    void alert(const std::string &message);
+
+    VerifierConfig m_config;
+    int64_t m_tickTicks;
+    AlertFn m_onAlert;
+
+    Ladder m_sides[2];
+    std::unordered_map<uint64_t, Level::iterator> m_index;
+    std::multimap<uint64_t, uint64_t> m_expiries;  // expiry -> order id; stale entries skipped
+    TradingPhase m_phase = TradingPhase::Continuous;
+    uint64_t m_nowMs = 0;
+
+    // The input being checked and what it has done so far
+    bool m_open = false;
+    bool m_predicted = false;
+    bool m_outcome = false;
+    VerifierEvent m_input;
+    Prediction m_prediction;
+    std::vector<Fill> m_fills;
+    uint64_t m_traded = 0;
+    uint64_t m_decremented = 0;   // self-trade prevention took this off the incoming order
+    uint64_t m_rests = 0;
+    uint64_t m_restQuantity = 0;
+    int64_t m_uncrossTicks = 0;
+
+    uint64_t m_inputs = 0;
+    uint64_t m_alerts = 0;
+};
+
+/**
+ * Verification mode for a live book. Attached as the book's event
+ * listener and input journal (forwarding both to the ones it displaces),
+ * it copies every input and event into a lock-free SPSC ring; the book
+ * lock serialises the callers, so they act as the single producer. A
+ * background thread feeds them to a ShadowMatcher, so checking costs the
+ * matching thread one ring write per event. If the checker falls so far
+ * behind that the ring fills, verification stops (with an alert) rather
+ * than slow the book down.
+ */
+class BookVerifier : public BookEventListener, public InputJournal {
+public:
+    BookVerifier(const VerifierConfig &config, ShadowMatcher::AlertFn onAlert,
+                 BookEventListener *next = nullptr, InputJournal *nextJournal = nullptr);
+    ~BookVerifier() override;
+
+    BookVerifier(const BookVerifier&) = delete;
+    BookVerifier& operator=(const BookVerifier&) = delete;
+
+    void start();
+
+    // Checks everything queued so far, then stops the thread
+    void stop();
+
+    void onOrder(const Order &o) override;
+    void onRest(const Order &o) override;
+    void onTrade(const Order &incoming, const Order &resting, double price, uint64_t quantity) override;
+    void onCancel(const Order &resting, uint64_t quantity, CancelReason reason) override;
+
+    void onOrderInput(const Order &o, uint64_t nowMs) override;
+    void onClockInput(uint64_t nowMs) override;
+    void onPhaseInput(TradingPhase phase, uint64_t nowMs) override;
+
+    uint64_t inputsChecked() const { return m_inputsChecked.load(std::memory_order_relaxed); }
+    uint64_t alertsRaised() const { return m_alertsRaised.load(std::memory_order_relaxed); }
+    bool overflowed() const { return m_overflowed.load(std::memory_order_relaxed); }
+
+private:
+    void push(const VerifierEvent &e);  // producer side
+    void run();
+    void raise(const VerifierAlert &a);  // checker thread
+
+    ShadowMatcher::AlertFn m_onAlert;
+    ShadowMatcher m_shadow;             // checker thread
+    BookEventListener *m_next;
+    InputJournal *m_nextJournal;
+    SpscRing<VerifierEvent> m_ring;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_overflowed{false};
+    std::atomic<uint64_t> m_inputsChecked{0};
+    std::atomic<uint64_t> m_alertsRaised{0};
+};
+
+#endif // BOOK_VERIFIER_HPP
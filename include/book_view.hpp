@@ -0,0 +1,67 @@
+#ifndef BOOK_VIEW_HPP
+#define BOOK_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "price_ladder.hpp"
+
+class OrderBook;
+
+// Most levels per side the published depth view can hold
+constexpr size_t kBookViewLevels = 32;
+
+/**
+ * Aggregated depth (L2) as the book last published it, best level first.
+ * Plain data, so it sits behind a SeqLock and any thread can copy it out
+ * without the book lock.
+ */
+struct BookDepthView {
+    uint64_t version;     // publications so far
+    uint32_t bidLevels;
+    uint32_t askLevels;
+    DepthLevel bids[kBookViewLevels];
+    DepthLevel asks[kBookViewLevels];
+};
+
+/**
+ * Every resting order (L3), best level first and in time priority within
+ * a level. Built by the book on request and shared, immutable, between
+ * the readers that asked for it.
+ */
+struct BookSnapshot {
+    uint64_t version = 0;  // the depth view publication it matches
+    std::vector<RestingOrder> bids;
+    std::vector<RestingOrder> asks;
+};
+
+enum class DepthQueryType : uint8_t {
+    TopOfBook,  // "top_of_book"
+    Levels,     // "l2", aggregated depth to `levels`
+    Orders      // "l3", every resting order
+};
+
+struct DepthQuery {
+    // Longest request_id the decoder accepts; it is repeated in every part
+    static constexpr size_t kMaxRequestIdBytes = 64;
+
+    DepthQueryType type = DepthQueryType::TopOfBook;
+    size_t levels = 0;
+    std::string requestId;  // echoed in the response when set
+};
+
+// Groups an L3 side into at most `levels` price levels (displayed quantity)
+std::vector<DepthLevel> aggregateDepth(const std::vector<RestingOrder> &orders, size_t levels);
+
+/**
+ * Answers a query from the book's published views as JSON messages of
+ * at most about maxBytes each. Top of book and L2 within the view depth
+ * come from the depth view; deeper L2 and L3 from an order snapshot.
+ * Longer answers are split into parts ("part"/"parts"), each a complete
+ * object listing some of the levels or orders.
+ */
+std::vector<std::string> answerDepthQuery(OrderBook &book, const DepthQuery &query, size_t maxBytes = 1200);
+
+#endif // BOOK_VIEW_HPP
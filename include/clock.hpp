@@ -0,0 +1,75 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Time source for everything in the book that depends on the time of day
+ * (good-till-date expiry). The server uses the system clock; the
+ * simulator drives a SimulatedClock from the timestamps in its input so
+ * replays do not depend on when they run.
+ */
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    // Milliseconds since the Unix epoch
+    virtual uint64_t nowMs() const = 0;
+};
+
+class SystemClock : public Clock {
+public:
+    uint64_t nowMs() const override {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+};
+
+// Shared SystemClock instance
+inline const Clock& systemClock() {
+    static const SystemClock clock;
+    return clock;
+}
+
+class SimulatedClock : public Clock {
+public:
+    explicit SimulatedClock(uint64_t startMs = 0) : m_nowMs(startMs) {}
+
+    uint64_t nowMs() const override { return m_nowMs; }
+
+    // Sets the time; callers keep it monotonic
+    void set(uint64_t nowMs) { m_nowMs = nowMs; }
+
+private:
+    uint64_t m_nowMs;
+};
+
+/**
+ * Reads the system clock while live. A standby replaying its primary's
+ * input follows the primary's timestamps instead, and goes live when it
+ * takes over. Safe to read from any thread.
+ */
+class FollowerClock : public Clock {
+public:
+    uint64_t nowMs() const override {
+        return m_live.load(std::memory_order_acquire) ? systemClock().nowMs()
+                                                      : m_followMs.load(std::memory_order_acquire);
+    }
+
+    // Switches to (or stays on) the given time
+    void follow(uint64_t nowMs) {
+        m_followMs.store(nowMs, std::memory_order_release);
+        m_live.store(false, std::memory_order_release);
+    }
+
+    void goLive() { m_live.store(true, std::memory_order_release); }
+    bool live() const { return m_live.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint64_t> m_followMs{0};
+    std::atomic<bool> m_live{true};
+};
+
+#endif // CLOCK_HPP
@@ -0,0 +1,119 @@
+#ifndef CONFIRMATION_COALESCER_HPP
+#define CONFIRMATION_COALESCER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <netinet/in.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "orderbook.hpp"
+
+struct CoalescerConfig {
+    size_t maxDatagramBytes = 1400;   // stay under a typical Ethernet MTU
+    uint64_t flushDelayNs = 50000;    // longest a confirmation waits for company
+    size_t clientQueueLimit = 1024;   // confirmations buffered per destination
+    uint64_t clientRatePerSec = 0;    // confirmations per destination per second; 0 = unlimited
+};
+
+/**
+ * Per-destination output buffers for the confirmation sender. Several
+ * confirmations to one client go out as one datagram of newline-separated
+ * JSON objects, up to maxDatagramBytes. Execution reports are rendered
+ * into the datagram as it is packed, so their text is only ever built on
+ * the sender thread.
+ *
+ * Coalescing is adaptive: when the caller has nothing more queued, every
+ * buffer is flushed at once. Under a backlog a buffer goes out when it is
+ * full or when its oldest confirmation has waited flushDelayNs.
+ *
+ * Each destination may buffer up to clientQueueLimit confirmations and,
+ * with a rate set, send at most clientRatePerSec of them. Past the limit,
+ * confirmations are dropped and conflated into a single throttle notice
+ * ({"dropped_confirmations":"N","status":"throttled"}). The notice leads
+ * the client's next datagram. A slow client therefore costs bounded memory
+ * and never delays anyone else.
+ *
+ * Single-threaded: the sender thread owns it. Counters may be read from
+ * any thread.
+ */
+class ConfirmationCoalescer {
+public:
+    enum class SendResult {
+        Sent,
+        WouldBlock,   // kept and retried later
+        Failed        // dropped
+    };
+
+    // Sends one datagram
+    using SendFn = std::function<SendResult(const sockaddr_in &addr, socklen_t addrLen, const std::string &datagram)>;
+    // Called for each confirmation once its datagram has been sent (or failed),
+    // with the time it spent buffered
+    using SentFn = std::function<void(const Confirmation &c, uint64_t bufferedNs, bool ok)>;
+
+    ConfirmationCoalescer(const CoalescerConfig &config, SendFn send, SentFn sent = nullptr);
+
+    // Replaces the sent callback (e.g. once the sending thread has its counters)
+    void setSentCallback(SentFn sent) { m_sent = std::move(sent); }
+
+    // False if the destination was over its limit and c was conflated
+    bool add(const Confirmation &c, uint64_t nowNs);
+
+    // Sends what is due; idle means the caller has nothing more queued
+    void flush(uint64_t nowNs, bool idle);
+
+    // Sends everything buffered, ignoring rate limits (shutdown)
+    void flushAll(uint64_t nowNs);
+
+    bool pending() const { return !m_active.empty(); }
+
+    // Earliest time flush() has work to do, or UINT64_MAX
+    uint64_t nextDeadlineNs() const;
+
+    uint64_t datagramsSent() const { return m_datagramsSent.load(std::memory_order_relaxed); }
+    uint64_t confirmationsSent() const { return m_confirmationsSent.load(std::memory_order_relaxed); }
+    uint64_t confirmationsConflated() const { return m_confirmationsConflated.load(std::memory_order_relaxed); }
+    uint64_t throttleNotices() const { return m_throttleNotices.load(std::memory_order_relaxed); }
+
+private:
+    struct Pending {
+        Confirmation confirmation;
+        uint64_t queuedNs;
+    };
+
+    struct Destination {
+        sockaddr_in addr{};
+        socklen_t addrLen = 0;
+        std::deque<Pending> queue;
+        uint64_t conflated = 0;   // dropped since the last throttle notice
+        double tokens = 0.0;
+        uint64_t refillNs = 0;
+        bool active = false;      // listed in m_active
+    };
+
+    static uint64_t keyOf(const sockaddr_in &addr);
+    void refill(Destination &d, uint64_t nowNs) const;
+
+    // Sends datagrams for d while due; false if the socket would block
+    bool drain(Destination &d, uint64_t nowNs, bool idle, bool ignoreRate);
+
+    CoalescerConfig m_config;
+    SendFn m_send;
+    SentFn m_sent;
+
+    std::unordered_map<uint64_t, Destination> m_destinations;
+    std::vector<uint64_t> m_active;   // destinations with something to send
+    std::string m_datagram;           // scratch
+    uint64_t m_blockedUntilNs = 0;    // the socket would block; retry after this
+
+    std::atomic<uint64_t> m_datagramsSent{0};
+    std::atomic<uint64_t> m_confirmationsSent{0};
+    std::atomic<uint64_t> m_confirmationsConflated{0};
+    std::atomic<uint64_t> m_throttleNotices{0};
+};
+
+#endif // CONFIRMATION_COALESCER_HPP
@@ -0,0 +1,85 @@
+#ifndef INGRESS_PRIORITY_HPP
+#define INGRESS_PRIORITY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "order.hpp"
+
+// Whether a raw message is a cancel, replace or kill, judged from its
+// "type" field without decoding the rest
+bool isPriorityMessage(const char *text, size_t length);
+
+// Whether kind adds an order rather than acting on resting ones; only
+// these are shed under load
+bool isNewOrder(OrderKind kind);
+
+/**
+ * Load shedding: new orders are refused ("overloaded") rather than queued
+ * once the server is this far behind. Cancels, replaces and kills are
+ * never shed.
+ */
+struct LoadShedConfig {
+    uint64_t maxQueuedMessages = 0;  // messages ahead of one on arrival; 0 = off
+    uint64_t maxSojournNs = 0;       // wait from receipt to matching; 0 = off
+
+    bool shedOnArrival(OrderKind kind, uint64_t queuedMessages) const {
+        return maxQueuedMessages != 0 && queuedMessages >= maxQueuedMessages && isNewOrder(kind);
+    }
+    bool shedOnSojourn(OrderKind kind, uint64_t sojournNs) const {
+        return maxSojournNs != 0 && sojournNs > maxSojournNs && isNewOrder(kind);
+    }
+};
+
+/**
+ * The matcher's record of messages it applied ahead of their turn.
+ *
+ * A cancel, replace or kill reaches the matcher twice: an expedited copy
+ * ahead of the queue and the original in sequence. The expedited copy may
+ * be applied early only if that cannot reorder it against other messages
+ * for the same order: it must still be ahead of the sequence, and no
+ * earlier message for the order may be waiting for its turn (a cancel
+ * whose order has not rested yet, say). A cancel or replace is further
+ * only applied early when its order is resting, which the caller checks.
+ * Kills act on whole owners and are always applied early; their in-sequence
+ * copy runs again to catch orders that rested in between.
+ *
+ * Sequence numbers are tracked in a window of `window` past the last one
+ * taken in sequence; messages further ahead wait for their turn.
+ * Single-threaded: the matcher owns it.
+ */
+class EarlyApplyLedger {
+public:
+    explicit EarlyApplyLedger(size_t window);
+
+    // Whether the expedited copy o may be applied now
+    bool mayApplyEarly(const Order &o) const;
+
+    // o was applied early; its in-sequence copy will be skipped
+    void markApplied(const Order &o);
+
+    // o waits for its turn, and so does every later message for its order
+    void defer(const Order &o);
+
+    // Every message taken in sequence passes through here; true if it was
+    // already applied early
+    bool takeInSequence(const Order &o);
+
+    uint64_t nextSequence() const { return m_next; }
+    size_t deferredOrders() const { return m_deferred.size(); }
+
+private:
+    bool applied(uint64_t sequence) const {
+        size_t bit = sequence % m_window;
+        return (m_applied[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    size_t m_window;
+    uint64_t m_next = 0;
+    std::vector<uint64_t> m_applied;                      // bitmap by sequence mod window
+    std::unordered_map<uint64_t, uint64_t> m_deferred;   // order id -> last deferred sequence
+};
+
+#endif // INGRESS_PRIORITY_HPP
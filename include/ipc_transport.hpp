@@ -0,0 +1,251 @@
+#ifndef IPC_TRANSPORT_HPP
+#define IPC_TRANSPORT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "order.hpp"
+
+/**
+ * Shared-memory order entry for processes on the same host as the server.
+ *
+ * The server creates one segment (/dev/shm/<name>) holding a fixed number
+ * of client slots. A client claims a free slot and gets a pair of
+ * lock-free single-producer/single-consumer rings in it: orders in,
+ * reports out. Both sides use the fixed-size IpcOrder and IpcReport
+ * records below, so nothing is parsed or formatted on the way and a
+ * round trip is a few cache-line transfers plus the match itself.
+ *
+ * The server polls the request rings with a busy-spinning thread while
+ * any client is attached. A client that exits without detaching is
+ * reclaimed once its process is gone; reports for its resting orders are
+ * then discarded rather than delivered to the slot's next owner.
+ */
+
+constexpr uint64_t kIpcMagic = 0x4f42495043303031ull;  // "OBIPC001"
+constexpr uint32_t kIpcVersion = 1;
+constexpr std::size_t kIpcRequestCapacity = 1024;
+constexpr std::size_t kIpcReportCapacity = 4096;
+
+// One order (or cancel), client to server
+struct IpcOrder {
+    uint64_t orderId;
+    uint64_t quantity;
+    uint64_t displayQuantity;
+    uint64_t expireTimeMs;
+    uint64_t userData;      // echoed in the order's own report
+    double price;
+    double stopPrice;
+    uint32_t ownerId;
+    OrderKind kind;
+    Side side;
+    uint8_t reserved[2];
+};
+
+// One order outcome, server to client
+struct IpcReport {
+    uint64_t orderId;
+    uint64_t filledQuantity;
+    uint64_t remainingQuantity;
+    uint64_t userData;      // from the order; 0 for expiries and auction fills
+    double averagePrice;
+    uint8_t status;         // orderStatusCode(); orderStatusName() for the text
+    uint8_t passive;        // 1 for a resting order's fill (ExecutionReport::passive)
+    uint8_t reserved[6];
+};
+
+static_assert(sizeof(IpcOrder) == 64, "IpcOrder is part of the shared layout");
+static_assert(sizeof(IpcReport) == 48, "IpcReport is part of the shared layout");
+
+// Shared-memory orders take arrival sequence numbers from here up, clear
+// of the receiver's
+constexpr uint64_t kIpcSequenceBase = 1ULL << 62;
+
+IpcOrder toIpcOrder(const Order &o, uint64_t userData = 0);
+Order fromIpcOrder(const IpcOrder &msg);
+IpcReport toIpcReport(const Order &o, uint64_t filledQuantity, double averagePrice, uint64_t userData = 0);
+
+/**
+ * SPSC ring laid out in place, for use inside a shared mapping. Same
+ * scheme as SpscRing: each side caches the other's index on its own
+ * cache line. All-zero bytes are a valid empty ring.
+ */
+template <typename T, std::size_t Capacity>
+struct IpcRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices must be address-free");
+
+    // Producer side; false if the ring is full
+    bool tryPush(const T &item) {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity) {
+                return false;
+            }
+        }
+        m_slots[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; false if the ring is empty
+    bool tryPop(T &out) {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        out = m_slots[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    // Only while neither side is using the ring
+    void reset() {
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_cachedTail = 0;
+        m_cachedHead = 0;
+    }
+
+private:
+    // Consumer-owned line
+    alignas(64) std::atomic<uint64_t> m_head;
+    uint64_t m_cachedTail;
+
+    // Producer-owned line
+    alignas(64) std::atomic<uint64_t> m_tail;
+    uint64_t m_cachedHead;
+
+    alignas(64) T m_slots[Capacity];
+};
+
+enum class IpcSlotState : uint32_t {
+    Free = 0,     // claimable
+    Attached,     // a client owns it
+    Detached      // the client left; the server resets it to Free
+};
+
+struct IpcSlot {
+    alignas(64) std::atomic<uint32_t> state;
+    std::atomic<uint32_t> generation;      // bumped by the server on every reclaim
+    std::atomic<int32_t> pid;              // owning client process
+    std::atomic<uint64_t> reportsDropped;  // reports lost to a full report ring
+    IpcRing<IpcOrder, kIpcRequestCapacity> requests;
+    IpcRing<IpcReport, kIpcReportCapacity> reports;
+};
+
+struct IpcSegmentHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    std::atomic<int32_t> serverPid;
+};
+
+// Slots start on a cache-line boundary after the header
+constexpr std::size_t kIpcHeaderBytes = 64;
+static_assert(sizeof(IpcSegmentHeader) <= kIpcHeaderBytes, "header overflows its line");
+
+/**
+ * Server side: creates the segment and polls every attached client.
+ * poll() and reap() belong to one thread. sendReport() may be called from
+ * any server thread; reports to one client are serialised by a lock kept
+ * in this process.
+ */
+class IpcServer {
+public:
+    // Handles one order from the client identified by the token
+    using OrderFn = std::function<void(uint32_t client, const IpcOrder &msg)>;
+
+    IpcServer(const std::string &name, std::size_t slots);
+    ~IpcServer();
+
+    IpcServer(const IpcServer&) = delete;
+    IpcServer& operator=(const IpcServer&) = delete;
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    // Takes up to budget orders from each attached client; returns how many
+    std::size_t poll(const OrderFn &onOrder, std::size_t budget = 16);
+
+    // Queues a report for the client token; false if the client is gone or
+    // its report ring is full (counted in the slot's reportsDropped)
+    bool sendReport(uint32_t client, const IpcReport &report);
+
+    // Frees the slots of clients that detached or died. New clients are
+    // picked up by poll().
+    void reap();
+
+    std::size_t attachedClients() const { return m_attached.load(std::memory_order_relaxed); }
+    uint64_t ordersReceived() const { return m_ordersReceived.load(std::memory_order_relaxed); }
+    uint64_t reportsSent() const { return m_reportsSent.load(std::memory_order_relaxed); }
+    uint64_t reportsDropped() const { return m_reportsDropped.load(std::memory_order_relaxed); }
+
+private:
+    // Server-local view of a slot
+    struct SlotControl {
+        std::mutex reportMutex;                // serialises report producers
+        std::atomic<uint32_t> token{0};        // current owner's token, 0 = none
+    };
+
+    IpcSlot* slot(std::size_t i) const;
+    void adopt(std::size_t i);
+    void release(std::size_t i);
+
+    std::string m_name;
+    std::size_t m_slotCount;
+    std::size_t m_mappedBytes = 0;
+    IpcSegmentHeader *m_header = nullptr;
+    std::unique_ptr<SlotControl[]> m_control;
+
+    std::atomic<std::size_t> m_attached{0};
+    std::atomic<uint64_t> m_ordersReceived{0};
+    std::atomic<uint64_t> m_reportsSent{0};
+    std::atomic<uint64_t> m_reportsDropped{0};
+};
+
+/**
+ * Client side: attaches to a server's segment and owns one slot.
+ * submit() and poll() may be used from different threads (one each).
+ */
+class IpcClient {
+public:
+    IpcClient() = default;
+    ~IpcClient();
+
+    IpcClient(const IpcClient&) = delete;
+    IpcClient& operator=(const IpcClient&) = delete;
+
+    // Claims a free slot; false if the segment is missing or full
+    bool attach(const std::string &name);
+    void detach();
+    bool attached() const { return m_slot != nullptr; }
+
+    // False if the request ring is full
+    bool submit(const IpcOrder &msg);
+
+    // False if no report is waiting
+    bool poll(IpcReport &out);
+
+    // Reports the server had to discard because this client fell behind
+    uint64_t reportsDropped() const;
+
+private:
+    void *m_mapping = nullptr;
+    std::size_t m_mappedBytes = 0;
+    IpcSlot *m_slot = nullptr;
+};
+
+#endif // IPC_TRANSPORT_HPP
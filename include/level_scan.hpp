@@ -0,0 +1,35 @@
+#ifndef LEVEL_SCAN_HPP
+#define LEVEL_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Kernels over the per-level aggregate quantities of one side of the book.
+ * The arrays are stored worst level first, best level last, so every kernel
+ * walks from the back. Quantities must stay below 2^63 (the AVX2 compare
+ * is signed).
+ *
+ * The dispatching entry points pick the AVX2 variant at runtime when the CPU
+ * supports it and fall back to the scalar variant otherwise.
+ */
+
+// Number of levels (counted from the best) needed before the cumulative
+// quantity reaches target, or n if it never does. The cumulative quantity
+// over those levels is written to *cumulative.
+size_t levelsToFill(const uint64_t *qty, size_t n, uint64_t target, uint64_t *cumulative);
+
+// Cumulative quantity of the best min(levels, n) levels, best first, written
+// to out. Returns the number of entries written.
+size_t cumulativeDepth(const uint64_t *qty, size_t n, size_t levels, uint64_t *out);
+
+// Explicit variants, exposed for tests and benchmarks
+size_t levelsToFillScalar(const uint64_t *qty, size_t n, uint64_t target, uint64_t *cumulative);
+size_t cumulativeDepthScalar(const uint64_t *qty, size_t n, size_t levels, uint64_t *out);
+size_t levelsToFillAvx2(const uint64_t *qty, size_t n, uint64_t target, uint64_t *cumulative);
+size_t cumulativeDepthAvx2(const uint64_t *qty, size_t n, size_t levels, uint64_t *out);
+
+// True when the dispatching entry points use the AVX2 variants
+bool levelScanUsesAvx2();
+
+#endif // LEVEL_SCAN_HPP
@@ -0,0 +1,160 @@
+#ifndef MEMORY_PLAN_HPP
+#define MEMORY_PLAN_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#include "seqlock.hpp"
+
+/**
+ * Memory reserved at startup, so the hot path neither allocates nor takes
+ * first-touch page faults while trading.
+ *
+ * A MemoryArena is one anonymous mapping, backed by huge pages when the
+ * system has them to give (fewer TLB misses over a deep book) and by
+ * regular pages otherwise. Either way every page is touched up front.
+ * NodePool recycles fixed-size blocks carved from an arena; PoolAllocator
+ * lets node-based standard containers draw from one.
+ */
+
+enum class HugePages : uint8_t {
+    Off,     // regular pages
+    Auto,    // 2 MB pages if reserved on the system, else transparent huge pages
+    Huge2M,
+    Huge1G   // falls back to 2 MB, then regular pages
+};
+
+// "off", "auto", "2m", "1g"
+bool parseHugePages(const std::string &name, HugePages &policy);
+
+// What the book reserves (see OrderBook::reserveMemory)
+struct MemoryPlan {
+    size_t orders = 0;       // resting orders across both sides; 0 = grow on demand
+    size_t levels = 0;       // price levels per side
+    HugePages hugePages = HugePages::Auto;
+};
+
+// Reserved memory as the stats publisher reports it
+struct MemoryUsage {
+    uint64_t arenaBytes = 0;      // mapped at startup
+    uint64_t arenaUsedBytes = 0;  // handed out so far
+    uint64_t pageBytes = 0;       // page size backing the arena
+    uint64_t nodesInUse = 0;      // pool blocks currently allocated
+    uint64_t heapFallbacks = 0;   // node requests the arena could not serve
+};
+
+class MemoryArena {
+public:
+    MemoryArena() = default;
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    // Maps at least `bytes` and prefaults it. False if nothing could be
+    // mapped; the arena then stays empty. Call once.
+    bool reserve(size_t bytes, HugePages policy);
+
+    // Bump allocation; nullptr once exhausted. Single-threaded.
+    void* allocate(size_t bytes, size_t align = kCacheLineSize);
+
+    bool contains(const void *p) const {
+        const char *c = static_cast<const char*>(p);
+        return c >= m_base && c < m_base + m_capacity;
+    }
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used.load(std::memory_order_relaxed); }
+    size_t pageSize() const { return m_pageSize; }   // 0 until reserved
+
+private:
+    char *m_base = nullptr;
+    size_t m_capacity = 0;
+    size_t m_pageSize = 0;
+    std::atomic<size_t> m_used{0};   // read by the stats publisher
+};
+
+/**
+ * Fixed-size blocks from an arena, with a free list per block size. Any
+ * request the arena cannot satisfy goes to the heap and is counted.
+ * Not thread-safe; the owner serialises use (the book uses it under its
+ * lock).
+ */
+class NodePool {
+public:
+    explicit NodePool(MemoryArena *arena) : m_arena(arena) {}
+    ~NodePool();
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    void* allocate(size_t bytes);
+    void deallocate(void *p, size_t bytes);
+
+    uint64_t blocksInUse() const { return m_inUse.load(std::memory_order_relaxed); }
+    uint64_t heapFallbacks() const { return m_heapFallbacks.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kGranule = 16;
+    static constexpr size_t kClassCount = 32;          // blocks up to 512 bytes
+    static constexpr size_t kChunkBytes = 64 * 1024;   // carved from the arena per class
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    struct SizeClass {
+        FreeBlock *free = nullptr;
+        char *chunk = nullptr;    // unused tail of the last chunk
+        char *chunkEnd = nullptr;
+    };
+
+    MemoryArena *m_arena;
+    SizeClass m_classes[kClassCount];
+    std::atomic<uint64_t> m_inUse{0};
+    std::atomic<uint64_t> m_heapFallbacks{0};
+};
+
+/**
+ * Standard allocator drawing single nodes from a NodePool. Arrays (hash
+ * buckets, vectors) and a default-constructed allocator use the heap.
+ */
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    PoolAllocator() = default;
+    explicit PoolAllocator(NodePool *p) : pool(p) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other) : pool(other.pool) {}
+
+    T* allocate(size_t n) {
+        if (pool && n == 1 && alignof(T) <= 16) {
+            return static_cast<T*>(pool->allocate(sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (pool && n == 1 && alignof(T) <= 16) {
+            pool->deallocate(p, sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    NodePool *pool = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.pool == b.pool; }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.pool != b.pool; }
+
+#endif // MEMORY_PLAN_HPP
@@ -0,0 +1,41 @@
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "stats.hpp"
+
+/**
+ * Minimal HTTP endpoint bound to 127.0.0.1 that answers every request with
+ * the latest published StatsSnapshot in Prometheus text format. It only
+ * reads the shared stats block, never the live counters.
+ */
+class MetricsServer {
+public:
+    explicit MetricsServer(const SharedStatsBlock *block);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Binds the loopback port and starts serving; returns false on failure
+    bool start(uint16_t port);
+    void stop();
+
+    // Bound port (useful when started with port 0)
+    uint16_t port() const { return m_port; }
+
+private:
+    void serveLoop();
+    void handleClient(int clientSock);
+
+    const SharedStatsBlock *m_block;
+    int m_listenSock = -1;
+    uint16_t m_port = 0;
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+};
+
+#endif // METRICS_SERVER_HPP
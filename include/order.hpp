@@ -2,33 +2,122 @@
 #define ORDER_HPP
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <netinet/in.h>
 #include <string>
 
+/**
+ * Order type and side, decoded once from the wire strings so the matching
+ * path never compares strings. The numeric values index the OrderBook
+ * dispatch table.
+ */
+enum class OrderKind : uint8_t {
+    Limit = 0,
+    Market,
+    IOC,
+    FOK,
+    PostOnly,
+    StopLoss,
+    Cancel,
+    Unknown,
+    Query,      // depth/snapshot requests; answered before matching, never reach the book
+    Replace,    // new price and open quantity for the resting order order_id
+    Kill,       // cancels every resting order of owner_id (kill switch)
+    Count
+};
+
+enum class Side : uint8_t {
+    Buy = 0,
+    Sell,
+    Unknown,
+    Count
+};
+
+OrderKind orderKindFromString(const std::string &type);
+Side sideFromString(const std::string &action);
+
+// Wire strings for a decoded kind/side ("unknown" if not one)
+const char* orderKindName(OrderKind kind);
+const char* sideName(Side side);
+
+/**
+ * Outcome of an order, set by the book where it is decided. The numeric
+ * values are the status codes of fixed-size records and audit files:
+ * append only.
+ */
+enum class OrderStatus : uint8_t {
+    Other = 0,
+    Open,
+    Executed,
+    PartiallyFilled,
+    Cancelled,
+    IocNoFill,
+    FokNoFill,
+    PostOnlyRejected,
+    Repriced,
+    StpCancelled,
+    Expired,
+    Rejected,
+    CancelRejected,
+    AuctionRejected,
+    Replaced,
+    ReplaceRejected,
+    Killed,
+    Overloaded,
+    Count
+};
+
+inline uint8_t orderStatusCode(OrderStatus status) { return static_cast<uint8_t>(status); }
+
+// Parses a wire status name; unknown names map to 0 ("other")
+uint8_t orderStatusCode(const char *status, size_t length);
+
+// Wire names, for rendering only ("other" if not a status)
+const char* orderStatusName(uint8_t code);
+inline const char* orderStatusName(OrderStatus status) { return orderStatusName(orderStatusCode(status)); }
+
 /**
  * Order struct capturing all relevant fields, including
  * partial fill tracking and extended attributes.
  */
 struct Order {
     uint64_t orderId;
-    std::string type;    // "market", "limit", "cancel", "stop-loss", "ioc", "fok", ...
+    std::string type;    // "market", "limit", "cancel", "stop-loss", "ioc", "fok", "post-only", "replace", "kill"
     std::string action;  // "buy" or "sell"
+    OrderKind kind;      // decoded from type by classify()
+    Side side;           // decoded from action by classify()
     double price;
     uint64_t quantity;
+    uint32_t ownerId;    // account/owner tag for self-trade prevention, 0 = untagged
 
     // Additional tracking
     uint64_t remainingQuantity;
-    std::string status;
+    uint64_t filledQuantity;
+    double filledNotional;  // price x quantity summed over its fills
+    OrderStatus status;
     bool isStopOrder;
     double stopPrice;
 
+    // Iceberg: displayQuantity > 0 shows only that much at a time; the rest
+    // of a resting order is kept in hiddenQuantity
+    uint64_t displayQuantity;
+    uint64_t hiddenQuantity;
+
+    // Good-till-date: expiry in milliseconds since the Unix epoch, 0 = none
+    uint64_t expireTimeMs;
+
+    // Arrival order assigned by the receiver, restored before matching
+    // (shared-memory orders count from kIpcSequenceBase)
+    uint64_t sequence;
+
     // Timestamps
     std::chrono::time_point<std::chrono::high_resolution_clock> recvTimestamp;
 
     // For sending confirmations back
     sockaddr_in clientAddr{};
     socklen_t clientAddrLen;
+    uint32_t ipcClient;  // shared-memory client token (ipc_transport.hpp), 0 = network
 
     // Constructors
     Order();
@@ -38,9 +127,14 @@ struct Order {
           double price,
           uint64_t quantity);
 
+    // Re-derives kind and side after type/action were assigned directly
+    void classify();
+
     // Utility
-    bool isBuy() const { return action == "buy"; }
-    bool isSell() const { return action == "sell"; }
+    bool isBuy() const { return side == Side::Buy; }
+    // Volume-weighted price of its fills, 0 if none
+    double averagePrice() const { return filledQuantity > 0 ? filledNotional / filledQuantity : 0.0; }
+    bool isSell() const { return side == Side::Sell; }
 };
 
 #endif // ORDER_HPP
@@ -0,0 +1,172 @@
+#ifndef ORDER_CLIENT_HPP
+#define ORDER_CLIENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ipc_transport.hpp"
+#include "order.hpp"
+
+/**
+ * Order entry for programs that trade against the server: submit, cancel
+ * and replace without blocking, and poll for the reports.
+ *
+ * Every request returns a handle (0 if refused) that comes back on the
+ * report answering it; a submit's handle is also the new order's id.
+ * Requests are encoded straight into an outgoing datagram, one per line,
+ * and go out on flush() or when the datagram is full. Over shared memory
+ * (attachIpc) each goes to the request ring at once instead. Orders sit in
+ * a fixed-size table from submit until the server reports them done, so
+ * the steady state neither allocates nor formats through strings.
+ *
+ * The server reports an order when a request for it is processed, and
+ * unsolicited when it trades while resting (a passive fill), trades in an
+ * uncross, expires or is killed. A resting order leaves the table once a
+ * report shows it filled or gone.
+ *
+ * Not thread-safe: one thread (or the caller's lock) drives a client.
+ */
+
+using RequestHandle = uint64_t;
+
+enum class RequestType : uint8_t {
+    None,      // unsolicited report (passive fill, expiry, auction fill)
+    Submit,
+    Cancel,
+    Replace
+};
+
+struct OrderRequest {
+    OrderKind kind = OrderKind::Limit;  // Limit, Market, IOC, FOK, PostOnly or StopLoss
+    Side side = Side::Buy;
+    double price = 0.0;
+    uint64_t quantity = 0;
+    double stopPrice = 0.0;          // stop-loss trigger
+    uint64_t displayQuantity = 0;    // iceberg slice; 0 = fully visible
+    uint64_t expireTimeMs = 0;       // good-till-date, ms since the epoch; 0 = none
+};
+
+struct ClientReport {
+    RequestHandle request = 0;       // the request answered; 0 if unsolicited
+    RequestType requestType = RequestType::None;
+    uint64_t orderId = 0;
+    uint64_t filledQuantity = 0;
+    uint64_t remainingQuantity = 0;
+    double averagePrice = 0.0;
+    uint8_t status = 0;              // orderStatusCode(); orderStatusName() for the text
+    bool passive = false;            // a fill while resting (always unsolicited)
+    bool done = false;               // the order has left the in-flight table
+};
+
+// An order as the client last heard of it
+struct InFlightOrder {
+    static constexpr size_t kMaxPending = 4;
+
+    uint64_t orderId = 0;            // 0 = free table slot
+    OrderKind kind = OrderKind::Limit;
+    Side side = Side::Buy;
+    uint8_t status = 0;              // last reported; 0 until the first report
+    uint8_t pendingCount = 0;
+    double price = 0.0;
+    uint64_t filledQuantity = 0;
+    uint64_t remainingQuantity = 0;
+    RequestHandle pending[kMaxPending];   // sent and unanswered, oldest first
+    RequestType pendingType[kMaxPending];
+};
+
+struct OrderClientConfig {
+    uint32_t ownerId = 0;            // tags every order when non-zero
+    size_t maxOrders = 4096;         // in-flight table capacity
+    size_t maxDatagramBytes = 1400;  // outgoing batch; the server reads up to 2048
+    RequestHandle firstHandle = 1;   // must not repeat a live order id on the server
+};
+
+class OrderClient {
+public:
+    explicit OrderClient(const OrderClientConfig &config = OrderClientConfig());
+    ~OrderClient();
+
+    OrderClient(const OrderClient&) = delete;
+    OrderClient& operator=(const OrderClient&) = delete;
+
+    // UDP to the server at ip:port, or its shared-memory segment; one of them
+    bool connect(const std::string &ip, int port, std::string *error = nullptr);
+    bool attachIpc(const std::string &name);
+    void close();
+
+    // Queue a request; 0 if refused (not connected, table or pending
+    // requests full, unknown order, invalid values, or the transport is
+    // backed up)
+    RequestHandle submit(const OrderRequest &request);
+    RequestHandle cancel(uint64_t orderId);
+    RequestHandle replace(uint64_t orderId, double price, uint64_t quantity);
+
+    // Sends the batched requests; false (keeping them) if the socket is full
+    bool flush();
+
+    // Next report that has arrived, without blocking; false if none
+    bool poll(ClientReport &out);
+
+    // Hands every report that has arrived to onReport; returns how many
+    template <typename Fn>
+    size_t pollAll(Fn &&onReport) {
+        size_t n = 0;
+        ClientReport report;
+        while (poll(report)) {
+            onReport(report);
+            n++;
+        }
+        return n;
+    }
+
+    const InFlightOrder* find(uint64_t orderId) const;
+    size_t inFlight() const { return m_inFlight; }
+    size_t batchedBytes() const { return m_batchLength; }
+    uint64_t unknownReports() const { return m_unknownReports; }  // for orders not in the table
+    uint64_t otherMessages() const { return m_otherMessages; }    // throttle notices, depth answers
+
+private:
+    InFlightOrder* lookup(uint64_t orderId);
+    InFlightOrder* insert(uint64_t orderId);
+    void erase(InFlightOrder *entry);
+    bool addPending(InFlightOrder *entry, RequestHandle handle, RequestType type);
+
+    // Reserves room for one request line in the batch (flushing if needed)
+    char* lineBuffer(size_t &capacity);
+    void commitLine(size_t length);
+
+    void apply(ClientReport &report, uint64_t userData);
+
+    OrderClientConfig m_config;
+    RequestHandle m_nextHandle;
+
+    int m_sock = -1;
+    IpcClient m_ipc;
+
+    std::vector<InFlightOrder> m_table;   // open addressing, power-of-two size
+    size_t m_inFlight = 0;
+
+    std::vector<char> m_batch;
+    size_t m_batchLength = 0;
+
+    std::vector<char> m_received;         // last datagram read
+    size_t m_receivedLength = 0;
+    size_t m_receivedOffset = 0;
+
+    uint64_t m_unknownReports = 0;
+    uint64_t m_otherMessages = 0;
+};
+
+// Request encodings (one JSON object, no newline) written into out; each
+// returns the length, or 0 if more than capacity bytes would be needed
+size_t encodeSubmit(char *out, size_t capacity, uint64_t orderId, uint32_t ownerId, const OrderRequest &r);
+size_t encodeCancel(char *out, size_t capacity, uint64_t orderId);
+size_t encodeReplace(char *out, size_t capacity, uint64_t orderId, double price, uint64_t quantity);
+
+// Reads one confirmation line into out (order id, quantities, price,
+// status); false if it is not an order report
+bool decodeReport(const char *line, size_t length, ClientReport &out);
+
+#endif // ORDER_CLIENT_HPP
@@ -0,0 +1,48 @@
+#ifndef ORDER_CODEC_HPP
+#define ORDER_CODEC_HPP
+
+#include <string>
+#include <string_view>
+
+#include "book_view.hpp"
+#include "order.hpp"
+
+/**
+ * Decodes one JSON order message into o (type/action classified).
+ *
+ * Numbers are parsed without exceptions and the order is validated for its
+ * type: a known type and side, a positive quantity, a positive price for
+ * priced types and a stop price for stop-loss, both below kMaxPrice. A
+ * cancel needs only its order_id, a replace its order_id, price and
+ * quantity, and a kill its order_id and a non-zero owner_id. A message
+ * that fails leaves o with kind Unknown and status "rejected", so the book
+ * answers it like any other unroutable order; *error (if given) receives
+ * the reason.
+ */
+bool decodeOrderMessage(const std::string &json, Order &o, std::string *error = nullptr);
+
+/**
+ * The value checks decodeOrderMessage applies once the fields are parsed,
+ * for orders that arrive already decoded (shared memory): a known type
+ * and side, a positive quantity, a price in [0, kMaxPrice) that is
+ * positive for priced types, a stop price for stop-loss, an owner for a
+ * kill. On failure o is left as decodeOrderMessage leaves it.
+ */
+bool validateOrder(Order &o, std::string *error = nullptr);
+
+/**
+ * Like decodeOrderMessage, but also accepts depth queries: type
+ * "top_of_book", "l2" (with a positive "levels") or "l3", each with an
+ * optional "request_id" of up to DepthQuery::kMaxRequestIdBytes. A query fills `query` and leaves o with kind
+ * Query; it carries no order id.
+ */
+bool decodeInboundMessage(const std::string &json, Order &o, DepthQuery &query, std::string *error = nullptr);
+
+/**
+ * Whole-string decimal price, as the decoders accept it: finite,
+ * non-negative and below kMaxPrice. Shared with the replay loader so both
+ * inputs bound prices the same way.
+ */
+bool parsePrice(std::string_view text, double &out);
+
+#endif // ORDER_CODEC_HPP
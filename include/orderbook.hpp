@@ -6,41 +6,155 @@
 #include <condition_variable>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <netinet/in.h>
-#include <queue>
 #include <string>
 #include <vector>
 
+#include "allocation.hpp"
+#include "book_view.hpp"
+#include "clock.hpp"
+#include "memory_plan.hpp"
 #include "order.hpp"
+#include "price_ladder.hpp"
+#include "seqlock.hpp"
+#include "timer_wheel.hpp"
 
 /**
- * Priority comparators
+ * What to do when an incoming order would trade with a resting order
+ * carrying the same non-zero ownerId.
  */
-struct BuyOrderComparator {
-    bool operator()(const Order &a, const Order &b) const;
+enum class SelfTradePrevention {
+    None,          // allow self-trades
+    CancelNewest,  // cancel the incoming order's remainder
+    CancelOldest,  // cancel the resting order and keep matching
+    CancelBoth,    // cancel both
+    Decrement      // reduce both by the smaller quantity without a trade
 };
 
-struct SellOrderComparator {
-    bool operator()(const Order &a, const Order &b) const;
+// Parses "none", "cancel-newest", "cancel-oldest", "cancel-both", "decrement"
+bool parseSelfTradePrevention(const std::string &name, SelfTradePrevention &mode);
+
+// What a post-only order does if it would trade on arrival
+enum class PostOnlyMode {
+    Reject,   // reject it
+    Reprice   // rest it one tick behind the opposite touch
+};
+
+// Continuous matching, or a call auction collecting orders for an uncross
+enum class TradingPhase : uint8_t {
+    Continuous,
+    Auction
+};
+
+/**
+ * Outcome of an uncross: the price and volume, and every order that
+ * traded, as it stands afterwards.
+ */
+struct AuctionResult {
+    bool crossed = false;   // false: nothing traded
+    double price = 0.0;
+    uint64_t volume = 0;
+    int64_t surplus = 0;    // bid minus ask quantity willing to trade at the price
+    std::vector<Order> filled;
 };
 
+/**
+ * An order's outcome as the matching thread reports it. Fixed size and
+ * free of text, so reporting costs the matcher a few stores; the sender
+ * renders it into the client's wire format (appendExecutionReportJson).
+ */
+struct ExecutionReport {
+    uint64_t orderId = 0;
+    uint64_t filledQuantity = 0;
+    uint64_t remainingQuantity = 0;
+    double averagePrice = 0.0;
+    uint8_t status = 0;     // orderStatusCode()
+    bool passive = false;   // a resting order's fill, not the answer to a request
+};
+
+ExecutionReport makeExecutionReport(const Order &o, uint64_t filledQuantity, double avgPrice);
+
+// Appends r as a JSON confirmation object
+void appendExecutionReportJson(std::string &out, const ExecutionReport &r);
+
 struct Confirmation {
-    sockaddr_in clientAddr;
+    sockaddr_in clientAddr;             // destination
     socklen_t clientAddrLen;
-    std::string message;
+    ExecutionReport report;
+    std::string message;    // ready-made text sent instead of report (e.g. depth answers)
+    bool traced = false;    // answers a sampled order (see tracing.hpp)
+    uint64_t sequence = 0;  // that order's arrival sequence
+};
+
+// Appends c in its wire format: message if set, otherwise the report
+void appendConfirmationText(std::string &out, const Confirmation &c);
+
+// Why a resting order left the book (or shrank) without trading
+enum class CancelReason : uint8_t {
+    Requested,  // a cancel message named it
+    SelfTrade,  // self-trade prevention cancelled or decremented it
+    Expired,    // its good-till-date passed
+    Killed      // a kill message named its owner
+};
+
+/**
+ * Observer for every change the book makes. Calls are made synchronously
+ * under the book lock, so they arrive in one total order even when
+ * several threads drive the book; implementations must be quick and must
+ * not call back into the OrderBook.
+ */
+class BookEventListener {
+public:
+    virtual ~BookEventListener() = default;
+
+    // An order finished processing; o.status holds the outcome (including rejects)
+    virtual void onOrder(const Order &o) { (void)o; }
+
+    // o joined the back of its price level, at o.price with o.remainingQuantity
+    // open (an iceberg's reserve included)
+    virtual void onRest(const Order &o) { (void)o; }
+
+    // incoming traded quantity with resting at price (the resting order's price)
+    virtual void onTrade(const Order &incoming, const Order &resting, double price, uint64_t quantity) {
+        (void)incoming; (void)resting; (void)price; (void)quantity;
+    }
+
+    // A resting order lost quantity without trading
+    virtual void onCancel(const Order &resting, uint64_t quantity, CancelReason reason) {
+        (void)resting; (void)quantity; (void)reason;
+    }
+};
+
+/**
+ * Receives every input the book applies, with the clock reading it was
+ * applied at, under the book lock and before it takes effect. Replaying
+ * the same calls in the same order (processOrder with the clock at nowMs,
+ * expireOrders(nowMs), beginAuction/uncross for a phase change) on a book
+ * with the same settings reproduces it exactly; that is what keeps a
+ * standby in step with its primary.
+ */
+class InputJournal {
+public:
+    virtual ~InputJournal() = default;
+    virtual void onOrderInput(const Order &o, uint64_t nowMs) = 0;
+    virtual void onClockInput(uint64_t nowMs) = 0;
+    // phase is the one being entered: Auction for beginAuction, Continuous for uncross
+    virtual void onPhaseInput(TradingPhase phase, uint64_t nowMs) = 0;
 };
 
 /**
  * OrderBook class encapsulating the logic for:
- * - Storing orders in buy/sell priority queues
+ * - Storing orders in buy/sell price ladders
  * - Matching orders
  * - Generating confirmations
  * - Measuring performance
  */
 class OrderBook {
 public:
-    OrderBook();
+    // Expiry follows clock (the system clock if null), which must outlive the book
+    explicit OrderBook(const Clock *clock = nullptr);
     ~OrderBook() = default;
 
     // Process a single order (blocking or from a worker thread)
@@ -52,31 +166,229 @@ public:
     uint64_t minLatencyNs() const { return m_minLatencyNs.load(); }
     uint64_t maxLatencyNs() const { return m_maxLatencyNs.load(); }
 
-    // Generates a single confirmation message
-    std::string buildConfirmation(const Order &o, uint64_t filledQuantity, double avgPrice);
+    // Resting order counts per side, for monitoring
+    uint64_t bidOrderCount() const { return m_bidOrderCount.load(std::memory_order_relaxed); }
+    uint64_t askOrderCount() const { return m_askOrderCount.load(std::memory_order_relaxed); }
+
+    // Reserves room for the plan's orders and levels up front, with order
+    // and index nodes in a prefaulted arena (on huge pages when available),
+    // so trading within the plan neither allocates nor takes page faults.
+    // Call before orders are processed. False if the arena could not be
+    // mapped; the containers are reserved on the heap regardless.
+    bool reserveMemory(const MemoryPlan &plan);
+
+    // Safe to call from any thread
+    MemoryUsage memoryUsage() const;
+
+    // Self-trade prevention mode; set before orders are processed
+    void setSelfTradePrevention(SelfTradePrevention mode) { m_stpMode = mode; }
+    SelfTradePrevention selfTradePrevention() const { return m_stpMode; }
+
+    // How a level is shared among its orders (FIFO unless set); set before
+    // orders are processed. Self-trade prevention settles the incoming
+    // order's own orders at a level before the level is allocated.
+    void setAllocationRules(const AllocationRules &rules) { m_allocation = rules; }
+    const AllocationRules& allocationRules() const { return m_allocation; }
+
+    // Post-only handling, and the tick used to reprice and to grid the
+    // ladders' dense windows; set before orders are processed
+    void setPostOnlyMode(PostOnlyMode mode) { m_postOnlyMode = mode; }
+    void setTickSize(double tickSize);
+
+    // Observer for orders, trades and cancels, or nullptr; set before orders are processed
+    void setEventListener(BookEventListener *listener) { m_listener = listener; }
+
+    // Journal of inputs for replication, or nullptr; set before orders are processed
+    void setInputJournal(InputJournal *journal) { m_journal = journal; }
+
+    // Keep resting orders that trade for takePassiveFills (off by default,
+    // since nothing else drains them)
+    void setReportPassiveFills(bool on) { m_reportPassiveFills = on; }
+
+    // Advances the expiry clock and returns the good-till-date orders that
+    // have expired since the last call, with status "expired". processOrder
+    // also advances the clock so expired orders never match.
+    std::vector<Order> expireOrders(uint64_t nowMs);
+
+    // Orders cancelled by kill messages since the last call, with status
+    // "cancelled". A kill itself reports "killed", with quantity set to the
+    // number of orders it cancelled.
+    std::vector<Order> takeKilled();
+
+    // Resting orders that traded since the last call, one entry per fill,
+    // as they stood after it: status "executed" or "partially_filled" and
+    // an iceberg's reserve counted as remaining. Swapped into out (cleared
+    // first), whose storage the book reuses.
+    void takePassiveFills(std::vector<Order> &out);
+
+    // Whether orderId is resting on either side
+    bool hasResting(uint64_t orderId);
+
+    // Starts a call auction: orders rest without matching until uncross().
+    // Market, IOC, FOK and stop-loss orders are refused ("auction_rejected").
+    void beginAuction();
+
+    // Executes every crossing order at the single price that trades the
+    // most quantity, in one batch, and returns to continuous matching.
+    // Self-trade prevention does not apply in the uncross.
+    AuctionResult uncross();
+
+    TradingPhase tradingPhase();
+
+    // Aggregated depth (L2) of the best `levels` price levels, best first
+    std::vector<DepthLevel> bidDepth(size_t levels);
+    std::vector<DepthLevel> askDepth(size_t levels);
+
+    // Levels per side in the published depth view (at most kBookViewLevels;
+    // 0 = none); set before orders are processed
+    void setDepthViewLevels(size_t levels);
+    size_t depthViewLevels() const { return m_viewLevels; }
+
+    // Depth as of the last change to the book, without taking the book lock
+    BookDepthView depthView() const { return m_depthView.load(); }
+
+    // Every resting order, built by whichever thread next changes the book
+    // (so readers never contend for the lock with matching). Concurrent
+    // callers share one snapshot. If nothing changes the book within
+    // `wait`, the book is idle and the caller builds it under the lock.
+    std::shared_ptr<const BookSnapshot> orderSnapshot(
+        std::chrono::milliseconds wait = std::chrono::milliseconds(5));
 
 private:
-    // The two main priority queues
-    std::priority_queue<Order, std::vector<Order>, BuyOrderComparator> m_buyOrders;
-    std::priority_queue<Order, std::vector<Order>, SellOrderComparator> m_sellOrders;
+    const Clock *m_clock;
+
+    // Backing for resting order nodes (reserveMemory); declared before the
+    // ladders so it outlives them
+    MemoryArena m_arena;
+    NodePool m_nodePool{&m_arena};
+
+    // The two sides of the book
+    PriceLadder m_buyOrders{true};
+    PriceLadder m_sellOrders{false};
 
     // Mutex for concurrency
     std::mutex m_bookMutex;
 
+    SelfTradePrevention m_stpMode = SelfTradePrevention::None;
+    AllocationRules m_allocation;
+    PostOnlyMode m_postOnlyMode = PostOnlyMode::Reject;
+    int64_t m_tickTicks = toTicks(0.01);
+    BookEventListener *m_listener = nullptr;
+    InputJournal *m_journal = nullptr;
+    TradingPhase m_phase = TradingPhase::Continuous;
+
+    // Resting quantities and allocations of the level matchProRata is
+    // sharing out; they keep their capacity between orders
+    std::vector<uint64_t> m_levelQuantities;
+    std::vector<uint64_t> m_levelAllocations;
+
+    // Good-till-date expiries; an order leaving the book early takes its
+    // timer with it
+    TimerWheel m_expiries;
+    std::vector<Order> m_expired;
+
+    // Orders cancelled by kill messages, until takeKilled
+    std::vector<Order> m_killed;
+    std::vector<RestingOrder> m_killScratch;
+
+    // Resting sides of trades, until takePassiveFills
+    bool m_reportPassiveFills = false;
+    std::vector<Order> m_passiveFills;
+
     // Performance counters
     std::atomic<uint64_t> m_ordersProcessed{0};
     std::atomic<uint64_t> m_totalLatencyNs{0};
     std::atomic<uint64_t> m_minLatencyNs{UINT64_MAX};
     std::atomic<uint64_t> m_maxLatencyNs{0};
 
-    // Core matching logic
-    void matchBuyOrder(Order &buyOrder);
-    void matchSellOrder(Order &sellOrder);
+    // Book depth mirrors: written under m_bookMutex, read by the stats publisher.
+    // Kept on their own cache line so monitoring reads don't contend with the counters above.
+    alignas(64) std::atomic<uint64_t> m_bidOrderCount{0};
+    std::atomic<uint64_t> m_askOrderCount{0};
+
+    // Published depth view; written under m_bookMutex (one writer at a time)
+    size_t m_viewLevels = 10;
+    BookDepthView m_viewScratch{};
+    SeqLock<BookDepthView> m_depthView;
+
+    // L3 snapshot requests, served by publishDepth
+    std::atomic<bool> m_snapshotRequested{false};
+    std::mutex m_snapshotMutex;
+    std::condition_variable m_snapshotCv;
+    std::shared_ptr<const BookSnapshot> m_snapshot;  // guarded by m_snapshotMutex
+
+    // Order handlers, indexed by [OrderKind][Side]. processOrder makes a
+    // single indirect call through this table; everything below it is
+    // specialised at compile time.
+    using Handler = void (OrderBook::*)(Order &);
+    static constexpr size_t kKindCount = static_cast<size_t>(OrderKind::Count);
+    static constexpr size_t kSideCount = static_cast<size_t>(Side::Count);
+    static const Handler kDispatch[kKindCount][kSideCount];
+
+    // The same during a call auction: nothing matches on arrival
+    static const Handler kAuctionDispatch[kKindCount][kSideCount];
+    const Handler (*m_handlers)[kSideCount] = kDispatch;
+
+    // Runs the table entry for o.kind/o.side; caller holds m_bookMutex
+    void dispatch(Order &o);
+
+    // Auction handlers: rest a priced order as is, or refuse the order
+    template <Side S>
+    void restForAuction(Order &o);
+    void rejectInAuction(Order &o);
+
+    // Clock reading for an input, never behind the expiry clock; caller holds m_bookMutex
+    uint64_t inputTime() const;
+
+    // Matching kernel for one side and order-type policy (see orderbook.cpp)
+    template <Side S, typename Policy>
+    void execute(Order &o);
+
+    // Trades o against the opposite side down to limitTicks. Returns false
+    // if self-trade prevention cancelled o's remainder.
+    template <Side S>
+    bool match(Order &o, int64_t limitTicks);
+
+    // The same for the pro-rata algorithms: each level is shared out in one
+    // allocation (see allocation.hpp)
+    template <Side S>
+    bool matchProRata(Order &o, int64_t limitTicks);
+
+    // Fills qty between o and resting (not yet removed from its ladder) and
+    // reports the trade
+    void recordTrade(Order &o, Order &resting, uint64_t qty);
+
+    // Value compared against resting ownerIds in the match loop; never
+    // equal to one when STP is off or the incoming order is untagged
+    uint64_t selfTradeKey(const Order &o) const;
+
+    // Applies m_stpMode against *own, an order at resting's best level;
+    // returns true if matching continues
+    bool preventSelfTrade(Order &incoming, PriceLadder &resting, PriceLadder::OrderQueue::iterator own);
 
     // Extended: different advanced order handling
+    template <Side S>
     void handleStopLoss(Order &o);
-    bool handleIOC(Order &o);  // immediate-or-cancel
-    bool handleFOK(Order &o);  // fill-or-kill
+    void handleCancel(Order &o);
+    void handleReplace(Order &o);
+    void handleKill(Order &o);
+    void reject(Order &o);
+
+    void recordLatency(const Order &o);
+
+    // Moves every order due by nowMs from the book to m_expired; caller holds m_bookMutex
+    void expireDue(uint64_t nowMs);
+
+    // Drops the expiry timer of an order leaving the book before its deadline
+    void forgetExpiry(const Order &o);
+
+    // Refresh the depth mirrors and view, and serve a pending snapshot
+    // request; caller holds m_bookMutex
+    void publishDepth();
+
+    // Builds and hands out a requested snapshot; caller holds m_bookMutex
+    void serveSnapshotRequest();
+    std::shared_ptr<const BookSnapshot> buildSnapshot() const;
 };
 
 #endif // ORDERBOOK_HPP
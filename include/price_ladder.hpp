@@ -0,0 +1,263 @@
+#ifndef PRICE_LADDER_HPP
+#define PRICE_LADDER_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "auction.hpp"
+#include "memory_plan.hpp"
+#include "order.hpp"
+
+// Prices travel as doubles; levels are keyed by integer ticks of 1e-6,
+// the precision the wire format (std::to_string) carries.
+constexpr int64_t kPriceScale = 1000000;
+
+// Supported prices are below this in magnitude. Its ticks (1e15) leave
+// int64 room for the no-limit sentinels below and for level arithmetic
+// around them; the decoders reject anything larger.
+constexpr double kMaxPrice = 1e9;
+constexpr int64_t kMaxPriceTicks = static_cast<int64_t>(kMaxPrice) * kPriceScale;
+
+inline bool priceInRange(double price) { return std::fabs(price) < kMaxPrice; }
+
+// Prices from kMaxPrice on are clamped to it (NaN to 0) rather than left
+// to llround's unspecified result
+inline int64_t toTicks(double price) {
+    double scaled = price * kPriceScale;
+    if (scaled >= static_cast<double>(kMaxPriceTicks)) {
+        return kMaxPriceTicks;
+    }
+    if (scaled <= -static_cast<double>(kMaxPriceTicks)) {
+        return -kMaxPriceTicks;
+    }
+    return std::isnan(scaled) ? 0 : std::llround(scaled);
+}
+inline double fromTicks(int64_t ticks) { return static_cast<double>(ticks) / kPriceScale; }
+
+// Limit sentinels for orders that may trade at any price
+constexpr int64_t kNoBuyLimit = INT64_MAX;
+constexpr int64_t kNoSellLimit = -INT64_MAX;
+
+struct DepthLevel {
+    double price;
+    uint64_t quantity;
+    uint64_t cumulativeQuantity;
+};
+
+// One resting order as seen in an order-by-order (L3) view
+struct RestingOrder {
+    uint64_t orderId;
+    double price;
+    uint64_t quantity;        // displayed
+    uint64_t hiddenQuantity;  // iceberg reserve
+    uint32_t ownerId;
+};
+
+/**
+ * One side of the book as a ladder of price levels.
+ *
+ * Levels live in one of two stores. A dense window of slots, one per
+ * price increment, covers a band of prices around the touch: a level there
+ * is found by arithmetic on its price, and slot quantities are stored
+ * worst first, as the level-scan kernels expect. The window is a ring, so
+ * recentering it when the touch leaves the band only moves the levels
+ * that fall out of it or come into it. Those, and levels at prices off the
+ * increment grid, sit in an ordered map. The best level is cached, so the
+ * matcher reaches it without searching either store.
+ *
+ * Keys are the tick price for bids and its negation for asks, so on both
+ * sides a higher key is a better price.
+ *
+ * An id index gives O(1) access to any resting order. Iceberg orders rest
+ * with only their display slice in remainingQuantity (and in the level
+ * total); the reserve sits in hiddenQuantity and refills the slice at the
+ * back of the queue. Order ids must be unique among resting orders.
+ */
+class PriceLadder {
+public:
+    using OrderQueue = std::list<Order, PoolAllocator<Order>>;
+
+    static constexpr size_t kDefaultWindowSlots = 256;
+
+    explicit PriceLadder(bool isBid);
+
+    // Sizes the dense window to cover `levels` price increments (rounded
+    // up to a power of two) and preallocates room for `orders` resting
+    // orders; order, index and outlying level nodes then come from pool
+    // (if given). Call while the ladder is empty.
+    void reserve(size_t levels, size_t orders, NodePool *pool);
+
+    // Price increment of the dense window, in ticks (default 0.01). Prices
+    // off this grid still rest, in the ordered map.
+    void setIncrement(int64_t ticks);
+
+    bool isBid() const { return m_isBid; }
+    bool empty() const { return m_bestQueue == nullptr; }
+    size_t levelCount() const { return m_windowLevels + m_outlying.size(); }
+    size_t orderCount() const { return m_orderCount; }
+
+    // Levels in the dense window; the rest are outlying or off the grid
+    size_t windowLevelCount() const { return m_windowLevels; }
+    size_t windowSlots() const { return m_slotQuantities.size(); }
+
+    // Best level; the ladder must not be empty
+    double bestPrice() const { return fromTicks(bestTicks()); }
+    int64_t bestTicks() const { return tickOf(m_bestKey); }
+
+    // True if the best level may trade with an incoming order limited at limitTicks
+    bool crosses(int64_t limitTicks) const {
+        return m_bestQueue != nullptr && m_bestKey >= keyFor(limitTicks);
+    }
+
+    // Appends an order to the back of its level's queue, splitting off
+    // the hidden reserve of an iceberg. False, and nothing added, if its
+    // price is outside the supported range (priceInRange).
+    bool add(const Order &o);
+
+    // Resting order by id, or nullptr
+    const Order* find(uint64_t orderId) const;
+
+    // Removes a resting order by id (with its hidden reserve) into *removed
+    bool remove(uint64_t orderId, Order *removed);
+
+    // Takes qty off a resting order's open quantity, hidden reserve first,
+    // keeping its place in the queue; qty must be less than it has open
+    void reduce(uint64_t orderId, uint64_t qty);
+
+    // Oldest order at the best level; the ladder must not be empty
+    Order& front() { return m_bestQueue->front(); }
+
+    // Orders at the best level in time priority, and their aggregate
+    // quantity; the ladder must not be empty
+    OrderQueue& bestLevel() { return *m_bestQueue; }
+    uint64_t bestQuantity() const { return *m_bestQuantity; }
+
+    // Records a fill of qty against front(). An exhausted iceberg slice is
+    // refilled from the reserve and loses time priority; any other exhausted
+    // order is removed.
+    void fillFront(uint64_t qty) { fillAt(m_bestQueue->begin(), qty); }
+
+    // The same for any order at the best level; `it` is invalidated if the
+    // order is removed, and moves to the back of the level if refilled
+    void fillAt(OrderQueue::iterator it, uint64_t qty);
+
+    // Removes front() (or *it, at the best level) with whatever quantity it has left
+    void cancelFront() { cancelAt(m_bestQueue->begin()); }
+    void cancelAt(OrderQueue::iterator it);
+
+    // Number of levels (best first) a sweep of qty limited at limitTicks
+    // would trade with; *available receives their aggregate quantity,
+    // iceberg reserves included
+    size_t sweep(uint64_t qty, int64_t limitTicks, uint64_t *available) const;
+
+    // The same aggregate, up to qty, counting only orders not owned by
+    // ownerId (self-trade prevention). Own orders are passed over if
+    // skipOwn, since matching cancels them; otherwise the count stops at
+    // the first one matching would reach, which is ahead of the rest of
+    // its level if ownFirst (pro-rata deals with them before sharing out).
+    uint64_t availableFromOthers(uint64_t qty, int64_t limitTicks, uint32_t ownerId,
+                                 bool skipOwn, bool ownFirst) const;
+
+    // Best min(levels, levelCount()) levels, best first
+    std::vector<DepthLevel> depth(size_t levels) const;
+
+    // The same into out[0..levels) without allocating; returns the count
+    size_t depthInto(DepthLevel *out, size_t levels) const;
+
+    // Appends every resting order, best level first, in time priority
+    void restingOrders(std::vector<RestingOrder> &out) const;
+
+    // Every level, best first, with iceberg reserves counted in full
+    void auctionLevels(std::vector<AuctionLevel> &out) const;
+
+private:
+    static constexpr size_t kNoSlot = SIZE_MAX;
+
+    struct OutlyingLevel {
+        explicit OutlyingLevel(OrderQueue &&q, uint64_t qty = 0) : quantity(qty), queue(std::move(q)) {}
+        uint64_t quantity;
+        OrderQueue queue;
+    };
+    using OutlyingAllocator = PoolAllocator<std::pair<const int64_t, OutlyingLevel>>;
+    using OutlyingMap = std::map<int64_t, OutlyingLevel, std::less<int64_t>, OutlyingAllocator>;
+
+    int64_t keyFor(int64_t ticks) const { return m_isBid ? ticks : -ticks; }
+    int64_t tickOf(int64_t key) const { return m_isBid ? key : -key; }
+
+    void resizeWindow(size_t slots);
+
+    // sweep() over displayed quantities only, from the level totals
+    size_t sweepDisplayed(uint64_t qty, int64_t limitTicks, uint64_t *available) const;
+
+    // Whether key lies within the window's band of prices, on the grid or not
+    bool inBand(int64_t key) const {
+        return m_windowPlaced && key >= m_windowLow &&
+               static_cast<uint64_t>(key - m_windowLow) / static_cast<uint64_t>(m_increment) < m_slotQuantities.size();
+    }
+
+    // Window slot (logical, 0 = worst) holding key, or kNoSlot if the key
+    // is off the grid or outside the window
+    size_t slotOf(int64_t key) const;
+    size_t physical(size_t slot) const { return (m_windowStart + slot) & (m_slotQuantities.size() - 1); }
+    int64_t keyOfSlot(size_t slot) const { return m_windowLow + static_cast<int64_t>(slot) * m_increment; }
+    bool occupied(size_t phys) const { return (m_occupied[phys >> 6] >> (phys & 63)) & 1; }
+
+    // Highest occupied window slot at or below `slot`, or kNoSlot
+    size_t occupiedAtOrBelow(size_t slot) const;
+
+    // The level holding key; both null if there is none
+    void locate(int64_t key, uint64_t *&quantity, OrderQueue *&queue);
+
+    // Drops an emptied level, then finds the best again if it was the best
+    void eraseLevel(int64_t key);
+
+    // Points the cache at the best level, recentering the window on it
+    // when it has left the window's band
+    void refreshBest();
+
+    // Places the window so key sits in its middle, moving levels between
+    // the window and the map. False, with nothing moved, for a key outside
+    // the supported price range or a window too wide to place.
+    bool recenter(int64_t key);
+    void demote(size_t slot);
+
+    // Calls fn(key, quantity, queue) for each level, best first, until it returns false
+    template <typename Fn>
+    void forEachLevel(Fn &&fn) const;
+
+    void unindex(const OrderQueue::iterator &it);
+
+    bool m_isBid;
+    size_t m_orderCount = 0;
+    PoolAllocator<Order> m_allocator;       // for level queues
+
+    // Dense window: slot i (logical) is key m_windowLow + i * m_increment
+    // and lives at physical index (m_windowStart + i) mod size
+    std::vector<uint64_t> m_slotQuantities;
+    std::vector<OrderQueue> m_slotQueues;
+    std::vector<uint64_t> m_occupied;       // bitmap over physical slots
+    int64_t m_increment;
+    int64_t m_windowLow = 0;
+    size_t m_windowStart = 0;
+    size_t m_windowTop = kNoSlot;           // best occupied slot
+    size_t m_windowLevels = 0;
+    bool m_windowPlaced = false;
+
+    OutlyingMap m_outlying;                 // outside the window or off its grid
+
+    // Best level
+    int64_t m_bestKey = 0;
+    uint64_t *m_bestQuantity = nullptr;
+    OrderQueue *m_bestQueue = nullptr;
+
+    using IndexAllocator = PoolAllocator<std::pair<const uint64_t, OrderQueue::iterator>>;
+    std::unordered_map<uint64_t, OrderQueue::iterator, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                       IndexAllocator> m_index;
+};
+
+#endif // PRICE_LADDER_HPP
@@ -0,0 +1,156 @@
+#ifndef REPLICATION_HPP
+#define REPLICATION_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <netinet/in.h>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "clock.hpp"
+#include "orderbook.hpp"
+#include "spsc_ring.hpp"
+
+enum class ReplicationRecordType : uint8_t {
+    Order = 1,   // processOrder input
+    Clock,       // expireOrders input
+    Heartbeat,   // primary is alive; nothing to apply
+    Ack,         // standby -> primary: sequence applied so far
+    Phase        // beginAuction / uncross
+};
+
+/**
+ * Fixed-size binary record exchanged between primary and standby over a
+ * local stream socket, in host byte order (both ends run on one machine).
+ * sequence numbers the Order/Clock records contiguously from 1.
+ */
+struct ReplicationRecord {
+    uint64_t sequence;
+    uint64_t nowMs;            // primary clock reading the input was applied at
+    uint64_t orderId;
+    uint64_t quantity;
+    uint64_t displayQuantity;
+    uint64_t expireTimeMs;
+    uint64_t orderSequence;    // Order::sequence
+    double price;
+    double stopPrice;
+    uint32_t ownerId;
+    ReplicationRecordType type;
+    OrderKind kind;
+    Side side;
+    TradingPhase phase;        // Phase records: the phase entered
+    sockaddr_in clientAddr;    // so the standby can confirm to the same clients
+    uint32_t clientAddrLen;
+    uint32_t reserved2;
+};
+
+static_assert(std::is_trivially_copyable<ReplicationRecord>::value,
+              "ReplicationRecord is sent as raw bytes");
+
+ReplicationRecord toReplicationRecord(const Order &o, uint64_t nowMs);
+Order fromReplicationRecord(const ReplicationRecord &r);
+
+// Unix stream socket helpers; return -1 (after perror) on failure
+int listenReplication(const std::string &path);
+int acceptReplication(int listenFd);
+int connectReplication(const std::string &path, int timeoutMs);
+
+struct ReplicationConfig {
+    int heartbeatMs = 5;        // primary: heartbeat when idle this long
+    int takeoverMs = 50;        // standby: take over after this much silence
+    bool acks = false;          // standby acknowledges applied sequences
+    size_t ringCapacity = 65536;
+};
+
+/**
+ * Primary side. Installed as the book's InputJournal, it copies every
+ * input into a lock-free ring (the book lock serialises the callers into
+ * a single producer); a sender thread writes them to the standby in
+ * batches, interleaved with heartbeats when idle. Acks, if the standby
+ * sends them, are read asynchronously and only reported. If the link
+ * fails the primary carries on unreplicated.
+ */
+class ReplicationPrimary : public InputJournal {
+public:
+    // Takes ownership of fd, a connected stream socket
+    ReplicationPrimary(int fd, const ReplicationConfig &config);
+    ~ReplicationPrimary() override;
+
+    ReplicationPrimary(const ReplicationPrimary&) = delete;
+    ReplicationPrimary& operator=(const ReplicationPrimary&) = delete;
+
+    void start();
+
+    // Sends everything journalled so far, then closes the link
+    void stop();
+
+    void onOrderInput(const Order &o, uint64_t nowMs) override;
+    void onClockInput(uint64_t nowMs) override;
+    void onPhaseInput(TradingPhase phase, uint64_t nowMs) override;
+
+    bool linkUp() const { return m_linkUp.load(std::memory_order_acquire); }
+    uint64_t sentSequence() const { return m_sentSequence.load(std::memory_order_relaxed); }
+    uint64_t ackedSequence() const { return m_ackedSequence.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kBatchRecords = 512;
+
+    void push(ReplicationRecord &r);
+    void run();
+    bool sendAll(const void *data, size_t size);
+    void readAcks();
+
+    int m_fd;
+    ReplicationConfig m_config;
+    SpscRing<ReplicationRecord> m_ring;
+    uint64_t m_nextSequence = 1;           // producer side, under the book lock
+    ReplicationRecord m_ack{};             // partially received ack
+    size_t m_ackBytes = 0;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_linkUp{true};
+    std::atomic<uint64_t> m_sentSequence{0};
+    std::atomic<uint64_t> m_ackedSequence{0};
+};
+
+/**
+ * Standby side: applies the primary's inputs to a book whose clock
+ * follows the primary's timestamps, so it stays identical. The book must
+ * have been created (its expiry clock started) no later than the primary's
+ * first input, which holds when the standby is up before the primary.
+ */
+class ReplicationStandby {
+public:
+    enum class Outcome {
+        Disconnected,   // the primary closed the link
+        HeartbeatLost,  // nothing arrived for takeoverMs
+        Error           // read error or a gap in the sequence
+    };
+
+    // Takes ownership of fd, a connected stream socket
+    ReplicationStandby(int fd, OrderBook &book, FollowerClock &clock, const ReplicationConfig &config);
+    ~ReplicationStandby();
+
+    ReplicationStandby(const ReplicationStandby&) = delete;
+    ReplicationStandby& operator=(const ReplicationStandby&) = delete;
+
+    // Applies records until the primary goes away; the caller then takes over
+    Outcome run();
+
+    uint64_t appliedSequence() const { return m_appliedSequence; }
+
+private:
+    bool apply(const ReplicationRecord &r);
+    void sendAck();
+
+    int m_fd;
+    OrderBook &m_book;
+    FollowerClock &m_clock;
+    ReplicationConfig m_config;
+    uint64_t m_appliedSequence = 0;
+    uint64_t m_ackedSequence = 0;
+};
+
+#endif // REPLICATION_HPP
@@ -0,0 +1,125 @@
+#ifndef RESEQUENCER_HPP
+#define RESEQUENCER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Restores sequence order after a parallel stage. Producers publish items
+ * tagged with consecutive sequence numbers in any order; the single
+ * consumer pops them strictly in sequence. Items wait in a ring indexed by
+ * sequence number, so a producer more than capacity ahead of the consumer
+ * blocks until its slot frees up. Every sequence number must be published
+ * exactly once or the consumer stalls at the gap.
+ *
+ * A producer may also expedite a copy of an item it publishes: expedited
+ * items bypass the ring and reach the consumer (through the two-argument
+ * pop) ahead of anything in sequence. The in-sequence copy still arrives
+ * at its turn, so the consumer decides which of the two takes effect.
+ */
+template <typename T>
+class Resequencer {
+public:
+    explicit Resequencer(std::size_t capacity = 4096, uint64_t firstSequence = 0)
+        : m_items(capacity), m_ready(capacity, false), m_next(firstSequence), m_expedited(capacity) {}
+
+    void publish(uint64_t sequence, T item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_spaceCv.wait(lock, [&] { return m_closed || sequence < m_next + m_items.size(); });
+        if (m_closed) {
+            return;
+        }
+        std::size_t slot = sequence % m_items.size();
+        m_items[slot] = std::move(item);
+        m_ready[slot] = true;
+        if (sequence == m_next) {
+            m_readyCv.notify_one();
+        }
+    }
+
+    // Queues item ahead of the sequence; false (item dropped) if capacity
+    // expedited items are already waiting or the resequencer is closed
+    bool expedite(T item) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed || m_expeditedCount == m_expedited.size()) {
+                return false;
+            }
+            m_expedited[(m_expeditedHead + m_expeditedCount) % m_expedited.size()] = std::move(item);
+            m_expeditedCount++;
+        }
+        m_readyCv.notify_one();
+        return true;
+    }
+
+    // Blocks for the next expedited item, or failing that the next item in
+    // sequence; *expedited says which. False once closed.
+    bool pop(T &out, bool *expedited) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_readyCv.wait(lock, [&] {
+            return m_closed || m_expeditedCount > 0 || m_ready[m_next % m_items.size()];
+        });
+        if (m_expeditedCount > 0) {
+            out = std::move(m_expedited[m_expeditedHead]);
+            m_expeditedHead = (m_expeditedHead + 1) % m_expedited.size();
+            m_expeditedCount--;
+            *expedited = true;
+            return true;
+        }
+        *expedited = false;
+        return takeNext(out, lock);
+    }
+
+    // Blocks for the next item in sequence; false once closed
+    bool pop(T &out) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_readyCv.wait(lock, [&] { return m_closed || m_ready[m_next % m_items.size()]; });
+        return takeNext(out, lock);
+    }
+
+    // Wakes the consumer and any blocked producers. pop still returns items
+    // already present at the head, then false; later publishes are dropped
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_readyCv.notify_all();
+        m_spaceCv.notify_all();
+    }
+
+    uint64_t nextSequence() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_next;
+    }
+
+private:
+    bool takeNext(T &out, std::unique_lock<std::mutex> &lock) {
+        std::size_t slot = m_next % m_items.size();
+        if (!m_ready[slot]) {
+            return false;
+        }
+        out = std::move(m_items[slot]);
+        m_ready[slot] = false;
+        m_next++;
+        lock.unlock();
+        m_spaceCv.notify_all();
+        return true;
+    }
+
+    std::vector<T> m_items;
+    std::vector<bool> m_ready;
+    uint64_t m_next;
+    std::vector<T> m_expedited;             // ring of m_expeditedCount from m_expeditedHead
+    std::size_t m_expeditedHead = 0;
+    std::size_t m_expeditedCount = 0;
+    bool m_closed = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_readyCv;
+    std::condition_variable m_spaceCv;
+};
+
+#endif // RESEQUENCER_HPP
@@ -0,0 +1,55 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+constexpr std::size_t kCacheLineSize = 64;
+
+/**
+ * Single-writer sequence lock. The writer makes the sequence odd, copies the
+ * payload and makes it even again; a reader retries until it sees the same
+ * even sequence before and after its copy. The payload must be trivially
+ * copyable so the block can be mapped and read by other processes.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLock payload must be trivially copyable");
+public:
+    void store(const T &value) {
+        uint64_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&m_value, &value, sizeof(T));
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Returns false if a write was in progress; the caller may retry
+    bool tryLoad(T &out) const {
+        uint64_t before = m_seq.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        std::memcpy(&out, &m_value, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_seq.load(std::memory_order_relaxed) == before;
+    }
+
+    T load() const {
+        T out;
+        while (!tryLoad(out)) {}
+        return out;
+    }
+
+    uint64_t sequence() const { return m_seq.load(std::memory_order_acquire); }
+
+private:
+    alignas(kCacheLineSize) std::atomic<uint64_t> m_seq{0};
+    alignas(kCacheLineSize) T m_value{};
+};
+
+#endif // SEQLOCK_HPP
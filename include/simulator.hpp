@@ -0,0 +1,55 @@
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "orderbook.hpp"
+
+/**
+ * Offline replay of a historical order file through one OrderBook per
+ * instrument.
+ *
+ * Input is CSV, one order per line:
+ *   timestamp_ms,instrument,order_id,type,action,price,quantity
+ *       [,owner_id[,display_quantity[,expire_time_ms[,stop_price]]]]
+ * with the same type/action strings as the wire protocol. Lines must be in
+ * time order. A first line that does not start with a digit is taken as a
+ * header; malformed lines are counted and skipped.
+ *
+ * The file is mapped, and every worker thread streams through it, fully
+ * parsing only the lines of the instruments hashed to it. Each book runs
+ * on its own SimulatedClock set from the line timestamps, so output is
+ * identical from run to run and for any thread count.
+ *
+ * Output, in outputDir:
+ *   fills.csv - every trade in input order:
+ *               line,timestamp_ms,instrument,order_id,resting_order_id,side,price,quantity
+ *   book.csv  - end-of-day depth per instrument (sorted), best level first:
+ *               instrument,side,level,price,quantity
+ */
+struct SimConfig {
+    std::string inputPath;
+    std::string outputDir;
+    unsigned threads = 0;  // 0 = one per hardware thread
+    SelfTradePrevention stp = SelfTradePrevention::None;
+    PostOnlyMode postOnly = PostOnlyMode::Reject;
+    double tickSize = 0.01;
+    AllocationRules allocation;
+    std::map<std::string, MatchingAlgorithm> instrumentAlgorithms;  // overrides allocation.algorithm
+};
+
+struct SimSummary {
+    uint64_t orders = 0;       // lines replayed
+    uint64_t badLines = 0;     // lines skipped as malformed
+    uint64_t fills = 0;
+    uint64_t expired = 0;      // good-till-date orders that expired
+    uint64_t instruments = 0;
+    unsigned threads = 0;
+};
+
+// Runs the replay; false (with *error set) if the input or output can't be opened
+bool runSimulation(const SimConfig &config, SimSummary &summary, std::string *error = nullptr);
+
+#endif // SIMULATOR_HPP
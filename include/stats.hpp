@@ -0,0 +1,156 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "seqlock.hpp"
+
+// Latency bucket i counts samples in [2^i, 2^(i+1)) nanoseconds
+constexpr std::size_t kLatencyBuckets = 32;
+
+// Fixed number of per-thread counter slots a StatsRegistry can hand out
+constexpr std::size_t kMaxStatsSlots = 32;
+
+/**
+ * Pipeline stages that report counters. Stage N's queue depth is derived
+ * as (events of stage N-1) - (events of stage N), so the order matters.
+ */
+enum class Stage : uint32_t {
+    Receive = 0,
+    Decode,
+    Match,
+    Send,
+    Count
+};
+
+constexpr std::size_t kStageCount = static_cast<std::size_t>(Stage::Count);
+
+const char* stageName(Stage stage);
+
+/**
+ * Plain-old-data views of the counters, as published to shared memory.
+ */
+struct LatencyHistogramSnapshot {
+    uint64_t buckets[kLatencyBuckets];
+    uint64_t count;
+    uint64_t sumNs;
+    uint64_t maxNs;
+};
+
+struct StageSnapshot {
+    uint64_t events;
+    uint64_t errors;
+    uint64_t queueDepth;
+    LatencyHistogramSnapshot latency;
+};
+
+struct StatsSnapshot {
+    uint64_t publishTimeNs;   // steady clock
+    uint64_t uptimeNs;
+    StageSnapshot stages[kStageCount];
+    uint64_t bidOrders;
+    uint64_t askOrders;
+    uint64_t reservedBytes;       // book memory reserved at startup
+    uint64_t reservedUsedBytes;   // the part handed out
+    uint64_t reservedPageBytes;   // page size backing it
+    uint64_t poolHeapFallbacks;   // order nodes that overflowed the reservation
+};
+
+/**
+ * Log2 latency histogram with a single writer. Updates are relaxed
+ * load+store pairs (no locked RMW) since only the owning thread writes.
+ */
+class LatencyHistogram {
+public:
+    void record(uint64_t ns);
+    void snapshotInto(LatencyHistogramSnapshot &out) const;
+
+    static std::size_t bucketFor(uint64_t ns);
+
+private:
+    std::atomic<uint64_t> m_buckets[kLatencyBuckets] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sumNs{0};
+    std::atomic<uint64_t> m_maxNs{0};
+};
+
+/**
+ * Counters owned by exactly one thread. Each slot sits on its own cache
+ * lines so the publisher never shares a line with another worker.
+ */
+struct alignas(kCacheLineSize) StageCounters {
+    void recordEvent(uint64_t latencyNs);
+    void recordError();
+
+    Stage stage = Stage::Receive;
+    std::atomic<bool> active{false};
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> errors{0};
+    LatencyHistogram latency;
+};
+
+/**
+ * Hands out per-thread counter slots and folds them into a StatsSnapshot.
+ * Slots are claimed at thread start-up and never released.
+ */
+class StatsRegistry {
+public:
+    StatsRegistry();
+
+    // Returns nullptr once all kMaxStatsSlots slots are taken
+    StageCounters* registerSlot(Stage stage);
+
+    // Sums every slot per stage and derives the inter-stage queue depths
+    void collect(StatsSnapshot &out) const;
+
+private:
+    StageCounters m_slots[kMaxStatsSlots];
+    std::atomic<std::size_t> m_used{0};
+    uint64_t m_startNs;
+};
+
+/**
+ * Layout of the shared memory segment. External readers check magic and
+ * version, then read the snapshot through the sequence lock.
+ */
+struct SharedStatsBlock {
+    static constexpr uint64_t kMagic = 0x4f424b5354415453ULL; // "OBKSTATS"
+    static constexpr uint32_t kVersion = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t snapshotSize;
+    SeqLock<StatsSnapshot> snapshot;
+};
+
+/**
+ * Owns the mapping of a SharedStatsBlock under /dev/shm. Falls back to
+ * process-private memory if the segment cannot be created.
+ */
+class StatsRegion {
+public:
+    explicit StatsRegion(const std::string &shmName);
+    ~StatsRegion();
+
+    StatsRegion(const StatsRegion&) = delete;
+    StatsRegion& operator=(const StatsRegion&) = delete;
+
+    SharedStatsBlock* block() { return m_block; }
+    const SharedStatsBlock* block() const { return m_block; }
+    bool isShared() const { return m_shared; }
+
+private:
+    std::string m_name;
+    SharedStatsBlock* m_block = nullptr;
+    bool m_shared = false;
+};
+
+// Renders a snapshot in the Prometheus text exposition format (0.0.4)
+std::string renderPrometheus(const StatsSnapshot &snap);
+
+uint64_t steadyNowNs();
+
+#endif // STATS_HPP
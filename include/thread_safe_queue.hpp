@@ -1,39 +1,130 @@
 #ifndef THREAD_SAFE_QUEUE_HPP
 #define THREAD_SAFE_QUEUE_HPP
 
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
-#include <queue>
+#include <utility>
+#include <vector>
 
+/**
+ * Blocking multi-producer/multi-consumer queue. Items live in a ring that
+ * only grows (doubling) when full, so a queue reserved for its expected
+ * depth never allocates while running.
+ */
 template <typename T>
 class ThreadSafeQueue {
 public:
     ThreadSafeQueue() = default;
     ~ThreadSafeQueue() = default;
 
-    void push(const T &item) {
+    // Makes room for `capacity` items up front
+    void reserve(std::size_t capacity) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (capacity > m_ring.size()) {
+            regrow(capacity);
+        }
+    }
+
+    // Returns false (and drops the item) once the queue is closed
+    bool push(const T &item) {
         {
             std::lock_guard<std::mutex> lock(m_mutex);
-            m_queue.push(item);
+            if (m_closed) {
+                return false;
+            }
+            if (m_count == m_ring.size()) {
+                regrow(m_ring.empty() ? kInitialCapacity : 2 * m_ring.size());
+            }
+            m_ring[(m_head + m_count) % m_ring.size()] = item;
+            m_count++;
         }
         m_cv.notify_one();
+        return true;
+    }
+
+    // Blocks for the next item. Returns false once the queue is closed and
+    // drained, so consumers finish what was queued before the close.
+    bool pop(T &out) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_count > 0 || m_closed; });
+        if (m_count == 0) {
+            return false;
+        }
+        takeFront(out);
+        return true;
     }
 
-    T pop() {
+    // As pop, but gives up after timeout; false then too
+    bool popFor(T &out, std::chrono::nanoseconds timeout) {
         std::unique_lock<std::mutex> lock(m_mutex);
-        m_cv.wait(lock, [this] { return !m_queue.empty(); });
-        T item = m_queue.front();
-        m_queue.pop();
-        return item;
+        if (!m_cv.wait_for(lock, timeout, [this] { return m_count > 0 || m_closed; }) ||
+            m_count == 0) {
+            return false;
+        }
+        takeFront(out);
+        return true;
+    }
+
+    // Never blocks; false if nothing is queued
+    bool tryPop(T &out) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_count == 0) {
+            return false;
+        }
+        takeFront(out);
+        return true;
+    }
+
+    // Rejects further pushes and wakes every blocked consumer
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_cv.notify_all();
+    }
+
+    bool closed() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
     }
 
     bool empty() const {
         std::lock_guard<std::mutex> lock(m_mutex);
-        return m_queue.empty();
+        return m_count == 0;
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count;
     }
 
 private:
-    std::queue<T> m_queue;
+    static constexpr std::size_t kInitialCapacity = 16;
+
+    // Caller holds m_mutex
+    void takeFront(T &out) {
+        out = std::move(m_ring[m_head]);
+        m_head = (m_head + 1) % m_ring.size();
+        m_count--;
+    }
+
+    // Caller holds m_mutex; capacity >= m_count
+    void regrow(std::size_t capacity) {
+        std::vector<T> ring(capacity);
+        for (std::size_t i = 0; i < m_count; i++) {
+            ring[i] = std::move(m_ring[(m_head + i) % m_ring.size()]);
+        }
+        m_ring.swap(ring);
+        m_head = 0;
+    }
+
+    std::vector<T> m_ring;
+    std::size_t m_head = 0;   // oldest item
+    std::size_t m_count = 0;
+    bool m_closed = false;
     mutable std::mutex m_mutex;
     std::condition_variable m_cv;
 };
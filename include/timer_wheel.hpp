@@ -0,0 +1,63 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * Hierarchical timer wheel with 1 ms ticks: four levels of 256 slots
+ * (about 49 days of range). Scheduling is O(1). Advancing visits only the
+ * occupied slots it passes, found through a bitmap per level, plus one
+ * re-bucketing per timer per level it cascades through; empty spans cost
+ * nothing. Timers cancelled by their owner are removed from their slot.
+ */
+class TimerWheel {
+public:
+    struct Timer {
+        uint64_t id;
+        uint64_t deadlineMs;
+    };
+
+    explicit TimerWheel(uint64_t nowMs = 0);
+
+    void schedule(uint64_t id, uint64_t deadlineMs);
+
+    // Removes the timer scheduled with this id and deadline; false if it
+    // is not pending (already fired, or never scheduled)
+    bool cancel(uint64_t id, uint64_t deadlineMs);
+
+    // Moves time forward to nowMs, invoking onExpire for every timer whose
+    // deadline is <= nowMs
+    void advance(uint64_t nowMs, const std::function<void(const Timer&)> &onExpire);
+
+    uint64_t now() const { return m_nowMs; }
+    size_t size() const { return m_count; }
+
+private:
+    static constexpr size_t kLevels = 4;
+    static constexpr size_t kSlotBits = 8;
+    static constexpr size_t kSlots = size_t(1) << kSlotBits;
+
+    // Level and slot a timer due at deadlineMs sits in, given the current time
+    void locate(uint64_t deadlineMs, size_t &level, size_t &slot) const;
+    void place(const Timer &t);
+
+    // Moves a slot's timers into out, leaving it empty
+    void take(size_t level, size_t slot, std::vector<Timer> &out);
+
+    // First occupied slot of the level at or after `from`, or kSlots
+    size_t nextOccupied(size_t level, size_t from) const;
+
+    // Earliest time after now at which a slot is due or a cascade may
+    // refill one
+    uint64_t nextEvent() const;
+
+    uint64_t m_nowMs;
+    size_t m_count = 0;
+    std::vector<Timer> m_wheel[kLevels][kSlots];
+    uint64_t m_occupied[kLevels][kSlots / 64] = {};
+};
+
+#endif // TIMER_WHEEL_HPP
@@ -0,0 +1,117 @@
+#ifndef TRACING_HPP
+#define TRACING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "spsc_ring.hpp"
+
+/**
+ * Stage boundaries a sampled order is timestamped at, in pipeline order.
+ */
+enum class TracePoint : uint8_t {
+    KernelReceive = 0,  // datagram arrived (SO_TIMESTAMPNS)
+    Receive,            // read by the receiver
+    DecodeStart,        // taken off the decode queue
+    DecodeEnd,          // decoded and published to the resequencer
+    MatchStart,         // popped by the matching thread
+    MatchEnd,           // processOrder returned
+    ConfirmEnqueue,     // confirmation queued for the sender
+    SendStart,          // confirmation taken off the queue
+    Sent,               // sendto returned
+    Count
+};
+
+constexpr size_t kTracePointCount = static_cast<size_t>(TracePoint::Count);
+
+const char* tracePointName(TracePoint point);
+
+// CLOCK_REALTIME in nanoseconds: the clock kernel receive timestamps use
+uint64_t traceNowNs();
+
+struct TraceRecord {
+    uint64_t sequence;
+    uint64_t timeNs;
+    TracePoint point;
+};
+
+/**
+ * One thread's trace records. Only the owning thread writes; the tracer's
+ * collector drains it. A full buffer drops records rather than block.
+ */
+class TraceBuffer {
+public:
+    TraceBuffer(const std::string &thread, size_t capacity) : m_thread(thread), m_ring(capacity) {}
+
+    void record(uint64_t sequence, TracePoint point, uint64_t timeNs) {
+        if (!m_ring.tryPush(TraceRecord{sequence, timeNs, point})) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void record(uint64_t sequence, TracePoint point) { record(sequence, point, traceNowNs()); }
+
+    const std::string& thread() const { return m_thread; }
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    friend class Tracer;
+
+    std::string m_thread;
+    SpscRing<TraceRecord> m_ring;
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+/**
+ * Sampled per-order tracing. Orders whose sequence number is a multiple
+ * of sampleEvery are timestamped at each TracePoint by the thread that
+ * handles them, into that thread's TraceBuffer. collect() moves buffered
+ * records aside (call it periodically so buffers don't fill up) and
+ * writeChromeTrace() writes them as Chrome trace JSON, one row per order.
+ */
+class Tracer {
+public:
+    // sampleEvery 0 disables tracing
+    explicit Tracer(uint64_t sampleEvery = 0, size_t bufferCapacity = 16384)
+        : m_sampleEvery(sampleEvery), m_bufferCapacity(bufferCapacity) {}
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Set before any thread registers
+    void setSampleEvery(uint64_t sampleEvery) { m_sampleEvery = sampleEvery; }
+
+    bool enabled() const { return m_sampleEvery != 0; }
+    bool sampled(uint64_t sequence) const { return m_sampleEvery != 0 && sequence % m_sampleEvery == 0; }
+
+    // Buffer for the calling thread, or nullptr when tracing is off
+    TraceBuffer* registerThread(const std::string &name);
+
+    // Drains every buffer into the collected records
+    void collect();
+
+    // Collects, then writes the Chrome trace; false if the file can't be written
+    bool writeChromeTrace(const std::string &path);
+
+    size_t recordsCollected() const;
+    uint64_t recordsDropped() const;
+
+private:
+    struct Collected {
+        TraceRecord record;
+        size_t buffer;  // index into m_buffers, for the thread name
+    };
+
+    uint64_t m_sampleEvery;
+    size_t m_bufferCapacity;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+    std::vector<Collected> m_collected;
+};
+
+#endif // TRACING_HPP
@@ -0,0 +1,79 @@
+#include "allocation.hpp"
+
+#include <algorithm>
+
+namespace {
+
+__extension__ typedef unsigned __int128 Wide;
+
+// floor(a * b / c), exact for any 64-bit operands as long as b <= c
+uint64_t mulDiv(uint64_t a, uint64_t b, uint64_t c) {
+    return static_cast<uint64_t>(static_cast<Wide>(a) * b / c);
+}
+
+} // namespace
+
+bool parseMatchingAlgorithm(const std::string &name, MatchingAlgorithm &algorithm) {
+    if (name == "fifo") {
+        algorithm = MatchingAlgorithm::Fifo;
+    } else if (name == "pro-rata") {
+        algorithm = MatchingAlgorithm::ProRata;
+    } else if (name == "price-time-pro-rata") {
+        algorithm = MatchingAlgorithm::PriceTimeProRata;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+uint64_t allocateLevel(const AllocationRules &rules, uint64_t qty, const uint64_t *resting,
+                       size_t count, uint64_t levelTotal, uint64_t *out) {
+    uint64_t fill = std::min(qty, levelTotal);
+    if (fill == levelTotal) {
+        // Takes the whole level; nothing to apportion
+        std::copy(resting, resting + count, out);
+        return fill;
+    }
+    std::fill(out, out + count, 0);
+    uint64_t left = fill;
+
+    if (rules.topOrderSlice > 0 && count > 0) {
+        out[0] = std::min({resting[0], rules.topOrderSlice, left});
+        left -= out[0];
+    }
+
+    if (rules.algorithm == MatchingAlgorithm::PriceTimeProRata) {
+        uint64_t share = mulDiv(fill, rules.fifoPercent, 100);
+        share = std::min(share, left);
+        left -= share;
+        for (size_t i = 0; share > 0 && i < count; i++) {
+            uint64_t take = std::min(resting[i] - out[i], share);
+            out[i] += take;
+            share -= take;
+        }
+    }
+
+    if (left > 0) {
+        // Proportions of what each order still has, against what the level
+        // still has; the pool never exceeds that, so no share exceeds its order
+        uint64_t pool = left;
+        uint64_t unallocated = levelTotal - (fill - left);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t open = resting[i] - out[i];
+            uint64_t share = mulDiv(pool, open, unallocated);
+            if (share < rules.minAllocation) {
+                continue;
+            }
+            out[i] += share;
+            left -= share;
+        }
+    }
+
+    // Rounding and minimum-allocation residue, in time priority
+    for (size_t i = 0; left > 0 && i < count; i++) {
+        uint64_t take = std::min(resting[i] - out[i], left);
+        out[i] += take;
+        left -= take;
+    }
+    return fill;
+}
@@ -0,0 +1,67 @@
+#include "auction.hpp"
+
+#include <algorithm>
+
+AuctionEquilibrium findEquilibrium(const AuctionLevel *bids, size_t bidCount,
+                                   const AuctionLevel *asks, size_t askCount) {
+    AuctionEquilibrium best;
+    if (bidCount == 0 || askCount == 0 || bids[0].ticks < asks[0].ticks) {
+        return best;
+    }
+
+    // Cumulative curves as the candidate price p walks down from the best
+    // bid to the best ask: demand is the bid quantity at or above p, supply
+    // the ask quantity at or below p. Only level prices can be optimal.
+    uint64_t supply = 0;
+    size_t askEnd = 0;  // asks[0, askEnd) are priced at or below p
+    while (askEnd < askCount && asks[askEnd].ticks <= bids[0].ticks) {
+        supply += asks[askEnd].quantity;
+        askEnd++;
+    }
+    uint64_t demand = 0;
+    size_t bidEnd = 0;  // bids[0, bidEnd) are priced at or above p
+
+    int64_t price = bids[0].ticks;
+    while (true) {
+        while (askEnd > 0 && asks[askEnd - 1].ticks > price) {
+            askEnd--;
+            supply -= asks[askEnd].quantity;
+        }
+        while (bidEnd < bidCount && bids[bidEnd].ticks >= price) {
+            demand += bids[bidEnd].quantity;
+            bidEnd++;
+        }
+
+        uint64_t volume = std::min(demand, supply);
+        int64_t surplus = static_cast<int64_t>(demand) - static_cast<int64_t>(supply);
+        uint64_t imbalance = (surplus < 0) ? static_cast<uint64_t>(-surplus) : static_cast<uint64_t>(surplus);
+        uint64_t bestImbalance = (best.surplus < 0) ? static_cast<uint64_t>(-best.surplus)
+                                                    : static_cast<uint64_t>(best.surplus);
+        // Walking down, a later tie is a lower price: take it unless buyers press
+        if (!best.crossed || volume > best.volume ||
+            (volume == best.volume && (imbalance < bestImbalance ||
+                                       (imbalance == bestImbalance && surplus <= 0)))) {
+            best.crossed = true;
+            best.ticks = price;
+            best.volume = volume;
+            best.surplus = surplus;
+        }
+
+        // Next candidate: the highest level price below this one on either side
+        int64_t next = INT64_MIN;
+        if (bidEnd < bidCount) {
+            next = bids[bidEnd].ticks;
+        }
+        if (askEnd > 0) {
+            size_t i = (asks[askEnd - 1].ticks < price) ? askEnd - 1 : askEnd - 2;
+            if (i < askEnd) {
+                next = std::max(next, asks[i].ticks);
+            }
+        }
+        if (next < asks[0].ticks) {
+            break;  // below the best ask nothing trades
+        }
+        price = next;
+    }
+    return best;
+}
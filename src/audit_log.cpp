@@ -0,0 +1,414 @@
+#include "audit_log.hpp"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// File header: magic, format version, reserved
+constexpr char kAuditMagic[8] = {'O', 'B', 'A', 'U', 'D', 'I', 'T', '1'};
+constexpr uint32_t kAuditVersion = 1;
+constexpr size_t kHeaderBytes = sizeof(kAuditMagic) + 2 * sizeof(uint32_t);
+
+// Block header: event count, payload bytes (host byte order)
+constexpr size_t kBlockHeaderBytes = 2 * sizeof(uint32_t);
+
+uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+void putVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int64_t delta(uint64_t cur, uint64_t prev) { return static_cast<int64_t>(cur - prev); }
+
+} // namespace
+
+//////////////////// Names ////////////////////
+const char* auditEventTypeName(AuditEventType type) {
+    switch (type) {
+        case AuditEventType::Order:  return "order";
+        case AuditEventType::Reject: return "reject";
+        case AuditEventType::Trade:  return "trade";
+        case AuditEventType::Cancel: return "cancel";
+        default:                     return "unknown";
+    }
+}
+
+const char* cancelReasonName(CancelReason reason) {
+    switch (reason) {
+        case CancelReason::Requested: return "requested";
+        case CancelReason::SelfTrade: return "self_trade";
+        case CancelReason::Expired:   return "expired";
+        case CancelReason::Killed:    return "killed";
+        default:                      return "unknown";
+    }
+}
+
+uint8_t auditStatusCode(OrderStatus status) {
+    return orderStatusCode(status);
+}
+
+const char* auditStatusName(uint8_t code) {
+    return orderStatusName(code);
+}
+
+bool parseAuditBackpressure(const std::string &name, AuditBackpressure &mode) {
+    if (name == "block") {
+        mode = AuditBackpressure::Block;
+    } else if (name == "spill") {
+        mode = AuditBackpressure::Spill;
+    } else if (name == "drop") {
+        mode = AuditBackpressure::Drop;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//////////////////// Block Codec ////////////////////
+void encodeAuditBlock(const AuditEvent *events, size_t count, std::string &out) {
+    AuditEvent prev;
+    for (size_t i = 0; i < count; i++) {
+        const AuditEvent &e = events[i];
+        out.push_back(static_cast<char>(e.type));
+        out.push_back(static_cast<char>(e.kind));
+        out.push_back(static_cast<char>(e.side));
+        out.push_back(static_cast<char>(e.detail));
+        putVarint(out, zigzag(delta(e.timestampNs, prev.timestampNs)));
+        putVarint(out, zigzag(delta(e.sequence, prev.sequence)));
+        putVarint(out, zigzag(delta(e.orderId, prev.orderId)));
+        putVarint(out, zigzag(delta(e.counterpartyId, prev.counterpartyId)));
+        putVarint(out, zigzag(e.priceTicks - prev.priceTicks));
+        putVarint(out, e.quantity);
+        putVarint(out, e.filledQuantity);
+        putVarint(out, e.remainingQuantity);
+        putVarint(out, e.ownerId);
+        prev = e;
+    }
+}
+
+bool decodeAuditBlock(const uint8_t *data, size_t size, size_t count, std::vector<AuditEvent> &out) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+    AuditEvent prev;
+    for (size_t i = 0; i < count; i++) {
+        if (end - p < 4) {
+            return false;
+        }
+        AuditEvent e;
+        e.type = static_cast<AuditEventType>(p[0]);
+        e.kind = static_cast<OrderKind>(p[1]);
+        e.side = static_cast<Side>(p[2]);
+        e.detail = p[3];
+        p += 4;
+
+        uint64_t v[9];
+        for (uint64_t &field : v) {
+            if (!getVarint(p, end, field)) {
+                return false;
+            }
+        }
+        e.timestampNs = prev.timestampNs + static_cast<uint64_t>(unzigzag(v[0]));
+        e.sequence = prev.sequence + static_cast<uint64_t>(unzigzag(v[1]));
+        e.orderId = prev.orderId + static_cast<uint64_t>(unzigzag(v[2]));
+        e.counterpartyId = prev.counterpartyId + static_cast<uint64_t>(unzigzag(v[3]));
+        e.priceTicks = prev.priceTicks + unzigzag(v[4]);
+        e.quantity = v[5];
+        e.filledQuantity = v[6];
+        e.remainingQuantity = v[7];
+        e.ownerId = static_cast<uint32_t>(v[8]);
+        out.push_back(e);
+        prev = e;
+    }
+    return p == end;
+}
+
+//////////////////// AuditWriter ////////////////////
+AuditWriter::AuditWriter(const AuditConfig &config)
+    : m_config(config),
+      m_spareSegments(config.spillSegments + 1) {
+    size_t spares = (config.backpressure == AuditBackpressure::Spill) ? config.spillSegments : 0;
+    for (size_t i = 0; i <= spares; i++) {
+        m_segments.emplace_back(new Segment(config.ringCapacity));
+        if (i > 0) {
+            m_spareSegments.tryPush(m_segments.back().get());
+        }
+    }
+    m_head = m_segments.front().get();
+    m_tail = m_head;
+}
+
+AuditWriter::~AuditWriter() {
+    stop();
+}
+
+bool AuditWriter::start() {
+    m_startTimeSec = wallClockNs() / 1000000000ULL;
+    if (!openNextFile()) {
+        return false;
+    }
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&AuditWriter::run, this);
+    return true;
+}
+
+void AuditWriter::stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_running.store(false, std::memory_order_release);
+    m_thread.join();
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+void AuditWriter::onOrder(const Order &o) {
+    AuditEvent e;
+    e.timestampNs = wallClockNs();
+    e.sequence = o.sequence;
+    e.orderId = o.orderId;
+    e.priceTicks = toTicks(o.price);
+    e.quantity = o.quantity;
+    e.filledQuantity = o.filledQuantity;
+    e.remainingQuantity = o.remainingQuantity;
+    e.ownerId = o.ownerId;
+    e.kind = o.kind;
+    e.side = o.side;
+    e.detail = auditStatusCode(o.status);
+    bool refused = o.status == OrderStatus::Rejected || o.status == OrderStatus::PostOnlyRejected ||
+                   o.status == OrderStatus::CancelRejected || o.status == OrderStatus::AuctionRejected ||
+                   o.status == OrderStatus::ReplaceRejected;
+    e.type = refused ? AuditEventType::Reject : AuditEventType::Order;
+    push(e);
+}
+
+void AuditWriter::onTrade(const Order &incoming, const Order &resting, double price, uint64_t quantity) {
+    AuditEvent e;
+    e.timestampNs = wallClockNs();
+    e.sequence = incoming.sequence;
+    e.orderId = incoming.orderId;
+    e.counterpartyId = resting.orderId;
+    e.priceTicks = toTicks(price);
+    e.quantity = quantity;
+    e.filledQuantity = incoming.filledQuantity;
+    e.remainingQuantity = incoming.remainingQuantity;
+    e.ownerId = incoming.ownerId;
+    e.type = AuditEventType::Trade;
+    e.kind = incoming.kind;
+    e.side = incoming.side;
+    push(e);
+}
+
+void AuditWriter::onCancel(const Order &resting, uint64_t quantity, CancelReason reason) {
+    AuditEvent e;
+    e.timestampNs = wallClockNs();
+    e.sequence = resting.sequence;
+    e.orderId = resting.orderId;
+    e.priceTicks = toTicks(resting.price);
+    e.quantity = quantity;
+    e.filledQuantity = resting.filledQuantity;
+    e.remainingQuantity = resting.remainingQuantity + resting.hiddenQuantity - quantity;
+    e.ownerId = resting.ownerId;
+    e.type = AuditEventType::Cancel;
+    e.kind = resting.kind;
+    e.side = resting.side;
+    e.detail = static_cast<uint8_t>(reason);
+    push(e);
+}
+
+void AuditWriter::push(const AuditEvent &e) {
+    if (m_tail->ring.tryPush(e)) {
+        return;
+    }
+    switch (m_config.backpressure) {
+        case AuditBackpressure::Block:
+            while (!m_tail->ring.tryPush(e)) {
+                std::this_thread::yield();
+            }
+            break;
+
+        case AuditBackpressure::Drop:
+            m_eventsDropped.fetch_add(1, std::memory_order_relaxed);
+            break;
+
+        case AuditBackpressure::Spill: {
+            // The writer returns each segment once it has moved past it
+            Segment *segment = nullptr;
+            if (!m_spareSegments.tryPop(segment)) {
+                m_eventsDropped.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            segment->ring.tryPush(e);
+            m_tail->next.store(segment, std::memory_order_release);
+            m_tail = segment;
+            m_segmentsSpilled.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+}
+
+bool AuditWriter::pop(AuditEvent &e) {
+    while (true) {
+        if (m_head->ring.tryPop(e)) {
+            return true;
+        }
+        Segment *next = m_head->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        // The producer never touches a segment after linking its successor,
+        // so one more look settles whether it is drained
+        if (m_head->ring.tryPop(e)) {
+            return true;
+        }
+        m_head->next.store(nullptr, std::memory_order_relaxed);
+        m_spareSegments.tryPush(m_head);
+        m_head = next;
+    }
+}
+
+void AuditWriter::run() {
+    std::vector<AuditEvent> batch;
+    batch.reserve(kBlockEvents);
+    while (true) {
+        // Read the flag first: anything pushed before stop() is then drained below
+        bool stopping = !m_running.load(std::memory_order_acquire);
+        AuditEvent e;
+        while (batch.size() < kBlockEvents && pop(e)) {
+            batch.push_back(e);
+        }
+        if (!batch.empty()) {
+            writeBlock(batch);
+            batch.clear();
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void AuditWriter::writeBlock(const std::vector<AuditEvent> &events) {
+    m_encoded.clear();
+    encodeAuditBlock(events.data(), events.size(), m_encoded);
+
+    uint64_t blockBytes = kBlockHeaderBytes + m_encoded.size();
+    if (m_file && m_fileBytes > kHeaderBytes && m_fileBytes + blockBytes > m_config.maxFileBytes) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        openNextFile();
+    }
+    if (!m_file) {
+        m_writeErrors.fetch_add(events.size(), std::memory_order_relaxed);
+        return;
+    }
+
+    uint32_t header[2] = {static_cast<uint32_t>(events.size()), static_cast<uint32_t>(m_encoded.size())};
+    bool ok = std::fwrite(header, sizeof(header), 1, m_file) == 1 &&
+              std::fwrite(m_encoded.data(), 1, m_encoded.size(), m_file) == m_encoded.size() &&
+              std::fflush(m_file) == 0;
+    if (!ok) {
+        m_writeErrors.fetch_add(events.size(), std::memory_order_relaxed);
+        return;
+    }
+    m_fileBytes += blockBytes;
+    m_eventsWritten.fetch_add(events.size(), std::memory_order_relaxed);
+}
+
+bool AuditWriter::openNextFile() {
+    char name[64];
+    std::snprintf(name, sizeof(name), "-%llu-%06u.bin",
+                  static_cast<unsigned long long>(m_startTimeSec),
+                  m_fileIndex.load(std::memory_order_relaxed));
+    std::string path = m_config.directory + "/" + m_config.prefix + name;
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        std::perror(path.c_str());
+        return false;
+    }
+    uint32_t version[2] = {kAuditVersion, 0};
+    if (std::fwrite(kAuditMagic, sizeof(kAuditMagic), 1, m_file) != 1 ||
+        std::fwrite(version, sizeof(version), 1, m_file) != 1) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_fileBytes = kHeaderBytes;
+    m_fileIndex.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+//////////////////// AuditReader ////////////////////
+AuditReader::AuditReader(const std::string &path) {
+    m_file = std::fopen(path.c_str(), "rb");
+    if (!m_file) {
+        return;
+    }
+    char magic[sizeof(kAuditMagic)];
+    uint32_t version[2];
+    if (std::fread(magic, sizeof(magic), 1, m_file) != 1 ||
+        std::memcmp(magic, kAuditMagic, sizeof(magic)) != 0 ||
+        std::fread(version, sizeof(version), 1, m_file) != 1 ||
+        version[0] != kAuditVersion) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+AuditReader::~AuditReader() {
+    if (m_file) {
+        std::fclose(m_file);
+    }
+}
+
+bool AuditReader::next(AuditEvent &e) {
+    if (m_pos == m_block.size() && !readBlock()) {
+        return false;
+    }
+    e = m_block[m_pos++];
+    return true;
+}
+
+bool AuditReader::readBlock() {
+    m_block.clear();
+    m_pos = 0;
+    uint32_t header[2];
+    if (!m_file || std::fread(header, sizeof(header), 1, m_file) != 1 || header[0] == 0) {
+        return false;
+    }
+    std::vector<uint8_t> payload(header[1]);
+    if (std::fread(payload.data(), 1, payload.size(), m_file) != payload.size()) {
+        return false;
+    }
+    if (!decodeAuditBlock(payload.data(), payload.size(), header[0], m_block)) {
+        m_block.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,850 @@
+#include "book_verifier.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+#include "price_ladder.hpp"
+
+namespace {
+
+bool isNewOrderKind(OrderKind kind) {
+    return kind == OrderKind::Limit || kind == OrderKind::Market || kind == OrderKind::IOC ||
+           kind == OrderKind::FOK || kind == OrderKind::PostOnly || kind == OrderKind::StopLoss;
+}
+
+// toTicks clamps prices the book refuses (priceInRange) to the range's ends
+bool ticksInRange(int64_t ticks) {
+    return ticks > -kMaxPriceTicks && ticks < kMaxPriceTicks;
+}
+
+} // namespace
+
+//////////////////// ShadowMatcher ////////////////////
+ShadowMatcher::ShadowMatcher(const VerifierConfig &config, AlertFn onAlert)
+    : m_config(config),
+      m_tickTicks(std::max<int64_t>(1, toTicks(config.tickSize))),
+      m_onAlert(std::move(onAlert)) {}
+
+void ShadowMatcher::process(const VerifierEvent &e) {
+    switch (e.type) {
+        case VerifierEventType::OrderInput:
+        case VerifierEventType::ClockInput:
+        case VerifierEventType::PhaseInput:
+            if (m_open) {
+                endInput();
+            }
+            beginInput(e);
+            return;
+        default:
+            break;
+    }
+    if (!m_open) {
+        alert("book event outside any input");
+        return;
+    }
+    if (e.type == VerifierEventType::Cancel && static_cast<CancelReason>(e.detail) == CancelReason::Expired) {
+        // Expiries come first, before the input itself takes effect
+        if (m_predicted) {
+            alert("order " + std::to_string(e.orderId) + " expired after the input took effect");
+        }
+        applyCancel(e);
+        return;
+    }
+    if (m_input.type == VerifierEventType::OrderInput && !m_predicted) {
+        predict(m_prediction);
+        m_predicted = true;
+    }
+    switch (e.type) {
+        case VerifierEventType::Trade:
+            if (m_input.type == VerifierEventType::PhaseInput) {
+                applyUncrossTrade(e);
+            } else if (m_input.type == VerifierEventType::OrderInput) {
+                applyTrade(e);
+            } else {
+                alert("trade on a clock input");
+            }
+            break;
+        case VerifierEventType::Cancel:
+            applyCancel(e);
+            break;
+        case VerifierEventType::Rest:
+            applyRest(e);
+            break;
+        case VerifierEventType::Outcome:
+            if (m_input.type != VerifierEventType::OrderInput) {
+                alert("order outcome without an order input");
+                break;
+            }
+            checkOutcome(e);
+            m_outcome = true;
+            endInput();
+            break;
+        default:
+            break;
+    }
+}
+
+void ShadowMatcher::finish() {
+    if (m_open) {
+        endInput();
+    }
+}
+
+void ShadowMatcher::beginInput(const VerifierEvent &e) {
+    m_open = true;
+    m_predicted = false;
+    m_outcome = false;
+    m_input = e;
+    m_prediction = Prediction();
+    m_fills.clear();
+    m_traded = 0;
+    m_decremented = 0;
+    m_rests = 0;
+    m_restQuantity = 0;
+    m_uncrossTicks = 0;
+
+    if (e.nowMs < m_nowMs) {
+        alert("clock went back from " + std::to_string(m_nowMs) + " to " + std::to_string(e.nowMs));
+    } else {
+        m_nowMs = e.nowMs;
+    }
+    if (e.type == VerifierEventType::PhaseInput) {
+        m_phase = static_cast<TradingPhase>(e.detail);
+    }
+}
+
+void ShadowMatcher::endInput() {
+    if (m_input.type == VerifierEventType::OrderInput && !m_outcome) {
+        alert("input ended without an outcome");
+    }
+    checkBook();
+    m_open = false;
+    m_inputs++;
+}
+
+void ShadowMatcher::alert(const std::string &message) {
+    m_alerts++;
+    if (!m_onAlert) {
+        return;
+    }
+    VerifierAlert a;
+    a.input = m_inputs;
+    if (m_open && m_input.type == VerifierEventType::OrderInput) {
+        a.sequence = m_input.sequence;
+        a.orderId = m_input.orderId;
+    }
+    a.message = message;
+    m_onAlert(a);
+}
+
+bool ShadowMatcher::bestTicks(Side side, int64_t &ticks) const {
+    const Ladder &l = ladder(side);
+    if (l.empty()) {
+        return false;
+    }
+    ticks = ticksOf(side, l.begin()->first);
+    return true;
+}
+
+ShadowMatcher::ShadowOrder* ShadowMatcher::find(uint64_t id) {
+    auto found = m_index.find(id);
+    return found == m_index.end() ? nullptr : &*found->second;
+}
+
+bool ShadowMatcher::stpApplies(uint32_t ownerId) const {
+    return m_config.stp != SelfTradePrevention::None && ownerId != 0;
+}
+
+//////////////////// Prediction ////////////////////
+void ShadowMatcher::predict(Prediction &p) {
+    const VerifierEvent &in = m_input;
+    // Matching is only predicted under FIFO and without self-trade prevention
+    bool fifo = m_config.allocation.algorithm == MatchingAlgorithm::Fifo;
+    p.valid = true;
+    p.status = OrderStatus::Rejected;
+    p.filled = in.filledQuantity;
+    p.remaining = in.remainingQuantity;
+
+    if (in.kind == OrderKind::Cancel) {
+        const ShadowOrder *r = find(in.orderId);
+        if (r) {
+            p.status = OrderStatus::Cancelled;
+            p.filled = r->filled;
+            p.remaining = 0;
+        } else {
+            p.status = OrderStatus::CancelRejected;
+        }
+        return;
+    }
+
+    if (in.kind == OrderKind::Kill) {
+        p.remaining = 0;
+        p.checkQuantity = true;
+        if (in.ownerId == 0) {
+            p.quantity = 0;
+            return;
+        }
+        p.status = OrderStatus::Killed;
+        for (const auto &entry : m_index) {
+            p.quantity += entry.second->ownerId == in.ownerId;
+        }
+        return;
+    }
+
+    if (in.kind == OrderKind::Replace) {
+        ShadowOrder *r = find(in.orderId);
+        if (!r || in.quantity == 0) {
+            p.status = OrderStatus::ReplaceRejected;
+            p.remaining = 0;
+            return;
+        }
+        uint64_t open = r->slice + r->hidden;
+        int64_t ticks = in.priceTicks;
+        p.side = r->side;
+        p.filledBefore = r->filled;
+        if (ticks == r->ticks && in.quantity <= open) {
+            p.status = OrderStatus::Replaced;
+            p.filled = r->filled;
+            p.remaining = in.quantity;
+            return;
+        }
+        if (r->kind != OrderKind::Limit && r->kind != OrderKind::PostOnly) {
+            p.valid = false;  // nothing else rests
+            return;
+        }
+        // Taken out and entered again as new
+        Entry moved{r->kind, r->side, ticks, in.quantity, r->expireTimeMs, r->ownerId};
+        if (m_phase == TradingPhase::Auction) {
+            restForAuction(moved, p);
+        } else {
+            p.valid = fifo && !stpApplies(r->ownerId);
+            predictEntry(moved, p);
+        }
+        bool rested = p.status == OrderStatus::Open || p.status == OrderStatus::PartiallyFilled;
+        if (rested && p.filled == p.filledBefore) {
+            p.status = OrderStatus::Replaced;
+        }
+        return;
+    }
+
+    if (!isNewOrderKind(in.kind) || in.side == Side::Unknown) {
+        return;
+    }
+    p.side = in.side;
+    Entry entry{in.kind, in.side, in.priceTicks, in.remainingQuantity, in.expireTimeMs, in.ownerId};
+
+    if (m_phase == TradingPhase::Auction) {
+        if (in.kind != OrderKind::Limit && in.kind != OrderKind::PostOnly) {
+            p.status = OrderStatus::AuctionRejected;
+            return;
+        }
+        restForAuction(entry, p);
+        return;
+    }
+    p.valid = fifo && !stpApplies(in.ownerId);
+
+    if (in.kind == OrderKind::StopLoss) {
+        // Triggered against the opposite touch, as a market order; otherwise
+        // a limit at the stop price
+        int64_t best = 0;
+        bool triggered = false;
+        if (bestTicks(opposite(in.side), best)) {
+            double bestPrice = fromTicks(best);
+            triggered = in.side == Side::Buy ? bestPrice <= in.stopPrice : bestPrice >= in.stopPrice;
+        }
+        entry.kind = triggered ? OrderKind::Market : OrderKind::Limit;
+        entry.limitTicks = triggered ? 0 : toTicks(in.stopPrice);
+    }
+    predictEntry(entry, p);
+}
+
+void ShadowMatcher::restForAuction(const Entry &entry, Prediction &p) const {
+    // Nothing may trade until the uncross
+    p.side = entry.side;
+    p.limitTicks = entry.side == Side::Buy ? kNoSellLimit : kNoBuyLimit;
+    p.filled = p.filledBefore;
+    p.remaining = entry.quantity;
+    if (entry.expireTimeMs != 0 && entry.expireTimeMs <= m_nowMs) {
+        p.status = OrderStatus::Expired;
+        return;
+    }
+    if (!ticksInRange(entry.limitTicks)) {
+        p.status = OrderStatus::Rejected;
+        return;
+    }
+    p.status = OrderStatus::Open;
+    p.rests = true;
+    p.restTicks = entry.limitTicks;
+}
+
+void ShadowMatcher::predictEntry(const Entry &entry, Prediction &p) const {
+    Side side = entry.side;
+    bool priced = entry.kind != OrderKind::Market;
+    bool rests = entry.kind == OrderKind::Limit || entry.kind == OrderKind::PostOnly;
+    int64_t limit = priced ? entry.limitTicks : (side == Side::Buy ? kNoBuyLimit : kNoSellLimit);
+    const Ladder &opp = ladder(opposite(side));
+    int64_t best = 0;
+    bool crosses = bestTicks(opposite(side), best) && withinLimit(side, best, limit);
+
+    p.status = OrderStatus::Open;
+    p.filled = p.filledBefore;
+    p.remaining = entry.quantity;
+    p.passiveOnly = entry.kind == OrderKind::PostOnly;
+    p.limitTicks = limit;
+
+    if (priced && !ticksInRange(limit)) {
+        p.status = OrderStatus::Rejected;
+        return;
+    }
+    if (rests && entry.expireTimeMs != 0 && entry.expireTimeMs <= m_nowMs) {
+        p.status = OrderStatus::Expired;
+        return;
+    }
+    if (entry.kind == OrderKind::PostOnly && crosses) {
+        if (m_config.postOnly == PostOnlyMode::Reject) {
+            p.status = OrderStatus::PostOnlyRejected;
+            return;
+        }
+        limit = side == Side::Buy ? best - m_tickTicks : best + m_tickTicks;
+        p.limitTicks = limit;
+        p.status = OrderStatus::Repriced;
+        crosses = false;
+    }
+    if (entry.kind == OrderKind::FOK) {
+        // Iceberg reserves count: they refill their slices within the match
+        uint64_t available = 0;
+        for (auto level = opp.begin(); level != opp.end() && available < entry.quantity; ++level) {
+            if (!withinLimit(side, ticksOf(opposite(side), level->first), limit)) {
+                break;
+            }
+            for (const ShadowOrder &o : level->second) {
+                available += o.slice + o.hidden;
+            }
+        }
+        if (available < entry.quantity) {
+            p.status = OrderStatus::FokNoFill;
+            return;
+        }
+    }
+
+    // FIFO, on a copy of each level reached: exhausted iceberg slices
+    // refill at the back of their level
+    struct Slice {
+        uint64_t id, slice, hidden, display;
+    };
+    uint64_t remaining = entry.quantity;
+    for (auto level = opp.begin(); crosses && level != opp.end() && remaining > 0; ++level) {
+        int64_t ticks = ticksOf(opposite(side), level->first);
+        if (!withinLimit(side, ticks, limit)) {
+            break;
+        }
+        std::deque<Slice> queue;
+        for (const ShadowOrder &o : level->second) {
+            queue.push_back(Slice{o.id, o.slice, o.hidden, o.display});
+        }
+        while (remaining > 0 && !queue.empty()) {
+            Slice front = queue.front();
+            queue.pop_front();
+            uint64_t qty = std::min(remaining, front.slice);
+            p.fills.push_back(Fill{front.id, qty, ticks});
+            remaining -= qty;
+            front.slice -= qty;
+            if (front.slice > 0) {
+                queue.push_front(front);
+            } else if (front.hidden > 0) {
+                front.slice = std::min(front.display, front.hidden);
+                front.hidden -= front.slice;
+                queue.push_back(front);
+            }
+        }
+    }
+
+    p.filled = p.filledBefore + (entry.quantity - remaining);
+    p.remaining = remaining;
+    if (remaining == 0) {
+        p.status = OrderStatus::Executed;
+    } else if (rests && !ticksInRange(limit)) {
+        p.status = OrderStatus::Rejected;  // repriced out of range
+    } else if (rests) {
+        if (p.filled > 0) {
+            p.status = OrderStatus::PartiallyFilled;
+        }
+        p.rests = true;
+        p.restTicks = limit;
+    } else if (p.filled > 0) {
+        p.status = OrderStatus::PartiallyFilled;
+    } else {
+        p.status = entry.kind == OrderKind::Market ? OrderStatus::Cancelled
+                 : entry.kind == OrderKind::IOC    ? OrderStatus::IocNoFill
+                                                   : OrderStatus::FokNoFill;
+    }
+}
+
+//////////////////// Applying Events ////////////////////
+void ShadowMatcher::applyTrade(const VerifierEvent &e) {
+    const Prediction &p = m_prediction;
+    std::string trade = "trade of " + std::to_string(e.quantity) + " with " + std::to_string(e.otherId);
+    if (e.orderId != m_input.orderId) {
+        alert(trade + " names order " + std::to_string(e.orderId) + " as the incoming one");
+    }
+    if (p.side == Side::Unknown) {
+        alert(trade + " by an order that cannot trade");
+        return;
+    }
+    if (p.passiveOnly) {
+        alert(trade + " by a post-only order");
+    }
+    ShadowOrder *r = find(e.otherId);
+    if (!r || r->side != opposite(p.side)) {
+        alert(trade + ": no such order on the other side");
+        return;
+    }
+    int64_t best = 0;
+    bestTicks(r->side, best);
+    const Level &level = ladder(r->side).begin()->second;
+    if (r->ticks != best) {
+        alert(trade + " at " + std::to_string(r->ticks) + " ticks, behind the touch at " + std::to_string(best));
+    } else if (m_config.allocation.algorithm == MatchingAlgorithm::Fifo && level.front().id != r->id) {
+        alert(trade + " ahead of " + std::to_string(level.front().id) + ", first in the queue");
+    }
+    if (e.priceTicks != r->ticks) {
+        alert(trade + " at " + std::to_string(e.priceTicks) + " ticks, not its resting price " +
+              std::to_string(r->ticks));
+    }
+    if (!withinLimit(p.side, r->ticks, p.limitTicks)) {
+        alert(trade + " through the incoming limit of " + std::to_string(p.limitTicks) + " ticks");
+    }
+    if (e.quantity == 0 || e.quantity > r->slice) {
+        alert(trade + ", which shows only " + std::to_string(r->slice));
+        return;
+    }
+    m_fills.push_back(Fill{r->id, e.quantity, e.priceTicks});
+    m_traded += e.quantity;
+    r->filled += e.quantity;
+    consume(*r, e.quantity);
+}
+
+void ShadowMatcher::applyUncrossTrade(const VerifierEvent &e) {
+    std::string trade = "uncross of " + std::to_string(e.quantity) + " between " + std::to_string(e.orderId) +
+                        " and " + std::to_string(e.otherId);
+    if (static_cast<TradingPhase>(m_input.detail) != TradingPhase::Continuous) {
+        alert(trade + " on entering an auction");
+    }
+    if (m_fills.empty()) {
+        m_uncrossTicks = e.priceTicks;
+    } else if (e.priceTicks != m_uncrossTicks) {
+        alert(trade + " at " + std::to_string(e.priceTicks) + " ticks; the uncross price is " +
+              std::to_string(m_uncrossTicks));
+    }
+    ShadowOrder *bid = find(e.orderId);
+    ShadowOrder *ask = find(e.otherId);
+    if (!bid || !ask || bid->side != Side::Buy || ask->side != Side::Sell) {
+        alert(trade + ": not a resting bid and ask");
+        return;
+    }
+    if (ladder(Side::Buy).begin()->second.front().id != bid->id ||
+        ladder(Side::Sell).begin()->second.front().id != ask->id) {
+        alert(trade + ": not the first in priority on both sides");
+    }
+    if (bid->ticks < e.priceTicks || ask->ticks > e.priceTicks) {
+        alert(trade + " at " + std::to_string(e.priceTicks) + " ticks, outside a limit");
+    }
+    if (e.quantity == 0 || e.quantity > bid->slice || e.quantity > ask->slice) {
+        alert(trade + ", more than is shown");
+        return;
+    }
+    m_fills.push_back(Fill{ask->id, e.quantity, e.priceTicks});
+    bid->filled += e.quantity;
+    ask->filled += e.quantity;
+    consume(*bid, e.quantity);
+    consume(*ask, e.quantity);
+}
+
+void ShadowMatcher::applyCancel(const VerifierEvent &e) {
+    CancelReason reason = static_cast<CancelReason>(e.detail);
+    std::string cancel = "cancel of " + std::to_string(e.quantity) + " from " + std::to_string(e.orderId);
+    ShadowOrder *r = find(e.orderId);
+    if (!r) {
+        alert(cancel + ": not resting");
+        return;
+    }
+    uint64_t open = r->slice + r->hidden;
+    if (e.quantity == 0 || e.quantity > open) {
+        alert(cancel + ", which has " + std::to_string(open) + " open");
+        return;
+    }
+    switch (reason) {
+        case CancelReason::Expired:
+            if (r->expireTimeMs == 0 || r->expireTimeMs > m_nowMs) {
+                alert(cancel + ": expired at " + std::to_string(m_nowMs) + ", due at " +
+                      std::to_string(r->expireTimeMs));
+            }
+            break;
+        case CancelReason::Killed:
+            if (m_input.kind != OrderKind::Kill || r->ownerId != m_input.ownerId) {
+                alert(cancel + ": killed, but its owner was not");
+            }
+            break;
+        case CancelReason::SelfTrade: {
+            int64_t best = 0;
+            if (!stpApplies(m_input.ownerId) || r->ownerId != m_input.ownerId) {
+                alert(cancel + ": self-trade prevention between different owners");
+            } else if (r->side != opposite(m_prediction.side) || !bestTicks(r->side, best) || r->ticks != best) {
+                alert(cancel + ": self-trade prevention away from the touch");
+            }
+            if (m_config.stp == SelfTradePrevention::Decrement) {
+                if (e.quantity > r->slice) {
+                    alert(cancel + ": decremented by more than it shows");
+                    return;
+                }
+                m_decremented += e.quantity;
+                consume(*r, e.quantity);
+                return;
+            }
+            break;
+        }
+        case CancelReason::Requested:
+            if (e.quantity < open) {
+                // A replace down in size keeps the order's place
+                uint64_t hidden = std::min(e.quantity, r->hidden);
+                r->hidden -= hidden;
+                r->slice -= e.quantity - hidden;
+                return;
+            }
+            break;
+    }
+    if (e.quantity != open) {
+        alert(cancel + " of " + std::to_string(open) + " open: the rest was left behind");
+    }
+    remove(e.orderId);
+}
+
+void ShadowMatcher::applyRest(const VerifierEvent &e) {
+    m_rests++;
+    m_restQuantity = e.remainingQuantity;
+    std::string rest = "order " + std::to_string(e.orderId) + " rested";
+    if (m_index.count(e.orderId)) {
+        alert(rest + " while already resting");
+        return;
+    }
+    if (e.remainingQuantity == 0 || e.side == Side::Unknown) {
+        alert(rest + " with nothing to rest");
+        return;
+    }
+    if (m_input.type != VerifierEventType::OrderInput || e.orderId != m_input.orderId) {
+        alert(rest + " on another order's input");
+    }
+    if (m_prediction.side != Side::Unknown && e.side != m_prediction.side) {
+        alert(rest + " on the wrong side");
+    }
+
+    ShadowOrder o;
+    o.id = e.orderId;
+    o.ownerId = e.ownerId;
+    o.side = e.side;
+    o.kind = e.kind;
+    o.ticks = e.priceTicks;
+    o.display = e.displayQuantity;
+    o.slice = e.remainingQuantity;
+    o.hidden = 0;
+    if (o.display > 0 && o.slice > o.display) {
+        o.hidden = o.slice - o.display;
+        o.slice = o.display;
+    }
+    o.expireTimeMs = e.expireTimeMs;
+    o.filled = e.filledQuantity;
+
+    Level &level = ladder(o.side)[keyOf(o.side, o.ticks)];
+    level.push_back(o);
+    m_index[o.id] = std::prev(level.end());
+    if (o.expireTimeMs != 0) {
+        m_expiries.emplace(o.expireTimeMs, o.id);
+    }
+}
+
+void ShadowMatcher::consume(ShadowOrder &o, uint64_t qty) {
+    o.slice -= qty;
+    if (o.slice > 0) {
+        return;
+    }
+    if (o.hidden == 0) {
+        remove(o.id);
+        return;
+    }
+    o.slice = std::min(o.display, o.hidden);
+    o.hidden -= o.slice;
+    Level &level = ladder(o.side)[keyOf(o.side, o.ticks)];
+    level.splice(level.end(), level, m_index[o.id]);
+}
+
+void ShadowMatcher::remove(uint64_t id) {
+    auto found = m_index.find(id);
+    if (found == m_index.end()) {
+        return;
+    }
+    Level::iterator node = found->second;
+    Ladder &l = ladder(node->side);
+    auto level = l.find(keyOf(node->side, node->ticks));
+    level->second.erase(node);
+    if (level->second.empty()) {
+        l.erase(level);
+    }
+    m_index.erase(found);
+}
+
+//////////////////// Checks ////////////////////
+void ShadowMatcher::checkOutcome(const VerifierEvent &e) {
+    const VerifierEvent &in = m_input;
+    const Prediction &p = m_prediction;
+    OrderStatus status = static_cast<OrderStatus>(e.detail);
+    std::string order = "order " + std::to_string(e.orderId);
+    if (e.orderId != in.orderId) {
+        alert("outcome for " + order + " on the input of order " + std::to_string(in.orderId));
+    }
+    if (m_rests > 1) {
+        alert(order + " rested " + std::to_string(m_rests) + " times");
+    }
+
+    // Conservation holds whatever the matching rules
+    if (isNewOrderKind(in.kind) && in.side != Side::Unknown) {
+        if (e.filledQuantity - in.filledQuantity != m_traded) {
+            alert(order + " reports " + std::to_string(e.filledQuantity - in.filledQuantity) +
+                  " filled but traded " + std::to_string(m_traded));
+        }
+        if (e.filledQuantity - in.filledQuantity + e.remainingQuantity + m_decremented != in.remainingQuantity) {
+            alert(order + " of " + std::to_string(in.remainingQuantity) + " reports " +
+                  std::to_string(e.filledQuantity - in.filledQuantity) + " filled and " +
+                  std::to_string(e.remainingQuantity) + " remaining");
+        }
+    }
+    if (status == OrderStatus::Executed && e.remainingQuantity != 0) {
+        alert(order + " executed with " + std::to_string(e.remainingQuantity) + " remaining");
+    }
+    if (m_rests == 1 && m_restQuantity != e.remainingQuantity) {
+        alert(order + " rested " + std::to_string(m_restQuantity) + " but reports " +
+              std::to_string(e.remainingQuantity) + " remaining");
+    }
+
+    if (!p.valid) {
+        return;
+    }
+    size_t common = std::min(p.fills.size(), m_fills.size());
+    for (size_t i = 0; i < common; i++) {
+        const Fill &want = p.fills[i];
+        const Fill &got = m_fills[i];
+        if (want.restingId != got.restingId || want.quantity != got.quantity || want.ticks != got.ticks) {
+            alert(order + " trade " + std::to_string(i + 1) + " was " + std::to_string(got.quantity) + " with " +
+                  std::to_string(got.restingId) + " at " + std::to_string(got.ticks) + ", expected " +
+                  std::to_string(want.quantity) + " with " + std::to_string(want.restingId) + " at " +
+                  std::to_string(want.ticks));
+            break;
+        }
+    }
+    if (p.fills.size() != m_fills.size()) {
+        alert(order + " made " + std::to_string(m_fills.size()) + " trades, expected " +
+              std::to_string(p.fills.size()));
+    }
+    if (status != p.status) {
+        alert(order + " ended " + orderStatusName(e.detail) + ", expected " + orderStatusName(p.status));
+    }
+    if (e.filledQuantity != p.filled || e.remainingQuantity != p.remaining) {
+        alert(order + " reports " + std::to_string(e.filledQuantity) + " filled and " +
+              std::to_string(e.remainingQuantity) + " remaining, expected " + std::to_string(p.filled) +
+              " and " + std::to_string(p.remaining));
+    }
+    if (p.checkQuantity && e.quantity != p.quantity) {
+        alert(order + " reports " + std::to_string(e.quantity) + ", expected " + std::to_string(p.quantity));
+    }
+    if (p.rests != (m_rests > 0)) {
+        alert(order + (p.rests ? " did not rest" : " rested unexpectedly"));
+    } else if (p.rests && find(e.orderId) && find(e.orderId)->ticks != p.restTicks) {
+        alert(order + " rested at " + std::to_string(find(e.orderId)->ticks) + " ticks, expected " +
+              std::to_string(p.restTicks));
+    }
+}
+
+void ShadowMatcher::checkBook() {
+    int64_t bid = 0;
+    int64_t ask = 0;
+    if (m_phase == TradingPhase::Continuous && bestTicks(Side::Buy, bid) && bestTicks(Side::Sell, ask) &&
+        bid >= ask) {
+        alert("book crossed: bid " + std::to_string(bid) + " ticks, ask " + std::to_string(ask));
+    }
+    // Every order due by now is gone; entries for orders that left early are dropped
+    for (auto it = m_expiries.begin(); it != m_expiries.end() && it->first <= m_nowMs;
+         it = m_expiries.erase(it)) {
+        const ShadowOrder *o = find(it->second);
+        if (o && o->expireTimeMs == it->first) {
+            alert("order " + std::to_string(o->id) + " still resting after expiring at " +
+                  std::to_string(it->first));
+        }
+    }
+}
+
+//////////////////// BookVerifier ////////////////////
+namespace {
+
+VerifierEvent eventFor(VerifierEventType type, const Order &o) {
+    VerifierEvent e;
+    e.type = type;
+    e.sequence = o.sequence;
+    e.orderId = o.orderId;
+    e.quantity = o.quantity;
+    e.filledQuantity = o.filledQuantity;
+    e.remainingQuantity = o.remainingQuantity;
+    e.displayQuantity = o.displayQuantity;
+    e.expireTimeMs = o.expireTimeMs;
+    e.priceTicks = toTicks(o.price);
+    e.stopPrice = o.stopPrice;
+    e.ownerId = o.ownerId;
+    e.kind = o.kind;
+    e.side = o.side;
+    return e;
+}
+
+} // namespace
+
+BookVerifier::BookVerifier(const VerifierConfig &config, ShadowMatcher::AlertFn onAlert,
+                           BookEventListener *next, InputJournal *nextJournal)
+    : m_onAlert(std::move(onAlert)),
+      m_shadow(config, [this](const VerifierAlert &a) { raise(a); }),
+      m_next(next),
+      m_nextJournal(nextJournal),
+      m_ring(config.ringCapacity) {}
+
+BookVerifier::~BookVerifier() {
+    stop();
+}
+
+void BookVerifier::start() {
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&BookVerifier::run, this);
+}
+
+void BookVerifier::stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_running.store(false, std::memory_order_release);
+    m_thread.join();
+}
+
+void BookVerifier::raise(const VerifierAlert &a) {
+    m_alertsRaised.fetch_add(1, std::memory_order_relaxed);
+    if (m_onAlert) {
+        m_onAlert(a);
+    }
+}
+
+void BookVerifier::push(const VerifierEvent &e) {
+    if (m_overflowed.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!m_ring.tryPush(e)) {
+        m_overflowed.store(true, std::memory_order_release);
+    }
+}
+
+void BookVerifier::run() {
+    bool suspended = false;
+    while (true) {
+        // Read the flags first: anything pushed before them is then drained below
+        bool stopping = !m_running.load(std::memory_order_acquire);
+        bool overflowed = m_overflowed.load(std::memory_order_acquire);
+        VerifierEvent e;
+        bool any = false;
+        while (!suspended && m_ring.tryPop(e)) {
+            m_shadow.process(e);
+            any = true;
+        }
+        m_inputsChecked.store(m_shadow.inputsChecked(), std::memory_order_relaxed);
+        if (any) {
+            continue;
+        }
+        if (overflowed && !suspended) {
+            // The input in progress lost events; checking it, or anything
+            // after it, would only raise false alarms
+            suspended = true;
+            VerifierAlert a;
+            a.input = m_shadow.inputsChecked();
+            a.message = "checker fell behind and the event ring overflowed; verification suspended";
+            raise(a);
+        }
+        if (stopping) {
+            if (!suspended) {
+                m_shadow.finish();
+                m_inputsChecked.store(m_shadow.inputsChecked(), std::memory_order_relaxed);
+            }
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void BookVerifier::onOrder(const Order &o) {
+    VerifierEvent e = eventFor(VerifierEventType::Outcome, o);
+    e.detail = orderStatusCode(o.status);
+    push(e);
+    if (m_next) {
+        m_next->onOrder(o);
+    }
+}
+
+void BookVerifier::onRest(const Order &o) {
+    push(eventFor(VerifierEventType::Rest, o));
+    if (m_next) {
+        m_next->onRest(o);
+    }
+}
+
+void BookVerifier::onTrade(const Order &incoming, const Order &resting, double price, uint64_t quantity) {
+    VerifierEvent e = eventFor(VerifierEventType::Trade, incoming);
+    e.otherId = resting.orderId;
+    e.quantity = quantity;
+    e.priceTicks = toTicks(price);
+    push(e);
+    if (m_next) {
+        m_next->onTrade(incoming, resting, price, quantity);
+    }
+}
+
+void BookVerifier::onCancel(const Order &resting, uint64_t quantity, CancelReason reason) {
+    VerifierEvent e = eventFor(VerifierEventType::Cancel, resting);
+    e.quantity = quantity;
+    e.detail = static_cast<uint8_t>(reason);
+    push(e);
+    if (m_next) {
+        m_next->onCancel(resting, quantity, reason);
+    }
+}
+
+void BookVerifier::onOrderInput(const Order &o, uint64_t nowMs) {
+    VerifierEvent e = eventFor(VerifierEventType::OrderInput, o);
+    e.nowMs = nowMs;
+    push(e);
+    if (m_nextJournal) {
+        m_nextJournal->onOrderInput(o, nowMs);
+    }
+}
+
+void BookVerifier::onClockInput(uint64_t nowMs) {
+    VerifierEvent e;
+    e.type = VerifierEventType::ClockInput;
+    e.nowMs = nowMs;
+    push(e);
+    if (m_nextJournal) {
+        m_nextJournal->onClockInput(nowMs);
+    }
+}
+
+void BookVerifier::onPhaseInput(TradingPhase phase, uint64_t nowMs) {
+    VerifierEvent e;
+    e.type = VerifierEventType::PhaseInput;
+    e.nowMs = nowMs;
+    e.detail = static_cast<uint8_t>(phase);
+    push(e);
+    if (m_nextJournal) {
+        m_nextJournal->onPhaseInput(phase, nowMs);
+    }
+}
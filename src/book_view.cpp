@@ -0,0 +1,187 @@
+#include "book_view.hpp"
+#include "json_utils.hpp"
+#include "orderbook.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+const char* queryTypeName(DepthQueryType type) {
+    switch (type) {
+        case DepthQueryType::TopOfBook: return "top_of_book";
+        case DepthQueryType::Levels:    return "l2";
+        default:                        return "l3";
+    }
+}
+
+std::string levelEntry(const DepthLevel &level) {
+    return "{\"price\":\"" + std::to_string(level.price) + "\",\"quantity\":\"" +
+           std::to_string(level.quantity) + "\"}";
+}
+
+// Iceberg reserves and owners stay private
+std::string orderEntry(const RestingOrder &o) {
+    return "{\"order_id\":\"" + std::to_string(o.orderId) + "\",\"price\":\"" + std::to_string(o.price) +
+           "\",\"quantity\":\"" + std::to_string(o.quantity) + "\"}";
+}
+
+void appendList(std::string &out, const char *name, const std::vector<std::string> &entries,
+                size_t begin, size_t end) {
+    out += ",\"";
+    out += name;
+    out += "\":[";
+    for (size_t i = begin; i < end; i++) {
+        if (i > begin) {
+            out.push_back(',');
+        }
+        out += entries[i];
+    }
+    out.push_back(']');
+}
+
+/**
+ * Packs the bid and ask entries, in order, into as few messages of about
+ * maxBytes as they fit. Every message carries both lists (possibly empty).
+ */
+std::vector<std::string> packEntries(const DepthQuery &query, uint64_t version,
+                                     const std::vector<std::string> &bids,
+                                     const std::vector<std::string> &asks, size_t maxBytes) {
+    std::string prefix = "{\"type\":\"" + std::string(queryTypeName(query.type)) + "\"";
+    if (!query.requestId.empty()) {
+        prefix += ",\"request_id\":" + escapeJsonString(query.requestId);
+    }
+    prefix += ",\"version\":\"" + std::to_string(version) + "\"";
+
+    // Entry ranges of each message
+    struct Part {
+        size_t bidBegin, bidEnd, askBegin, askEnd;
+    };
+    // The prefix, part numbers, list keys and brackets of every message
+    const size_t kEnvelopeBytes = prefix.size() + 96;
+    std::vector<Part> parts;
+    Part part{0, 0, 0, 0};
+    size_t bytes = kEnvelopeBytes;
+    auto take = [&](size_t entryBytes) {
+        if (bytes + entryBytes + 1 > maxBytes && bytes > kEnvelopeBytes) {
+            parts.push_back(part);
+            part = Part{part.bidEnd, part.bidEnd, part.askEnd, part.askEnd};
+            bytes = kEnvelopeBytes;
+        }
+        bytes += entryBytes + 1;
+    };
+    for (const std::string &e : bids) {
+        take(e.size());
+        part.bidEnd++;
+    }
+    for (const std::string &e : asks) {
+        take(e.size());
+        part.askEnd++;
+    }
+    parts.push_back(part);
+
+    std::vector<std::string> out;
+    for (size_t i = 0; i < parts.size(); i++) {
+        std::string msg = prefix;
+        if (parts.size() > 1) {
+            msg += ",\"part\":\"" + std::to_string(i + 1) + "\",\"parts\":\"" + std::to_string(parts.size()) + "\"";
+        }
+        appendList(msg, "bids", bids, parts[i].bidBegin, parts[i].bidEnd);
+        appendList(msg, "asks", asks, parts[i].askBegin, parts[i].askEnd);
+        msg.push_back('}');
+        out.push_back(std::move(msg));
+    }
+    return out;
+}
+
+std::string topOfBook(const DepthQuery &query, const BookDepthView &view) {
+    std::map<std::string, std::string> fields;
+    fields["type"] = queryTypeName(query.type);
+    fields["version"] = std::to_string(view.version);
+    if (!query.requestId.empty()) {
+        fields["request_id"] = query.requestId;
+    }
+    if (view.bidLevels > 0) {
+        fields["bid_price"] = std::to_string(view.bids[0].price);
+        fields["bid_quantity"] = std::to_string(view.bids[0].quantity);
+    }
+    if (view.askLevels > 0) {
+        fields["ask_price"] = std::to_string(view.asks[0].price);
+        fields["ask_quantity"] = std::to_string(view.asks[0].quantity);
+    }
+    return buildJsonString(fields);
+}
+
+} // namespace
+
+std::vector<DepthLevel> aggregateDepth(const std::vector<RestingOrder> &orders, size_t levels) {
+    std::vector<DepthLevel> out;
+    uint64_t cumulative = 0;
+    for (const RestingOrder &o : orders) {
+        if (out.empty() || out.back().price != o.price) {
+            if (out.size() == levels) {
+                break;
+            }
+            out.push_back(DepthLevel{o.price, 0, cumulative});
+        }
+        out.back().quantity += o.quantity;
+        cumulative += o.quantity;
+        out.back().cumulativeQuantity = cumulative;
+    }
+    return out;
+}
+
+std::vector<std::string> answerDepthQuery(OrderBook &book, const DepthQuery &query, size_t maxBytes) {
+    std::vector<std::string> bids, asks;
+
+    size_t viewLevels = book.depthViewLevels();
+    bool fromView = viewLevels > 0 && (query.type == DepthQueryType::TopOfBook ||
+                                       (query.type == DepthQueryType::Levels && query.levels <= viewLevels));
+    if (fromView) {
+        BookDepthView view = book.depthView();
+        if (query.type == DepthQueryType::TopOfBook) {
+            return {topOfBook(query, view)};
+        }
+        for (size_t i = 0; i < std::min<size_t>(query.levels, view.bidLevels); i++) {
+            bids.push_back(levelEntry(view.bids[i]));
+        }
+        for (size_t i = 0; i < std::min<size_t>(query.levels, view.askLevels); i++) {
+            asks.push_back(levelEntry(view.asks[i]));
+        }
+        return packEntries(query, view.version, bids, asks, maxBytes);
+    }
+
+    std::shared_ptr<const BookSnapshot> snap = book.orderSnapshot();
+    if (query.type == DepthQueryType::TopOfBook) {
+        // No depth view published: take the touch from the snapshot
+        BookDepthView view{};
+        view.version = snap->version;
+        std::vector<DepthLevel> bestBid = aggregateDepth(snap->bids, 1);
+        std::vector<DepthLevel> bestAsk = aggregateDepth(snap->asks, 1);
+        view.bidLevels = static_cast<uint32_t>(bestBid.size());
+        view.askLevels = static_cast<uint32_t>(bestAsk.size());
+        if (!bestBid.empty()) {
+            view.bids[0] = bestBid[0];
+        }
+        if (!bestAsk.empty()) {
+            view.asks[0] = bestAsk[0];
+        }
+        return {topOfBook(query, view)};
+    }
+    if (query.type == DepthQueryType::Levels) {
+        for (const DepthLevel &level : aggregateDepth(snap->bids, query.levels)) {
+            bids.push_back(levelEntry(level));
+        }
+        for (const DepthLevel &level : aggregateDepth(snap->asks, query.levels)) {
+            asks.push_back(levelEntry(level));
+        }
+    } else {
+        for (const RestingOrder &o : snap->bids) {
+            bids.push_back(orderEntry(o));
+        }
+        for (const RestingOrder &o : snap->asks) {
+            asks.push_back(orderEntry(o));
+        }
+    }
+    return packEntries(query, snap->version, bids, asks, maxBytes);
+}
@@ -0,0 +1,193 @@
+#include "confirmation_coalescer.hpp"
+#include "json_utils.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+// Retry delay after the socket reported it would block
+constexpr uint64_t kBlockedRetryNs = 100000;
+
+std::string throttleNotice(uint64_t dropped) {
+    std::map<std::string, std::string> fields;
+    fields["status"] = "throttled";
+    fields["dropped_confirmations"] = std::to_string(dropped);
+    return buildJsonString(fields);
+}
+
+} // namespace
+
+ConfirmationCoalescer::ConfirmationCoalescer(const CoalescerConfig &config, SendFn send, SentFn sent)
+    : m_config(config), m_send(std::move(send)), m_sent(std::move(sent)) {
+    m_config.clientQueueLimit = std::max<size_t>(1, m_config.clientQueueLimit);
+}
+
+uint64_t ConfirmationCoalescer::keyOf(const sockaddr_in &addr) {
+    return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+}
+
+void ConfirmationCoalescer::refill(Destination &d, uint64_t nowNs) const {
+    // Bucket holds up to one second's worth
+    double rate = static_cast<double>(m_config.clientRatePerSec);
+    if (nowNs > d.refillNs) {
+        d.tokens = std::min(rate, d.tokens + rate * static_cast<double>(nowNs - d.refillNs) / 1e9);
+        d.refillNs = nowNs;
+    }
+}
+
+bool ConfirmationCoalescer::add(const Confirmation &c, uint64_t nowNs) {
+    uint64_t key = keyOf(c.clientAddr);
+    Destination &d = m_destinations[key];
+    if (d.addrLen == 0) {
+        d.addr = c.clientAddr;
+        d.addrLen = c.clientAddrLen;
+        d.tokens = static_cast<double>(m_config.clientRatePerSec);
+        d.refillNs = nowNs;
+    }
+
+    bool accepted = d.queue.size() < m_config.clientQueueLimit;
+    if (accepted) {
+        d.queue.push_back(Pending{c, nowNs});
+    } else {
+        d.conflated++;
+        m_confirmationsConflated.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!d.active) {
+        d.active = true;
+        m_active.push_back(key);
+    }
+    return accepted;
+}
+
+bool ConfirmationCoalescer::drain(Destination &d, uint64_t nowNs, bool idle, bool ignoreRate) {
+    bool limited = m_config.clientRatePerSec > 0 && !ignoreRate;
+    if (limited) {
+        refill(d, nowNs);
+    }
+
+    while (!d.queue.empty() || d.conflated > 0) {
+        // Pack what fits: the throttle notice first, then confirmations in order
+        m_datagram.clear();
+        if (d.conflated > 0) {
+            m_datagram = throttleNotice(d.conflated);
+        }
+        size_t count = 0;
+        bool full = false;
+        for (const Pending &p : d.queue) {
+            if (limited && d.tokens < static_cast<double>(count + 1)) {
+                break;
+            }
+            // Render straight into the datagram; take it back out if it overflows
+            size_t mark = m_datagram.size();
+            if (mark > 0) {
+                m_datagram.push_back('\n');
+            }
+            appendConfirmationText(m_datagram, p.confirmation);
+            if (mark > 0 && m_datagram.size() > m_config.maxDatagramBytes) {
+                m_datagram.resize(mark);
+                full = true;
+                break;
+            }
+            count++;
+        }
+        if (m_datagram.empty()) {
+            break;  // out of tokens
+        }
+
+        bool due = idle || full || ignoreRate || d.queue.empty() ||
+                   nowNs - d.queue.front().queuedNs >= m_config.flushDelayNs;
+        if (!due) {
+            break;
+        }
+        SendResult result = m_send(d.addr, d.addrLen, m_datagram);
+        if (result == SendResult::WouldBlock) {
+            return false;
+        }
+
+        bool ok = (result == SendResult::Sent);
+        if (ok) {
+            m_datagramsSent.fetch_add(1, std::memory_order_relaxed);
+            m_confirmationsSent.fetch_add(count, std::memory_order_relaxed);
+        }
+        if (d.conflated > 0) {
+            d.conflated = 0;
+            m_throttleNotices.fetch_add(1, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < count; i++) {
+            const Pending &p = d.queue.front();
+            if (m_sent) {
+                m_sent(p.confirmation, nowNs - p.queuedNs, ok);
+            }
+            d.queue.pop_front();
+        }
+        if (limited) {
+            d.tokens -= static_cast<double>(count);
+        }
+    }
+    return true;
+}
+
+void ConfirmationCoalescer::flush(uint64_t nowNs, bool idle) {
+    if (nowNs < m_blockedUntilNs) {
+        return;
+    }
+    size_t kept = 0;
+    size_t i = 0;
+    for (; i < m_active.size(); i++) {
+        uint64_t key = m_active[i];
+        Destination &d = m_destinations[key];
+        if (!drain(d, nowNs, idle, false)) {
+            m_blockedUntilNs = nowNs + kBlockedRetryNs;
+            break;
+        }
+        if (d.queue.empty() && d.conflated == 0) {
+            d.active = false;
+            if (m_config.clientRatePerSec == 0) {
+                m_destinations.erase(key);  // nothing worth remembering
+            }
+        } else {
+            m_active[kept++] = key;
+        }
+    }
+    // Destinations not reached because the socket blocked stay listed
+    for (; i < m_active.size(); i++) {
+        m_active[kept++] = m_active[i];
+    }
+    m_active.resize(kept);
+}
+
+void ConfirmationCoalescer::flushAll(uint64_t nowNs) {
+    for (uint64_t key : m_active) {
+        Destination &d = m_destinations[key];
+        // A blocked socket at shutdown loses what's left
+        drain(d, nowNs, true, true);
+        for (const Pending &p : d.queue) {
+            if (m_sent) {
+                m_sent(p.confirmation, nowNs - p.queuedNs, false);
+            }
+        }
+        d.queue.clear();
+        d.conflated = 0;
+        d.active = false;
+    }
+    m_active.clear();
+}
+
+uint64_t ConfirmationCoalescer::nextDeadlineNs() const {
+    uint64_t deadline = UINT64_MAX;
+    for (uint64_t key : m_active) {
+        const Destination &d = m_destinations.at(key);
+        uint64_t due;
+        if (m_config.clientRatePerSec > 0 && d.tokens < 1.0 && !d.queue.empty()) {
+            // When the next token arrives
+            due = d.refillNs + static_cast<uint64_t>((1.0 - d.tokens) * 1e9 / m_config.clientRatePerSec) + 1;
+        } else if (!d.queue.empty()) {
+            due = d.queue.front().queuedNs + m_config.flushDelayNs;
+        } else {
+            due = 0;  // a throttle notice on its own goes at once
+        }
+        deadline = std::min(deadline, due);
+    }
+    return std::max(deadline, m_blockedUntilNs);
+}
@@ -0,0 +1,93 @@
+#include "ingress_priority.hpp"
+
+#include <cstring>
+
+//////////////////// Classification ////////////////////
+bool isPriorityMessage(const char *text, size_t length) {
+    static const char kKey[] = "\"type\"";
+    const char *end = text + length;
+    const char *p = text;
+    while (p < end) {
+        const char *key = static_cast<const char*>(memmem(p, end - p, kKey, sizeof(kKey) - 1));
+        if (!key) {
+            return false;
+        }
+        p = key + sizeof(kKey) - 1;
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        if (p == end || *p != ':') {
+            continue;  // "type" as a value, not a key
+        }
+        p++;
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        if (p == end || *p != '"') {
+            return false;
+        }
+        const char *value = ++p;
+        const char *close = static_cast<const char*>(std::memchr(value, '"', end - value));
+        if (!close) {
+            return false;
+        }
+        size_t n = static_cast<size_t>(close - value);
+        return (n == 6 && std::memcmp(value, "cancel", 6) == 0) ||
+               (n == 7 && std::memcmp(value, "replace", 7) == 0) ||
+               (n == 4 && std::memcmp(value, "kill", 4) == 0);
+    }
+    return false;
+}
+
+bool isNewOrder(OrderKind kind) {
+    switch (kind) {
+        case OrderKind::Limit:
+        case OrderKind::Market:
+        case OrderKind::IOC:
+        case OrderKind::FOK:
+        case OrderKind::PostOnly:
+        case OrderKind::StopLoss:
+            return true;
+        default:
+            return false;
+    }
+}
+
+//////////////////// EarlyApplyLedger ////////////////////
+EarlyApplyLedger::EarlyApplyLedger(size_t window)
+    : m_window(window > 0 ? window : 1), m_applied((m_window + 63) / 64, 0) {}
+
+bool EarlyApplyLedger::mayApplyEarly(const Order &o) const {
+    if (o.sequence < m_next || o.sequence - m_next >= m_window) {
+        return false;
+    }
+    return o.kind == OrderKind::Kill || m_deferred.find(o.orderId) == m_deferred.end();
+}
+
+void EarlyApplyLedger::markApplied(const Order &o) {
+    size_t bit = o.sequence % m_window;
+    m_applied[bit >> 6] |= uint64_t{1} << (bit & 63);
+}
+
+void EarlyApplyLedger::defer(const Order &o) {
+    // A copy that fell behind the sequence has nothing left to wait for
+    if (o.kind != OrderKind::Kill && o.sequence >= m_next) {
+        m_deferred[o.orderId] = o.sequence;
+    }
+}
+
+bool EarlyApplyLedger::takeInSequence(const Order &o) {
+    m_next = o.sequence + 1;
+    if (applied(o.sequence)) {
+        size_t bit = o.sequence % m_window;
+        m_applied[bit >> 6] &= ~(uint64_t{1} << (bit & 63));
+        return true;
+    }
+    if (!m_deferred.empty()) {
+        auto it = m_deferred.find(o.orderId);
+        if (it != m_deferred.end() && it->second == o.sequence) {
+            m_deferred.erase(it);
+        }
+    }
+    return false;
+}
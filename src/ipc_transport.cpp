@@ -0,0 +1,272 @@
+#include "ipc_transport.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string shmPath(const std::string &name) {
+    return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+std::size_t segmentBytes(std::size_t slots) {
+    return kIpcHeaderBytes + slots * sizeof(IpcSlot);
+}
+
+IpcSlot* slotAt(void *mapping, std::size_t i) {
+    return reinterpret_cast<IpcSlot*>(static_cast<char*>(mapping) + kIpcHeaderBytes) + i;
+}
+
+// Client tokens: slot + 1 in the low half, the slot's generation above it
+uint32_t makeToken(std::size_t slot, uint32_t generation) {
+    return (generation << 16) | static_cast<uint32_t>(slot + 1);
+}
+
+std::size_t tokenSlot(uint32_t token) {
+    return static_cast<std::size_t>(token & 0xFFFF) - 1;
+}
+
+bool processGone(int32_t pid) {
+    return pid > 0 && kill(pid, 0) < 0 && errno == ESRCH;
+}
+
+} // namespace
+
+//////////////////// Records ////////////////////
+IpcOrder toIpcOrder(const Order &o, uint64_t userData) {
+    IpcOrder msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.orderId = o.orderId;
+    msg.quantity = o.quantity;
+    msg.displayQuantity = o.displayQuantity;
+    msg.expireTimeMs = o.expireTimeMs;
+    msg.userData = userData;
+    msg.price = o.price;
+    msg.stopPrice = o.stopPrice;
+    msg.ownerId = o.ownerId;
+    msg.kind = orderKindFromString(o.type);
+    msg.side = sideFromString(o.action);
+    return msg;
+}
+
+Order fromIpcOrder(const IpcOrder &msg) {
+    Order o(msg.orderId, orderKindName(msg.kind), sideName(msg.side), msg.price, msg.quantity);
+    o.ownerId = msg.ownerId;
+    o.isStopOrder = (o.kind == OrderKind::StopLoss);
+    o.stopPrice = msg.stopPrice;
+    o.displayQuantity = msg.displayQuantity;
+    o.expireTimeMs = msg.expireTimeMs;
+    return o;
+}
+
+IpcReport toIpcReport(const Order &o, uint64_t filledQuantity, double averagePrice, uint64_t userData) {
+    IpcReport r;
+    std::memset(&r, 0, sizeof(r));
+    r.orderId = o.orderId;
+    r.filledQuantity = filledQuantity;
+    r.remainingQuantity = o.remainingQuantity;
+    r.userData = userData;
+    r.averagePrice = averagePrice;
+    r.status = orderStatusCode(o.status);
+    return r;
+}
+
+//////////////////// IpcServer ////////////////////
+IpcServer::IpcServer(const std::string &name, std::size_t slots)
+    : m_name(shmPath(name)), m_slotCount(slots), m_control(new SlotControl[slots]) {
+    // A segment left by an earlier server has no live clients worth keeping
+    shm_unlink(m_name.c_str());
+    int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "[IPC] shm_open " << m_name << ": " << std::strerror(errno) << "\n";
+        return;
+    }
+    std::size_t bytes = segmentBytes(slots);
+    void *addr = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "[IPC] mapping " << m_name << ": " << std::strerror(errno) << "\n";
+        shm_unlink(m_name.c_str());
+        return;
+    }
+
+    // The mapping starts zeroed: every slot is Free with empty rings. The
+    // magic goes in last so a client never sees a half-written header.
+    m_mappedBytes = bytes;
+    m_header = static_cast<IpcSegmentHeader*>(addr);
+    m_header->version = kIpcVersion;
+    m_header->slotCount = static_cast<uint32_t>(slots);
+    m_header->serverPid.store(static_cast<int32_t>(getpid()), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = kIpcMagic;
+}
+
+IpcServer::~IpcServer() {
+    if (m_header) {
+        m_header->serverPid.store(0, std::memory_order_release);
+        munmap(m_header, m_mappedBytes);
+        shm_unlink(m_name.c_str());
+    }
+}
+
+IpcSlot* IpcServer::slot(std::size_t i) const {
+    return slotAt(m_header, i);
+}
+
+void IpcServer::adopt(std::size_t i) {
+    uint32_t generation = slot(i)->generation.load(std::memory_order_relaxed);
+    m_control[i].token.store(makeToken(i, generation), std::memory_order_release);
+    m_attached.fetch_add(1, std::memory_order_relaxed);
+}
+
+void IpcServer::release(std::size_t i) {
+    IpcSlot *s = slot(i);
+    {
+        // No report producer may be mid-push while the rings are reset
+        std::lock_guard<std::mutex> lock(m_control[i].reportMutex);
+        if (m_control[i].token.exchange(0, std::memory_order_acq_rel) != 0) {
+            m_attached.fetch_sub(1, std::memory_order_relaxed);
+        }
+        s->requests.reset();
+        s->reports.reset();
+    }
+    s->pid.store(0, std::memory_order_relaxed);
+    s->reportsDropped.store(0, std::memory_order_relaxed);
+    s->generation.fetch_add(1, std::memory_order_relaxed);
+    s->state.store(static_cast<uint32_t>(IpcSlotState::Free), std::memory_order_release);
+}
+
+std::size_t IpcServer::poll(const OrderFn &onOrder, std::size_t budget) {
+    if (!m_header) {
+        return 0;
+    }
+    std::size_t handled = 0;
+    for (std::size_t i = 0; i < m_slotCount; i++) {
+        IpcSlot *s = slot(i);
+        if (s->state.load(std::memory_order_acquire) != static_cast<uint32_t>(IpcSlotState::Attached)) {
+            continue;
+        }
+        uint32_t token = m_control[i].token.load(std::memory_order_relaxed);
+        if (token == 0) {
+            adopt(i);
+            token = m_control[i].token.load(std::memory_order_relaxed);
+        }
+        IpcOrder msg;
+        for (std::size_t n = 0; n < budget && s->requests.tryPop(msg); n++) {
+            onOrder(token, msg);
+            handled++;
+        }
+    }
+    m_ordersReceived.fetch_add(handled, std::memory_order_relaxed);
+    return handled;
+}
+
+bool IpcServer::sendReport(uint32_t client, const IpcReport &report) {
+    std::size_t i = tokenSlot(client);
+    if (!m_header || i >= m_slotCount) {
+        return false;
+    }
+    SlotControl &control = m_control[i];
+    std::lock_guard<std::mutex> lock(control.reportMutex);
+    if (control.token.load(std::memory_order_relaxed) != client) {
+        return false;  // the order's owner has gone
+    }
+    IpcSlot *s = slot(i);
+    if (!s->reports.tryPush(report)) {
+        s->reportsDropped.fetch_add(1, std::memory_order_relaxed);
+        m_reportsDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_reportsSent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void IpcServer::reap() {
+    if (!m_header) {
+        return;
+    }
+    for (std::size_t i = 0; i < m_slotCount; i++) {
+        IpcSlot *s = slot(i);
+        uint32_t state = s->state.load(std::memory_order_acquire);
+        if (state == static_cast<uint32_t>(IpcSlotState::Detached) ||
+            (state == static_cast<uint32_t>(IpcSlotState::Attached) &&
+             processGone(s->pid.load(std::memory_order_relaxed)))) {
+            release(i);
+        }
+    }
+}
+
+//////////////////// IpcClient ////////////////////
+IpcClient::~IpcClient() {
+    detach();
+}
+
+bool IpcClient::attach(const std::string &name) {
+    detach();
+    int fd = shm_open(shmPath(name).c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= kIpcHeaderBytes) {
+        addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    m_mapping = addr;
+    m_mappedBytes = static_cast<std::size_t>(st.st_size);
+
+    const IpcSegmentHeader *header = static_cast<const IpcSegmentHeader*>(addr);
+    bool valid = header->magic == kIpcMagic && header->version == kIpcVersion &&
+                 segmentBytes(header->slotCount) <= m_mappedBytes;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    for (uint32_t i = 0; valid && i < header->slotCount; i++) {
+        IpcSlot *s = slotAt(addr, i);
+        uint32_t expected = static_cast<uint32_t>(IpcSlotState::Free);
+        if (s->state.compare_exchange_strong(expected, static_cast<uint32_t>(IpcSlotState::Attached),
+                                             std::memory_order_acq_rel)) {
+            s->pid.store(static_cast<int32_t>(getpid()), std::memory_order_relaxed);
+            m_slot = s;
+            return true;
+        }
+    }
+
+    munmap(m_mapping, m_mappedBytes);
+    m_mapping = nullptr;
+    return false;
+}
+
+void IpcClient::detach() {
+    if (m_slot) {
+        m_slot->state.store(static_cast<uint32_t>(IpcSlotState::Detached), std::memory_order_release);
+        m_slot = nullptr;
+    }
+    if (m_mapping) {
+        munmap(m_mapping, m_mappedBytes);
+        m_mapping = nullptr;
+    }
+}
+
+bool IpcClient::submit(const IpcOrder &msg) {
+    return m_slot && m_slot->requests.tryPush(msg);
+}
+
+bool IpcClient::poll(IpcReport &out) {
+    return m_slot && m_slot->reports.tryPop(out);
+}
+
+uint64_t IpcClient::reportsDropped() const {
+    return m_slot ? m_slot->reportsDropped.load(std::memory_order_relaxed) : 0;
+}
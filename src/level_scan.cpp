@@ -0,0 +1,146 @@
+#include "level_scan.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEVEL_SCAN_HAVE_AVX2 1
+#else
+#define LEVEL_SCAN_HAVE_AVX2 0
+#endif
+
+//////////////////// Scalar ////////////////////
+size_t levelsToFillScalar(const uint64_t *qty, size_t n, uint64_t target, uint64_t *cumulative) {
+    uint64_t sum = 0;
+    size_t used = 0;
+    while (used < n && sum < target) {
+        sum += qty[n - 1 - used];
+        used++;
+    }
+    *cumulative = sum;
+    return used;
+}
+
+size_t cumulativeDepthScalar(const uint64_t *qty, size_t n, size_t levels, uint64_t *out) {
+    size_t count = (levels < n) ? levels : n;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += qty[n - 1 - i];
+        out[i] = sum;
+    }
+    return count;
+}
+
+//////////////////// AVX2 ////////////////////
+#if LEVEL_SCAN_HAVE_AVX2
+
+namespace {
+
+// Loads qty[end-4 .. end-1] and reverses it so lane 0 holds the best level
+__attribute__((target("avx2")))
+inline __m256i loadBestFirst(const uint64_t *qty, size_t end) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(qty + end - 4));
+    return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+// Inclusive prefix sum across the four 64-bit lanes (two shift+add steps)
+__attribute__((target("avx2")))
+inline __m256i prefixSum4(__m256i v) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i s1 = _mm256_blend_epi32(_mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03);
+    v = _mm256_add_epi64(v, s1);
+    __m256i s2 = _mm256_blend_epi32(_mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F);
+    return _mm256_add_epi64(v, s2);
+}
+
+} // namespace
+
+__attribute__((target("avx2")))
+size_t levelsToFillAvx2(const uint64_t *qty, size_t n, uint64_t target, uint64_t *cumulative) {
+    if (target == 0) {
+        *cumulative = 0;
+        return 0;
+    }
+    const __m256i threshold = _mm256_set1_epi64x(static_cast<long long>(target - 1));
+    uint64_t running = 0;
+    size_t used = 0;
+
+    while (n - used >= 4) {
+        __m256i prefix = _mm256_add_epi64(prefixSum4(loadBestFirst(qty, n - used)),
+                                          _mm256_set1_epi64x(static_cast<long long>(running)));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(prefix, threshold)));
+        if (mask != 0) {
+            int lane = __builtin_ctz(mask);
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), prefix);
+            *cumulative = lanes[lane];
+            return used + lane + 1;
+        }
+        running = static_cast<uint64_t>(_mm256_extract_epi64(prefix, 3));
+        used += 4;
+    }
+
+    // Tail of fewer than four levels
+    uint64_t tailSum = 0;
+    size_t tailUsed = levelsToFillScalar(qty, n - used, target - running, &tailSum);
+    *cumulative = running + tailSum;
+    return used + tailUsed;
+}
+
+__attribute__((target("avx2")))
+size_t cumulativeDepthAvx2(const uint64_t *qty, size_t n, size_t levels, uint64_t *out) {
+    size_t count = (levels < n) ? levels : n;
+    uint64_t running = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i prefix = _mm256_add_epi64(prefixSum4(loadBestFirst(qty, n - i)),
+                                          _mm256_set1_epi64x(static_cast<long long>(running)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), prefix);
+        running = static_cast<uint64_t>(_mm256_extract_epi64(prefix, 3));
+    }
+    for (; i < count; i++) {
+        running += qty[n - 1 - i];
+        out[i] = running;
+    }
+    return count;
+}
+
+#else
+
+size_t levelsToFillAvx2(const uint64_t *qty, size_t n, uint64_t target, uint64_t *cumulative) {
+    return levelsToFillScalar(qty, n, target, cumulative);
+}
+
+size_t cumulativeDepthAvx2(const uint64_t *qty, size_t n, size_t levels, uint64_t *out) {
+    return cumulativeDepthScalar(qty, n, levels, out);
+}
+
+#endif
+
+//////////////////// Dispatch ////////////////////
+namespace {
+
+bool detectAvx2() {
+#if LEVEL_SCAN_HAVE_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const bool g_useAvx2 = detectAvx2();
+
+} // namespace
+
+bool levelScanUsesAvx2() {
+    return g_useAvx2;
+}
+
+size_t levelsToFill(const uint64_t *qty, size_t n, uint64_t target, uint64_t *cumulative) {
+    return g_useAvx2 ? levelsToFillAvx2(qty, n, target, cumulative)
+                     : levelsToFillScalar(qty, n, target, cumulative);
+}
+
+size_t cumulativeDepth(const uint64_t *qty, size_t n, size_t levels, uint64_t *out) {
+    return g_useAvx2 ? cumulativeDepthAvx2(qty, n, levels, out)
+                     : cumulativeDepthScalar(qty, n, levels, out);
+}
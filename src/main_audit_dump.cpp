@@ -0,0 +1,85 @@
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "audit_log.hpp"
+#include "json_utils.hpp"
+
+/********************************************************************
+ * orderbook_audit_dump: converts audit files to CSV or JSON lines
+ ********************************************************************/
+static const char* detailName(const AuditEvent &e) {
+    if (e.type == AuditEventType::Cancel) {
+        return cancelReasonName(static_cast<CancelReason>(e.detail));
+    }
+    if (e.type == AuditEventType::Trade) {
+        return "";
+    }
+    return auditStatusName(e.detail);
+}
+
+static std::map<std::string, std::string> toFields(const AuditEvent &e) {
+    std::map<std::string, std::string> fields;
+    fields["timestamp_ns"] = std::to_string(e.timestampNs);
+    fields["sequence"] = std::to_string(e.sequence);
+    fields["event"] = auditEventTypeName(e.type);
+    fields["order_id"] = std::to_string(e.orderId);
+    fields["counterparty_id"] = std::to_string(e.counterpartyId);
+    fields["type"] = orderKindName(e.kind);
+    fields["action"] = sideName(e.side);
+    fields["price"] = std::to_string(fromTicks(e.priceTicks));
+    fields["quantity"] = std::to_string(e.quantity);
+    fields["filled_quantity"] = std::to_string(e.filledQuantity);
+    fields["remaining_quantity"] = std::to_string(e.remainingQuantity);
+    fields["owner_id"] = std::to_string(e.ownerId);
+    fields["detail"] = detailName(e);
+    return fields;
+}
+
+static const char *const kCsvColumns[] = {
+    "timestamp_ns", "sequence", "event", "order_id", "counterparty_id", "type", "action",
+    "price", "quantity", "filled_quantity", "remaining_quantity", "owner_id", "detail",
+};
+static constexpr size_t kCsvColumnCount = sizeof(kCsvColumns) / sizeof(kCsvColumns[0]);
+
+int main(int argc, char **argv) {
+    bool json = false;
+    int first = 1;
+    if (argc > 1 && std::string(argv[1]) == "--json") {
+        json = true;
+        first = 2;
+    }
+    if (first >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [--json] <audit file>...\n"
+                  << "  Writes CSV (default) or one JSON object per line to stdout.\n";
+        return 1;
+    }
+
+    if (!json) {
+        for (size_t c = 0; c < kCsvColumnCount; c++) {
+            std::cout << kCsvColumns[c] << (c + 1 < kCsvColumnCount ? "," : "\n");
+        }
+    }
+
+    int status = 0;
+    for (int i = first; i < argc; i++) {
+        AuditReader reader(argv[i]);
+        if (!reader.ok()) {
+            std::cerr << argv[i] << ": not an audit file\n";
+            status = 1;
+            continue;
+        }
+        AuditEvent e;
+        while (reader.next(e)) {
+            auto fields = toFields(e);
+            if (json) {
+                std::cout << buildJsonString(fields) << "\n";
+            } else {
+                for (size_t c = 0; c < kCsvColumnCount; c++) {
+                    std::cout << fields[kCsvColumns[c]] << (c + 1 < kCsvColumnCount ? "," : "\n");
+                }
+            }
+        }
+    }
+    return status;
+}
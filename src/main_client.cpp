@@ -1,37 +1,56 @@
-#include <arpa/inet.h>  // for inet_pton
-#include <cstring>
+#include <atomic>
+#include <chrono>
 #include <iostream>
-#include <netinet/in.h>
+#include <mutex>
 #include <random>
 #include <string>
-#include <sys/socket.h>
 #include <thread>
-#include <unistd.h>
-#include <vector>
 
-#include "json_utils.hpp"
 #include "order.hpp"
+#include "order_client.hpp"
 
 /********************************************************************
  * Global for client
  ********************************************************************/
-static int g_clientSock = -1;
+static OrderClientConfig g_config;   // owner id tags every order when non-zero
 static std::atomic<bool> g_clientRunning{true};
+static std::mutex g_clientMutex;     // the receiver polls while the menu submits
+
+static const char* requestTypeName(RequestType type) {
+    switch (type) {
+        case RequestType::Submit: return "submit";
+        case RequestType::Cancel: return "cancel";
+        case RequestType::Replace: return "replace";
+        default: return "unsolicited";
+    }
+}
 
 /********************************************************************
- * Confirmation receiver
+ * Report receiver
  ********************************************************************/
-static void clientConfirmationReceiverThread() {
+static void printReport(const ClientReport &r) {
+    std::cout << "[Client] Report: order " << r.orderId
+              << " " << orderStatusName(r.status)
+              << " filled=" << r.filledQuantity
+              << " remaining=" << r.remainingQuantity
+              << " avg=" << r.averagePrice
+              << " (" << requestTypeName(r.requestType);
+    if (r.request != 0) {
+        std::cout << " #" << r.request;
+    }
+    std::cout << (r.done ? ", done)" : ")") << std::endl;
+}
+
+static void clientReportReceiverThread(OrderClient &client) {
     while (g_clientRunning.load()) {
-        char buffer[2048];
-        sockaddr_in fromAddr;
-        socklen_t fromLen = sizeof(fromAddr);
-        ssize_t len = recvfrom(g_clientSock, buffer, sizeof(buffer) - 1, 0,
-                               (struct sockaddr*)&fromAddr, &fromLen);
-        if (len > 0) {
-            buffer[len] = '\0';
-            std::string msg(buffer);
-            std::cout << "[Client] Confirmation: " << msg << std::endl;
+        size_t n;
+        {
+            std::lock_guard<std::mutex> lock(g_clientMutex);
+            client.flush();  // anything a full socket held back
+            n = client.pollAll(printReport);
+        }
+        if (n == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
         }
     }
 }
@@ -39,82 +58,69 @@ static void clientConfirmationReceiverThread() {
 /********************************************************************
  * Build random order
  ********************************************************************/
-static Order buildRandomOrder(uint64_t orderId) {
+static OrderRequest buildRandomOrder() {
     static std::mt19937_64 rng(std::random_device{}());
     static std::uniform_int_distribution<int> typeDist(0, 6);
     static std::uniform_int_distribution<int> actionDist(0, 1);
     static std::uniform_real_distribution<double> priceDist(10.0, 100.0);
     static std::uniform_int_distribution<int> qtyDist(1, 500);
 
-    Order o;
-    o.orderId = orderId;
+    OrderRequest r;
     switch (typeDist(rng)) {
-        case 0: o.type = "market"; break;
-        case 1: o.type = "limit"; break;
-        case 2: o.type = "cancel"; break;
-        case 3: o.type = "stop-loss"; o.isStopOrder = true; break;
-        case 4: o.type = "ioc"; break;
-        case 5: o.type = "fok"; break;
-        default: o.type = "limit"; break;
+        case 0: r.kind = OrderKind::Market; break;
+        case 2: r.kind = OrderKind::StopLoss; break;
+        case 3: r.kind = OrderKind::IOC; break;
+        case 4: r.kind = OrderKind::FOK; break;
+        case 5: r.kind = OrderKind::PostOnly; break;
+        default: r.kind = OrderKind::Limit; break;
     }
-    o.action = (actionDist(rng) == 0) ? "buy" : "sell";
-    o.price = priceDist(rng);
-    o.quantity = qtyDist(rng);
-    o.remainingQuantity = o.quantity;
-    if (o.isStopOrder) {
-        o.stopPrice = o.price;
+    r.side = (actionDist(rng) == 0) ? Side::Buy : Side::Sell;
+    r.price = priceDist(rng);
+    r.quantity = static_cast<uint64_t>(qtyDist(rng));
+    if (r.kind == OrderKind::StopLoss) {
+        r.stopPrice = r.price;
     }
-    return o;
+    return r;
 }
 
-/********************************************************************
- * Build JSON message from Order
- ********************************************************************/
-static std::string buildOrderMessage(const Order &o) {
-    std::map<std::string, std::string> fields;
-    fields["order_id"] = std::to_string(o.orderId);
-    fields["type"] = o.type;
-    fields["action"] = o.action;
-    fields["quantity"] = std::to_string(o.quantity);
-    fields["price"] = std::to_string(o.price);
-    if (o.isStopOrder) {
-        fields["stop_price"] = std::to_string(o.stopPrice);
+// Waits out a backed-up transport; 0 if the client refuses outright
+template <typename Request>
+static RequestHandle sendRequest(OrderClient &client, Request request) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        RequestHandle handle;
+        {
+            std::lock_guard<std::mutex> lock(g_clientMutex);
+            handle = request(client);
+        }
+        if (handle != 0) {
+            return handle;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
-    return buildJsonString(fields);
+    return 0;
+}
+
+static void flushRequests(OrderClient &client) {
+    std::lock_guard<std::mutex> lock(g_clientMutex);
+    client.flush();
 }
 
 /********************************************************************
  * runClient
  ********************************************************************/
-static void runClient(const std::string &ip, int port) {
-    g_clientSock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (g_clientSock < 0) {
-        perror("socket");
-        exit(EXIT_FAILURE);
-    }
-
-    sockaddr_in serverAddr;
-    std::memset(&serverAddr, 0, sizeof(serverAddr));
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(port);
-
-    if (inet_pton(AF_INET, ip.c_str(), &serverAddr.sin_addr) <= 0) {
-        perror("inet_pton");
-        close(g_clientSock);
-        exit(EXIT_FAILURE);
-    }
-
+static void runClient(OrderClient &client) {
     // Start receiver
-    std::thread receiver(clientConfirmationReceiverThread);
+    std::thread receiver(clientReportReceiverThread, std::ref(client));
 
-    uint64_t orderCounter = 1;
     bool done = false;
     while (!done) {
         std::cout << "\n[Client Menu]\n"
                   << "1) Send a random order\n"
                   << "2) Send multiple random orders (bulk)\n"
                   << "3) Enter a custom order\n"
-                  << "4) Quit\n"
+                  << "4) Cancel an order\n"
+                  << "5) Replace an order (new price and quantity)\n"
+                  << "6) Quit\n"
                   << "Select: ";
         int choice;
         std::cin >> choice;
@@ -126,47 +132,96 @@ static void runClient(const std::string &ip, int port) {
 
         switch (choice) {
             case 1: {
-                Order randOrder = buildRandomOrder(orderCounter++);
-                std::string msg = buildOrderMessage(randOrder);
-                sendto(g_clientSock, msg.c_str(), msg.size(), 0,
-                       (struct sockaddr*)&serverAddr, sizeof(serverAddr));
-                std::cout << "[Client] Sent random order: " << msg << std::endl;
+                OrderRequest r = buildRandomOrder();
+                RequestHandle id = sendRequest(client, [&](OrderClient &c) { return c.submit(r); });
+                flushRequests(client);
+                std::cout << "[Client] Sent random " << orderKindName(r.kind) << " " << sideName(r.side)
+                          << " " << r.quantity << " @ " << r.price << " as order " << id << std::endl;
             } break;
             case 2: {
                 std::cout << "How many orders? ";
                 int n;
                 std::cin >> n;
-                for (int i = 0; i < n; i++) {
-                    Order randOrder = buildRandomOrder(orderCounter++);
-                    std::string msg = buildOrderMessage(randOrder);
-                    sendto(g_clientSock, msg.c_str(), msg.size(), 0,
-                           (struct sockaddr*)&serverAddr, sizeof(serverAddr));
+                // Batched into as few datagrams as fit, then flushed once
+                int sent = 0;
+                for (; sent < n; sent++) {
+                    OrderRequest r = buildRandomOrder();
+                    if (sendRequest(client, [&](OrderClient &c) { return c.submit(r); }) == 0) {
+                        break;
+                    }
+                }
+                flushRequests(client);
+                std::cout << "[Client] Sent " << sent << " random orders.\n";
+                if (sent < n) {
+                    std::cout << "[Client] Stopped early: " << client.inFlight() << " orders in flight\n";
                 }
-                std::cout << "[Client] Sent " << n << " random orders.\n";
             } break;
             case 3: {
-                Order custom;
-                custom.orderId = orderCounter++;
-                std::cout << "Enter type (market/limit/cancel/stop-loss/ioc/fok): ";
-                std::cin >> custom.type;
+                OrderRequest r;
+                std::string type, action;
+                std::cout << "Enter type (market/limit/stop-loss/ioc/fok/post-only): ";
+                std::cin >> type;
                 std::cout << "Enter action (buy/sell): ";
-                std::cin >> custom.action;
+                std::cin >> action;
+                r.kind = orderKindFromString(type);
+                r.side = sideFromString(action);
                 std::cout << "Enter price: ";
-                std::cin >> custom.price;
+                std::cin >> r.price;
                 std::cout << "Enter quantity: ";
-                std::cin >> custom.quantity;
-                custom.remainingQuantity = custom.quantity;
-                if (custom.type == "stop-loss") {
-                    custom.isStopOrder = true;
+                std::cin >> r.quantity;
+                if (r.kind == OrderKind::StopLoss) {
                     std::cout << "Enter stop price: ";
-                    std::cin >> custom.stopPrice;
+                    std::cin >> r.stopPrice;
+                }
+                if (r.kind == OrderKind::Limit || r.kind == OrderKind::PostOnly) {
+                    std::cout << "Enter display quantity (0 = fully visible): ";
+                    std::cin >> r.displayQuantity;
+                    uint64_t ttlMs = 0;
+                    std::cout << "Enter time-to-live in ms (0 = good till cancel): ";
+                    std::cin >> ttlMs;
+                    if (ttlMs > 0) {
+                        r.expireTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count() + ttlMs;
+                    }
+                }
+                RequestHandle id = sendRequest(client, [&](OrderClient &c) { return c.submit(r); });
+                flushRequests(client);
+                if (id == 0) {
+                    std::cout << "[Client] Order refused (check type, action and quantity)\n";
+                } else {
+                    std::cout << "[Client] Sent custom order " << id << std::endl;
                 }
-                std::string msg = buildOrderMessage(custom);
-                sendto(g_clientSock, msg.c_str(), msg.size(), 0,
-                       (struct sockaddr*)&serverAddr, sizeof(serverAddr));
-                std::cout << "[Client] Sent custom order: " << msg << std::endl;
             } break;
             case 4: {
+                uint64_t orderId;
+                std::cout << "Order id: ";
+                std::cin >> orderId;
+                RequestHandle h = sendRequest(client, [&](OrderClient &c) { return c.cancel(orderId); });
+                flushRequests(client);
+                if (h == 0) {
+                    std::cout << "[Client] No live order " << orderId << std::endl;
+                } else {
+                    std::cout << "[Client] Sent cancel #" << h << std::endl;
+                }
+            } break;
+            case 5: {
+                uint64_t orderId, quantity;
+                double price;
+                std::cout << "Order id: ";
+                std::cin >> orderId;
+                std::cout << "New price: ";
+                std::cin >> price;
+                std::cout << "New total quantity: ";
+                std::cin >> quantity;
+                RequestHandle h = sendRequest(client, [&](OrderClient &c) { return c.replace(orderId, price, quantity); });
+                flushRequests(client);
+                if (h == 0) {
+                    std::cout << "[Client] Replace refused (unknown order or invalid values)\n";
+                } else {
+                    std::cout << "[Client] Sent replace #" << h << std::endl;
+                }
+            } break;
+            case 6: {
                 done = true;
             } break;
             default: {
@@ -177,12 +232,8 @@ static void runClient(const std::string &ip, int port) {
 
     // shutdown
     g_clientRunning.store(false);
-    sockaddr_in dummy;
-    std::memset(&dummy, 0, sizeof(dummy));
-    sendto(g_clientSock, "", 0, 0, (struct sockaddr*)&dummy, sizeof(dummy));
-
     receiver.join();
-    close(g_clientSock);
+    client.close();
     std::cout << "[Client] Exiting...\n";
 }
 
@@ -191,12 +242,45 @@ static void runClient(const std::string &ip, int port) {
  ********************************************************************/
 int main(int argc, char** argv) {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <IP> <PORT>\n";
+        std::cerr << "Usage: " << argv[0] << " <IP> <PORT> [OWNER_ID] [--ipc <NAME>]\n"
+                  << "  --ipc <NAME>  send orders over the server's shared-memory segment\n";
         return 1;
     }
     std::string ip = argv[1];
     int port = std::stoi(argv[2]);
+    std::string ipcName;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--ipc" && i + 1 < argc) {
+            ipcName = argv[++i];
+        } else {
+            g_config.ownerId = static_cast<uint32_t>(std::stoul(arg));
+        }
+    }
+
+    // Resting orders stay in flight until cancelled or replaced, so leave room
+    g_config.maxOrders = 65536;
+    // Distinct runs don't reuse each other's order ids
+    g_config.firstHandle = static_cast<RequestHandle>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()) << 16;
+    OrderClient client(g_config);
+
+    if (!ipcName.empty()) {
+        if (!client.attachIpc(ipcName)) {
+            std::cerr << "Cannot attach to shared-memory segment " << ipcName
+                      << " (server not started with --ipc-clients, or every slot taken)\n";
+            return 1;
+        }
+        std::cout << "[Client] Attached to shared-memory segment " << ipcName << std::endl;
+    } else {
+        std::string error;
+        if (!client.connect(ip, port, &error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
 
-    runClient(ip, port);
+    runClient(client);
     return 0;
 }
@@ -1,164 +1,932 @@
+#include <algorithm>
 #include <arpa/inet.h>  // for inet_pton
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <netinet/in.h>
+#include <poll.h>
 #include <string>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
 #include <thread>
+#include <type_traits>
 #include <unistd.h>
 #include <vector>
 
+#include "audit_log.hpp"
+#include "book_verifier.hpp"
+#include "book_view.hpp"
+#include "confirmation_coalescer.hpp"
+#include "ingress_priority.hpp"
+#include "ipc_transport.hpp"
 #include "order.hpp"
+#include "order_codec.hpp"
 #include "orderbook.hpp"
+#include "replication.hpp"
+#include "resequencer.hpp"
 #include "thread_safe_queue.hpp"
+#include "tracing.hpp"
 #include "json_utils.hpp"
+#include "memory_plan.hpp"
+#include "metrics_server.hpp"
+#include "stats.hpp"
 
 /********************************************************************
  * Global state for the server
  ********************************************************************/
-static OrderBook g_orderBook;
+// The book's clock; a standby follows its primary's until it takes over
+static FollowerClock g_clock;
+static OrderBook g_orderBook(&g_clock);
+
+/**
+ * A received datagram waiting to be decoded. Buffers come from a fixed
+ * pool; the receiver stamps each with its arrival sequence number.
+ * Clients may batch messages one per line; each line takes its own
+ * sequence number, from sequence on.
+ */
+struct RawDatagram {
+    uint64_t sequence = 0;
+    size_t messages = 1;
+    std::chrono::time_point<std::chrono::high_resolution_clock> recvTimestamp;
+    uint64_t kernelRecvNs = 0;  // SO_TIMESTAMPNS, when tracing
+    sockaddr_in clientAddr{};
+    socklen_t clientAddrLen = sizeof(sockaddr_in);
+    bool shedNewOrders = false;  // the server was overloaded when it arrived
+    size_t length = 0;
+    char data[2048];
+};
+
+static constexpr size_t kDatagramPoolSize = 4096;
+static_assert(std::is_trivially_destructible<RawDatagram>::value, "pool buffers are never destroyed");
+
+// Receive buffers, in a prefaulted arena (huge pages when available) or,
+// failing that, on the heap; set up by reserveMemory()
+static MemoryArena g_datagramArena;
+static std::vector<RawDatagram> g_datagramHeap;
+static RawDatagram *g_datagramPool = nullptr;
+
+// Confirmations queued between the matcher and the sender, reserved up front
+static constexpr size_t kConfirmationQueueReserve = 4 * kDatagramPoolSize;
 
 // Thread-safe queues
-static ThreadSafeQueue<Order> g_orderQueue;
+static ThreadSafeQueue<RawDatagram*> g_freeDatagrams;  // empty buffers for the receiver
+static ThreadSafeQueue<RawDatagram*> g_decodeQueue;    // filled buffers for the decoders
+static Resequencer<Order> g_sequencedOrders(kDatagramPoolSize);
 static ThreadSafeQueue<Confirmation> g_confirmationQueue;
 
-// For server control
-static std::atomic<bool> g_serverRunning{true};
+// For server control. Shutdown stops ingress first, then lets each stage
+// drain in pipeline order; past the drain deadline g_drainExpired tells
+// the remaining stages to discard what they hold.
+static std::atomic<bool> g_serverRunning{true};   // cleared to stop ingress
+static std::atomic<bool> g_statsRunning{true};    // cleared after the drain
+static std::atomic<bool> g_drainExpired{false};
+static int g_wakeFd = -1;                         // eventfd that wakes the receiver
+static std::mutex g_stopMutex;
+static std::condition_variable g_stopCv;
+static bool g_drained = false;                    // guarded by g_stopMutex
+
+// Shutdown accounting
+static std::atomic<uint64_t> g_ordersReceived{0};
+static std::atomic<uint64_t> g_ordersMatched{0};
+static std::atomic<uint64_t> g_confirmationsDropped{0};
+static std::atomic<uint64_t> g_ordersExpedited{0};  // applied ahead of their turn
+static std::atomic<uint64_t> g_ordersShed{0};
+
+// Cancels, replaces and kills jump the queue (--priority-lane), and new
+// orders are shed past the load thresholds (--shed-*); set before startup
+static bool g_priorityLane = true;
+static LoadShedConfig g_loadShed;
+
+// Per-thread stage counters, folded into the shared stats block by the publisher
+static StatsRegistry g_stats;
+
+// Sampled per-order tracing (--trace-sample); drained by the stats publisher
+static Tracer g_tracer;
+
+// Shared-memory order entry (--ipc-clients); null when off
+static IpcServer *g_ipc = nullptr;
+
+// Steady-clock time (ms) of a scheduled uncross; 0 = none
+static std::atomic<uint64_t> g_uncrossAtMs{0};
+
+// Largest depth query answer message; fits a confirmation datagram
+static size_t g_depthAnswerBytes = 1200;
 
 /********************************************************************
- * Utility: parse an Order from JSON
+ * Command line options
  ********************************************************************/
-static Order parseOrderMessage(const std::string &json, const sockaddr_in &clientAddr) {
-    Order o;
-    o.recvTimestamp = std::chrono::high_resolution_clock::now();
-    o.clientAddr = clientAddr;
+static MemoryPlan defaultMemoryPlan() {
+    MemoryPlan plan;
+    plan.orders = 65536;
+    plan.levels = 1024;
+    return plan;
+}
+
+struct ServerOptions {
+    std::string ip;
+    int port = 0;
+    int metricsPort = 0;  // 0 = no metrics endpoint
+    int decoders = 2;
+    SelfTradePrevention stp = SelfTradePrevention::None;
+    PostOnlyMode postOnly = PostOnlyMode::Reject;
+    double tickSize = 0.01;
+    AllocationRules allocation;
+    std::string auditDir;  // empty = no audit trail
+    AuditBackpressure auditBackpressure = AuditBackpressure::Spill;
+    uint64_t auditFileMb = 64;
+    int drainTimeoutMs = 2000;
+    int openingAuctionMs = 0;  // start in a call auction uncrossed after this long; 0 = none
+    uint64_t traceSample = 0;  // trace one order in N; 0 = off
+    std::string traceFile = "orderbook_trace.json";
+    std::string replicateTo;  // standby socket to stream input to; empty = none
+    std::string standbyPath;  // run as a standby listening here; empty = primary
+    int heartbeatMs = 5;
+    int takeoverMs = 50;
+    bool standbyAcks = true;
+    CoalescerConfig coalescer;
+    std::string ipcName = "orderbook_ipc";
+    size_t ipcClients = 0;  // shared-memory client slots; 0 = off
+    size_t depthViewLevels = 10;
+    MemoryPlan memory = defaultMemoryPlan();
+    bool priorityLane = true;
+    LoadShedConfig loadShed;
+    bool verify = false;  // check the book against a reference matcher as it runs
+};
 
-    auto fields = parseJsonString(json);
+// Sleeps for period unless flag is cleared first; returns the flag
+static bool waitWhile(const std::atomic<bool> &flag, std::chrono::milliseconds period) {
+    std::unique_lock<std::mutex> lock(g_stopMutex);
+    g_stopCv.wait_for(lock, period, [&] { return !flag.load(); });
+    return flag.load();
+}
 
-    if (fields.find("order_id") != fields.end()) {
-        o.orderId = std::stoull(fields["order_id"]);
+static void clearFlag(std::atomic<bool> &flag) {
+    {
+        std::lock_guard<std::mutex> lock(g_stopMutex);
+        flag.store(false);
     }
-    if (fields.find("type") != fields.end()) {
-        o.type = fields["type"];
-        if (o.type == "stop-loss") {
-            o.isStopOrder = true;
+    g_stopCv.notify_all();
+}
+
+// Next non-blank line from cursor on, as [line, line + length); false if none
+static bool nextMessage(const char *&cursor, const char *end, const char *&line, size_t &length) {
+    while (cursor < end) {
+        const char *newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        const char *stop = newline ? newline : end;
+        line = cursor;
+        length = static_cast<size_t>(stop - cursor);
+        cursor = newline ? newline + 1 : end;
+        if (length > 0 && !(length == 1 && *line == '\r')) {
+            return true;
         }
     }
-    if (fields.find("action") != fields.end()) {
-        o.action = fields["action"];
+    return false;
+}
+
+// Messages in a datagram; a blank one still counts as one (and is
+// rejected). *urgent (if given) is set when any is a cancel, replace or kill.
+static size_t countMessages(const char *data, size_t length, bool *urgent = nullptr) {
+    const char *cursor = data;
+    const char *line = nullptr;
+    size_t lineLength = 0;
+    size_t n = 0;
+    while (nextMessage(cursor, data + length, line, lineLength)) {
+        if (urgent && !*urgent) {
+            *urgent = isPriorityMessage(line, lineLength);
+        }
+        n++;
     }
-    if (fields.find("quantity") != fields.end()) {
-        o.quantity = std::stoull(fields["quantity"]);
-        o.remainingQuantity = o.quantity;
+    return std::max<size_t>(n, 1);
+}
+
+/********************************************************************
+ * Decoder threads: turn raw datagrams into validated orders
+ *
+ * Any number of these run in parallel. Invalid messages still produce an
+ * order (kind Unknown, rejected by the book) so that every sequence
+ * number reaches the resequencer. Depth queries are answered here from
+ * the book's published views; a placeholder (kind Query) still takes
+ * their sequence number, and goes first so the matcher never waits on a
+ * query being answered. New orders that arrived while the server was
+ * overloaded are refused here the same way.
+ ********************************************************************/
+static void decodeMessage(const RawDatagram &dgram, const char *text, size_t length, uint64_t sequence,
+                          StageCounters *counters, TraceBuffer *trace) {
+    uint64_t start = steadyNowNs();
+    bool traced = trace && g_tracer.sampled(sequence);
+    if (traced) {
+        trace->record(sequence, TracePoint::DecodeStart);
     }
-    if (fields.find("price") != fields.end()) {
-        o.price = std::stod(fields["price"]);
+
+    Order o;
+    o.sequence = sequence;
+    o.recvTimestamp = dgram.recvTimestamp;
+    o.clientAddr = dgram.clientAddr;
+    o.clientAddrLen = dgram.clientAddrLen;
+    DepthQuery query;
+    bool valid = decodeInboundMessage(std::string(text, length), o, query);
+
+    if (counters) {
+        if (valid) {
+            counters->recordEvent(steadyNowNs() - start);
+        } else {
+            counters->recordError();
+        }
     }
-    if (o.isStopOrder && fields.find("stop_price") != fields.end()) {
-        o.stopPrice = std::stod(fields["stop_price"]);
+    if (traced) {
+        trace->record(o.sequence, TracePoint::DecodeEnd);
     }
+    if (valid && o.kind == OrderKind::Query) {
+        Confirmation c;
+        c.clientAddr = o.clientAddr;
+        c.clientAddrLen = o.clientAddrLen;
+        c.sequence = o.sequence;
+        g_sequencedOrders.publish(o.sequence, std::move(o));
+        for (std::string &msg : answerDepthQuery(g_orderBook, query, g_depthAnswerBytes)) {
+            c.message = std::move(msg);
+            g_confirmationQueue.push(c);
+        }
+        return;
+    }
+    if (valid && dgram.shedNewOrders && isNewOrder(o.kind)) {
+        o.status = OrderStatus::Overloaded;
+        Confirmation c;
+        c.clientAddr = o.clientAddr;
+        c.clientAddrLen = o.clientAddrLen;
+        c.report = makeExecutionReport(o, 0, 0.0);
+        c.sequence = o.sequence;
+        o.kind = OrderKind::Query;  // placeholder for the sequence number
+        g_sequencedOrders.publish(o.sequence, std::move(o));
+        g_confirmationQueue.push(c);
+        g_ordersShed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    g_sequencedOrders.publish(o.sequence, std::move(o));
+}
+
+static void decoderThread() {
+    StageCounters *counters = g_stats.registerSlot(Stage::Decode);
+    TraceBuffer *trace = g_tracer.registerThread("decoder");
+    RawDatagram *dgram = nullptr;
+    while (g_decodeQueue.pop(dgram)) {
+        if (g_drainExpired.load(std::memory_order_relaxed)) {
+            g_freeDatagrams.push(dgram);
+            continue;
+        }
+        // Same split as the receiver's count, so every sequence is published
+        const char *cursor = dgram->data;
+        const char *end = dgram->data + dgram->length;
+        const char *line = nullptr;
+        size_t length = 0;
+        for (size_t i = 0; i < dgram->messages; i++) {
+            if (!nextMessage(cursor, end, line, length)) {
+                line = dgram->data;
+                length = dgram->length;
+            }
+            decodeMessage(*dgram, line, length, dgram->sequence + i, counters, trace);
+        }
+        g_freeDatagrams.push(dgram);
+    }
+}
+
+// Reports an order that changed after its own submission (an expiry, an
+// auction fill, a kill or, if passive, a fill while resting) to whichever
+// transport it came in on
+static void confirmLater(const Order &o, bool passive = false) {
+    if (o.ipcClient != 0) {
+        if (g_ipc) {
+            IpcReport r = toIpcReport(o, o.filledQuantity, o.averagePrice());
+            r.passive = passive ? 1 : 0;
+            g_ipc->sendReport(o.ipcClient, r);
+        }
+        return;
+    }
+    Confirmation c;
+    c.clientAddr = o.clientAddr;
+    c.clientAddrLen = o.clientAddrLen;
+    c.report = makeExecutionReport(o, o.filledQuantity, o.averagePrice());
+    c.report.passive = passive;
+    g_confirmationQueue.push(c);
+}
+
+// Reports the orders kill messages have taken off the book
+static void confirmKilled() {
+    for (const Order &o : g_orderBook.takeKilled()) {
+        confirmLater(o);
+    }
+}
 
-    return o;
+// Reports the resting orders the last input traded with to their owners
+static void confirmPassiveFills() {
+    thread_local std::vector<Order> fills;
+    g_orderBook.takePassiveFills(fills);
+    for (const Order &o : fills) {
+        confirmLater(o, true);
+    }
 }
 
 /********************************************************************
- * Worker thread: pops orders from the queue and processes them
+ * Matching thread: processes orders in arrival order
+ *
+ * Cancels, replaces and kills also arrive expedited, ahead of the orders
+ * queued before them, and take effect then if the ledger allows it
+ * (ingress_priority.hpp). Their in-sequence copies are then skipped,
+ * except that a kill runs again, quietly, for orders of its owner that
+ * rested in between. New orders that waited past --shed-sojourn-us are
+ * refused without reaching the book.
  ********************************************************************/
-static void serverWorkerThread() {
-    while (g_serverRunning.load()) {
-        Order o = g_orderQueue.pop();
+// Queues the report of an order matched here
+static void confirmMatched(const Order &o, bool traced, TraceBuffer *trace) {
+    Confirmation c;
+    c.clientAddr = o.clientAddr;
+    c.clientAddrLen = o.clientAddrLen;
+    c.report = makeExecutionReport(o, o.filledQuantity, o.averagePrice());
+    c.traced = traced;
+    c.sequence = o.sequence;
+    if (traced) {
+        trace->record(o.sequence, TracePoint::ConfirmEnqueue);
+    }
+    g_confirmationQueue.push(c);
+}
+
+static void matchingThread() {
+    StageCounters *counters = g_stats.registerSlot(Stage::Match);
+    TraceBuffer *trace = g_tracer.registerThread("matcher");
+    EarlyApplyLedger ledger(kDatagramPoolSize);
+    Order o;
+    bool expedited = false;
+    while (!g_drainExpired.load(std::memory_order_relaxed) && g_sequencedOrders.pop(o, &expedited)) {
+        if (expedited) {
+            bool resting = o.kind == OrderKind::Kill || g_orderBook.hasResting(o.orderId);
+            if (!ledger.mayApplyEarly(o) || !resting) {
+                ledger.defer(o);
+                continue;
+            }
+            ledger.markApplied(o);
+            g_ordersExpedited.fetch_add(1, std::memory_order_relaxed);
+        } else if (ledger.takeInSequence(o)) {
+            if (o.kind == OrderKind::Kill) {
+                g_orderBook.processOrder(o);
+                confirmKilled();
+            }
+            continue;
+        }
+        auto now = std::chrono::high_resolution_clock::now();
+        uint64_t waitedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - o.recvTimestamp).count();
+        if (o.kind == OrderKind::Query) {
+            // Answered (or shed) by its decoder; only the sequence number passes through
+            if (counters) {
+                counters->recordEvent(waitedNs);
+            }
+            continue;
+        }
+        bool traced = trace && g_tracer.sampled(o.sequence);
+        if (g_loadShed.shedOnSojourn(o.kind, waitedNs)) {
+            o.status = OrderStatus::Overloaded;
+            g_ordersShed.fetch_add(1, std::memory_order_relaxed);
+            confirmMatched(o, traced, trace);
+            continue;
+        }
+        if (traced) {
+            trace->record(o.sequence, TracePoint::MatchStart);
+        }
         g_orderBook.processOrder(o);
+        if (traced) {
+            trace->record(o.sequence, TracePoint::MatchEnd);
+        }
+        g_ordersMatched.fetch_add(1, std::memory_order_relaxed);
+        if (counters) {
+            auto done = std::chrono::high_resolution_clock::now();
+            counters->recordEvent(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                done - o.recvTimestamp).count());
+        }
 
-        // Build a confirmation. Use naive logic for "filled qty" & "avg price"
-        uint64_t filledQty = (o.quantity > o.remainingQuantity)
-                             ? (o.quantity - o.remainingQuantity)
-                             : 0;
-        double avgPrice = (filledQty > 0) ? o.price : 0.0;
-        std::string msg = g_orderBook.buildConfirmation(o, filledQty, avgPrice);
+        // Report the outcome; the sender renders it
+        confirmMatched(o, traced, trace);
+        confirmPassiveFills();
+        if (o.kind == OrderKind::Kill) {
+            confirmKilled();
+        }
+    }
+}
 
-        // Enqueue
-        Confirmation c;
-        c.clientAddr = o.clientAddr;
-        c.clientAddrLen = o.clientAddrLen;
-        c.message = msg;
-        g_confirmationQueue.push(c);
+/********************************************************************
+ * Shared-memory poller
+ *
+ * Orders from co-located clients are matched right here and their reports
+ * written straight back to the client's ring, with no sequencing or
+ * confirmation queue in between; the book lock orders them against the
+ * matching thread. Spins while any client is attached (yielding once idle
+ * for a while, in case a client shares the core), otherwise looks for new
+ * ones every millisecond.
+ ********************************************************************/
+static void ipcPollerThread(IpcServer *ipc) {
+    constexpr uint64_t kReapIntervalNs = 100000000;  // 100 ms
+    constexpr int kSpinsBeforeYield = 4096;          // then let a client on this core run
+
+    uint64_t nextSequence = kIpcSequenceBase;
+    auto onOrder = [ipc, &nextSequence](uint32_t client, const IpcOrder &msg) {
+        Order o = fromIpcOrder(msg);
+        o.ipcClient = client;
+        o.sequence = nextSequence++;
+        o.recvTimestamp = std::chrono::high_resolution_clock::now();
+        // The same checks the UDP decoder makes; a failure comes back as an
+        // Unknown order, which the book rejects
+        validateOrder(o);
+        g_orderBook.processOrder(o);
+        ipc->sendReport(client, toIpcReport(o, o.filledQuantity, o.averagePrice(), msg.userData));
+        confirmPassiveFills();
+        if (o.kind == OrderKind::Kill) {
+            confirmKilled();
+        }
+    };
+
+    uint64_t nextReapNs = 0;
+    int idleSpins = 0;
+    while (g_serverRunning.load(std::memory_order_relaxed)) {
+        size_t handled = ipc->poll(onOrder);
+        if (handled > 0) {
+            g_ordersReceived.fetch_add(handled, std::memory_order_relaxed);
+            g_ordersMatched.fetch_add(handled, std::memory_order_relaxed);
+            idleSpins = 0;
+            continue;
+        }
+        uint64_t now = steadyNowNs();
+        if (now >= nextReapNs) {
+            ipc->reap();
+            nextReapNs = now + kReapIntervalNs;
+        }
+        if (ipc->attachedClients() == 0) {
+            waitWhile(g_serverRunning, std::chrono::milliseconds(1));
+        } else if (++idleSpins < kSpinsBeforeYield) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/********************************************************************
+ * Call auctions: started and uncrossed by SIGUSR1, or uncrossed on a
+ * schedule by the expiry thread after --opening-auction-ms
+ ********************************************************************/
+static void uncrossAuction() {
+    AuctionResult result = g_orderBook.uncross();
+    for (const Order &o : result.filled) {
+        confirmLater(o);
+    }
+    if (result.crossed) {
+        std::cout << "[Auction] uncrossed " << result.volume << " at " << result.price
+                  << " (" << result.filled.size() << " orders, surplus " << result.surplus << ")" << std::endl;
+    } else {
+        std::cout << "[Auction] closed without a cross" << std::endl;
+    }
+}
+
+static void toggleAuction() {
+    if (g_orderBook.tradingPhase() == TradingPhase::Auction) {
+        g_uncrossAtMs.store(0);
+        uncrossAuction();
+    } else {
+        g_orderBook.beginAuction();
+        std::cout << "[Auction] call started" << std::endl;
+    }
+}
+
+/********************************************************************
+ * Expiry thread: reports good-till-date orders as they expire and runs
+ * a scheduled uncross
+ ********************************************************************/
+static void expiryTimerThread() {
+    while (waitWhile(g_serverRunning, std::chrono::milliseconds(1))) {
+        for (const Order &o : g_orderBook.expireOrders(g_clock.nowMs())) {
+            confirmLater(o);
+        }
+
+        uint64_t uncrossAt = g_uncrossAtMs.load();
+        if (uncrossAt != 0 && steadyNowNs() / 1000000 >= uncrossAt &&
+            g_uncrossAtMs.compare_exchange_strong(uncrossAt, 0)) {
+            uncrossAuction();
+        }
     }
 }
 
 /********************************************************************
  * Confirmation sender thread
+ *
+ * Hands confirmations to the coalescer, which packs each client's into
+ * shared datagrams, rendering the matcher's fixed-size execution reports
+ * to JSON as it goes. While more are queued it keeps collecting; once the
+ * queue runs dry everything buffered goes out, so an idle server adds no
+ * delay. The socket is non-blocking: a full send buffer holds the
+ * coalescer back instead of stalling the thread.
  ********************************************************************/
-static void confirmationSenderThread(int serverSock) {
-    while (g_serverRunning.load()) {
-        Confirmation c = g_confirmationQueue.pop();
-        sendto(serverSock, c.message.c_str(), c.message.size(), 0,
-               (struct sockaddr*)&c.clientAddr, c.clientAddrLen);
+static ConfirmationCoalescer::SendResult sendDatagram(int serverSock, const sockaddr_in &addr,
+                                                      socklen_t addrLen, const std::string &datagram) {
+    ssize_t sent = sendto(serverSock, datagram.data(), datagram.size(), MSG_DONTWAIT,
+                          (const struct sockaddr*)&addr, addrLen);
+    if (sent >= 0) {
+        return ConfirmationCoalescer::SendResult::Sent;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+        return ConfirmationCoalescer::SendResult::WouldBlock;
+    }
+    return ConfirmationCoalescer::SendResult::Failed;
+}
+
+static void confirmationSenderThread(ConfirmationCoalescer *coalescer) {
+    // Bounds the batch taken off the queue between flushes
+    constexpr int kMaxBatch = 256;
+
+    StageCounters *counters = g_stats.registerSlot(Stage::Send);
+    TraceBuffer *trace = g_tracer.registerThread("sender");
+    coalescer->setSentCallback([&](const Confirmation &c, uint64_t bufferedNs, bool ok) {
+        if (trace && c.traced) {
+            trace->record(c.sequence, TracePoint::Sent);
+        }
+        if (counters) {
+            if (ok) {
+                counters->recordEvent(bufferedNs);
+            } else {
+                counters->recordError();
+            }
+        }
+    });
+
+    Confirmation c;
+    while (true) {
+        bool got;
+        if (!coalescer->pending()) {
+            got = g_confirmationQueue.pop(c);
+        } else {
+            uint64_t now = steadyNowNs();
+            uint64_t deadline = coalescer->nextDeadlineNs();
+            got = (deadline > now) &&
+                  g_confirmationQueue.popFor(c, std::chrono::nanoseconds(deadline - now));
+        }
+        if (!got && g_confirmationQueue.closed() && g_confirmationQueue.empty()) {
+            break;
+        }
+
+        for (int taken = 0; got && taken < kMaxBatch; taken++) {
+            if (g_drainExpired.load(std::memory_order_relaxed)) {
+                g_confirmationsDropped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                if (trace && c.traced) {
+                    trace->record(c.sequence, TracePoint::SendStart);
+                }
+                if (!coalescer->add(c, steadyNowNs()) && counters) {
+                    counters->recordError();  // conflated into a throttle notice
+                }
+            }
+            got = g_confirmationQueue.tryPop(c);
+        }
+        coalescer->flush(steadyNowNs(), g_confirmationQueue.empty());
+    }
+
+    if (!g_drainExpired.load(std::memory_order_relaxed)) {
+        coalescer->flushAll(steadyNowNs());
     }
+    coalescer->setSentCallback(nullptr);
 }
 
 /********************************************************************
- * Throughput logger thread
+ * Verifier alerts
+ *
+ * Called on the verifier's thread. One bug tends to raise a run of
+ * alerts, so only the first few are printed; the stats line keeps count.
  ********************************************************************/
-static void throughputLoggerThread() {
-    auto prevTime = std::chrono::steady_clock::now();
-    uint64_t prevCount = 0;
+static constexpr uint64_t kPrintedVerifierAlerts = 20;
+static uint64_t g_verifierAlertsPrinted = 0;  // verifier thread only
 
-    while (g_serverRunning.load()) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        auto now = std::chrono::steady_clock::now();
+static void printVerifierAlert(const VerifierAlert &a) {
+    if (g_verifierAlertsPrinted >= kPrintedVerifierAlerts) {
+        return;
+    }
+    std::cerr << "[Verifier] input " << a.input;
+    if (a.sequence != 0) {
+        std::cerr << " (seq " << a.sequence << ", order " << a.orderId << ")";
+    }
+    std::cerr << ": " << a.message << "\n";
+    if (++g_verifierAlertsPrinted == kPrintedVerifierAlerts) {
+        std::cerr << "[Verifier] further alerts are counted but not printed\n";
+    }
+}
 
-        uint64_t count = g_orderBook.ordersProcessed();
-        double elapsedSec = std::chrono::duration_cast<std::chrono::seconds>(now - prevTime).count();
-        uint64_t delta = count - prevCount;
-        double tps = (elapsedSec > 0) ? (delta / elapsedSec) : 0.0;
+/********************************************************************
+ * Stats publisher thread
+ *
+ * Folds the per-thread counters into a snapshot, publishes it through
+ * the seqlock in shared memory and logs a throughput line. Publishes a
+ * last time once the pipeline has drained.
+ ********************************************************************/
+static void statsPublisherThread(SharedStatsBlock *block, const AuditWriter *audit,
+                                 const ConfirmationCoalescer *coalescer, const BookVerifier *verifier) {
+    uint64_t prevTimeNs = steadyNowNs();
+    uint64_t prevCount = 0;
 
-        uint64_t totalLat = g_orderBook.totalLatencyNs();
-        double avgLatUs = 0.0;
-        if (count > 0) {
-            avgLatUs = (totalLat / 1000.0) / count;
+    bool running = true;
+    while (running) {
+        running = waitWhile(g_statsRunning, std::chrono::milliseconds(1000));
+        if (g_tracer.enabled()) {
+            g_tracer.collect();
         }
-        uint64_t minLat = g_orderBook.minLatencyNs();
-        uint64_t maxLat = g_orderBook.maxLatencyNs();
+
+        StatsSnapshot snap;
+        g_stats.collect(snap);
+        snap.bidOrders = g_orderBook.bidOrderCount();
+        snap.askOrders = g_orderBook.askOrderCount();
+        MemoryUsage memory = g_orderBook.memoryUsage();
+        snap.reservedBytes = memory.arenaBytes;
+        snap.reservedUsedBytes = memory.arenaUsedBytes;
+        snap.reservedPageBytes = memory.pageBytes;
+        snap.poolHeapFallbacks = memory.heapFallbacks;
+        block->snapshot.store(snap);
+
+        const StageSnapshot &match = snap.stages[static_cast<size_t>(Stage::Match)];
+        double elapsedSec = (snap.publishTimeNs - prevTimeNs) / 1e9;
+        uint64_t count = match.events;
+        double tps = (elapsedSec > 0) ? ((count - prevCount) / elapsedSec) : 0.0;
+        double avgLatUs = (count > 0) ? (match.latency.sumNs / 1000.0) / count : 0.0;
 
         std::cout << "[Server Throughput] " << tps << " orders/sec, "
                   << "AvgLat=" << avgLatUs << "us "
-                  << "MinLat=" << (minLat / 1000.0) << "us "
-                  << "MaxLat=" << (maxLat / 1000.0) << "us "
+                  << "MinLat=" << (count > 0 ? g_orderBook.minLatencyNs() / 1000.0 : 0.0) << "us "
+                  << "MaxLat=" << (match.latency.maxNs / 1000.0) << "us "
                   << "(processed " << count << " total)\n";
+        if (audit && (audit->eventsDropped() > 0 || audit->writeErrors() > 0)) {
+            std::cout << "[Audit] " << audit->eventsWritten() << " written, "
+                      << audit->eventsDropped() << " dropped, "
+                      << audit->writeErrors() << " lost to write errors\n";
+        }
+        if (coalescer->datagramsSent() > 0) {
+            std::cout << "[Confirmations] " << coalescer->confirmationsSent() << " in "
+                      << coalescer->datagramsSent() << " datagrams";
+            if (coalescer->confirmationsConflated() > 0) {
+                std::cout << ", " << coalescer->confirmationsConflated() << " conflated for slow clients ("
+                          << coalescer->throttleNotices() << " throttle notices)";
+            }
+            std::cout << "\n";
+        }
+        uint64_t expedited = g_ordersExpedited.load(std::memory_order_relaxed);
+        uint64_t shed = g_ordersShed.load(std::memory_order_relaxed);
+        if (expedited > 0 || shed > 0) {
+            std::cout << "[Ingress] " << expedited << " cancels/replaces/kills applied ahead of the queue, "
+                      << shed << " new orders shed as overloaded\n";
+        }
+        if (verifier) {
+            std::cout << "[Verifier] " << verifier->inputsChecked() << " inputs checked, "
+                      << verifier->alertsRaised() << " alerts"
+                      << (verifier->overflowed() ? " (suspended: fell behind)" : "") << "\n";
+        }
+        if (g_ipc && g_ipc->ordersReceived() > 0) {
+            std::cout << "[IPC] " << g_ipc->attachedClients() << " clients attached, "
+                      << g_ipc->ordersReceived() << " orders, " << g_ipc->reportsSent() << " reports";
+            if (g_ipc->reportsDropped() > 0) {
+                std::cout << ", " << g_ipc->reportsDropped() << " dropped for slow clients";
+            }
+            std::cout << "\n";
+        }
 
-        prevTime = now;
+        prevTimeNs = snap.publishTimeNs;
         prevCount = count;
     }
 }
 
 /********************************************************************
  * Receiver thread
+ *
+ * Each datagram lands in a pooled buffer, gets the next sequence number
+ * (one per message it carries) and goes to the decoders. When every
+ * buffer is in flight the receiver waits and the socket buffer absorbs
+ * the burst. A write to g_wakeFd stops it, and closing g_freeDatagrams
+ * ends that wait; datagrams still in the socket buffer are not read.
+ *
+ * Cancels, replaces and kills are also decoded right here and expedited
+ * to the matcher, so they never wait behind the decode queue. Doing it
+ * on this one thread keeps expedited messages in arrival order. Past
+ * --shed-queue-depth, the datagram is flagged for its decoder to refuse
+ * the new orders in it.
  ********************************************************************/
+static void expediteUrgent(const RawDatagram &dgram) {
+    const char *cursor = dgram.data;
+    const char *end = dgram.data + dgram.length;
+    const char *line = nullptr;
+    size_t length = 0;
+    for (size_t i = 0; i < dgram.messages && nextMessage(cursor, end, line, length); i++) {
+        if (!isPriorityMessage(line, length)) {
+            continue;
+        }
+        Order o;
+        o.sequence = dgram.sequence + i;
+        o.recvTimestamp = dgram.recvTimestamp;
+        o.clientAddr = dgram.clientAddr;
+        o.clientAddrLen = dgram.clientAddrLen;
+        if (decodeOrderMessage(std::string(line, length), o)) {
+            // The decoders still publish it in sequence; that copy is
+            // skipped if this one takes effect
+            g_sequencedOrders.expedite(std::move(o));
+        }
+    }
+}
+
 static void serverReceiverThread(int serverSock) {
-    while (g_serverRunning.load()) {
-        char buffer[2048];
-        sockaddr_in clientAddr;
-        socklen_t clientAddrLen = sizeof(clientAddr);
+    StageCounters *counters = g_stats.registerSlot(Stage::Receive);
+    TraceBuffer *trace = g_tracer.registerThread("receiver");
+    uint64_t nextSequence = 0;
+    pollfd fds[2] = {{serverSock, POLLIN, 0}, {g_wakeFd, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if ((fds[0].revents & POLLIN) == 0) {
+            continue;
+        }
 
-        std::memset(&clientAddr, 0, sizeof(clientAddr));
-        std::memset(buffer, 0, sizeof(buffer));
+        RawDatagram *dgram = nullptr;
+        if (!g_freeDatagrams.pop(dgram)) {
+            break;  // closed on stop
+        }
+        if (!g_serverRunning.load(std::memory_order_relaxed)) {
+            // Stopped while waiting for the buffer
+            g_freeDatagrams.push(dgram);
+            break;
+        }
+        // recvmsg rather than recvfrom so the kernel receive time comes
+        // along when tracing has turned on SO_TIMESTAMPNS
+        iovec iov{dgram->data, sizeof(dgram->data)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+        msghdr msg{};
+        msg.msg_name = &dgram->clientAddr;
+        msg.msg_namelen = sizeof(dgram->clientAddr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = trace ? control : nullptr;
+        msg.msg_controllen = trace ? sizeof(control) : 0;
+        ssize_t recvLen = recvmsg(serverSock, &msg, MSG_DONTWAIT);
+        if (recvLen <= 0) {
+            g_freeDatagrams.push(dgram);
+            continue;
+        }
+        dgram->recvTimestamp = std::chrono::high_resolution_clock::now();
+        dgram->clientAddrLen = msg.msg_namelen;
+        dgram->length = static_cast<size_t>(recvLen);
+        bool urgent = false;
+        dgram->messages = countMessages(dgram->data, dgram->length, g_priorityLane ? &urgent : nullptr);
+        dgram->sequence = nextSequence;
+        nextSequence += dgram->messages;
+        dgram->shedNewOrders = g_loadShed.maxQueuedMessages != 0 &&
+            dgram->sequence - g_sequencedOrders.nextSequence() >= g_loadShed.maxQueuedMessages;
+        g_ordersReceived.fetch_add(dgram->messages, std::memory_order_relaxed);
+        if (trace && g_tracer.sampled(dgram->sequence)) {
+            for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+                if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec ts;
+                    std::memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+                    trace->record(dgram->sequence, TracePoint::KernelReceive,
+                                  static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec);
+                }
+            }
+            trace->record(dgram->sequence, TracePoint::Receive);
+        }
+        if (urgent) {
+            expediteUrgent(*dgram);
+        }
+        g_decodeQueue.push(dgram);
+        if (counters) {
+            auto queued = std::chrono::high_resolution_clock::now();
+            counters->recordEvent(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                queued - dgram->recvTimestamp).count());
+        }
+    }
+}
 
-        ssize_t recvLen = recvfrom(serverSock, buffer, sizeof(buffer) - 1, 0,
-                                   (struct sockaddr *)&clientAddr, &clientAddrLen);
-        if (recvLen > 0) {
-            buffer[recvLen] = '\0';
-            std::string msg(buffer);
-            Order o = parseOrderMessage(msg, clientAddr);
-            o.clientAddrLen = clientAddrLen;
-            g_orderQueue.push(o);
+/********************************************************************
+ * Shutdown helpers
+ ********************************************************************/
+// Blocks until ENTER on stdin or SIGINT/SIGTERM (read through signalFd).
+// With stdin closed, as under a service manager, only the signals count.
+// SIGUSR1 starts or uncrosses a call auction and keeps waiting.
+static void waitForStopRequest(int signalFd) {
+    pollfd fds[2] = {{signalFd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+    nfds_t count = 2;
+    while (true) {
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            return;
+        }
+        if (fds[0].revents != 0) {
+            signalfd_siginfo info;
+            if (read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+                if (info.ssi_signo == SIGUSR1) {
+                    toggleAuction();
+                    continue;
+                }
+                std::cout << "Received " << strsignal(static_cast<int>(info.ssi_signo)) << std::endl;
+            }
+            return;
+        }
+        if (count > 1 && fds[1].revents != 0) {
+            char buf[256];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0) {
+                count = 1;
+            } else if (std::memchr(buf, '\n', static_cast<size_t>(n))) {
+                return;
+            }
         }
     }
 }
 
+// Past the deadline, tells the stages still draining to discard their input
+static void drainWatchdog(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(g_stopMutex);
+    if (!g_stopCv.wait_until(lock, deadline, [] { return g_drained; })) {
+        g_drainExpired.store(true);
+        lock.unlock();
+        g_sequencedOrders.close();
+        std::cerr << "Drain deadline passed; discarding queued work" << std::endl;
+    }
+}
+
 /********************************************************************
  * runServer
  ********************************************************************/
-static void runServer(const std::string &ip, int port) {
+/********************************************************************
+ * Startup memory plan: the book's order and level storage, the receive
+ * buffers and the pipeline queues are all reserved before any traffic
+ ********************************************************************/
+static void reserveMemory(const ServerOptions &opts) {
+    bool bookMapped = g_orderBook.reserveMemory(opts.memory);
+
+    void *buffers = nullptr;
+    if (g_datagramArena.reserve(kDatagramPoolSize * sizeof(RawDatagram), opts.memory.hugePages)) {
+        buffers = g_datagramArena.allocate(kDatagramPoolSize * sizeof(RawDatagram));
+    }
+    if (buffers) {
+        g_datagramPool = static_cast<RawDatagram*>(buffers);
+        for (size_t i = 0; i < kDatagramPoolSize; i++) {
+            new (&g_datagramPool[i]) RawDatagram();
+        }
+    } else {
+        g_datagramHeap.resize(kDatagramPoolSize);
+        g_datagramPool = g_datagramHeap.data();
+    }
+    g_freeDatagrams.reserve(kDatagramPoolSize);
+    g_decodeQueue.reserve(kDatagramPoolSize);
+    g_confirmationQueue.reserve(kConfirmationQueueReserve);
+
+    MemoryUsage book = g_orderBook.memoryUsage();
+    if (opts.memory.orders > 0) {
+        std::cout << "[Memory] book: " << opts.memory.orders << " orders, " << opts.memory.levels
+                  << " levels per side";
+        if (bookMapped) {
+            std::cout << " in " << (book.arenaBytes >> 20) << " MiB of " << (book.pageBytes >> 10) << " KiB pages";
+        } else {
+            std::cout << " on the heap (arena could not be mapped)";
+        }
+        std::cout << "; receive buffers: "
+                  << (buffers ? std::to_string(g_datagramArena.pageSize() >> 10) + " KiB pages" : "heap")
+                  << std::endl;
+    }
+}
+
+static void runServer(const ServerOptions &opts) {
+    const std::string &ip = opts.ip;
+    int port = opts.port;
+
+    // Stop signals are blocked in every thread (the mask is inherited, so
+    // this comes before any thread starts) and read through a signalfd
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    sigaddset(&stopSignals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    int signalFd = signalfd(-1, &stopSignals, SFD_CLOEXEC);
+    g_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (signalFd < 0 || g_wakeFd < 0) {
+        perror("signalfd/eventfd");
+        exit(EXIT_FAILURE);
+    }
+
     // Create socket
     int serverSock = socket(AF_INET, SOCK_DGRAM, 0);
     if (serverSock < 0) {
@@ -185,47 +953,460 @@ static void runServer(const std::string &ip, int port) {
 
     std::cout << "Server listening on " << ip << ":" << port << std::endl;
 
+    if (g_tracer.enabled()) {
+        int on = 1;
+        if (setsockopt(serverSock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+            perror("SO_TIMESTAMPNS");
+        }
+        std::cout << "Tracing one order in " << opts.traceSample << " to " << opts.traceFile << std::endl;
+    }
+
+    std::unique_ptr<AuditWriter> audit;
+    if (!opts.auditDir.empty()) {
+        AuditConfig auditConfig;
+        auditConfig.directory = opts.auditDir;
+        auditConfig.backpressure = opts.auditBackpressure;
+        auditConfig.maxFileBytes = opts.auditFileMb << 20;
+        audit.reset(new AuditWriter(auditConfig));
+        if (!audit->start()) {
+            close(serverSock);
+            exit(EXIT_FAILURE);
+        }
+        g_orderBook.setEventListener(audit.get());
+        std::cout << "Audit trail in " << opts.auditDir << std::endl;
+    }
+
+    std::unique_ptr<ReplicationPrimary> replicator;
+    if (!opts.replicateTo.empty()) {
+        int fd = connectReplication(opts.replicateTo, 5000);
+        if (fd < 0) {
+            close(serverSock);
+            exit(EXIT_FAILURE);
+        }
+        ReplicationConfig replicationConfig;
+        replicationConfig.heartbeatMs = opts.heartbeatMs;
+        replicator.reset(new ReplicationPrimary(fd, replicationConfig));
+        replicator->start();
+        g_orderBook.setInputJournal(replicator.get());
+        std::cout << "Replicating to standby at " << opts.replicateTo << std::endl;
+    }
+
+    // Wraps the audit writer and replicator, which keep their events
+    std::unique_ptr<BookVerifier> verifier;
+    if (opts.verify && !opts.standbyPath.empty()) {
+        // A standby that took over holds a book the verifier never saw built
+        std::cout << "Verification off: this server took over from a primary" << std::endl;
+    } else if (opts.verify) {
+        VerifierConfig verifierConfig;
+        verifierConfig.stp = opts.stp;
+        verifierConfig.allocation = opts.allocation;
+        verifierConfig.postOnly = opts.postOnly;
+        verifierConfig.tickSize = opts.tickSize;
+        verifier.reset(new BookVerifier(verifierConfig, printVerifierAlert, audit.get(), replicator.get()));
+        verifier->start();
+        g_orderBook.setEventListener(verifier.get());
+        g_orderBook.setInputJournal(verifier.get());
+        std::cout << "Verifying the book against a reference matcher" << std::endl;
+    }
+
+    StatsRegion statsRegion("/orderbook_stats");
+    MetricsServer metrics(statsRegion.block());
+    if (opts.metricsPort > 0) {
+        if (metrics.start(static_cast<uint16_t>(opts.metricsPort))) {
+            std::cout << "Metrics on http://127.0.0.1:" << metrics.port() << "/metrics" << std::endl;
+        }
+    }
+
+    // A standby that took over keeps whatever phase its primary was in
+    if (opts.openingAuctionMs > 0 && opts.standbyPath.empty()) {
+        g_orderBook.beginAuction();
+        g_uncrossAtMs.store(steadyNowNs() / 1000000 + static_cast<uint64_t>(opts.openingAuctionMs));
+        std::cout << "Opening auction: uncross in " << opts.openingAuctionMs << " ms" << std::endl;
+    }
+
+    std::unique_ptr<IpcServer> ipc;
+    if (opts.ipcClients > 0) {
+        ipc.reset(new IpcServer(opts.ipcName, opts.ipcClients));
+        if (!ipc->isOpen()) {
+            close(serverSock);
+            exit(EXIT_FAILURE);
+        }
+        g_ipc = ipc.get();
+        std::cout << "Shared-memory order entry on /dev/shm/" << opts.ipcName << " ("
+                  << opts.ipcClients << " client slots)" << std::endl;
+    }
+
+    ConfirmationCoalescer coalescer(opts.coalescer,
+        [serverSock](const sockaddr_in &addr, socklen_t addrLen, const std::string &datagram) {
+            return sendDatagram(serverSock, addr, addrLen, datagram);
+        });
+
+    for (size_t i = 0; i < kDatagramPoolSize; i++) {
+        g_freeDatagrams.push(&g_datagramPool[i]);
+    }
+
+    // Owners hear of their resting orders' fills (confirmPassiveFills)
+    g_orderBook.setReportPassiveFills(true);
+
     // Start threads
     std::thread receiver(serverReceiverThread, serverSock);
-    const int workerCount = 4;
-    std::vector<std::thread> workers;
-    for (int i = 0; i < workerCount; i++) {
-        workers.emplace_back(serverWorkerThread);
+    std::vector<std::thread> decoders;
+    for (int i = 0; i < opts.decoders; i++) {
+        decoders.emplace_back(decoderThread);
     }
-    std::thread confirmer(confirmationSenderThread, serverSock);
-    std::thread logger(throughputLoggerThread);
+    std::thread matcher(matchingThread);
+    std::thread confirmer(confirmationSenderThread, &coalescer);
+    std::thread expiry(expiryTimerThread);
+    std::thread ipcPoller;
+    if (ipc) {
+        ipcPoller = std::thread(ipcPollerThread, ipc.get());
+    }
+    std::thread logger(statsPublisherThread, statsRegion.block(), audit.get(), &coalescer, verifier.get());
 
-    std::cout << "Press ENTER to stop server..." << std::endl;
-    std::cin.get();
+    std::cout << "Press ENTER (or send SIGINT/SIGTERM) to stop server..." << std::endl;
+    waitForStopRequest(signalFd);
 
-    // shutdown
-    g_serverRunning.store(false);
-    // push dummy to unblock
-    g_orderQueue.push(Order());
-    g_confirmationQueue.push(Confirmation());
+    // The deadline covers stopping ingress as well as the drain
+    std::thread watchdog(drainWatchdog,
+                         std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.drainTimeoutMs));
 
+    // 1. Stop ingress and the expiry timer. Closing the buffer pool frees
+    // a receiver waiting for the decoders to return one.
+    clearFlag(g_serverRunning);
+    uint64_t wake = 1;
+    if (write(g_wakeFd, &wake, sizeof(wake)) != sizeof(wake)) {
+        perror("eventfd write");
+    }
+    g_freeDatagrams.close();
     receiver.join();
-    for (auto &w : workers) {
-        w.join();
+    expiry.join();
+    if (ipcPoller.joinable()) {
+        ipcPoller.join();
     }
+
+    // 2. Drain each stage in pipeline order, bounded by the deadline
+    g_decodeQueue.close();
+    for (auto &d : decoders) {
+        d.join();
+    }
+    g_sequencedOrders.close();
+    matcher.join();
+    g_confirmationQueue.close();
     confirmer.join();
+
+    // 3. Finish checking and flush the audit trail
+    if (verifier) {
+        verifier->stop();
+    }
+    if (audit) {
+        audit->stop();
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_stopMutex);
+        g_drained = true;
+    }
+    g_stopCv.notify_all();
+    watchdog.join();
+
+    clearFlag(g_statsRunning);
     logger.join();
+    metrics.stop();
+    g_ipc = nullptr;
+
+    if (g_tracer.enabled()) {
+        if (g_tracer.writeChromeTrace(opts.traceFile)) {
+            std::cout << "Trace written to " << opts.traceFile << " (" << g_tracer.recordsCollected()
+                      << " records, " << g_tracer.recordsDropped() << " dropped)" << std::endl;
+        }
+    }
 
     close(serverSock);
-    std::cout << "Server stopped.\n";
+    close(g_wakeFd);
+    close(signalFd);
+
+    // Last, so a standby on this host can bind the port once it sees us go
+    if (replicator) {
+        replicator->stop();
+        std::cout << "Replicated " << replicator->sentSequence() << " inputs ("
+                  << replicator->ackedSequence() << " acknowledged)"
+                  << (replicator->linkUp() ? "" : "; standby link lost") << std::endl;
+    }
+    if (verifier) {
+        std::cout << "Verified " << verifier->inputsChecked() << " inputs: " << verifier->alertsRaised()
+                  << " alerts" << (verifier->overflowed() ? ", then suspended after falling behind" : "")
+                  << std::endl;
+    }
+    std::cout << "Server stopped: " << g_ordersReceived.load() << " orders received, "
+              << g_ordersMatched.load() << " matched, "
+              << g_ordersShed.load() << " shed, "
+              << g_confirmationsDropped.load() << " confirmations dropped\n";
+}
+
+/********************************************************************
+ * runStandby: mirrors a primary until it goes away
+ ********************************************************************/
+static bool runStandby(const ServerOptions &opts) {
+    int listenFd = listenReplication(opts.standbyPath);
+    if (listenFd < 0) {
+        return false;
+    }
+    std::cout << "Standby waiting for a primary on " << opts.standbyPath << std::endl;
+    int fd = acceptReplication(listenFd);
+    close(listenFd);
+    unlink(opts.standbyPath.c_str());
+    if (fd < 0) {
+        return false;
+    }
+
+    ReplicationConfig config;
+    config.takeoverMs = opts.takeoverMs;
+    config.acks = opts.standbyAcks;
+    ReplicationStandby standby(fd, g_orderBook, g_clock, config);
+    std::cout << "Standby following primary" << std::endl;
+    ReplicationStandby::Outcome outcome = standby.run();
+    if (outcome == ReplicationStandby::Outcome::Error) {
+        std::cerr << "Replication stream broken after " << standby.appliedSequence()
+                  << " inputs; not taking over" << std::endl;
+        return false;
+    }
+
+    g_clock.goLive();
+    std::cout << "Primary " << (outcome == ReplicationStandby::Outcome::Disconnected ? "disconnected" : "silent")
+              << " after " << standby.appliedSequence() << " inputs; taking over"
+              << (g_orderBook.tradingPhase() == TradingPhase::Auction ? " in a call auction" : "") << std::endl;
+    return true;
 }
 
 /********************************************************************
  * main (server)
  ********************************************************************/
-int main(int argc, char** argv) {
+static void printUsage(const char *prog) {
+    std::cerr << "Usage: " << prog << " <IP> <PORT> [options]\n"
+              << "  --metrics-port <N>  serve Prometheus metrics on 127.0.0.1:N\n"
+              << "  --decoders <N>      threads decoding messages (default 2)\n"
+              << "  --stp <MODE>        self-trade prevention: none, cancel-newest,\n"
+              << "                      cancel-oldest, cancel-both, decrement\n"
+              << "  --post-only <MODE>  crossing post-only orders: reject, reprice\n"
+              << "  --tick-size <T>     price increment used to reprice and to grid the\n"
+              << "                      ladders' dense price windows (default 0.01)\n"
+              << "  --matching <ALGO>   allocation within a price level: fifo (default),\n"
+              << "                      pro-rata, price-time-pro-rata\n"
+              << "  --top-order-slice <N>\n"
+              << "                      pro-rata: oldest order at a level is filled up to N first\n"
+              << "  --fifo-percent <P>  price-time-pro-rata: share of a level's fill allocated\n"
+              << "                      in time priority (default 50)\n"
+              << "  --min-allocation <N>\n"
+              << "                      pro-rata: shares under N go to time priority instead\n"
+              << "  --reserve-orders <N>\n"
+              << "                      resting orders to reserve memory for at startup\n"
+              << "                      (default 65536; 0 = allocate on demand)\n"
+              << "  --reserve-levels <N>\n"
+              << "                      price increments per side held in the dense window\n"
+              << "                      around the touch (default 1024)\n"
+              << "  --huge-pages <MODE> page size for reserved memory: auto (default), 2m, 1g\n"
+              << "                      or off; falls back to prefaulted regular pages\n"
+              << "  --depth-view-levels <N>\n"
+              << "                      price levels per side published for lock-free depth\n"
+              << "                      queries (default 10, at most 32, 0 = off)\n"
+              << "  --audit-dir <DIR>   write the audit trail to rotating files in DIR\n"
+              << "  --audit-backpressure <MODE>\n"
+              << "                      when the audit writer falls behind: block,\n"
+              << "                      spill (default) or drop\n"
+              << "  --audit-file-mb <N> rotate audit files at N MiB (default 64)\n"
+              << "  --priority-lane <on|off>\n"
+              << "                      apply cancels, replaces and kills ahead of queued new\n"
+              << "                      orders (default on)\n"
+              << "  --shed-queue-depth <N>\n"
+              << "                      refuse new orders (\"overloaded\") that arrive with N or\n"
+              << "                      more messages ahead of them (default 0 = off)\n"
+              << "  --shed-sojourn-us <N>\n"
+              << "                      refuse new orders that waited over N us for the\n"
+              << "                      matcher (default 0 = off)\n"
+              << "  --verify <on|off>   check every input against a reference matcher and the\n"
+              << "                      book invariants on a background thread (default off)\n"
+              << "  --drain-timeout-ms <N>\n"
+              << "                      time allowed to drain queues on shutdown (default 2000)\n"
+              << "  --opening-auction-ms <N>\n"
+              << "                      collect orders in a call auction for N ms, then uncross.\n"
+              << "                      SIGUSR1 starts a call (e.g. the close) or uncrosses one.\n"
+              << "  --confirm-mtu <N>   largest confirmation datagram in bytes (default 1400)\n"
+              << "  --confirm-flush-us <N>\n"
+              << "                      longest a confirmation is held back for batching while\n"
+              << "                      the sender is busy (default 50)\n"
+              << "  --client-queue-limit <N>\n"
+              << "                      confirmations buffered per client before the rest are\n"
+              << "                      conflated into a throttle notice (default 1024)\n"
+              << "  --client-rate <N>   confirmations per second per client (default unlimited)\n"
+              << "  --ipc-clients <N>   accept orders from up to N co-located processes over\n"
+              << "                      shared memory (default 0 = off)\n"
+              << "  --ipc-name <NAME>   shared-memory segment in /dev/shm (default orderbook_ipc)\n"
+              << "  --trace-sample <N>  trace one order in N through every stage (default off)\n"
+              << "  --trace-file <PATH> Chrome trace JSON written on shutdown\n"
+              << "                      (default orderbook_trace.json)\n"
+              << "  --replicate-to <PATH>\n"
+              << "                      stream every input to the standby listening on PATH\n"
+              << "  --standby <PATH>    mirror the primary that connects to PATH, then take\n"
+              << "                      over (bind IP:PORT) when it disconnects or goes silent\n"
+              << "  --heartbeat-ms <N>  primary heartbeat interval when idle (default 5)\n"
+              << "  --takeover-ms <N>   standby takes over after N ms of silence (default 50)\n"
+              << "  --standby-acks <on|off>\n"
+              << "                      standby acknowledges applied input (default on)\n";
+}
+
+static bool parseServerOptions(int argc, char **argv, ServerOptions &opts) {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <IP> <PORT>\n";
+        return false;
+    }
+    opts.ip = argv[1];
+    opts.port = std::stoi(argv[2]);
+
+    for (int i = 3; i < argc; i++) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (flag == "--metrics-port") {
+            opts.metricsPort = std::stoi(value);
+        } else if (flag == "--decoders") {
+            opts.decoders = std::stoi(value);
+            if (opts.decoders < 1) {
+                return false;
+            }
+        } else if (flag == "--stp") {
+            if (!parseSelfTradePrevention(value, opts.stp)) {
+                return false;
+            }
+        } else if (flag == "--post-only") {
+            if (value == "reject") {
+                opts.postOnly = PostOnlyMode::Reject;
+            } else if (value == "reprice") {
+                opts.postOnly = PostOnlyMode::Reprice;
+            } else {
+                return false;
+            }
+        } else if (flag == "--tick-size") {
+            opts.tickSize = std::stod(value);
+        } else if (flag == "--matching") {
+            if (!parseMatchingAlgorithm(value, opts.allocation.algorithm)) {
+                return false;
+            }
+        } else if (flag == "--top-order-slice") {
+            opts.allocation.topOrderSlice = std::stoull(value);
+        } else if (flag == "--fifo-percent") {
+            opts.allocation.fifoPercent = static_cast<uint32_t>(std::stoul(value));
+            if (opts.allocation.fifoPercent > 100) {
+                return false;
+            }
+        } else if (flag == "--min-allocation") {
+            opts.allocation.minAllocation = std::stoull(value);
+        } else if (flag == "--reserve-orders") {
+            opts.memory.orders = std::stoull(value);
+        } else if (flag == "--reserve-levels") {
+            opts.memory.levels = std::stoull(value);
+        } else if (flag == "--huge-pages") {
+            if (!parseHugePages(value, opts.memory.hugePages)) {
+                return false;
+            }
+        } else if (flag == "--depth-view-levels") {
+            opts.depthViewLevels = std::stoull(value);
+            if (opts.depthViewLevels > kBookViewLevels) {
+                return false;
+            }
+        } else if (flag == "--audit-dir") {
+            opts.auditDir = value;
+        } else if (flag == "--audit-backpressure") {
+            if (!parseAuditBackpressure(value, opts.auditBackpressure)) {
+                return false;
+            }
+        } else if (flag == "--audit-file-mb") {
+            opts.auditFileMb = std::stoull(value);
+        } else if (flag == "--priority-lane") {
+            if (value != "on" && value != "off") {
+                return false;
+            }
+            opts.priorityLane = (value == "on");
+        } else if (flag == "--shed-queue-depth") {
+            opts.loadShed.maxQueuedMessages = std::stoull(value);
+        } else if (flag == "--shed-sojourn-us") {
+            opts.loadShed.maxSojournNs = std::stoull(value) * 1000;
+        } else if (flag == "--verify") {
+            if (value != "on" && value != "off") {
+                return false;
+            }
+            opts.verify = (value == "on");
+        } else if (flag == "--drain-timeout-ms") {
+            opts.drainTimeoutMs = std::stoi(value);
+        } else if (flag == "--opening-auction-ms") {
+            opts.openingAuctionMs = std::stoi(value);
+        } else if (flag == "--confirm-mtu") {
+            opts.coalescer.maxDatagramBytes = std::stoull(value);
+        } else if (flag == "--confirm-flush-us") {
+            opts.coalescer.flushDelayNs = std::stoull(value) * 1000;
+        } else if (flag == "--client-queue-limit") {
+            opts.coalescer.clientQueueLimit = std::stoull(value);
+            if (opts.coalescer.clientQueueLimit < 1) {
+                return false;
+            }
+        } else if (flag == "--client-rate") {
+            opts.coalescer.clientRatePerSec = std::stoull(value);
+        } else if (flag == "--ipc-clients") {
+            opts.ipcClients = std::stoull(value);
+            if (opts.ipcClients > 0xFFFF) {
+                return false;
+            }
+        } else if (flag == "--ipc-name") {
+            opts.ipcName = value;
+        } else if (flag == "--trace-sample") {
+            opts.traceSample = std::stoull(value);
+        } else if (flag == "--trace-file") {
+            opts.traceFile = value;
+        } else if (flag == "--replicate-to") {
+            opts.replicateTo = value;
+        } else if (flag == "--standby") {
+            opts.standbyPath = value;
+        } else if (flag == "--heartbeat-ms") {
+            opts.heartbeatMs = std::stoi(value);
+        } else if (flag == "--takeover-ms") {
+            opts.takeoverMs = std::stoi(value);
+        } else if (flag == "--standby-acks") {
+            if (value != "on" && value != "off") {
+                return false;
+            }
+            opts.standbyAcks = (value == "on");
+        } else {
+            return false;
+        }
+    }
+    if (opts.heartbeatMs < 1 || opts.takeoverMs <= opts.heartbeatMs) {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ServerOptions opts;
+    if (!parseServerOptions(argc, argv, opts)) {
+        printUsage(argv[0]);
         return 1;
     }
-    std::string ip = argv[1];
-    int port = std::stoi(argv[2]);
 
-    runServer(ip, port);
+    g_tracer.setSampleEvery(opts.traceSample);
+    g_priorityLane = opts.priorityLane;
+    g_loadShed = opts.loadShed;
+
+    // Book settings must match between a primary and its standby
+    g_orderBook.setSelfTradePrevention(opts.stp);
+    g_orderBook.setPostOnlyMode(opts.postOnly);
+    g_orderBook.setTickSize(opts.tickSize);
+    g_orderBook.setAllocationRules(opts.allocation);
+    g_orderBook.setDepthViewLevels(opts.depthViewLevels);
+    g_depthAnswerBytes = std::min(g_depthAnswerBytes, opts.coalescer.maxDatagramBytes);
+    reserveMemory(opts);
+
+    if (!opts.standbyPath.empty() && !runStandby(opts)) {
+        return 1;
+    }
+    runServer(opts);
     return 0;
 }
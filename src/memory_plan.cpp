@@ -0,0 +1,164 @@
+#include "memory_plan.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace {
+
+constexpr size_t k2M = size_t(2) << 20;
+constexpr size_t k1G = size_t(1) << 30;
+
+size_t roundUp(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+// Explicit huge pages from the system's reserved pool; nullptr if none
+void* mapHuge(size_t bytes, size_t pageSize) {
+#ifdef MAP_HUGETLB
+    int log2 = (pageSize == k1G) ? 30 : 21;
+    void *addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE | (log2 << MAP_HUGE_SHIFT),
+                      -1, 0);
+    return (addr == MAP_FAILED) ? nullptr : addr;
+#else
+    (void)bytes;
+    (void)pageSize;
+    return nullptr;
+#endif
+}
+
+} // namespace
+
+bool parseHugePages(const std::string &name, HugePages &policy) {
+    if (name == "off") {
+        policy = HugePages::Off;
+    } else if (name == "auto") {
+        policy = HugePages::Auto;
+    } else if (name == "2m") {
+        policy = HugePages::Huge2M;
+    } else if (name == "1g") {
+        policy = HugePages::Huge1G;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//////////////////// MemoryArena ////////////////////
+MemoryArena::~MemoryArena() {
+    if (m_base) {
+        munmap(m_base, m_capacity);
+    }
+}
+
+bool MemoryArena::reserve(size_t bytes, HugePages policy) {
+    if (m_base || bytes == 0) {
+        return false;
+    }
+
+    void *addr = nullptr;
+    if (policy == HugePages::Huge1G) {
+        addr = mapHuge(roundUp(bytes, k1G), k1G);
+        if (addr) {
+            m_capacity = roundUp(bytes, k1G);
+            m_pageSize = k1G;
+        }
+    }
+    if (!addr && policy != HugePages::Off) {
+        addr = mapHuge(roundUp(bytes, k2M), k2M);
+        if (addr) {
+            m_capacity = roundUp(bytes, k2M);
+            m_pageSize = k2M;
+        }
+    }
+    if (!addr) {
+        // Regular pages: ask for transparent huge pages, then fault every
+        // page in now rather than on first use
+        size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t capacity = roundUp(bytes, policy == HugePages::Off ? pageSize : k2M);
+        addr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            return false;
+        }
+#ifdef MADV_HUGEPAGE
+        if (policy != HugePages::Off) {
+            madvise(addr, capacity, MADV_HUGEPAGE);
+        }
+#endif
+        volatile char *page = static_cast<char*>(addr);
+        for (size_t off = 0; off < capacity; off += pageSize) {
+            page[off] = 0;
+        }
+        m_capacity = capacity;
+        m_pageSize = pageSize;
+    }
+
+    // Keep it resident if allowed; locked memory is often capped, so best effort
+    mlock(addr, m_capacity);
+    m_base = static_cast<char*>(addr);
+    return true;
+}
+
+void* MemoryArena::allocate(size_t bytes, size_t align) {
+    size_t used = m_used.load(std::memory_order_relaxed);
+    size_t start = roundUp(used, align);
+    if (!m_base || start + bytes > m_capacity) {
+        return nullptr;
+    }
+    m_used.store(start + bytes, std::memory_order_relaxed);
+    return m_base + start;
+}
+
+//////////////////// NodePool ////////////////////
+NodePool::~NodePool() = default;
+
+void* NodePool::allocate(size_t bytes) {
+    size_t blockBytes = roundUp(bytes, kGranule);
+    size_t cls = blockBytes / kGranule - 1;
+    if (cls < kClassCount && m_arena) {
+        SizeClass &c = m_classes[cls];
+        if (c.free) {
+            FreeBlock *block = c.free;
+            c.free = block->next;
+            m_inUse.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+        if (!c.chunk || c.chunk + blockBytes > c.chunkEnd) {
+            size_t chunkBytes = roundUp(kChunkBytes, blockBytes);
+            char *chunk = static_cast<char*>(m_arena->allocate(chunkBytes));
+            if (!chunk) {
+                // The arena's tail may still hold a few blocks
+                chunkBytes = blockBytes;
+                chunk = static_cast<char*>(m_arena->allocate(chunkBytes, kGranule));
+            }
+            if (chunk) {
+                c.chunk = chunk;
+                c.chunkEnd = chunk + chunkBytes;
+            }
+        }
+        if (c.chunk && c.chunk + blockBytes <= c.chunkEnd) {
+            void *block = c.chunk;
+            c.chunk += blockBytes;
+            m_inUse.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+    m_heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(bytes);
+}
+
+void NodePool::deallocate(void *p, size_t bytes) {
+    if (!m_arena || !m_arena->contains(p)) {
+        ::operator delete(p);
+        return;
+    }
+    size_t cls = roundUp(bytes, kGranule) / kGranule - 1;
+    FreeBlock *block = static_cast<FreeBlock*>(p);
+    block->next = m_classes[cls].free;
+    m_classes[cls].free = block;
+    m_inUse.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,101 @@
+#include "metrics_server.hpp"
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MetricsServer::MetricsServer(const SharedStatsBlock *block) : m_block(block) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(uint16_t port) {
+    m_listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenSock < 0) {
+        perror("metrics socket");
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(m_listenSock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Loopback only: the endpoint is for a local scraper or sidecar
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(m_listenSock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(m_listenSock, 16) < 0) {
+        perror("metrics bind");
+        close(m_listenSock);
+        m_listenSock = -1;
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(m_listenSock, (struct sockaddr *)&addr, &len);
+    m_port = ntohs(addr.sin_port);
+
+    m_running.store(true);
+    m_thread = std::thread(&MetricsServer::serveLoop, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    close(m_listenSock);
+    m_listenSock = -1;
+}
+
+void MetricsServer::serveLoop() {
+    while (m_running.load()) {
+        pollfd pfd{m_listenSock, POLLIN, 0};
+        // Short timeout so stop() is noticed promptly
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int clientSock = accept(m_listenSock, nullptr, nullptr);
+        if (clientSock >= 0) {
+            handleClient(clientSock);
+            close(clientSock);
+        }
+    }
+}
+
+void MetricsServer::handleClient(int clientSock) {
+    // The request itself is irrelevant; drain what has arrived and answer
+    char request[1024];
+    pollfd pfd{clientSock, POLLIN, 0};
+    if (poll(&pfd, 1, 100) > 0) {
+        recv(clientSock, request, sizeof(request), 0);
+    }
+
+    std::string body = renderPrometheus(m_block->snapshot.load());
+    std::string response =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(clientSock, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
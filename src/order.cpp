@@ -1,16 +1,28 @@
 #include "order.hpp"
 
+#include <cstring>
+
 Order::Order()
     : orderId(0),
       type(""),
       action(""),
+      kind(OrderKind::Unknown),
+      side(Side::Unknown),
       price(0.0),
       quantity(0),
+      ownerId(0),
       remainingQuantity(0),
-      status("open"),
+      filledQuantity(0),
+      filledNotional(0.0),
+      status(OrderStatus::Open),
       isStopOrder(false),
       stopPrice(0.0),
-      clientAddrLen(sizeof(clientAddr)) {
+      displayQuantity(0),
+      hiddenQuantity(0),
+      expireTimeMs(0),
+      sequence(0),
+      clientAddrLen(sizeof(clientAddr)),
+      ipcClient(0) {
 }
 
 Order::Order(uint64_t orderId,
@@ -21,11 +33,95 @@ Order::Order(uint64_t orderId,
     : orderId(orderId),
       type(type),
       action(action),
+      kind(orderKindFromString(type)),
+      side(sideFromString(action)),
       price(price),
       quantity(quantity),
+      ownerId(0),
       remainingQuantity(quantity),
-      status("open"),
+      filledQuantity(0),
+      filledNotional(0.0),
+      status(OrderStatus::Open),
       isStopOrder(false),
       stopPrice(0.0),
-      clientAddrLen(sizeof(clientAddr)) {
+      displayQuantity(0),
+      hiddenQuantity(0),
+      expireTimeMs(0),
+      sequence(0),
+      clientAddrLen(sizeof(clientAddr)),
+      ipcClient(0) {
+}
+
+void Order::classify() {
+    kind = orderKindFromString(type);
+    side = sideFromString(action);
+}
+
+OrderKind orderKindFromString(const std::string &type) {
+    if (type == "limit") return OrderKind::Limit;
+    if (type == "market") return OrderKind::Market;
+    if (type == "ioc") return OrderKind::IOC;
+    if (type == "fok") return OrderKind::FOK;
+    if (type == "post-only") return OrderKind::PostOnly;
+    if (type == "stop-loss") return OrderKind::StopLoss;
+    if (type == "cancel") return OrderKind::Cancel;
+    if (type == "replace") return OrderKind::Replace;
+    if (type == "kill") return OrderKind::Kill;
+    return OrderKind::Unknown;
+}
+
+Side sideFromString(const std::string &action) {
+    if (action == "buy") return Side::Buy;
+    if (action == "sell") return Side::Sell;
+    return Side::Unknown;
+}
+
+const char* orderKindName(OrderKind kind) {
+    switch (kind) {
+        case OrderKind::Limit:    return "limit";
+        case OrderKind::Market:   return "market";
+        case OrderKind::IOC:      return "ioc";
+        case OrderKind::FOK:      return "fok";
+        case OrderKind::PostOnly: return "post-only";
+        case OrderKind::StopLoss: return "stop-loss";
+        case OrderKind::Cancel:   return "cancel";
+        case OrderKind::Query:    return "query";
+        case OrderKind::Replace:  return "replace";
+        case OrderKind::Kill:     return "kill";
+        default:                  return "unknown";
+    }
+}
+
+const char* sideName(Side side) {
+    switch (side) {
+        case Side::Buy:  return "buy";
+        case Side::Sell: return "sell";
+        default:         return "unknown";
+    }
+}
+
+namespace {
+
+const char *const kStatusNames[] = {
+    "other", "open", "executed", "partially_filled", "cancelled", "ioc_no_fill",
+    "fok_no_fill", "post_only_rejected", "repriced", "stp_cancelled", "expired",
+    "rejected", "cancel_rejected", "auction_rejected", "replaced", "replace_rejected",
+    "killed", "overloaded",
+};
+constexpr size_t kStatusCount = sizeof(kStatusNames) / sizeof(kStatusNames[0]);
+static_assert(kStatusCount == static_cast<size_t>(OrderStatus::Count), "a name for every status");
+
+} // namespace
+
+uint8_t orderStatusCode(const char *status, size_t length) {
+    for (size_t i = 1; i < kStatusCount; i++) {
+        if (std::strlen(kStatusNames[i]) == length && std::memcmp(status, kStatusNames[i], length) == 0) {
+            return static_cast<uint8_t>(i);
+        }
+    }
+    return 0;
+}
+
+const char* orderStatusName(uint8_t code) {
+    return (code < kStatusCount) ? kStatusNames[code] : kStatusNames[0];
 }
@@ -0,0 +1,564 @@
+#include "order_client.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Longest request line the client writes; a batch always has room for one
+constexpr size_t kMaxLineBytes = 384;
+// The server's receive buffer
+constexpr size_t kMaxDatagramBytes = 2048;
+
+// Writes "key":"value" pairs into a fixed buffer; overflow is sticky
+class LineWriter {
+public:
+    LineWriter(char *out, size_t capacity) : m_out(out), m_capacity(capacity) { raw("{", 1); }
+
+    void field(const char *key, const char *value) {
+        open(key);
+        raw(value, std::strlen(value));
+        raw("\"", 1);
+    }
+
+    void field(const char *key, uint64_t value) {
+        char digits[20];
+        size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        open(key);
+        while (n > 0) {
+            raw(&digits[--n], 1);
+        }
+        raw("\"", 1);
+    }
+
+    // The same rendering as std::to_string, which the server's own clients used
+    void price(const char *key, double value) {
+        char text[64];
+        int n = std::snprintf(text, sizeof(text), "%f", value);
+        if (n < 0 || static_cast<size_t>(n) >= sizeof(text)) {
+            m_overflow = true;
+            return;
+        }
+        open(key);
+        raw(text, static_cast<size_t>(n));
+        raw("\"", 1);
+    }
+
+    size_t finish() {
+        raw("}", 1);
+        return m_overflow ? 0 : m_length;
+    }
+
+private:
+    void open(const char *key) {
+        if (m_fields++ > 0) {
+            raw(",", 1);
+        }
+        raw("\"", 1);
+        raw(key, std::strlen(key));
+        raw("\":\"", 3);
+    }
+
+    void raw(const char *text, size_t n) {
+        if (m_overflow || m_length + n > m_capacity) {
+            m_overflow = true;
+            return;
+        }
+        std::memcpy(m_out + m_length, text, n);
+        m_length += n;
+    }
+
+    char *m_out;
+    size_t m_capacity;
+    size_t m_length = 0;
+    size_t m_fields = 0;
+    bool m_overflow = false;
+};
+
+bool parseDigits(const char *text, size_t n, uint64_t &out) {
+    if (n == 0 || n > 20) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(text[i] - '0');
+    }
+    out = value;
+    return true;
+}
+
+bool parseDouble(const char *text, size_t n, double &out) {
+    char copy[64];
+    if (n == 0 || n >= sizeof(copy)) {
+        return false;
+    }
+    std::memcpy(copy, text, n);
+    copy[n] = '\0';
+    char *end = nullptr;
+    out = std::strtod(copy, &end);
+    return end == copy + n;
+}
+
+bool keyIs(const char *key, size_t n, const char *name) {
+    return std::strlen(name) == n && std::memcmp(key, name, n) == 0;
+}
+
+// Whether an order last reported with status is still resting
+bool resting(OrderKind kind, uint8_t code) {
+    OrderStatus status = static_cast<OrderStatus>(code);
+    if (status == OrderStatus::Open || status == OrderStatus::Repriced || status == OrderStatus::Replaced) {
+        return true;
+    }
+    bool rests = kind == OrderKind::Limit || kind == OrderKind::PostOnly || kind == OrderKind::StopLoss;
+    return rests && status == OrderStatus::PartiallyFilled;
+}
+
+uint64_t hashId(uint64_t orderId) {
+    uint64_t h = orderId * 0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 32);
+}
+
+} // namespace
+
+//////////////////// Encoding ////////////////////
+size_t encodeSubmit(char *out, size_t capacity, uint64_t orderId, uint32_t ownerId, const OrderRequest &r) {
+    // Keys in the order the server's own messages use
+    LineWriter w(out, capacity);
+    w.field("action", sideName(r.side));
+    if (r.displayQuantity != 0) {
+        w.field("display_quantity", r.displayQuantity);
+    }
+    if (r.expireTimeMs != 0) {
+        w.field("expire_time_ms", r.expireTimeMs);
+    }
+    w.field("order_id", orderId);
+    if (ownerId != 0) {
+        w.field("owner_id", static_cast<uint64_t>(ownerId));
+    }
+    w.price("price", r.price);
+    w.field("quantity", r.quantity);
+    if (r.kind == OrderKind::StopLoss) {
+        w.price("stop_price", r.stopPrice);
+    }
+    w.field("type", orderKindName(r.kind));
+    return w.finish();
+}
+
+size_t encodeCancel(char *out, size_t capacity, uint64_t orderId) {
+    LineWriter w(out, capacity);
+    w.field("order_id", orderId);
+    w.field("type", "cancel");
+    return w.finish();
+}
+
+size_t encodeReplace(char *out, size_t capacity, uint64_t orderId, double price, uint64_t quantity) {
+    LineWriter w(out, capacity);
+    w.field("order_id", orderId);
+    w.price("price", price);
+    w.field("quantity", quantity);
+    w.field("type", "replace");
+    return w.finish();
+}
+
+bool decodeReport(const char *line, size_t length, ClientReport &out) {
+    // "key":"value" pairs, as appendExecutionReportJson writes them
+    const char *p = line;
+    const char *end = line + length;
+    bool haveId = false;
+    while (p < end) {
+        const char *keyStart = static_cast<const char*>(std::memchr(p, '"', end - p));
+        if (!keyStart) break;
+        const char *keyEnd = static_cast<const char*>(std::memchr(keyStart + 1, '"', end - keyStart - 1));
+        if (!keyEnd) break;
+        const char *colon = static_cast<const char*>(std::memchr(keyEnd, ':', end - keyEnd));
+        if (!colon) break;
+        const char *valueStart = static_cast<const char*>(std::memchr(colon, '"', end - colon));
+        if (!valueStart) break;
+        const char *valueEnd = static_cast<const char*>(std::memchr(valueStart + 1, '"', end - valueStart - 1));
+        if (!valueEnd) break;
+
+        const char *key = keyStart + 1;
+        size_t keyLength = static_cast<size_t>(keyEnd - key);
+        const char *value = valueStart + 1;
+        size_t valueLength = static_cast<size_t>(valueEnd - value);
+        if (keyIs(key, keyLength, "order_id")) {
+            haveId = parseDigits(value, valueLength, out.orderId);
+        } else if (keyIs(key, keyLength, "filled_quantity")) {
+            parseDigits(value, valueLength, out.filledQuantity);
+        } else if (keyIs(key, keyLength, "remaining_quantity")) {
+            parseDigits(value, valueLength, out.remainingQuantity);
+        } else if (keyIs(key, keyLength, "average_price")) {
+            parseDouble(value, valueLength, out.averagePrice);
+        } else if (keyIs(key, keyLength, "status")) {
+            out.status = orderStatusCode(value, valueLength);
+        } else if (keyIs(key, keyLength, "passive")) {
+            out.passive = (valueLength == 1 && value[0] == '1');
+        }
+        p = valueEnd + 1;
+    }
+    return haveId && out.status != 0;
+}
+
+//////////////////// OrderClient ////////////////////
+OrderClient::OrderClient(const OrderClientConfig &config)
+    : m_config(config), m_nextHandle(std::max<RequestHandle>(config.firstHandle, 1)) {
+    m_config.maxOrders = std::max<size_t>(m_config.maxOrders, 1);
+    m_config.maxDatagramBytes = std::min(std::max(m_config.maxDatagramBytes, kMaxLineBytes), kMaxDatagramBytes);
+
+    // At most half full, so probes stay short
+    size_t slots = 8;
+    while (slots < 2 * m_config.maxOrders) {
+        slots *= 2;
+    }
+    m_table.resize(slots);
+    m_batch.resize(m_config.maxDatagramBytes);
+    m_received.resize(65536);
+}
+
+OrderClient::~OrderClient() {
+    close();
+}
+
+bool OrderClient::connect(const std::string &ip, int port, std::string *error) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) <= 0) {
+        if (error) {
+            *error = "invalid address " + ip;
+        }
+        return false;
+    }
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0 || ::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        if (error) {
+            *error = std::string("socket: ") + std::strerror(errno);
+        }
+        if (sock >= 0) {
+            ::close(sock);
+        }
+        return false;
+    }
+    // Reports arrive in bursts; best effort
+    int rcvbuf = 4 << 20;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    m_sock = sock;
+    return true;
+}
+
+bool OrderClient::attachIpc(const std::string &name) {
+    return m_ipc.attach(name);
+}
+
+void OrderClient::close() {
+    if (m_sock >= 0) {
+        flush();
+        ::close(m_sock);
+        m_sock = -1;
+    }
+    m_ipc.detach();
+}
+
+RequestHandle OrderClient::submit(const OrderRequest &request) {
+    if (request.quantity == 0 || request.side == Side::Unknown || m_inFlight >= m_config.maxOrders) {
+        return 0;
+    }
+    RequestHandle handle = m_nextHandle;
+    if (m_ipc.attached()) {
+        IpcOrder msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.orderId = handle;
+        msg.quantity = request.quantity;
+        msg.displayQuantity = request.displayQuantity;
+        msg.expireTimeMs = request.expireTimeMs;
+        msg.userData = handle;
+        msg.price = request.price;
+        msg.stopPrice = request.stopPrice;
+        msg.ownerId = m_config.ownerId;
+        msg.kind = request.kind;
+        msg.side = request.side;
+        if (!m_ipc.submit(msg)) {
+            return 0;
+        }
+    } else {
+        size_t capacity = 0;
+        char *out = lineBuffer(capacity);
+        size_t n = out ? encodeSubmit(out, capacity, handle, m_config.ownerId, request) : 0;
+        if (n == 0) {
+            return 0;
+        }
+        commitLine(n);
+    }
+    m_nextHandle++;
+
+    InFlightOrder *entry = insert(handle);
+    entry->kind = request.kind;
+    entry->side = request.side;
+    entry->price = request.price;
+    entry->remainingQuantity = request.quantity;
+    addPending(entry, handle, RequestType::Submit);
+    return handle;
+}
+
+RequestHandle OrderClient::cancel(uint64_t orderId) {
+    InFlightOrder *entry = lookup(orderId);
+    if (!entry || entry->pendingCount == InFlightOrder::kMaxPending) {
+        return 0;
+    }
+    RequestHandle handle = m_nextHandle;
+    if (m_ipc.attached()) {
+        IpcOrder msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.orderId = orderId;
+        msg.userData = handle;
+        msg.kind = OrderKind::Cancel;
+        msg.side = Side::Unknown;
+        if (!m_ipc.submit(msg)) {
+            return 0;
+        }
+    } else {
+        size_t capacity = 0;
+        char *out = lineBuffer(capacity);
+        size_t n = out ? encodeCancel(out, capacity, orderId) : 0;
+        if (n == 0) {
+            return 0;
+        }
+        commitLine(n);
+    }
+    m_nextHandle++;
+    addPending(entry, handle, RequestType::Cancel);
+    return handle;
+}
+
+RequestHandle OrderClient::replace(uint64_t orderId, double price, uint64_t quantity) {
+    InFlightOrder *entry = lookup(orderId);
+    if (!entry || entry->pendingCount == InFlightOrder::kMaxPending || !(price > 0.0) || quantity == 0) {
+        return 0;
+    }
+    RequestHandle handle = m_nextHandle;
+    if (m_ipc.attached()) {
+        IpcOrder msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.orderId = orderId;
+        msg.quantity = quantity;
+        msg.userData = handle;
+        msg.price = price;
+        msg.kind = OrderKind::Replace;
+        msg.side = entry->side;
+        if (!m_ipc.submit(msg)) {
+            return 0;
+        }
+    } else {
+        size_t capacity = 0;
+        char *out = lineBuffer(capacity);
+        size_t n = out ? encodeReplace(out, capacity, orderId, price, quantity) : 0;
+        if (n == 0) {
+            return 0;
+        }
+        commitLine(n);
+    }
+    m_nextHandle++;
+    entry->price = price;
+    addPending(entry, handle, RequestType::Replace);
+    return handle;
+}
+
+bool OrderClient::flush() {
+    if (m_batchLength == 0) {
+        return true;
+    }
+    if (m_sock < 0) {
+        return false;
+    }
+    ssize_t sent = ::send(m_sock, m_batch.data(), m_batchLength, MSG_DONTWAIT);
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)) {
+        return false;
+    }
+    // Sent, or refused outright (the datagram is lost like any dropped one)
+    m_batchLength = 0;
+    return sent >= 0;
+}
+
+char* OrderClient::lineBuffer(size_t &capacity) {
+    if (m_ipc.attached() || m_sock < 0) {
+        return nullptr;
+    }
+    size_t separator = (m_batchLength > 0) ? 1 : 0;
+    if (m_batch.size() - m_batchLength - separator < kMaxLineBytes) {
+        if (!flush()) {
+            return nullptr;
+        }
+        separator = 0;
+    }
+    capacity = m_batch.size() - m_batchLength - separator;
+    return m_batch.data() + m_batchLength + separator;
+}
+
+void OrderClient::commitLine(size_t length) {
+    if (m_batchLength > 0) {
+        m_batch[m_batchLength++] = '\n';
+    }
+    m_batchLength += length;
+}
+
+bool OrderClient::poll(ClientReport &out) {
+    if (m_ipc.attached()) {
+        IpcReport r;
+        if (!m_ipc.poll(r)) {
+            return false;
+        }
+        out = ClientReport();
+        out.orderId = r.orderId;
+        out.filledQuantity = r.filledQuantity;
+        out.remainingQuantity = r.remainingQuantity;
+        out.averagePrice = r.averagePrice;
+        out.status = r.status;
+        out.passive = (r.passive != 0);
+        apply(out, r.userData);
+        return true;
+    }
+    if (m_sock < 0) {
+        return false;
+    }
+    while (true) {
+        // Several newline-separated reports per datagram
+        while (m_receivedOffset < m_receivedLength) {
+            const char *line = m_received.data() + m_receivedOffset;
+            size_t rest = m_receivedLength - m_receivedOffset;
+            const char *newline = static_cast<const char*>(std::memchr(line, '\n', rest));
+            size_t length = newline ? static_cast<size_t>(newline - line) : rest;
+            m_receivedOffset += length + 1;
+            if (length == 0) {
+                continue;
+            }
+            out = ClientReport();
+            if (decodeReport(line, length, out)) {
+                apply(out, 0);
+                return true;
+            }
+            m_otherMessages++;
+        }
+        ssize_t n = ::recv(m_sock, m_received.data(), m_received.size(), MSG_DONTWAIT);
+        if (n <= 0) {
+            return false;
+        }
+        m_receivedLength = static_cast<size_t>(n);
+        m_receivedOffset = 0;
+    }
+}
+
+void OrderClient::apply(ClientReport &report, uint64_t userData) {
+    InFlightOrder *entry = lookup(report.orderId);
+    if (!entry) {
+        m_unknownReports++;
+        report.done = true;
+        return;
+    }
+
+    // Answers come back in request order. Over shared memory the handle is
+    // echoed; over UDP anything but a cancel's own outcome (or an expiry
+    // while a replace waits) can't be the answer to a pending cancel.
+    // Passive fills answer nothing.
+    if (entry->pendingCount > 0 && !report.passive) {
+        OrderStatus status = static_cast<OrderStatus>(report.status);
+        bool answers;
+        if (m_ipc.attached()) {
+            answers = (userData == entry->pending[0]);
+        } else if (entry->pendingType[0] == RequestType::Cancel) {
+            answers = (status == OrderStatus::Cancelled || status == OrderStatus::CancelRejected);
+        } else if (entry->pendingType[0] == RequestType::Replace) {
+            answers = (status != OrderStatus::Expired);
+        } else {
+            answers = true;
+        }
+        if (answers) {
+            report.request = entry->pending[0];
+            report.requestType = entry->pendingType[0];
+            entry->pendingCount--;
+            std::copy(entry->pending + 1, entry->pending + 1 + entry->pendingCount, entry->pending);
+            std::copy(entry->pendingType + 1, entry->pendingType + 1 + entry->pendingCount, entry->pendingType);
+        }
+    }
+
+    entry->status = report.status;
+    entry->filledQuantity = report.filledQuantity;
+    entry->remainingQuantity = report.remainingQuantity;
+    if (entry->pendingCount == 0 && !resting(entry->kind, entry->status)) {
+        erase(entry);
+        report.done = true;
+    }
+}
+
+const InFlightOrder* OrderClient::find(uint64_t orderId) const {
+    return const_cast<OrderClient*>(this)->lookup(orderId);
+}
+
+bool OrderClient::addPending(InFlightOrder *entry, RequestHandle handle, RequestType type) {
+    if (entry->pendingCount == InFlightOrder::kMaxPending) {
+        return false;
+    }
+    entry->pending[entry->pendingCount] = handle;
+    entry->pendingType[entry->pendingCount] = type;
+    entry->pendingCount++;
+    return true;
+}
+
+//////////////////// In-flight table ////////////////////
+// Linear probing; ids are never 0, which marks a free slot
+InFlightOrder* OrderClient::lookup(uint64_t orderId) {
+    if (orderId == 0) {
+        return nullptr;
+    }
+    size_t mask = m_table.size() - 1;
+    for (size_t i = hashId(orderId) & mask;; i = (i + 1) & mask) {
+        if (m_table[i].orderId == orderId) {
+            return &m_table[i];
+        }
+        if (m_table[i].orderId == 0) {
+            return nullptr;
+        }
+    }
+}
+
+InFlightOrder* OrderClient::insert(uint64_t orderId) {
+    size_t mask = m_table.size() - 1;
+    size_t i = hashId(orderId) & mask;
+    while (m_table[i].orderId != 0) {
+        i = (i + 1) & mask;
+    }
+    m_table[i] = InFlightOrder();
+    m_table[i].orderId = orderId;
+    m_inFlight++;
+    return &m_table[i];
+}
+
+void OrderClient::erase(InFlightOrder *entry) {
+    // Backward-shift deletion: pull later entries of the probe run into
+    // the gap unless that would move them before their home slot
+    size_t mask = m_table.size() - 1;
+    size_t gap = static_cast<size_t>(entry - m_table.data());
+    for (size_t j = (gap + 1) & mask; m_table[j].orderId != 0; j = (j + 1) & mask) {
+        size_t home = hashId(m_table[j].orderId) & mask;
+        bool between = (gap <= j) ? (gap < home && home <= j) : (gap < home || home <= j);
+        if (!between) {
+            m_table[gap] = m_table[j];
+            gap = j;
+        }
+    }
+    m_table[gap].orderId = 0;
+    m_inFlight--;
+}
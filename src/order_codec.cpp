@@ -0,0 +1,188 @@
+#include "order_codec.hpp"
+#include "json_utils.hpp"
+#include "price_ladder.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+using Fields = std::map<std::string, std::string>;
+
+// Whole-string unsigned decimal; strtoull alone would accept "-1" and "12abc"
+bool parseUnsigned(const std::string &text, uint64_t &out) {
+    if (text.empty() || text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+    errno = 0;
+    char *end = nullptr;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+// Optional field: absent is fine, present must parse
+bool optionalUnsigned(const Fields &fields, const char *key, uint64_t &out) {
+    auto it = fields.find(key);
+    return it == fields.end() || parseUnsigned(it->second, out);
+}
+
+bool fail(Order &o, std::string *error, const char *reason) {
+    o.kind = OrderKind::Unknown;
+    o.status = OrderStatus::Rejected;
+    if (error) {
+        *error = reason;
+    }
+    return false;
+}
+
+bool decodeQuery(const Fields &fields, const std::string &type, Order &o, DepthQuery &query,
+                 std::string *error) {
+    if (type == "top_of_book") {
+        query.type = DepthQueryType::TopOfBook;
+    } else if (type == "l2") {
+        query.type = DepthQueryType::Levels;
+        auto levels = fields.find("levels");
+        uint64_t n = 0;
+        if (levels == fields.end() || !parseUnsigned(levels->second, n) || n == 0) {
+            return fail(o, error, "missing or invalid levels");
+        }
+        query.levels = static_cast<size_t>(n);
+    } else {
+        query.type = DepthQueryType::Orders;
+    }
+    auto requestId = fields.find("request_id");
+    if (requestId != fields.end() && requestId->second.size() > DepthQuery::kMaxRequestIdBytes) {
+        return fail(o, error, "request_id too long");
+    }
+    query.requestId = (requestId == fields.end()) ? std::string() : requestId->second;
+    o.type = type;
+    o.kind = OrderKind::Query;
+    return true;
+}
+
+bool decodeOrderFields(const Fields &fields, Order &o, std::string *error) {
+    auto id = fields.find("order_id");
+    if (id == fields.end() || !parseUnsigned(id->second, o.orderId)) {
+        return fail(o, error, "missing or invalid order_id");
+    }
+    auto type = fields.find("type");
+    if (type != fields.end()) {
+        o.type = type->second;
+    }
+    auto action = fields.find("action");
+    if (action != fields.end()) {
+        o.action = action->second;
+    }
+    o.isStopOrder = (o.type == "stop-loss");
+    o.classify();
+
+    if (o.kind == OrderKind::Unknown || o.kind == OrderKind::Cancel) {
+        // A cancel only needs the id it refers to
+        return validateOrder(o, error);
+    }
+    uint64_t owner = 0;
+    if (!optionalUnsigned(fields, "owner_id", owner) || owner > UINT32_MAX) {
+        return fail(o, error, (o.kind == OrderKind::Kill) ? "missing or invalid owner_id"
+                                                          : "invalid optional field");
+    }
+    o.ownerId = static_cast<uint32_t>(owner);
+    if (o.kind == OrderKind::Kill) {
+        // A kill names the owner whose orders go; order_id only tags its report
+        return validateOrder(o, error);
+    }
+
+    auto quantity = fields.find("quantity");
+    if (quantity != fields.end() && !parseUnsigned(quantity->second, o.quantity)) {
+        return fail(o, error, "missing or invalid quantity");
+    }
+    o.remainingQuantity = o.quantity;
+
+    auto price = fields.find("price");
+    if (price != fields.end() && !parsePrice(price->second, o.price)) {
+        return fail(o, error, "invalid price");
+    }
+    if (o.isStopOrder) {
+        auto stop = fields.find("stop_price");
+        if (stop != fields.end() && !parsePrice(stop->second, o.stopPrice)) {
+            return fail(o, error, "missing or invalid stop_price");
+        }
+    }
+    if (!optionalUnsigned(fields, "display_quantity", o.displayQuantity) ||
+        !optionalUnsigned(fields, "expire_time_ms", o.expireTimeMs)) {
+        return fail(o, error, "invalid optional field");
+    }
+    return validateOrder(o, error);
+}
+
+} // namespace
+
+bool parsePrice(std::string_view text, double &out) {
+    // strtod needs a terminator; no valid price comes near this long
+    char buf[64];
+    if (text.empty() || text.size() >= sizeof(buf)) {
+        return false;
+    }
+    std::memcpy(buf, text.data(), text.size());
+    buf[text.size()] = '\0';
+    errno = 0;
+    char *end = nullptr;
+    double value = std::strtod(buf, &end);
+    if (errno != 0 || *end != '\0' || !std::isfinite(value) || value < 0.0 ||
+        !priceInRange(value)) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+bool validateOrder(Order &o, std::string *error) {
+    if (o.kind == OrderKind::Unknown || o.kind == OrderKind::Query) {
+        return fail(o, error, "unknown type");
+    }
+    if (o.kind == OrderKind::Cancel) {
+        return true;
+    }
+    if (o.kind == OrderKind::Kill) {
+        return (o.ownerId != 0) || fail(o, error, "missing or invalid owner_id");
+    }
+    if (o.side == Side::Unknown && o.kind != OrderKind::Replace) {
+        // A replace finds its side from the order it names
+        return fail(o, error, "unknown action");
+    }
+    if (o.quantity == 0) {
+        return fail(o, error, "missing or invalid quantity");
+    }
+    if (!(o.price >= 0.0) || !priceInRange(o.price)) {
+        return fail(o, error, "invalid price");
+    }
+    bool priced = o.kind == OrderKind::Limit || o.kind == OrderKind::IOC ||
+                  o.kind == OrderKind::FOK || o.kind == OrderKind::PostOnly ||
+                  o.kind == OrderKind::Replace;
+    if (priced && o.price <= 0.0) {
+        return fail(o, error, "missing price");
+    }
+    if (o.isStopOrder && (!(o.stopPrice > 0.0) || !priceInRange(o.stopPrice))) {
+        return fail(o, error, "missing or invalid stop_price");
+    }
+    return true;
+}
+
+bool decodeOrderMessage(const std::string &json, Order &o, std::string *error) {
+    return decodeOrderFields(parseJsonString(json), o, error);
+}
+
+bool decodeInboundMessage(const std::string &json, Order &o, DepthQuery &query, std::string *error) {
+    Fields fields = parseJsonString(json);
+    auto type = fields.find("type");
+    if (type != fields.end() &&
+        (type->second == "top_of_book" || type->second == "l2" || type->second == "l3")) {
+        return decodeQuery(fields, type->second, o, query, error);
+    }
+    return decodeOrderFields(fields, o, error);
+}
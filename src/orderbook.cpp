@@ -1,296 +1,792 @@
 #include "orderbook.hpp"
-#include "json_utils.hpp"
 #include <algorithm>
-#include <cmath>
+#include <cinttypes>
+#include <cstdio>
 #include <iostream>
 #include <mutex>
+#include <unordered_map>
+
+bool parseSelfTradePrevention(const std::string &name, SelfTradePrevention &mode) {
+    if (name == "none") {
+        mode = SelfTradePrevention::None;
+    } else if (name == "cancel-newest") {
+        mode = SelfTradePrevention::CancelNewest;
+    } else if (name == "cancel-oldest") {
+        mode = SelfTradePrevention::CancelOldest;
+    } else if (name == "cancel-both") {
+        mode = SelfTradePrevention::CancelBoth;
+    } else if (name == "decrement") {
+        mode = SelfTradePrevention::Decrement;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-//////////////////// Priority Comparators ////////////////////
-bool BuyOrderComparator::operator()(const Order &a, const Order &b) const {
-    if (std::fabs(a.price - b.price) < 1e-12) {
-        // Compare timestamps for FIFO
-        return a.recvTimestamp > b.recvTimestamp; // older is higher priority
+//////////////////// Matching Policies ////////////////////
+namespace {
+
+// Per-side constants: the limit used by orders that may trade at any price
+template <Side S> struct SideTraits;
+template <> struct SideTraits<Side::Buy>  { static constexpr int64_t kNoLimit = kNoBuyLimit; };
+template <> struct SideTraits<Side::Sell> { static constexpr int64_t kNoLimit = kNoSellLimit; };
+
+/**
+ * Order-type policies for OrderBook::execute. Every field is a compile-time
+ * constant so each instantiation keeps only the branches it needs.
+ *   kPriced      - trades only down to o.price (else any price)
+ *   kRests       - an unfilled remainder joins the book
+ *   kAllOrNone   - rejected unless the whole quantity is available (FOK)
+ *   kPassiveOnly - rejected if it would trade on arrival (post-only)
+ *   kNoFillStatus - status when nothing traded and nothing rests
+ */
+struct LimitPolicy {
+    static constexpr bool kPriced = true, kRests = true, kAllOrNone = false, kPassiveOnly = false;
+    static constexpr OrderStatus kNoFillStatus = OrderStatus::Open;
+};
+struct MarketPolicy {
+    static constexpr bool kPriced = false, kRests = false, kAllOrNone = false, kPassiveOnly = false;
+    static constexpr OrderStatus kNoFillStatus = OrderStatus::Cancelled;
+};
+struct IocPolicy {
+    static constexpr bool kPriced = true, kRests = false, kAllOrNone = false, kPassiveOnly = false;
+    static constexpr OrderStatus kNoFillStatus = OrderStatus::IocNoFill;
+};
+struct FokPolicy {
+    static constexpr bool kPriced = true, kRests = false, kAllOrNone = true, kPassiveOnly = false;
+    static constexpr OrderStatus kNoFillStatus = OrderStatus::FokNoFill;
+};
+struct PostOnlyPolicy {
+    static constexpr bool kPriced = true, kRests = true, kAllOrNone = false, kPassiveOnly = true;
+    static constexpr OrderStatus kNoFillStatus = OrderStatus::Open;
+};
+
+} // namespace
+
+//////////////////// Execution Reports ////////////////////
+ExecutionReport makeExecutionReport(const Order &o, uint64_t filledQuantity, double avgPrice) {
+    ExecutionReport r;
+    r.orderId = o.orderId;
+    r.filledQuantity = filledQuantity;
+    r.remainingQuantity = o.remainingQuantity;
+    r.averagePrice = avgPrice;
+    r.status = orderStatusCode(o.status);
+    return r;
+}
+
+void appendExecutionReportJson(std::string &out, const ExecutionReport &r) {
+    // Same object buildJsonString would give: sorted keys, string values
+    char buf[512];  // fits any double in %f
+    int n = std::snprintf(buf, sizeof(buf),
+                          "{\"average_price\":\"%f\",\"filled_quantity\":\"%" PRIu64
+                          "\",\"order_id\":\"%" PRIu64 "\",%s\"remaining_quantity\":\"%" PRIu64
+                          "\",\"status\":\"%s\"}",
+                          r.averagePrice, r.filledQuantity, r.orderId, r.passive ? "\"passive\":\"1\"," : "",
+                          r.remainingQuantity, orderStatusName(r.status));
+    if (n > 0) {
+        out.append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
     }
-    return a.price < b.price; // higher price = higher priority
 }
 
-bool SellOrderComparator::operator()(const Order &a, const Order &b) const {
-    if (std::fabs(a.price - b.price) < 1e-12) {
-        return a.recvTimestamp > b.recvTimestamp;
+void appendConfirmationText(std::string &out, const Confirmation &c) {
+    if (!c.message.empty()) {
+        out += c.message;
+    } else {
+        appendExecutionReportJson(out, c.report);
     }
-    return a.price > b.price; // lower price = higher priority
 }
 
 //////////////////// OrderBook ////////////////////
-OrderBook::OrderBook() {}
+OrderBook::OrderBook(const Clock *clock)
+    : m_clock(clock ? clock : &systemClock()),
+      m_expiries(m_clock->nowMs()) {}
+
+void OrderBook::setTickSize(double tickSize) {
+    m_tickTicks = std::max<int64_t>(1, toTicks(tickSize));
+    m_buyOrders.setIncrement(m_tickTicks);
+    m_sellOrders.setIncrement(m_tickTicks);
+}
+
+const OrderBook::Handler OrderBook::kDispatch[kKindCount][kSideCount] = {
+    //                      Buy                                              Sell                                              Unknown
+    /* Limit    */ { &OrderBook::execute<Side::Buy, LimitPolicy>,     &OrderBook::execute<Side::Sell, LimitPolicy>,     &OrderBook::reject },
+    /* Market   */ { &OrderBook::execute<Side::Buy, MarketPolicy>,    &OrderBook::execute<Side::Sell, MarketPolicy>,    &OrderBook::reject },
+    /* IOC      */ { &OrderBook::execute<Side::Buy, IocPolicy>,       &OrderBook::execute<Side::Sell, IocPolicy>,       &OrderBook::reject },
+    /* FOK      */ { &OrderBook::execute<Side::Buy, FokPolicy>,       &OrderBook::execute<Side::Sell, FokPolicy>,       &OrderBook::reject },
+    /* PostOnly */ { &OrderBook::execute<Side::Buy, PostOnlyPolicy>,  &OrderBook::execute<Side::Sell, PostOnlyPolicy>,  &OrderBook::reject },
+    /* StopLoss */ { &OrderBook::handleStopLoss<Side::Buy>,           &OrderBook::handleStopLoss<Side::Sell>,           &OrderBook::reject },
+    /* Cancel   */ { &OrderBook::handleCancel,                        &OrderBook::handleCancel,                         &OrderBook::handleCancel },
+    /* Unknown  */ { &OrderBook::reject,                              &OrderBook::reject,                               &OrderBook::reject },
+    /* Query    */ { &OrderBook::reject,                              &OrderBook::reject,                               &OrderBook::reject },
+    /* Replace  */ { &OrderBook::handleReplace,                       &OrderBook::handleReplace,                        &OrderBook::handleReplace },
+    /* Kill     */ { &OrderBook::handleKill,                          &OrderBook::handleKill,                           &OrderBook::handleKill },
+};
+
+const OrderBook::Handler OrderBook::kAuctionDispatch[kKindCount][kSideCount] = {
+    //                      Buy                                              Sell                                              Unknown
+    /* Limit    */ { &OrderBook::restForAuction<Side::Buy>,           &OrderBook::restForAuction<Side::Sell>,           &OrderBook::reject },
+    /* Market   */ { &OrderBook::rejectInAuction,                     &OrderBook::rejectInAuction,                      &OrderBook::reject },
+    /* IOC      */ { &OrderBook::rejectInAuction,                     &OrderBook::rejectInAuction,                      &OrderBook::reject },
+    /* FOK      */ { &OrderBook::rejectInAuction,                     &OrderBook::rejectInAuction,                      &OrderBook::reject },
+    /* PostOnly */ { &OrderBook::restForAuction<Side::Buy>,           &OrderBook::restForAuction<Side::Sell>,           &OrderBook::reject },
+    /* StopLoss */ { &OrderBook::rejectInAuction,                     &OrderBook::rejectInAuction,                      &OrderBook::reject },
+    /* Cancel   */ { &OrderBook::handleCancel,                        &OrderBook::handleCancel,                         &OrderBook::handleCancel },
+    /* Unknown  */ { &OrderBook::reject,                              &OrderBook::reject,                               &OrderBook::reject },
+    /* Query    */ { &OrderBook::reject,                              &OrderBook::reject,                               &OrderBook::reject },
+    /* Replace  */ { &OrderBook::handleReplace,                       &OrderBook::handleReplace,                        &OrderBook::handleReplace },
+    /* Kill     */ { &OrderBook::handleKill,                          &OrderBook::handleKill,                           &OrderBook::handleKill },
+};
+
+uint64_t OrderBook::inputTime() const {
+    // The journalled time is then always the one in effect
+    return std::max(m_clock->nowMs(), m_expiries.now());
+}
 
 void OrderBook::processOrder(Order &o) {
-    auto startProcess = std::chrono::high_resolution_clock::now();
-
-    // CANCEL
-    if (o.type == "cancel") {
-        // Real system would search the book by ID, remove it if found.
-        // We'll just confirm "cancelled" for demo.
-        o.status = "cancelled";
-        // update stats
-        auto endProcess = std::chrono::high_resolution_clock::now();
-        uint64_t latNs = std::chrono::duration_cast<std::chrono::nanoseconds>(endProcess - o.recvTimestamp).count();
-        m_ordersProcessed.fetch_add(1, std::memory_order_relaxed);
-        m_totalLatencyNs.fetch_add(latNs, std::memory_order_relaxed);
-        // update min/max
-        uint64_t currentMin = m_minLatencyNs.load(std::memory_order_relaxed);
-        while (latNs < currentMin && !m_minLatencyNs.compare_exchange_weak(currentMin, latNs)) {}
-        uint64_t currentMax = m_maxLatencyNs.load(std::memory_order_relaxed);
-        while (latNs > currentMax && !m_maxLatencyNs.compare_exchange_weak(currentMax, latNs)) {}
-
-        return; // no further matching
-    }
-
-    if (o.type == "stop-loss") {
-        handleStopLoss(o);
-    }
-
-    // Immediate or Cancel?
-    if (o.type == "ioc") {
-        bool filledAtAll = handleIOC(o);
-        if (!filledAtAll) {
-            // ioc that didn't fill -> rejected or zero fill
-            o.status = (o.quantity == 0) ? "executed" : "ioc_no_fill";
+    {
+        std::lock_guard<std::mutex> lock(m_bookMutex);
+        uint64_t nowMs = inputTime();
+        if (m_journal) {
+            m_journal->onOrderInput(o, nowMs);
         }
-    }
-    // Fill or Kill?
-    else if (o.type == "fok") {
-        bool canFill = handleFOK(o);
-        if (!canFill) {
-            // entire order not fillable -> kill
-            o.remainingQuantity = o.quantity;
-            o.status = "fok_no_fill";
+        expireDue(nowMs);
+        dispatch(o);
+        if (m_listener) {
+            m_listener->onOrder(o);
         }
+        publishDepth();
     }
-    else if (o.type == "market" || o.type == "limit") {
-        std::lock_guard<std::mutex> lock(m_bookMutex);
+    recordLatency(o);
+}
 
-        if (o.isBuy()) {
-            matchBuyOrder(o);
-            if (o.remainingQuantity > 0 && o.type == "limit") {
-                m_buyOrders.push(o);
-            } else if (o.remainingQuantity == 0) {
-                o.status = "executed";
-            } else {
-                // partial fill
-                if (o.remainingQuantity < o.quantity) {
-                    o.status = "partially_filled";
-                }
-            }
-        } else if (o.isSell()) {
-            matchSellOrder(o);
-            if (o.remainingQuantity > 0 && o.type == "limit") {
-                m_sellOrders.push(o);
-            } else if (o.remainingQuantity == 0) {
-                o.status = "executed";
-            } else {
-                if (o.remainingQuantity < o.quantity) {
-                    o.status = "partially_filled";
-                }
+void OrderBook::dispatch(Order &o) {
+    (this->*m_handlers[static_cast<size_t>(o.kind)][static_cast<size_t>(o.side)])(o);
+}
+
+template <Side S, typename Policy>
+void OrderBook::execute(Order &o) {
+    PriceLadder &own = (S == Side::Buy) ? m_buyOrders : m_sellOrders;
+    PriceLadder &opposite = (S == Side::Buy) ? m_sellOrders : m_buyOrders;
+    int64_t limit = Policy::kPriced ? toTicks(o.price) : SideTraits<S>::kNoLimit;
+
+    if constexpr (Policy::kPriced) {
+        // Beyond the ladder's range; the decoders normally refuse these first
+        if (!priceInRange(o.price)) {
+            o.status = OrderStatus::Rejected;
+            return;
+        }
+    }
+    if constexpr (Policy::kRests) {
+        if (o.expireTimeMs != 0 && o.expireTimeMs <= m_expiries.now()) {
+            o.status = OrderStatus::Expired;
+            return;
+        }
+    }
+    if constexpr (Policy::kPassiveOnly) {
+        if (opposite.crosses(limit)) {
+            if (m_postOnlyMode == PostOnlyMode::Reject) {
+                o.status = OrderStatus::PostOnlyRejected;
+                return;
             }
-        } else {
-            o.status = "rejected";
+            // Rest one tick behind the opposite touch instead of taking liquidity
+            limit = (S == Side::Buy) ? opposite.bestTicks() - m_tickTicks
+                                     : opposite.bestTicks() + m_tickTicks;
+            o.price = fromTicks(limit);
+            o.status = OrderStatus::Repriced;
         }
     }
-    else {
-        // unknown type
-        o.status = "rejected";
+    if constexpr (Policy::kAllOrNone) {
+        uint64_t available = 0;
+        opposite.sweep(o.remainingQuantity, limit, &available);
+        if (available >= o.remainingQuantity && m_stpMode != SelfTradePrevention::None && o.ownerId != 0) {
+            // Its own orders never fill it: cancelling the resting one skips
+            // them, any other mode stops or shrinks the order when reached
+            available = opposite.availableFromOthers(
+                o.remainingQuantity, limit, o.ownerId, m_stpMode == SelfTradePrevention::CancelOldest,
+                m_allocation.algorithm != MatchingAlgorithm::Fifo);
+        }
+        if (available < o.remainingQuantity) {
+            o.status = Policy::kNoFillStatus;
+            return;
+        }
     }
 
-    auto endProcess = std::chrono::high_resolution_clock::now();
-    uint64_t latNs = std::chrono::duration_cast<std::chrono::nanoseconds>(endProcess - o.recvTimestamp).count();
-    m_ordersProcessed.fetch_add(1, std::memory_order_relaxed);
-    m_totalLatencyNs.fetch_add(latNs, std::memory_order_relaxed);
-
-    // track min, max
-    uint64_t currentMin = m_minLatencyNs.load(std::memory_order_relaxed);
-    while (latNs < currentMin && !m_minLatencyNs.compare_exchange_weak(currentMin, latNs)) {}
-    uint64_t currentMax = m_maxLatencyNs.load(std::memory_order_relaxed);
-    while (latNs > currentMax && !m_maxLatencyNs.compare_exchange_weak(currentMax, latNs)) {}
+    if (!match<S>(o, limit)) {
+        // self-trade prevention already set the status
+    } else if (o.remainingQuantity == 0) {
+        o.status = OrderStatus::Executed;
+    } else if constexpr (Policy::kRests) {
+        if (o.filledQuantity > 0) {
+            o.status = OrderStatus::PartiallyFilled;
+        }
+        if (!own.add(o)) {
+            o.status = OrderStatus::Rejected;  // repriced out of range
+            return;
+        }
+        if (m_listener) {
+            m_listener->onRest(o);
+        }
+        if (o.expireTimeMs != 0) {
+            m_expiries.schedule(o.orderId, o.expireTimeMs);
+        }
+    } else {
+        // the unfilled remainder is cancelled
+        o.status = (o.filledQuantity > 0) ? OrderStatus::PartiallyFilled : Policy::kNoFillStatus;
+    }
 }
 
-void OrderBook::matchBuyOrder(Order &buyOrder) {
-    while (buyOrder.remainingQuantity > 0 && !m_sellOrders.empty()) {
-        Order topSell = m_sellOrders.top();
-
-        double effectiveBuyPrice = (buyOrder.type == "market") ? 1e15 : buyOrder.price;
-        if (effectiveBuyPrice < topSell.price) {
-            // no more matching
-            break;
+template <Side S>
+bool OrderBook::match(Order &o, int64_t limitTicks) {
+    if (m_allocation.algorithm != MatchingAlgorithm::Fifo) {
+        return matchProRata<S>(o, limitTicks);
+    }
+    PriceLadder &opposite = (S == Side::Buy) ? m_sellOrders : m_buyOrders;
+    uint64_t stpKey = selfTradeKey(o);
+
+    while (o.remainingQuantity > 0 && opposite.crosses(limitTicks)) {
+        Order &resting = opposite.front();
+        if (resting.ownerId == stpKey) {
+            if (!preventSelfTrade(o, opposite, opposite.bestLevel().begin())) {
+                return false;
+            }
+            continue;
         }
+        uint64_t tradedQty = std::min(o.remainingQuantity, resting.remainingQuantity);
+        recordTrade(o, resting, tradedQty);
 
-        m_sellOrders.pop();
-        uint64_t tradedQty = std::min(buyOrder.remainingQuantity, topSell.remainingQuantity);
-        double tradePrice = topSell.price;
+        // Drops the resting order (and its level) once exhausted
+        opposite.fillFront(tradedQty);
+    }
+    return true;
+}
 
-        buyOrder.remainingQuantity -= tradedQty;
-        topSell.remainingQuantity -= tradedQty;
+template <Side S>
+bool OrderBook::matchProRata(Order &o, int64_t limitTicks) {
+    PriceLadder &opposite = (S == Side::Buy) ? m_sellOrders : m_buyOrders;
+    uint64_t stpKey = selfTradeKey(o);
+
+    while (o.remainingQuantity > 0 && opposite.crosses(limitTicks)) {
+        PriceLadder::OrderQueue &level = opposite.bestLevel();
+        size_t count = level.size();
+        if (m_levelQuantities.size() < count) {
+            m_levelQuantities.resize(count);
+            m_levelAllocations.resize(count);
+        }
 
-        if (topSell.remainingQuantity == 0) {
-            topSell.status = "executed";
-        } else {
-            topSell.status = "partially_filled";
+        // Own orders are dealt with before anything is shared out
+        auto own = level.end();
+        size_t i = 0;
+        for (auto it = level.begin(); it != level.end(); ++it, ++i) {
+            if (it->ownerId == stpKey) {
+                own = it;
+                break;
+            }
+            m_levelQuantities[i] = it->remainingQuantity;
+        }
+        if (own != level.end()) {
+            if (!preventSelfTrade(o, opposite, own)) {
+                return false;
+            }
+            continue;
         }
 
-        // If there's still quantity in topSell, push it back
-        if (topSell.remainingQuantity > 0) {
-            m_sellOrders.push(topSell);
+        allocateLevel(m_allocation, o.remainingQuantity, m_levelQuantities.data(), count,
+                      opposite.bestQuantity(), m_levelAllocations.data());
+
+        // Refilled icebergs move to the back, behind the orders still to
+        // visit, and the level goes away only with its last order, so the
+        // walk is bounded by count rather than by the queue
+        auto it = level.begin();
+        for (i = 0; i < count; i++) {
+            auto next = std::next(it);
+            uint64_t qty = m_levelAllocations[i];
+            if (qty > 0) {
+                recordTrade(o, *it, qty);
+                opposite.fillAt(it, qty);
+            }
+            it = next;
         }
     }
+    return true;
 }
 
-void OrderBook::matchSellOrder(Order &sellOrder) {
-    while (sellOrder.remainingQuantity > 0 && !m_buyOrders.empty()) {
-        Order topBuy = m_buyOrders.top();
-        double effectiveSellPrice = (sellOrder.type == "market") ? 0.0 : sellOrder.price;
-
-        if (topBuy.price < effectiveSellPrice) {
-            break;
-        }
-
-        m_buyOrders.pop();
-        uint64_t tradedQty = std::min(sellOrder.remainingQuantity, topBuy.remainingQuantity);
-        double tradePrice = topBuy.price;
+void OrderBook::recordTrade(Order &o, Order &resting, uint64_t qty) {
+    o.remainingQuantity -= qty;
+    o.filledQuantity += qty;
+    o.filledNotional += resting.price * qty;
+    resting.remainingQuantity -= qty;
+    resting.filledQuantity += qty;
+    resting.filledNotional += resting.price * qty;
+    resting.status = (resting.remainingQuantity == 0) ? OrderStatus::Executed : OrderStatus::PartiallyFilled;
+    if (resting.remainingQuantity + resting.hiddenQuantity == 0) {
+        forgetExpiry(resting);
+    }
+    if (m_reportPassiveFills) {
+        m_passiveFills.push_back(resting);
+        Order &fill = m_passiveFills.back();
+        fill.remainingQuantity += fill.hiddenQuantity;
+        fill.hiddenQuantity = 0;
+        fill.status = (fill.remainingQuantity == 0) ? OrderStatus::Executed : OrderStatus::PartiallyFilled;
+    }
+    if (m_listener) {
+        m_listener->onTrade(o, resting, resting.price, qty);
+    }
+}
 
-        sellOrder.remainingQuantity -= tradedQty;
-        topBuy.remainingQuantity -= tradedQty;
+//////////////////// Call Auction ////////////////////
+void OrderBook::beginAuction() {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    uint64_t nowMs = inputTime();
+    if (m_journal) {
+        m_journal->onPhaseInput(TradingPhase::Auction, nowMs);
+    }
+    expireDue(nowMs);
+    m_phase = TradingPhase::Auction;
+    m_handlers = kAuctionDispatch;
+}
 
-        if (topBuy.remainingQuantity == 0) {
-            topBuy.status = "executed";
+AuctionResult OrderBook::uncross() {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    uint64_t nowMs = inputTime();
+    if (m_journal) {
+        m_journal->onPhaseInput(TradingPhase::Continuous, nowMs);
+    }
+    expireDue(nowMs);
+    m_phase = TradingPhase::Continuous;
+    m_handlers = kDispatch;
+
+    std::vector<AuctionLevel> bids, asks;
+    m_buyOrders.auctionLevels(bids);
+    m_sellOrders.auctionLevels(asks);
+    AuctionEquilibrium eq = findEquilibrium(bids.data(), bids.size(), asks.data(), asks.size());
+
+    AuctionResult result;
+    result.crossed = eq.crossed && eq.volume > 0;
+    if (!result.crossed) {
+        return result;
+    }
+    result.price = fromTicks(eq.ticks);
+    result.volume = eq.volume;
+    result.surplus = eq.surplus;
+
+    // Both sides hold at least volume at or through the price, so pairing
+    // the fronts in priority order executes exactly the crossing orders.
+    // The buy order is reported as the incoming side of each trade.
+    std::unordered_map<uint64_t, size_t> filledIndex;
+    auto recordFill = [&](const Order &o) {
+        auto found = filledIndex.emplace(o.orderId, result.filled.size());
+        if (found.second) {
+            result.filled.push_back(o);
         } else {
-            topBuy.status = "partially_filled";
+            result.filled[found.first->second] = o;
         }
-
-        if (topBuy.remainingQuantity > 0) {
-            m_buyOrders.push(topBuy);
+    };
+
+    uint64_t left = eq.volume;
+    while (left > 0 && !m_buyOrders.empty() && !m_sellOrders.empty()) {
+        Order &bid = m_buyOrders.front();
+        Order &ask = m_sellOrders.front();
+        uint64_t qty = std::min({bid.remainingQuantity, ask.remainingQuantity, left});
+        for (Order *o : {&bid, &ask}) {
+            o->remainingQuantity -= qty;
+            o->filledQuantity += qty;
+            o->filledNotional += result.price * qty;
+            o->status = (o->remainingQuantity + o->hiddenQuantity == 0) ? OrderStatus::Executed : OrderStatus::PartiallyFilled;
+            if (o->status == OrderStatus::Executed) {
+                forgetExpiry(*o);
+            }
         }
+        if (m_listener) {
+            m_listener->onTrade(bid, ask, result.price, qty);
+        }
+        recordFill(bid);
+        recordFill(ask);
+        m_buyOrders.fillFront(qty);
+        m_sellOrders.fillFront(qty);
+        left -= qty;
+    }
+    // What the confirmations report: reserves still resting count as remaining
+    for (Order &o : result.filled) {
+        o.remainingQuantity += o.hiddenQuantity;
     }
+    publishDepth();
+    return result;
 }
 
-std::string OrderBook::buildConfirmation(const Order &o, uint64_t filledQuantity, double avgPrice) {
-    // Build JSON
-    std::map<std::string, std::string> fields;
-    fields["order_id"] = std::to_string(o.orderId);
-    fields["status"] = o.status;
-    fields["filled_quantity"] = std::to_string(filledQuantity);
-    fields["remaining_quantity"] = std::to_string(o.remainingQuantity);
-    fields["average_price"] = std::to_string(avgPrice);
+TradingPhase OrderBook::tradingPhase() {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    return m_phase;
+}
 
-    return buildJsonString(fields);
+template <Side S>
+void OrderBook::restForAuction(Order &o) {
+    if (o.expireTimeMs != 0 && o.expireTimeMs <= m_expiries.now()) {
+        o.status = OrderStatus::Expired;
+        return;
+    }
+    PriceLadder &own = (S == Side::Buy) ? m_buyOrders : m_sellOrders;
+    if (!own.add(o)) {
+        o.status = OrderStatus::Rejected;
+        return;
+    }
+    if (m_listener) {
+        m_listener->onRest(o);
+    }
+    if (o.expireTimeMs != 0) {
+        m_expiries.schedule(o.orderId, o.expireTimeMs);
+    }
+    o.status = OrderStatus::Open;
 }
 
-//////////////////// Extended Logic ////////////////////
+void OrderBook::rejectInAuction(Order &o) {
+    o.status = OrderStatus::AuctionRejected;
+}
 
-void OrderBook::handleStopLoss(Order &o) {
-    // Very naive approach:
-    if (o.isBuy()) {
-        double bestSell = 1e15;
-        {
-            std::lock_guard<std::mutex> lock(m_bookMutex);
-            if (!m_sellOrders.empty()) {
-                bestSell = m_sellOrders.top().price;
-            }
-        }
-        if (bestSell <= o.stopPrice) {
-            // triggers
-            o.type = "market";
-        } else {
-            // store as limit at stopPrice
-            o.type = "limit";
-            o.price = o.stopPrice;
+void OrderBook::handleCancel(Order &o) {
+    // order_id names the resting order to cancel
+    Order removed;
+    if (m_buyOrders.remove(o.orderId, &removed) || m_sellOrders.remove(o.orderId, &removed)) {
+        forgetExpiry(removed);
+        if (m_listener) {
+            m_listener->onCancel(removed, removed.remainingQuantity + removed.hiddenQuantity,
+                                 CancelReason::Requested);
         }
+        o.filledQuantity = removed.filledQuantity;
+        o.remainingQuantity = 0;
+        o.status = OrderStatus::Cancelled;
     } else {
-        double bestBuy = 0.0;
-        {
-            std::lock_guard<std::mutex> lock(m_bookMutex);
-            if (!m_buyOrders.empty()) {
-                bestBuy = m_buyOrders.top().price;
+        o.status = OrderStatus::CancelRejected;
+    }
+}
+
+void OrderBook::handleReplace(Order &o) {
+    // order_id names the resting order; price and quantity are its new
+    // limit and open quantity
+    PriceLadder *ladder = m_buyOrders.find(o.orderId) ? &m_buyOrders
+                        : m_sellOrders.find(o.orderId) ? &m_sellOrders : nullptr;
+    if (!ladder || o.quantity == 0) {
+        o.remainingQuantity = 0;
+        o.status = OrderStatus::ReplaceRejected;
+        return;
+    }
+    const Order &resting = *ladder->find(o.orderId);
+    uint64_t open = resting.remainingQuantity + resting.hiddenQuantity;
+
+    if (toTicks(o.price) == toTicks(resting.price) && o.quantity <= open) {
+        // Same price, no more quantity: keeps its place in the queue
+        if (o.quantity < open) {
+            if (m_listener) {
+                m_listener->onCancel(resting, open - o.quantity, CancelReason::Requested);
             }
+            ladder->reduce(o.orderId, open - o.quantity);
         }
-        if (bestBuy >= o.stopPrice) {
-            o.type = "market";
-        } else {
-            o.type = "limit";
-            o.price = o.stopPrice;
+        o.filledQuantity = resting.filledQuantity;
+        o.filledNotional = resting.filledNotional;
+        o.remainingQuantity = o.quantity;
+        o.status = OrderStatus::Replaced;
+        return;
+    }
+
+    // Anything else loses priority: the order is taken out and entered
+    // again as new, so it may trade at its new price
+    Order moved;
+    ladder->remove(o.orderId, &moved);
+    forgetExpiry(moved);
+    if (m_listener) {
+        m_listener->onCancel(moved, moved.remainingQuantity + moved.hiddenQuantity, CancelReason::Requested);
+    }
+    uint64_t filledBefore = moved.filledQuantity;
+    moved.price = o.price;
+    moved.quantity = filledBefore + o.quantity;
+    moved.remainingQuantity = o.quantity;
+    moved.hiddenQuantity = 0;
+    moved.status = OrderStatus::Open;
+    dispatch(moved);
+
+    o.price = moved.price;
+    o.filledQuantity = moved.filledQuantity;
+    o.filledNotional = moved.filledNotional;
+    o.remainingQuantity = moved.remainingQuantity;
+    bool rested = moved.status == OrderStatus::Open || moved.status == OrderStatus::PartiallyFilled;
+    o.status = (rested && moved.filledQuantity == filledBefore) ? OrderStatus::Replaced : moved.status;
+}
+
+void OrderBook::handleKill(Order &o) {
+    // owner_id names the account whose resting orders all go, both sides
+    o.remainingQuantity = 0;
+    if (o.ownerId == 0) {
+        o.quantity = 0;
+        o.status = OrderStatus::Rejected;
+        return;
+    }
+    uint64_t count = 0;
+    PriceLadder *sides[] = {&m_buyOrders, &m_sellOrders};
+    for (PriceLadder *side : sides) {
+        m_killScratch.clear();
+        side->restingOrders(m_killScratch);
+        for (const RestingOrder &r : m_killScratch) {
+            Order removed;
+            if (r.ownerId != o.ownerId || !side->remove(r.orderId, &removed)) {
+                continue;
+            }
+            forgetExpiry(removed);
+            removed.remainingQuantity += removed.hiddenQuantity;
+            removed.hiddenQuantity = 0;
+            removed.status = OrderStatus::Cancelled;
+            if (m_listener) {
+                m_listener->onCancel(removed, removed.remainingQuantity, CancelReason::Killed);
+            }
+            m_killed.push_back(removed);
+            count++;
         }
     }
+    o.quantity = count;
+    o.status = OrderStatus::Killed;
+}
+
+std::vector<Order> OrderBook::takeKilled() {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    std::vector<Order> killed;
+    killed.swap(m_killed);
+    return killed;
 }
 
-bool OrderBook::handleIOC(Order &o) {
-    // "Immediate Or Cancel": Attempt to match; leftover is canceled
-    // We'll do a quick partial match, but no insertion.
+void OrderBook::takePassiveFills(std::vector<Order> &out) {
+    out.clear();
     std::lock_guard<std::mutex> lock(m_bookMutex);
+    out.swap(m_passiveFills);
+}
 
-    uint64_t originalQty = o.remainingQuantity;
-    if (o.isBuy()) {
-        matchBuyOrder(o);
-    } else if (o.isSell()) {
-        matchSellOrder(o);
-    }
-    // leftover is canceled
-    o.remainingQuantity = 0; // effectively canceled leftover
-    return (o.remainingQuantity < originalQty);
-}
-
-bool OrderBook::handleFOK(Order &o) {
-    // "Fill Or Kill": If the entire quantity cannot be matched immediately, kill the order
-    // We must see if there's enough quantity on the opposite side to fill it in total.
-    // We'll do a quick simulation, then either fill or kill.
-    // For simplicity, let's do a rough approach:
-    if (o.isBuy()) {
-        // Sum up available sell liquidity at or below price
-        std::priority_queue<Order, std::vector<Order>, SellOrderComparator> tempQueue = m_sellOrders;
-        uint64_t accumQty = 0;
-        std::vector<Order> removed;
-
-        while (!tempQueue.empty() && accumQty < o.remainingQuantity) {
-            Order topSell = tempQueue.top();
-            tempQueue.pop();
-            double effectiveBuyPrice = (o.type == "fok") ? o.price : 1e15;
-            if (effectiveBuyPrice < topSell.price) {
-                break;
+bool OrderBook::hasResting(uint64_t orderId) {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    return m_buyOrders.find(orderId) != nullptr || m_sellOrders.find(orderId) != nullptr;
+}
+
+std::vector<Order> OrderBook::expireOrders(uint64_t nowMs) {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    if (m_journal && nowMs > m_expiries.now() && m_expiries.size() > 0) {
+        // Only an advance with expiries pending changes anything; the next
+        // processOrder carries the time forward otherwise
+        m_journal->onClockInput(nowMs);
+    }
+    expireDue(nowMs);
+    if (!m_expired.empty()) {
+        publishDepth();
+    } else {
+        // Nothing changed, but an idle book still answers snapshot requests here
+        serveSnapshotRequest();
+    }
+    std::vector<Order> expired;
+    expired.swap(m_expired);
+    return expired;
+}
+
+void OrderBook::expireDue(uint64_t nowMs) {
+    m_expiries.advance(nowMs, [this](const TimerWheel::Timer &t) {
+        // The order may have filled or been cancelled (or its id reused) since
+        PriceLadder *sides[] = {&m_buyOrders, &m_sellOrders};
+        for (PriceLadder *side : sides) {
+            const Order *resting = side->find(t.id);
+            if (resting && resting->expireTimeMs == t.deadlineMs) {
+                Order removed;
+                side->remove(t.id, &removed);
+                removed.remainingQuantity += removed.hiddenQuantity;
+                removed.hiddenQuantity = 0;
+                removed.status = OrderStatus::Expired;
+                if (m_listener) {
+                    m_listener->onCancel(removed, removed.remainingQuantity, CancelReason::Expired);
+                }
+                m_expired.push_back(removed);
+                return;
             }
-            accumQty += topSell.remainingQuantity;
-            removed.push_back(topSell);
         }
+    });
+}
 
-        if (accumQty >= o.remainingQuantity) {
-            // we can fill
-            std::lock_guard<std::mutex> lock(m_bookMutex);
-            matchBuyOrder(o);
+void OrderBook::forgetExpiry(const Order &o) {
+    if (o.expireTimeMs != 0) {
+        m_expiries.cancel(o.orderId, o.expireTimeMs);
+    }
+}
+
+void OrderBook::reject(Order &o) {
+    o.status = OrderStatus::Rejected;
+}
+
+void OrderBook::recordLatency(const Order &o) {
+    auto endProcess = std::chrono::high_resolution_clock::now();
+    uint64_t latNs = std::chrono::duration_cast<std::chrono::nanoseconds>(endProcess - o.recvTimestamp).count();
+    m_ordersProcessed.fetch_add(1, std::memory_order_relaxed);
+    m_totalLatencyNs.fetch_add(latNs, std::memory_order_relaxed);
+
+    // track min, max
+    uint64_t currentMin = m_minLatencyNs.load(std::memory_order_relaxed);
+    while (latNs < currentMin && !m_minLatencyNs.compare_exchange_weak(currentMin, latNs)) {}
+    uint64_t currentMax = m_maxLatencyNs.load(std::memory_order_relaxed);
+    while (latNs > currentMax && !m_maxLatencyNs.compare_exchange_weak(currentMax, latNs)) {}
+}
+
+uint64_t OrderBook::selfTradeKey(const Order &o) const {
+    // ownerIds are 32-bit, so this sentinel never matches a resting order
+    constexpr uint64_t kNoSelfTradeKey = UINT64_MAX;
+    if (m_stpMode == SelfTradePrevention::None || o.ownerId == 0) {
+        return kNoSelfTradeKey;
+    }
+    return o.ownerId;
+}
+
+bool OrderBook::preventSelfTrade(Order &incoming, PriceLadder &resting, PriceLadder::OrderQueue::iterator own) {
+    switch (m_stpMode) {
+        case SelfTradePrevention::CancelOldest:
+            forgetExpiry(*own);
+            if (m_listener) {
+                m_listener->onCancel(*own, own->remainingQuantity + own->hiddenQuantity, CancelReason::SelfTrade);
+            }
+            resting.cancelAt(own);
             return true;
-        } else {
-            // kill
+
+        case SelfTradePrevention::CancelBoth:
+            forgetExpiry(*own);
+            if (m_listener) {
+                m_listener->onCancel(*own, own->remainingQuantity + own->hiddenQuantity, CancelReason::SelfTrade);
+            }
+            resting.cancelAt(own);
+            incoming.status = OrderStatus::StpCancelled;
             return false;
-        }
-    } else {
-        // For sells
-        std::priority_queue<Order, std::vector<Order>, BuyOrderComparator> tempQueue = m_buyOrders;
-        uint64_t accumQty = 0;
-        std::vector<Order> removed;
-
-        while (!tempQueue.empty() && accumQty < o.remainingQuantity) {
-            Order topBuy = tempQueue.top();
-            tempQueue.pop();
-            double effectiveSellPrice = (o.type == "fok") ? o.price : 0.0;
-            if (topBuy.price < effectiveSellPrice) {
-                break;
+
+        case SelfTradePrevention::Decrement: {
+            uint64_t qty = std::min(incoming.remainingQuantity, own->remainingQuantity);
+            if (m_listener) {
+                m_listener->onCancel(*own, qty, CancelReason::SelfTrade);
+            }
+            incoming.remainingQuantity -= qty;
+            own->remainingQuantity -= qty;
+            if (own->remainingQuantity + own->hiddenQuantity == 0) {
+                forgetExpiry(*own);
+            }
+            resting.fillAt(own, qty);
+            if (incoming.remainingQuantity == 0) {
+                incoming.status = OrderStatus::StpCancelled;
+                return false;
             }
-            accumQty += topBuy.remainingQuantity;
-            removed.push_back(topBuy);
+            return true;
         }
 
-        if (accumQty >= o.remainingQuantity) {
-            std::lock_guard<std::mutex> lock(m_bookMutex);
-            matchSellOrder(o);
-            return true;
-        } else {
+        case SelfTradePrevention::CancelNewest:
+        default:
+            incoming.status = OrderStatus::StpCancelled;
             return false;
+    }
+}
+
+void OrderBook::publishDepth() {
+    m_bidOrderCount.store(m_buyOrders.orderCount(), std::memory_order_relaxed);
+    m_askOrderCount.store(m_sellOrders.orderCount(), std::memory_order_relaxed);
+
+    m_viewScratch.version++;
+    if (m_viewLevels > 0) {
+        m_viewScratch.bidLevels = static_cast<uint32_t>(m_buyOrders.depthInto(m_viewScratch.bids, m_viewLevels));
+        m_viewScratch.askLevels = static_cast<uint32_t>(m_sellOrders.depthInto(m_viewScratch.asks, m_viewLevels));
+        m_depthView.store(m_viewScratch);
+    }
+    serveSnapshotRequest();
+}
+
+bool OrderBook::reserveMemory(const MemoryPlan &plan) {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    // A list node and an index node per resting order, plus a chunk of
+    // slack per node size
+    constexpr size_t kNodeBytes = sizeof(Order) + 2 * sizeof(void*) + 48;
+    constexpr size_t kSlackBytes = 1 << 20;
+    bool mapped = plan.orders > 0 && m_arena.reserve(plan.orders * kNodeBytes + kSlackBytes, plan.hugePages);
+    NodePool *pool = mapped ? &m_nodePool : nullptr;
+    m_buyOrders.reserve(plan.levels, plan.orders, pool);
+    m_sellOrders.reserve(plan.levels, plan.orders, pool);
+    m_expired.reserve(1024);
+    m_passiveFills.reserve(1024);
+    return mapped;
+}
+
+MemoryUsage OrderBook::memoryUsage() const {
+    MemoryUsage usage;
+    usage.arenaBytes = m_arena.capacity();
+    usage.arenaUsedBytes = m_arena.used();
+    usage.pageBytes = m_arena.pageSize();
+    usage.nodesInUse = m_nodePool.blocksInUse();
+    usage.heapFallbacks = m_nodePool.heapFallbacks();
+    return usage;
+}
+
+void OrderBook::setDepthViewLevels(size_t levels) {
+    m_viewLevels = std::min(levels, kBookViewLevels);
+}
+
+std::shared_ptr<const BookSnapshot> OrderBook::buildSnapshot() const {
+    auto snap = std::make_shared<BookSnapshot>();
+    snap->version = m_viewScratch.version;
+    m_buyOrders.restingOrders(snap->bids);
+    m_sellOrders.restingOrders(snap->asks);
+    return snap;
+}
+
+void OrderBook::serveSnapshotRequest() {
+    if (!m_snapshotRequested.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::shared_ptr<const BookSnapshot> snap = buildSnapshot();
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        m_snapshot = std::move(snap);
+        m_snapshotRequested.store(false, std::memory_order_relaxed);
+    }
+    m_snapshotCv.notify_all();
+}
+
+std::shared_ptr<const BookSnapshot> OrderBook::orderSnapshot(std::chrono::milliseconds wait) {
+    {
+        std::unique_lock<std::mutex> lock(m_snapshotMutex);
+        std::shared_ptr<const BookSnapshot> previous = m_snapshot;
+        m_snapshotRequested.store(true, std::memory_order_release);
+        if (m_snapshotCv.wait_for(lock, wait, [&] { return m_snapshot != previous; })) {
+            return m_snapshot;
         }
     }
+    std::lock_guard<std::mutex> bookLock(m_bookMutex);
+    serveSnapshotRequest();
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    return m_snapshot;
+}
+
+std::vector<DepthLevel> OrderBook::bidDepth(size_t levels) {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    return m_buyOrders.depth(levels);
+}
+
+std::vector<DepthLevel> OrderBook::askDepth(size_t levels) {
+    std::lock_guard<std::mutex> lock(m_bookMutex);
+    return m_sellOrders.depth(levels);
+}
+
+//////////////////// Extended Logic ////////////////////
+
+template <Side S>
+void OrderBook::handleStopLoss(Order &o) {
+    // Very naive approach: trigger against the opposite touch, otherwise
+    // store as a limit at stopPrice
+    const PriceLadder &opposite = (S == Side::Buy) ? m_sellOrders : m_buyOrders;
+    bool triggered = false;
+    if (!opposite.empty()) {
+        triggered = (S == Side::Buy) ? (opposite.bestPrice() <= o.stopPrice)
+                                     : (opposite.bestPrice() >= o.stopPrice);
+    }
+
+    if (triggered) {
+        o.type = "market";
+        o.kind = OrderKind::Market;
+    } else {
+        o.type = "limit";
+        o.kind = OrderKind::Limit;
+        o.price = o.stopPrice;
+    }
+    dispatch(o);
 }
@@ -0,0 +1,575 @@
+#include "price_ladder.hpp"
+#include "level_scan.hpp"
+#include <algorithm>
+
+namespace {
+
+// Non-negative remainder, for keys on either side of zero
+int64_t floorMod(int64_t value, int64_t step) {
+    int64_t r = value % step;
+    return (r < 0) ? r + step : r;
+}
+
+} // namespace
+
+PriceLadder::PriceLadder(bool isBid)
+    : m_isBid(isBid), m_increment(toTicks(0.01)) {
+    resizeWindow(kDefaultWindowSlots);
+}
+
+void PriceLadder::reserve(size_t levels, size_t orders, NodePool *pool) {
+    m_allocator = PoolAllocator<Order>(pool);
+    size_t slots = 64;
+    while (slots < levels) {
+        slots *= 2;
+    }
+    resizeWindow(slots);
+    m_outlying = OutlyingMap(std::less<int64_t>(), OutlyingAllocator(pool));
+    // Buckets for every order, so the index never rehashes mid-session
+    m_index = decltype(m_index)(orders, m_index.hash_function(), m_index.key_eq(), IndexAllocator(pool));
+}
+
+void PriceLadder::resizeWindow(size_t slots) {
+    m_slotQuantities.assign(slots, 0);
+    m_slotQueues.clear();
+    m_slotQueues.reserve(slots);
+    for (size_t i = 0; i < slots; i++) {
+        m_slotQueues.emplace_back(m_allocator);
+    }
+    m_occupied.assign((slots + 63) / 64, 0);
+    m_windowStart = 0;
+    m_windowTop = kNoSlot;
+    m_windowLevels = 0;
+    m_windowPlaced = false;
+}
+
+void PriceLadder::setIncrement(int64_t ticks) {
+    ticks = std::max<int64_t>(1, ticks);
+    if (ticks == m_increment) {
+        return;
+    }
+    // Everything goes to the map; the window is placed again on the new grid
+    if (m_windowPlaced) {
+        for (size_t slot = 0; slot < m_slotQuantities.size(); slot++) {
+            if (occupied(physical(slot))) {
+                demote(slot);
+            }
+        }
+    }
+    m_increment = ticks;
+    m_windowStart = 0;
+    m_windowTop = kNoSlot;
+    m_windowPlaced = false;
+    if (m_bestQueue) {
+        refreshBest();
+    }
+}
+
+size_t PriceLadder::slotOf(int64_t key) const {
+    if (!inBand(key)) {
+        return kNoSlot;
+    }
+    int64_t offset = key - m_windowLow;
+    return (offset % m_increment == 0) ? static_cast<size_t>(offset / m_increment) : kNoSlot;
+}
+
+size_t PriceLadder::occupiedAtOrBelow(size_t slot) const {
+    // Walk the bitmap a word at a time, downwards from slot's physical
+    // position and round the ring, over slot + 1 positions at most
+    size_t mask = m_slotQuantities.size() - 1;
+    size_t left = slot + 1;
+    size_t phys = physical(slot);
+    while (left > 0) {
+        size_t bit = phys & 63;
+        size_t span = std::min(bit + 1, left);
+        uint64_t upTo = (bit == 63) ? ~0ull : ((1ull << (bit + 1)) - 1);
+        uint64_t from = ~((1ull << (bit + 1 - span)) - 1);
+        uint64_t word = m_occupied[phys >> 6] & upTo & from;
+        if (word != 0) {
+            size_t high = 63 - static_cast<size_t>(__builtin_clzll(word));
+            return (phys - bit + high - m_windowStart) & mask;
+        }
+        left -= span;
+        phys = (phys - span) & mask;
+    }
+    return kNoSlot;
+}
+
+void PriceLadder::locate(int64_t key, uint64_t *&quantity, OrderQueue *&queue) {
+    quantity = nullptr;
+    queue = nullptr;
+    size_t slot = slotOf(key);
+    if (slot != kNoSlot) {
+        size_t phys = physical(slot);
+        if (occupied(phys)) {
+            quantity = &m_slotQuantities[phys];
+            queue = &m_slotQueues[phys];
+        }
+        return;
+    }
+    auto found = m_outlying.find(key);
+    if (found != m_outlying.end()) {
+        quantity = &found->second.quantity;
+        queue = &found->second.queue;
+    }
+}
+
+bool PriceLadder::add(const Order &o) {
+    if (!priceInRange(o.price)) {
+        return false;
+    }
+    int64_t key = keyFor(toTicks(o.price));
+    if ((m_bestQueue == nullptr || key > m_bestKey) && !inBand(key)) {
+        // A new best beyond the window moves the window to it
+        recenter(key);
+    }
+
+    uint64_t *quantity;
+    OrderQueue *queue;
+    size_t slot = slotOf(key);
+    if (slot != kNoSlot) {
+        size_t phys = physical(slot);
+        if (!occupied(phys)) {
+            m_occupied[phys >> 6] |= 1ull << (phys & 63);
+            m_windowLevels++;
+            if (m_windowTop == kNoSlot || slot > m_windowTop) {
+                m_windowTop = slot;
+            }
+        }
+        quantity = &m_slotQuantities[phys];
+        queue = &m_slotQueues[phys];
+    } else {
+        auto level = m_outlying.try_emplace(key, OrderQueue(m_allocator)).first;
+        quantity = &level->second.quantity;
+        queue = &level->second.queue;
+    }
+
+    queue->push_back(o);
+    Order &node = queue->back();
+    if (node.displayQuantity > 0 && node.remainingQuantity > node.displayQuantity) {
+        node.hiddenQuantity = node.remainingQuantity - node.displayQuantity;
+        node.remainingQuantity = node.displayQuantity;
+    }
+
+    *quantity += node.remainingQuantity;
+    m_index[node.orderId] = std::prev(queue->end());
+    m_orderCount++;
+
+    if (m_bestQueue == nullptr || key > m_bestKey) {
+        m_bestKey = key;
+        m_bestQuantity = quantity;
+        m_bestQueue = queue;
+    }
+    return true;
+}
+
+const Order* PriceLadder::find(uint64_t orderId) const {
+    auto found = m_index.find(orderId);
+    return (found == m_index.end()) ? nullptr : &*found->second;
+}
+
+bool PriceLadder::remove(uint64_t orderId, Order *removed) {
+    auto found = m_index.find(orderId);
+    if (found == m_index.end()) {
+        return false;
+    }
+    OrderQueue::iterator node = found->second;
+    m_index.erase(found);
+
+    int64_t key = keyFor(toTicks(node->price));
+    uint64_t *quantity;
+    OrderQueue *queue;
+    locate(key, quantity, queue);
+    *quantity -= node->remainingQuantity;
+    if (removed) {
+        *removed = *node;
+    }
+    queue->erase(node);
+    m_orderCount--;
+    if (queue->empty()) {
+        eraseLevel(key);
+    }
+    return true;
+}
+
+void PriceLadder::reduce(uint64_t orderId, uint64_t qty) {
+    auto found = m_index.find(orderId);
+    if (found == m_index.end()) {
+        return;
+    }
+    Order &node = *found->second;
+    uint64_t hidden = std::min(qty, node.hiddenQuantity);
+    node.hiddenQuantity -= hidden;
+    node.remainingQuantity -= qty - hidden;
+
+    uint64_t *quantity;
+    OrderQueue *queue;
+    locate(keyFor(toTicks(node.price)), quantity, queue);
+    *quantity -= qty - hidden;
+}
+
+void PriceLadder::fillAt(OrderQueue::iterator it, uint64_t qty) {
+    OrderQueue &queue = *m_bestQueue;
+    *m_bestQuantity -= qty;
+
+    if (it->remainingQuantity > 0) {
+        return;
+    }
+    if (it->hiddenQuantity > 0) {
+        // Replenish the iceberg's slice and send it to the back of the level
+        uint64_t slice = std::min(it->displayQuantity, it->hiddenQuantity);
+        it->hiddenQuantity -= slice;
+        it->remainingQuantity = slice;
+        *m_bestQuantity += slice;
+        queue.splice(queue.end(), queue, it);
+        return;
+    }
+
+    unindex(it);
+    queue.erase(it);
+    m_orderCount--;
+    if (queue.empty()) {
+        eraseLevel(m_bestKey);
+    }
+}
+
+void PriceLadder::cancelAt(OrderQueue::iterator it) {
+    uint64_t qty = it->remainingQuantity;
+    it->remainingQuantity = 0;
+    it->hiddenQuantity = 0;
+    fillAt(it, qty);
+}
+
+void PriceLadder::eraseLevel(int64_t key) {
+    size_t slot = slotOf(key);
+    if (slot != kNoSlot) {
+        size_t phys = physical(slot);
+        m_occupied[phys >> 6] &= ~(1ull << (phys & 63));
+        m_slotQuantities[phys] = 0;
+        m_windowLevels--;
+        if (slot == m_windowTop) {
+            m_windowTop = (slot == 0) ? kNoSlot : occupiedAtOrBelow(slot - 1);
+        }
+    } else {
+        m_outlying.erase(key);
+    }
+    if (key == m_bestKey) {
+        refreshBest();
+    }
+}
+
+void PriceLadder::refreshBest() {
+    // At most one recenter: a key the window cannot be placed on stays the
+    // best from the map
+    bool recentered = false;
+    while (true) {
+        auto top = m_outlying.rbegin();
+        bool haveOutlying = (top != m_outlying.rend());
+        if (m_windowTop == kNoSlot && !haveOutlying) {
+            m_bestQuantity = nullptr;
+            m_bestQueue = nullptr;
+            return;
+        }
+        if (haveOutlying && (m_windowTop == kNoSlot || top->first > keyOfSlot(m_windowTop))) {
+            if (!recentered && !inBand(top->first)) {
+                // The touch has moved past the window's edge
+                recentered = true;
+                if (recenter(top->first)) {
+                    continue;
+                }
+            }
+            m_bestKey = top->first;
+            m_bestQuantity = &top->second.quantity;
+            m_bestQueue = &top->second.queue;
+        } else {
+            size_t phys = physical(m_windowTop);
+            m_bestKey = keyOfSlot(m_windowTop);
+            m_bestQuantity = &m_slotQuantities[phys];
+            m_bestQueue = &m_slotQueues[phys];
+        }
+        return;
+    }
+}
+
+bool PriceLadder::recenter(int64_t key) {
+    int64_t slots = static_cast<int64_t>(m_slotQuantities.size());
+    // Keys and the window's span stay within the supported price range, so
+    // none of the arithmetic below can overflow
+    if (key > kMaxPriceTicks || key < -kMaxPriceTicks || m_increment > kMaxPriceTicks / slots) {
+        return false;
+    }
+    int64_t low = key - floorMod(key, m_increment) - (slots / 2) * m_increment;
+    if (m_windowPlaced && low == m_windowLow) {
+        return true;
+    }
+
+    // Levels the move uncovers go to the map. Slots that stay in the band
+    // keep their physical place; only the ring's start moves.
+    int64_t shift = m_windowPlaced ? (low - m_windowLow) / m_increment : slots;
+    if (shift >= slots || shift <= -slots) {
+        for (size_t slot = 0; slot < m_slotQuantities.size(); slot++) {
+            if (occupied(physical(slot))) {
+                demote(slot);
+            }
+        }
+        m_windowStart = 0;
+    } else if (shift > 0) {
+        for (size_t slot = 0; slot < static_cast<size_t>(shift); slot++) {
+            if (occupied(physical(slot))) {
+                demote(slot);
+            }
+        }
+        m_windowStart = (m_windowStart + static_cast<size_t>(shift)) & (m_slotQuantities.size() - 1);
+    } else {
+        for (size_t slot = static_cast<size_t>(slots + shift); slot < m_slotQuantities.size(); slot++) {
+            if (occupied(physical(slot))) {
+                demote(slot);
+            }
+        }
+        m_windowStart = (m_windowStart + static_cast<size_t>(slots + shift)) & (m_slotQuantities.size() - 1);
+    }
+    m_windowLow = low;
+    m_windowPlaced = true;
+
+    // Levels the window now covers come out of the map
+    for (auto it = m_outlying.lower_bound(low); it != m_outlying.end() && inBand(it->first);) {
+        size_t slot = slotOf(it->first);
+        if (slot == kNoSlot) {
+            ++it;   // off the grid; stays in the map
+            continue;
+        }
+        size_t phys = physical(slot);
+        m_slotQuantities[phys] = it->second.quantity;
+        m_slotQueues[phys] = std::move(it->second.queue);
+        m_occupied[phys >> 6] |= 1ull << (phys & 63);
+        m_windowLevels++;
+        it = m_outlying.erase(it);
+    }
+    m_windowTop = occupiedAtOrBelow(m_slotQuantities.size() - 1);
+    return true;
+}
+
+void PriceLadder::demote(size_t slot) {
+    // The queue's nodes move with it, so the id index stays valid
+    size_t phys = physical(slot);
+    m_outlying.try_emplace(keyOfSlot(slot), std::move(m_slotQueues[phys]), m_slotQuantities[phys]);
+    m_slotQueues[phys].clear();
+    m_slotQuantities[phys] = 0;
+    m_occupied[phys >> 6] &= ~(1ull << (phys & 63));
+    m_windowLevels--;
+}
+
+template <typename Fn>
+void PriceLadder::forEachLevel(Fn &&fn) const {
+    // Merge the window (best slot down) with the map (highest key down)
+    size_t slot = m_windowTop;
+    auto outlying = m_outlying.rbegin();
+    while (slot != kNoSlot || outlying != m_outlying.rend()) {
+        int64_t windowKey = (slot != kNoSlot) ? keyOfSlot(slot) : INT64_MIN;
+        if (outlying != m_outlying.rend() && (slot == kNoSlot || outlying->first > windowKey)) {
+            if (!fn(outlying->first, outlying->second.quantity, outlying->second.queue)) {
+                return;
+            }
+            ++outlying;
+        } else {
+            size_t phys = physical(slot);
+            if (!fn(windowKey, m_slotQuantities[phys], m_slotQueues[phys])) {
+                return;
+            }
+            slot = (slot == 0) ? kNoSlot : occupiedAtOrBelow(slot - 1);
+        }
+    }
+}
+
+void PriceLadder::unindex(const OrderQueue::iterator &it) {
+    // A later order reusing the id owns the entry; leave it alone
+    auto found = m_index.find(it->orderId);
+    if (found != m_index.end() && found->second == it) {
+        m_index.erase(found);
+    }
+}
+
+size_t PriceLadder::sweep(uint64_t qty, int64_t limitTicks, uint64_t *available) const {
+    size_t levels = sweepDisplayed(qty, limitTicks, available);
+    if (*available >= qty) {
+        return levels;
+    }
+    // Short on displayed quantity: iceberg reserves refill their slices
+    // within the same match, so walk the queues and count them too
+    int64_t limitKey = keyFor(limitTicks);
+    uint64_t total = 0;
+    levels = 0;
+    forEachLevel([&](int64_t key, uint64_t quantity, const OrderQueue &queue) {
+        if (key < limitKey || total >= qty) {
+            return false;
+        }
+        total += quantity;
+        for (const Order &o : queue) {
+            total += o.hiddenQuantity;
+        }
+        levels++;
+        return true;
+    });
+    *available = total;
+    return levels;
+}
+
+size_t PriceLadder::sweepDisplayed(uint64_t qty, int64_t limitTicks, uint64_t *available) const {
+    int64_t limitKey = keyFor(limitTicks);
+    uint64_t total = 0;
+    size_t levels = 0;
+
+    bool mapBelowWindow = m_outlying.empty() || m_outlying.rbegin()->first < m_windowLow;
+    if (m_windowTop != kNoSlot && mapBelowWindow) {
+        // Every eligible level above the map is in the window: scan its slot
+        // quantities (empty slots hold 0) with the level kernels, best first
+        size_t first = 0;
+        if (limitKey > m_windowLow) {
+            uint64_t offset = static_cast<uint64_t>(limitKey - m_windowLow);
+            first = static_cast<size_t>((offset + static_cast<uint64_t>(m_increment) - 1) / static_cast<uint64_t>(m_increment));
+        }
+        if (first > m_windowTop) {
+            *available = 0;
+            return 0;
+        }
+        size_t lowPhys = physical(first);
+        size_t topPhys = physical(m_windowTop);
+        auto scan = [&](size_t from, size_t to) {
+            uint64_t cumulative = 0;
+            size_t used = levelsToFill(m_slotQuantities.data() + from, to - from + 1, qty - total, &cumulative);
+            total += cumulative;
+            for (size_t phys = to + 1 - used; phys <= to; phys++) {
+                levels += occupied(phys);
+            }
+        };
+        if (lowPhys <= topPhys) {
+            scan(lowPhys, topPhys);
+        } else {
+            scan(0, topPhys);
+            if (total < qty) {
+                scan(lowPhys, m_slotQuantities.size() - 1);
+            }
+        }
+        if (total >= qty || first > 0) {
+            *available = total;
+            return levels;
+        }
+        // The limit reaches past the window into the map
+        for (auto it = m_outlying.rbegin(); it != m_outlying.rend() && it->first >= limitKey && total < qty; ++it) {
+            total += it->second.quantity;
+            levels++;
+        }
+        *available = total;
+        return levels;
+    }
+
+    forEachLevel([&](int64_t key, uint64_t quantity, const OrderQueue &) {
+        if (key < limitKey || total >= qty) {
+            return false;
+        }
+        total += quantity;
+        levels++;
+        return true;
+    });
+    *available = total;
+    return levels;
+}
+
+uint64_t PriceLadder::availableFromOthers(uint64_t qty, int64_t limitTicks, uint32_t ownerId,
+                                          bool skipOwn, bool ownFirst) const {
+    int64_t limitKey = keyFor(limitTicks);
+    uint64_t total = 0;
+    bool blocked = false;
+    forEachLevel([&](int64_t key, uint64_t, const OrderQueue &queue) {
+        if (key < limitKey) {
+            return false;
+        }
+        if (!skipOwn && ownFirst) {
+            for (const Order &o : queue) {
+                if (o.ownerId == ownerId) {
+                    blocked = true;
+                    return false;
+                }
+            }
+        }
+        // Refilled slices go to the back of the level, so reserves count
+        // only once every order at the level can be reached
+        uint64_t reserve = 0;
+        for (const Order &o : queue) {
+            if (o.ownerId != ownerId) {
+                total += o.remainingQuantity;
+                reserve += o.hiddenQuantity;
+            } else if (!skipOwn) {
+                blocked = true;
+            }
+            if (blocked || total >= qty) {
+                return false;
+            }
+        }
+        total += reserve;
+        return total < qty;
+    });
+    return std::min(total, qty);
+}
+
+std::vector<DepthLevel> PriceLadder::depth(size_t levels) const {
+    std::vector<DepthLevel> out;
+    std::vector<uint64_t> quantities;   // worst of the chosen levels first, for the kernel
+    out.reserve(std::min(levels, levelCount()));
+    forEachLevel([&](int64_t key, uint64_t quantity, const OrderQueue &) {
+        if (out.size() == levels) {
+            return false;
+        }
+        out.push_back(DepthLevel{fromTicks(tickOf(key)), quantity, 0});
+        return true;
+    });
+
+    size_t count = out.size();
+    quantities.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        quantities[count - 1 - i] = out[i].quantity;
+    }
+    std::vector<uint64_t> cumulative(count);
+    cumulativeDepth(quantities.data(), count, count, cumulative.data());
+    for (size_t i = 0; i < count; i++) {
+        out[i].cumulativeQuantity = cumulative[i];
+    }
+    return out;
+}
+
+size_t PriceLadder::depthInto(DepthLevel *out, size_t levels) const {
+    size_t count = 0;
+    uint64_t cumulative = 0;
+    forEachLevel([&](int64_t key, uint64_t quantity, const OrderQueue &) {
+        if (count == levels) {
+            return false;
+        }
+        cumulative += quantity;
+        out[count++] = DepthLevel{fromTicks(tickOf(key)), quantity, cumulative};
+        return true;
+    });
+    return count;
+}
+
+void PriceLadder::restingOrders(std::vector<RestingOrder> &out) const {
+    out.reserve(out.size() + m_orderCount);
+    forEachLevel([&](int64_t key, uint64_t, const OrderQueue &queue) {
+        double price = fromTicks(tickOf(key));
+        for (const Order &o : queue) {
+            out.push_back(RestingOrder{o.orderId, price, o.remainingQuantity, o.hiddenQuantity, o.ownerId});
+        }
+        return true;
+    });
+}
+
+void PriceLadder::auctionLevels(std::vector<AuctionLevel> &out) const {
+    out.clear();
+    out.reserve(levelCount());
+    forEachLevel([&](int64_t key, uint64_t quantity, const OrderQueue &queue) {
+        for (const Order &o : queue) {
+            quantity += o.hiddenQuantity;
+        }
+        out.push_back(AuctionLevel{tickOf(key), quantity});
+        return true;
+    });
+}
@@ -0,0 +1,367 @@
+#include "replication.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+bool makeAddress(const std::string &path, sockaddr_un &addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        std::fprintf(stderr, "%s: invalid replication socket path\n", path.c_str());
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+uint64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+//////////////////// Records ////////////////////
+ReplicationRecord toReplicationRecord(const Order &o, uint64_t nowMs) {
+    ReplicationRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.type = ReplicationRecordType::Order;
+    r.nowMs = nowMs;
+    r.orderId = o.orderId;
+    r.quantity = o.quantity;
+    r.displayQuantity = o.displayQuantity;
+    r.expireTimeMs = o.expireTimeMs;
+    r.orderSequence = o.sequence;
+    r.price = o.price;
+    r.stopPrice = o.stopPrice;
+    r.ownerId = o.ownerId;
+    r.kind = o.kind;
+    r.side = o.side;
+    r.clientAddr = o.clientAddr;
+    r.clientAddrLen = o.clientAddrLen;
+    return r;
+}
+
+Order fromReplicationRecord(const ReplicationRecord &r) {
+    Order o(r.orderId, orderKindName(r.kind), sideName(r.side), r.price, r.quantity);
+    o.classify();
+    o.ownerId = r.ownerId;
+    o.isStopOrder = (o.kind == OrderKind::StopLoss);
+    o.stopPrice = r.stopPrice;
+    o.displayQuantity = r.displayQuantity;
+    o.expireTimeMs = r.expireTimeMs;
+    o.sequence = r.orderSequence;
+    o.clientAddr = r.clientAddr;
+    o.clientAddrLen = r.clientAddrLen;
+    return o;
+}
+
+//////////////////// Sockets ////////////////////
+int listenReplication(const std::string &path) {
+    sockaddr_un addr;
+    if (!makeAddress(path, addr)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("replication socket");
+        return -1;
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        perror("replication bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int acceptReplication(int listenFd) {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0) {
+            return fd;
+        }
+        if (errno != EINTR) {
+            perror("replication accept");
+            return -1;
+        }
+    }
+}
+
+int connectReplication(const std::string &path, int timeoutMs) {
+    sockaddr_un addr;
+    if (!makeAddress(path, addr)) {
+        return -1;
+    }
+    uint64_t deadline = steadyMs() + static_cast<uint64_t>(timeoutMs);
+    while (true) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            perror("replication socket");
+            return -1;
+        }
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            return fd;
+        }
+        int err = errno;
+        close(fd);
+        // The standby may not be listening yet
+        if ((err != ENOENT && err != ECONNREFUSED && err != EINTR) || steadyMs() >= deadline) {
+            errno = err;
+            perror("replication connect");
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+//////////////////// Primary ////////////////////
+ReplicationPrimary::ReplicationPrimary(int fd, const ReplicationConfig &config)
+    : m_fd(fd), m_config(config), m_ring(config.ringCapacity) {}
+
+ReplicationPrimary::~ReplicationPrimary() {
+    stop();
+}
+
+void ReplicationPrimary::start() {
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&ReplicationPrimary::run, this);
+}
+
+void ReplicationPrimary::stop() {
+    m_running.store(false, std::memory_order_release);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void ReplicationPrimary::onOrderInput(const Order &o, uint64_t nowMs) {
+    ReplicationRecord r = toReplicationRecord(o, nowMs);
+    push(r);
+}
+
+void ReplicationPrimary::onClockInput(uint64_t nowMs) {
+    ReplicationRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.type = ReplicationRecordType::Clock;
+    r.nowMs = nowMs;
+    push(r);
+}
+
+void ReplicationPrimary::onPhaseInput(TradingPhase phase, uint64_t nowMs) {
+    ReplicationRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.type = ReplicationRecordType::Phase;
+    r.nowMs = nowMs;
+    r.phase = phase;
+    push(r);
+}
+
+void ReplicationPrimary::push(ReplicationRecord &r) {
+    if (!linkUp()) {
+        return;
+    }
+    r.sequence = m_nextSequence++;
+    // A full ring means the standby is behind; wait for it rather than
+    // let the two books diverge
+    while (!m_ring.tryPush(r)) {
+        if (!linkUp()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void ReplicationPrimary::run() {
+    std::vector<ReplicationRecord> batch(kBatchRecords);
+    uint64_t lastSendMs = steadyMs();
+
+    while (linkUp()) {
+        bool running = m_running.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (n < kBatchRecords && m_ring.tryPop(batch[n])) {
+            n++;
+        }
+
+        if (n > 0) {
+            if (!sendAll(batch.data(), n * sizeof(ReplicationRecord))) {
+                break;
+            }
+            m_sentSequence.store(batch[n - 1].sequence, std::memory_order_relaxed);
+            lastSendMs = steadyMs();
+        } else if (!running) {
+            break;  // drained
+        } else if (steadyMs() - lastSendMs >= static_cast<uint64_t>(m_config.heartbeatMs)) {
+            ReplicationRecord hb;
+            std::memset(&hb, 0, sizeof(hb));
+            hb.type = ReplicationRecordType::Heartbeat;
+            hb.sequence = m_sentSequence.load(std::memory_order_relaxed);
+            if (!sendAll(&hb, sizeof(hb))) {
+                break;
+            }
+            lastSendMs = steadyMs();
+        }
+
+        // Check for acks without blocking while busy; wait a little when idle
+        pollfd pfd{m_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, (n == kBatchRecords) ? 0 : 1);
+        if (ready > 0) {
+            readAcks();
+        }
+    }
+}
+
+bool ReplicationPrimary::sendAll(const void *data, size_t size) {
+    const char *p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t sent = send(m_fd, p, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("replication send");
+            m_linkUp.store(false, std::memory_order_release);
+            return false;
+        }
+        p += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+void ReplicationPrimary::readAcks() {
+    while (true) {
+        char *dst = reinterpret_cast<char*>(&m_ack) + m_ackBytes;
+        ssize_t got = recv(m_fd, dst, sizeof(m_ack) - m_ackBytes, MSG_DONTWAIT);
+        if (got < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                m_linkUp.store(false, std::memory_order_release);
+            }
+            return;
+        }
+        if (got == 0) {
+            // Standby went away; its writes are gone but ours would fail too
+            m_linkUp.store(false, std::memory_order_release);
+            return;
+        }
+        m_ackBytes += static_cast<size_t>(got);
+        if (m_ackBytes == sizeof(m_ack)) {
+            if (m_ack.type == ReplicationRecordType::Ack) {
+                m_ackedSequence.store(m_ack.sequence, std::memory_order_relaxed);
+            }
+            m_ackBytes = 0;
+        }
+    }
+}
+
+//////////////////// Standby ////////////////////
+ReplicationStandby::ReplicationStandby(int fd, OrderBook &book, FollowerClock &clock,
+                                       const ReplicationConfig &config)
+    : m_fd(fd), m_book(book), m_clock(clock), m_config(config) {}
+
+ReplicationStandby::~ReplicationStandby() {
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+ReplicationStandby::Outcome ReplicationStandby::run() {
+    constexpr size_t kBufferRecords = 512;
+    std::vector<ReplicationRecord> buffer(kBufferRecords);
+    char *base = reinterpret_cast<char*>(buffer.data());
+    size_t filled = 0;
+
+    while (true) {
+        pollfd pfd{m_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, m_config.takeoverMs);
+        if (ready == 0) {
+            return Outcome::HeartbeatLost;
+        }
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("replication poll");
+            return Outcome::Error;
+        }
+
+        ssize_t got = recv(m_fd, base + filled, kBufferRecords * sizeof(ReplicationRecord) - filled, 0);
+        if (got == 0) {
+            return Outcome::Disconnected;
+        }
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("replication recv");
+            return Outcome::Error;
+        }
+        filled += static_cast<size_t>(got);
+
+        size_t complete = filled / sizeof(ReplicationRecord);
+        for (size_t i = 0; i < complete; i++) {
+            if (!apply(buffer[i])) {
+                return Outcome::Error;
+            }
+        }
+        // Keep a trailing partial record for the next read
+        size_t consumed = complete * sizeof(ReplicationRecord);
+        std::memmove(base, base + consumed, filled - consumed);
+        filled -= consumed;
+
+        if (m_config.acks && m_appliedSequence != m_ackedSequence) {
+            sendAck();
+        }
+    }
+}
+
+bool ReplicationStandby::apply(const ReplicationRecord &r) {
+    if (r.type == ReplicationRecordType::Heartbeat || r.type == ReplicationRecordType::Ack) {
+        return true;
+    }
+    if (r.sequence != m_appliedSequence + 1) {
+        std::fprintf(stderr, "replication: expected sequence %llu, got %llu\n",
+                     static_cast<unsigned long long>(m_appliedSequence + 1),
+                     static_cast<unsigned long long>(r.sequence));
+        return false;
+    }
+
+    m_clock.follow(r.nowMs);
+    if (r.type == ReplicationRecordType::Order) {
+        Order o = fromReplicationRecord(r);
+        m_book.processOrder(o);
+    } else if (r.type == ReplicationRecordType::Clock) {
+        m_book.expireOrders(r.nowMs);
+    } else if (r.phase == TradingPhase::Auction) {
+        m_book.beginAuction();
+    } else {
+        m_book.uncross();
+    }
+    m_appliedSequence = r.sequence;
+    return true;
+}
+
+void ReplicationStandby::sendAck() {
+    ReplicationRecord ack;
+    std::memset(&ack, 0, sizeof(ack));
+    ack.type = ReplicationRecordType::Ack;
+    ack.sequence = m_appliedSequence;
+    // Best effort: a full socket buffer only delays the primary's view
+    if (send(m_fd, &ack, sizeof(ack), MSG_NOSIGNAL | MSG_DONTWAIT) == static_cast<ssize_t>(sizeof(ack))) {
+        m_ackedSequence = m_appliedSequence;
+    }
+}
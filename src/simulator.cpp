@@ -0,0 +1,410 @@
+#include "simulator.hpp"
+#include "order_codec.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Read-only mapping of the whole input file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            m_ok = true;
+            m_size = static_cast<size_t>(st.st_size);
+            if (m_size > 0) {
+                void *p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    m_ok = false;
+                    m_size = 0;
+                } else {
+                    madvise(p, m_size, MADV_SEQUENTIAL);
+                    m_data = static_cast<const char*>(p);
+                }
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (m_data) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const { return m_ok; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    bool m_ok = false;
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+constexpr size_t kMaxFields = 11;
+constexpr size_t kRequiredFields = 7;
+
+// FNV-1a: stable across runs and platforms, unlike std::hash
+uint64_t hashInstrument(std::string_view name) {
+    uint64_t h = 1469598103934665603ULL;
+    for (char c : name) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool parseUnsigned(std::string_view text, uint64_t &out) {
+    if (text.empty() || text.size() > 19) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    out = value;
+    return true;
+}
+
+// Optional trailing field: absent or empty leaves out untouched
+bool parseOptional(const std::string_view *fields, size_t count, size_t idx, uint64_t &out) {
+    return idx >= count || fields[idx].empty() || parseUnsigned(fields[idx], out);
+}
+
+size_t splitFields(const char *begin, const char *end, std::string_view *fields) {
+    size_t count = 0;
+    while (count < kMaxFields) {
+        const char *comma = static_cast<const char*>(std::memchr(begin, ',', end - begin));
+        const char *fieldEnd = comma ? comma : end;
+        fields[count++] = std::string_view(begin, fieldEnd - begin);
+        if (!comma) {
+            break;
+        }
+        begin = comma + 1;
+    }
+    return count;
+}
+
+/**
+ * Writes the trades of the order being replayed as fills.csv rows.
+ */
+class FillWriter : public BookEventListener {
+public:
+    explicit FillWriter(std::FILE *out) : m_out(out) {}
+
+    void begin(uint64_t line, uint64_t timestampMs, const std::string *instrument) {
+        m_line = line;
+        m_timestampMs = timestampMs;
+        m_instrument = instrument;
+    }
+
+    void onTrade(const Order &incoming, const Order &resting, double price, uint64_t quantity) override {
+        std::fprintf(m_out, "%llu,%llu,%s,%llu,%llu,%s,%.6f,%llu\n",
+                     static_cast<unsigned long long>(m_line),
+                     static_cast<unsigned long long>(m_timestampMs),
+                     m_instrument->c_str(),
+                     static_cast<unsigned long long>(incoming.orderId),
+                     static_cast<unsigned long long>(resting.orderId),
+                     sideName(incoming.side), price,
+                     static_cast<unsigned long long>(quantity));
+        m_fills++;
+    }
+
+    uint64_t fills() const { return m_fills; }
+
+private:
+    std::FILE *m_out;
+    uint64_t m_line = 0;
+    uint64_t m_timestampMs = 0;
+    const std::string *m_instrument = nullptr;
+    uint64_t m_fills = 0;
+};
+
+// One instrument's book on its own clock, so clamping out-of-order
+// timestamps does not depend on which other instruments share the thread
+struct InstrumentBook {
+    SimulatedClock clock;
+    OrderBook book{&clock};
+};
+
+struct ShardResult {
+    std::FILE *fills = nullptr;
+    std::string fillsPath;
+    std::map<std::string, std::string> bookRows;  // per instrument
+    SimSummary counts;
+};
+
+void appendDepth(std::string &rows, const std::string &instrument, const char *side,
+                 const std::vector<DepthLevel> &levels) {
+    char buf[128];
+    for (size_t i = 0; i < levels.size(); i++) {
+        std::snprintf(buf, sizeof(buf), ",%s,%zu,%.6f,%llu\n", side, i + 1, levels[i].price,
+                      static_cast<unsigned long long>(levels[i].quantity));
+        rows += instrument;
+        rows += buf;
+    }
+}
+
+void runShard(const SimConfig &config, const char *data, size_t size,
+              unsigned shard, unsigned shards, ShardResult &result) {
+    FillWriter fills(result.fills);
+    std::unordered_map<std::string, std::unique_ptr<InstrumentBook>> books;
+    std::string key;
+    std::string_view fields[kMaxFields];
+
+    const char *p = data;
+    const char *end = data + size;
+    uint64_t line = 0;
+    uint64_t endOfDayMs = 0;  // latest timestamp in the file, seen by every shard
+    while (p < end) {
+        const char *eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) {
+            eol = end;
+        }
+        const char *begin = p;
+        const char *lineEnd = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+        p = eol + 1;
+        line++;
+
+        if (begin == lineEnd || (line == 1 && (*begin < '0' || *begin > '9'))) {
+            continue;  // blank line or header
+        }
+
+        // Cheap routing first: only the owner of the instrument parses the rest
+        const char *c1 = static_cast<const char*>(std::memchr(begin, ',', lineEnd - begin));
+        const char *c2 = c1 ? static_cast<const char*>(std::memchr(c1 + 1, ',', lineEnd - c1 - 1)) : nullptr;
+        if (!c2) {
+            if (shard == 0) {
+                result.counts.badLines++;
+            }
+            continue;
+        }
+        uint64_t lineMs = 0;
+        if (parseUnsigned(std::string_view(begin, c1 - begin), lineMs)) {
+            endOfDayMs = std::max(endOfDayMs, lineMs);
+        }
+        std::string_view instrument(c1 + 1, c2 - c1 - 1);
+        if (hashInstrument(instrument) % shards != shard) {
+            continue;
+        }
+
+        size_t count = splitFields(begin, lineEnd, fields);
+        Order o;
+        uint64_t timestampMs = 0;
+        uint64_t owner = 0;
+        bool ok = count >= kRequiredFields &&
+                  parseUnsigned(fields[0], timestampMs) &&
+                  parseUnsigned(fields[2], o.orderId) &&
+                  (fields[5].empty() || parsePrice(fields[5], o.price)) &&
+                  (fields[6].empty() || parseUnsigned(fields[6], o.quantity)) &&
+                  parseOptional(fields, count, 7, owner) && owner <= UINT32_MAX &&
+                  parseOptional(fields, count, 8, o.displayQuantity) &&
+                  parseOptional(fields, count, 9, o.expireTimeMs) &&
+                  (count <= 10 || fields[10].empty() || parsePrice(fields[10], o.stopPrice));
+        if (!ok) {
+            result.counts.badLines++;
+            continue;
+        }
+        o.type.assign(fields[3].data(), fields[3].size());
+        o.action.assign(fields[4].data(), fields[4].size());
+        o.isStopOrder = (o.type == "stop-loss");
+        o.ownerId = static_cast<uint32_t>(owner);
+        o.remainingQuantity = o.quantity;
+        o.sequence = line;
+        o.recvTimestamp = std::chrono::high_resolution_clock::now();  // latency stats only
+        o.classify();
+
+        key.assign(instrument.data(), instrument.size());
+        auto it = books.find(key);
+        if (it == books.end()) {
+            auto entry = std::make_unique<InstrumentBook>();
+            entry->book.setSelfTradePrevention(config.stp);
+            entry->book.setPostOnlyMode(config.postOnly);
+            entry->book.setTickSize(config.tickSize);
+            AllocationRules rules = config.allocation;
+            auto algorithm = config.instrumentAlgorithms.find(key);
+            if (algorithm != config.instrumentAlgorithms.end()) {
+                rules.algorithm = algorithm->second;
+            }
+            entry->book.setAllocationRules(rules);
+            entry->book.setEventListener(&fills);
+            it = books.emplace(key, std::move(entry)).first;
+        }
+        InstrumentBook &ib = *it->second;
+
+        // Out-of-order timestamps are held at the latest time seen
+        if (timestampMs > ib.clock.nowMs()) {
+            ib.clock.set(timestampMs);
+        }
+        fills.begin(line, ib.clock.nowMs(), &it->first);
+        ib.book.processOrder(o);
+        result.counts.orders++;
+        result.counts.expired += ib.book.expireOrders(ib.clock.nowMs()).size();
+    }
+
+    // End of day: expire what is due, then record what is left
+    for (auto &entry : books) {
+        InstrumentBook &ib = *entry.second;
+        OrderBook &book = ib.book;
+        ib.clock.set(std::max(ib.clock.nowMs(), endOfDayMs));
+        result.counts.expired += book.expireOrders(ib.clock.nowMs()).size();
+        std::string &rows = result.bookRows[entry.first];
+        appendDepth(rows, entry.first, "buy", book.bidDepth(SIZE_MAX));
+        appendDepth(rows, entry.first, "sell", book.askDepth(SIZE_MAX));
+    }
+    result.counts.fills = fills.fills();
+    result.counts.instruments = books.size();
+}
+
+// Leading "line," column of a fills row
+uint64_t rowLine(const char *row) {
+    return std::strtoull(row, nullptr, 10);
+}
+
+// k-way merge of the per-shard fill files by input line; each is already in line order
+bool mergeFills(std::vector<ShardResult> &shards, const std::string &path) {
+    std::FILE *out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        return false;
+    }
+    std::fputs("line,timestamp_ms,instrument,order_id,resting_order_id,side,price,quantity\n", out);
+
+    struct Cursor {
+        std::FILE *in;
+        char *buf = nullptr;
+        size_t cap = 0;
+        ssize_t len = -1;
+    };
+    std::vector<Cursor> cursors;
+    for (ShardResult &shard : shards) {
+        Cursor c{std::fopen(shard.fillsPath.c_str(), "r")};
+        if (c.in) {
+            c.len = getline(&c.buf, &c.cap, c.in);
+        }
+        cursors.push_back(c);
+    }
+
+    while (true) {
+        Cursor *next = nullptr;
+        for (Cursor &c : cursors) {
+            if (c.len > 0 && (!next || rowLine(c.buf) < rowLine(next->buf))) {
+                next = &c;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        std::fwrite(next->buf, 1, static_cast<size_t>(next->len), out);
+        next->len = getline(&next->buf, &next->cap, next->in);
+    }
+
+    for (Cursor &c : cursors) {
+        std::free(c.buf);
+        if (c.in) {
+            std::fclose(c.in);
+        }
+    }
+    return std::fclose(out) == 0;
+}
+
+bool fail(std::string *error, const std::string &message) {
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+} // namespace
+
+bool runSimulation(const SimConfig &config, SimSummary &summary, std::string *error) {
+    MappedFile input(config.inputPath);
+    if (!input.ok()) {
+        return fail(error, "cannot map " + config.inputPath);
+    }
+
+    unsigned shards = config.threads ? config.threads : std::thread::hardware_concurrency();
+    shards = std::max(1u, shards);
+
+    std::vector<ShardResult> results(shards);
+    for (unsigned i = 0; i < shards; i++) {
+        results[i].fillsPath = config.outputDir + "/fills." + std::to_string(i) + ".tmp";
+        results[i].fills = std::fopen(results[i].fillsPath.c_str(), "w");
+        if (!results[i].fills) {
+            for (unsigned j = 0; j < i; j++) {
+                std::fclose(results[j].fills);
+                std::remove(results[j].fillsPath.c_str());
+            }
+            return fail(error, "cannot write to " + config.outputDir);
+        }
+        std::setvbuf(results[i].fills, nullptr, _IOFBF, 1 << 20);
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < shards; i++) {
+        workers.emplace_back(runShard, std::cref(config), input.data(), input.size(),
+                             i, shards, std::ref(results[i]));
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    for (ShardResult &r : results) {
+        std::fclose(r.fills);
+    }
+
+    bool ok = mergeFills(results, config.outputDir + "/fills.csv");
+    for (ShardResult &r : results) {
+        std::remove(r.fillsPath.c_str());
+    }
+    if (!ok) {
+        return fail(error, "cannot write " + config.outputDir + "/fills.csv");
+    }
+
+    std::map<std::string, std::string> bookRows;
+    summary = SimSummary();
+    summary.threads = shards;
+    for (ShardResult &r : results) {
+        summary.orders += r.counts.orders;
+        summary.badLines += r.counts.badLines;
+        summary.fills += r.counts.fills;
+        summary.expired += r.counts.expired;
+        summary.instruments += r.counts.instruments;
+        bookRows.insert(r.bookRows.begin(), r.bookRows.end());
+    }
+
+    std::string bookPath = config.outputDir + "/book.csv";
+    std::FILE *book = std::fopen(bookPath.c_str(), "w");
+    if (!book) {
+        return fail(error, "cannot write " + bookPath);
+    }
+    std::fputs("instrument,side,level,price,quantity\n", book);
+    for (const auto &entry : bookRows) {
+        std::fwrite(entry.second.data(), 1, entry.second.size(), book);
+    }
+    if (std::fclose(book) != 0) {
+        return fail(error, "cannot write " + bookPath);
+    }
+    return true;
+}
@@ -0,0 +1,221 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// Single-writer increment: avoids a locked RMW on the hot path
+inline void bump(std::atomic<uint64_t> &counter, uint64_t delta = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void initBlock(SharedStatsBlock *block) {
+    new (&block->snapshot) SeqLock<StatsSnapshot>();
+    block->snapshotSize = sizeof(StatsSnapshot);
+    block->version = SharedStatsBlock::kVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    block->magic = SharedStatsBlock::kMagic;
+}
+
+} // namespace
+
+uint64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Receive: return "receive";
+        case Stage::Decode:  return "decode";
+        case Stage::Match:   return "match";
+        case Stage::Send:    return "send";
+        default:             return "unknown";
+    }
+}
+
+//////////////////// LatencyHistogram ////////////////////
+std::size_t LatencyHistogram::bucketFor(uint64_t ns) {
+    std::size_t bucket = 63 - __builtin_clzll(ns | 1);
+    return (bucket < kLatencyBuckets) ? bucket : kLatencyBuckets - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    bump(m_buckets[bucketFor(ns)]);
+    bump(m_count);
+    bump(m_sumNs, ns);
+    if (ns > m_maxNs.load(std::memory_order_relaxed)) {
+        m_maxNs.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::snapshotInto(LatencyHistogramSnapshot &out) const {
+    for (std::size_t i = 0; i < kLatencyBuckets; i++) {
+        out.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    out.count = m_count.load(std::memory_order_relaxed);
+    out.sumNs = m_sumNs.load(std::memory_order_relaxed);
+    out.maxNs = m_maxNs.load(std::memory_order_relaxed);
+}
+
+//////////////////// StageCounters ////////////////////
+void StageCounters::recordEvent(uint64_t latencyNs) {
+    bump(events);
+    latency.record(latencyNs);
+}
+
+void StageCounters::recordError() {
+    bump(errors);
+}
+
+//////////////////// StatsRegistry ////////////////////
+StatsRegistry::StatsRegistry() : m_startNs(steadyNowNs()) {}
+
+StageCounters* StatsRegistry::registerSlot(Stage stage) {
+    std::size_t idx = m_used.fetch_add(1);
+    if (idx >= kMaxStatsSlots) {
+        return nullptr;
+    }
+    m_slots[idx].stage = stage;
+    m_slots[idx].active.store(true, std::memory_order_release);
+    return &m_slots[idx];
+}
+
+void StatsRegistry::collect(StatsSnapshot &out) const {
+    std::memset(&out, 0, sizeof(out));
+    out.publishTimeNs = steadyNowNs();
+    out.uptimeNs = out.publishTimeNs - m_startNs;
+
+    for (const auto &slot : m_slots) {
+        if (!slot.active.load(std::memory_order_acquire)) {
+            continue;
+        }
+        StageSnapshot &st = out.stages[static_cast<std::size_t>(slot.stage)];
+        st.events += slot.events.load(std::memory_order_relaxed);
+        st.errors += slot.errors.load(std::memory_order_relaxed);
+
+        LatencyHistogramSnapshot h;
+        slot.latency.snapshotInto(h);
+        for (std::size_t i = 0; i < kLatencyBuckets; i++) {
+            st.latency.buckets[i] += h.buckets[i];
+        }
+        st.latency.count += h.count;
+        st.latency.sumNs += h.sumNs;
+        st.latency.maxNs = std::max(st.latency.maxNs, h.maxNs);
+    }
+
+    // Whatever an upstream stage emitted and this stage hasn't consumed is queued
+    for (std::size_t i = 1; i < kStageCount; i++) {
+        uint64_t in = out.stages[i - 1].events;
+        uint64_t done = out.stages[i].events + out.stages[i].errors;
+        out.stages[i].queueDepth = (in > done) ? in - done : 0;
+    }
+}
+
+//////////////////// StatsRegion ////////////////////
+StatsRegion::StatsRegion(const std::string &shmName) : m_name(shmName) {
+    int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd >= 0) {
+        if (ftruncate(fd, sizeof(SharedStatsBlock)) == 0) {
+            void *addr = mmap(nullptr, sizeof(SharedStatsBlock), PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                m_block = static_cast<SharedStatsBlock*>(addr);
+                m_shared = true;
+            }
+        }
+        close(fd);
+    }
+
+    if (!m_shared) {
+        std::cerr << "[Stats] shared memory segment " << m_name
+                  << " unavailable, publishing in-process only\n";
+        m_block = static_cast<SharedStatsBlock*>(
+            ::operator new(sizeof(SharedStatsBlock), std::align_val_t(kCacheLineSize)));
+    }
+    initBlock(m_block);
+}
+
+StatsRegion::~StatsRegion() {
+    if (m_shared) {
+        munmap(m_block, sizeof(SharedStatsBlock));
+        shm_unlink(m_name.c_str());
+    } else {
+        ::operator delete(m_block, std::align_val_t(kCacheLineSize));
+    }
+}
+
+//////////////////// Prometheus ////////////////////
+std::string renderPrometheus(const StatsSnapshot &snap) {
+    std::ostringstream oss;
+
+    oss << "# HELP orderbook_uptime_seconds Time since the server started.\n"
+        << "# TYPE orderbook_uptime_seconds gauge\n"
+        << "orderbook_uptime_seconds " << (snap.uptimeNs / 1e9) << "\n";
+
+    oss << "# HELP orderbook_stage_events_total Messages completed by each pipeline stage.\n"
+        << "# TYPE orderbook_stage_events_total counter\n";
+    for (std::size_t i = 0; i < kStageCount; i++) {
+        oss << "orderbook_stage_events_total{stage=\"" << stageName(static_cast<Stage>(i))
+            << "\"} " << snap.stages[i].events << "\n";
+    }
+
+    oss << "# HELP orderbook_stage_errors_total Messages each pipeline stage failed.\n"
+        << "# TYPE orderbook_stage_errors_total counter\n";
+    for (std::size_t i = 0; i < kStageCount; i++) {
+        oss << "orderbook_stage_errors_total{stage=\"" << stageName(static_cast<Stage>(i))
+            << "\"} " << snap.stages[i].errors << "\n";
+    }
+
+    oss << "# HELP orderbook_queue_depth Messages waiting in front of each stage.\n"
+        << "# TYPE orderbook_queue_depth gauge\n";
+    for (std::size_t i = 1; i < kStageCount; i++) {
+        oss << "orderbook_queue_depth{stage=\"" << stageName(static_cast<Stage>(i))
+            << "\"} " << snap.stages[i].queueDepth << "\n";
+    }
+
+    oss << "# HELP orderbook_book_orders Resting orders per side of the book.\n"
+        << "# TYPE orderbook_book_orders gauge\n"
+        << "orderbook_book_orders{side=\"bid\"} " << snap.bidOrders << "\n"
+        << "orderbook_book_orders{side=\"ask\"} " << snap.askOrders << "\n";
+
+    oss << "# HELP orderbook_reserved_memory_bytes Book memory reserved at startup, and the part in use.\n"
+        << "# TYPE orderbook_reserved_memory_bytes gauge\n"
+        << "orderbook_reserved_memory_bytes{state=\"reserved\"} " << snap.reservedBytes << "\n"
+        << "orderbook_reserved_memory_bytes{state=\"used\"} " << snap.reservedUsedBytes << "\n"
+        << "# HELP orderbook_reserved_memory_page_bytes Page size backing the reserved memory.\n"
+        << "# TYPE orderbook_reserved_memory_page_bytes gauge\n"
+        << "orderbook_reserved_memory_page_bytes " << snap.reservedPageBytes << "\n"
+        << "# HELP orderbook_pool_heap_allocations_total Order nodes allocated on the heap past the reservation.\n"
+        << "# TYPE orderbook_pool_heap_allocations_total counter\n"
+        << "orderbook_pool_heap_allocations_total " << snap.poolHeapFallbacks << "\n";
+
+    oss << "# HELP orderbook_stage_latency_seconds Per-stage latency.\n"
+        << "# TYPE orderbook_stage_latency_seconds histogram\n";
+    for (std::size_t i = 0; i < kStageCount; i++) {
+        const char *name = stageName(static_cast<Stage>(i));
+        const LatencyHistogramSnapshot &h = snap.stages[i].latency;
+        uint64_t cumulative = 0;
+        for (std::size_t b = 0; b < kLatencyBuckets; b++) {
+            cumulative += h.buckets[b];
+            double upperSec = static_cast<double>(1ULL << (b + 1)) / 1e9;
+            oss << "orderbook_stage_latency_seconds_bucket{stage=\"" << name
+                << "\",le=\"" << upperSec << "\"} " << cumulative << "\n";
+        }
+        oss << "orderbook_stage_latency_seconds_bucket{stage=\"" << name
+            << "\",le=\"+Inf\"} " << h.count << "\n"
+            << "orderbook_stage_latency_seconds_sum{stage=\"" << name << "\"} "
+            << (h.sumNs / 1e9) << "\n"
+            << "orderbook_stage_latency_seconds_count{stage=\"" << name << "\"} "
+            << h.count << "\n";
+    }
+
+    return oss.str();
+}
@@ -0,0 +1,138 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t nowMs) : m_nowMs(nowMs) {}
+
+void TimerWheel::locate(uint64_t deadlineMs, size_t &level, size_t &slot) const {
+    // The level is set by the highest bit in which the deadline differs
+    // from now; past-due timers land in the current level-0 slot. A timer
+    // stays where this puts it until now reaches its slot.
+    uint64_t deadline = (deadlineMs > m_nowMs) ? deadlineMs : m_nowMs;
+    uint64_t diff = deadline ^ m_nowMs;
+    level = (diff == 0) ? 0 : (63 - __builtin_clzll(diff)) / kSlotBits;
+    if (level >= kLevels) {
+        // Beyond the wheel's range: park at the top level, re-placed on cascade
+        level = kLevels - 1;
+    }
+    slot = (deadline >> (level * kSlotBits)) & (kSlots - 1);
+}
+
+void TimerWheel::place(const Timer &t) {
+    size_t level, slot;
+    locate(t.deadlineMs, level, slot);
+    m_wheel[level][slot].push_back(t);
+    m_occupied[level][slot >> 6] |= uint64_t(1) << (slot & 63);
+}
+
+void TimerWheel::take(size_t level, size_t slot, std::vector<Timer> &out) {
+    out.swap(m_wheel[level][slot]);
+    m_occupied[level][slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+}
+
+size_t TimerWheel::nextOccupied(size_t level, size_t from) const {
+    for (size_t word = from >> 6; word < kSlots / 64; word++) {
+        uint64_t bits = m_occupied[level][word];
+        if (word == (from >> 6)) {
+            bits &= ~uint64_t(0) << (from & 63);
+        }
+        if (bits != 0) {
+            return word * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return kSlots;
+}
+
+uint64_t TimerWheel::nextEvent() const {
+    // Every pending timer sits in a slot ahead of now's digit on its
+    // level, so the earliest of those slots is the next time anything can
+    // fire or cascade; none is passed on the way there
+    uint64_t next = UINT64_MAX;
+    for (size_t level = 0; level < kLevels; level++) {
+        size_t shift = level * kSlotBits;
+        size_t digit = (m_nowMs >> shift) & (kSlots - 1);
+        size_t slot = nextOccupied(level, digit + 1);
+        if (slot < kSlots) {
+            uint64_t base = (m_nowMs >> (shift + kSlotBits)) << (shift + kSlotBits);
+            next = std::min(next, base | (uint64_t(slot) << shift));
+        }
+    }
+    // ...except timers parked beyond the range, which may sit behind it
+    // on the top level until the top level wraps
+    constexpr size_t kRangeBits = kLevels * kSlotBits;
+    if (nextOccupied(kLevels - 1, 0) < kSlots && (m_nowMs >> kRangeBits) < (UINT64_MAX >> kRangeBits)) {
+        next = std::min(next, ((m_nowMs >> kRangeBits) + 1) << kRangeBits);
+    }
+    return next;
+}
+
+void TimerWheel::schedule(uint64_t id, uint64_t deadlineMs) {
+    place(Timer{id, deadlineMs});
+    m_count++;
+}
+
+bool TimerWheel::cancel(uint64_t id, uint64_t deadlineMs) {
+    size_t level, slot;
+    locate(deadlineMs, level, slot);
+    std::vector<Timer> &timers = m_wheel[level][slot];
+    for (auto it = timers.begin(); it != timers.end(); ++it) {
+        if (it->id == id && it->deadlineMs == deadlineMs) {
+            timers.erase(it);  // keeps the rest in firing order
+            if (timers.empty()) {
+                m_occupied[level][slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+            }
+            m_count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TimerWheel::advance(uint64_t nowMs, const std::function<void(const Timer&)> &onExpire) {
+    if (m_count == 0) {
+        // Nothing pending: jump straight to the new time
+        if (nowMs > m_nowMs) {
+            m_nowMs = nowMs;
+        }
+        return;
+    }
+
+    // Due timers parked in the current slot (scheduled at or before now)
+    std::vector<Timer> due;
+    take(0, m_nowMs & (kSlots - 1), due);
+
+    while (true) {
+        for (const Timer &t : due) {
+            if (t.deadlineMs <= m_nowMs) {
+                m_count--;
+                onExpire(t);
+            } else {
+                place(t);
+            }
+        }
+        due.clear();
+
+        if (m_nowMs >= nowMs || m_count == 0) {
+            break;
+        }
+        m_nowMs = std::min(nextEvent(), nowMs);
+
+        // On a slot boundary: pull the next slot of each higher level down
+        for (size_t level = 1; level < kLevels; level++) {
+            if ((m_nowMs & ((uint64_t(1) << (level * kSlotBits)) - 1)) != 0) {
+                break;
+            }
+            size_t slot = (m_nowMs >> (level * kSlotBits)) & (kSlots - 1);
+            std::vector<Timer> cascade;
+            take(level, slot, cascade);
+            for (const Timer &t : cascade) {
+                place(t);
+            }
+        }
+        take(0, m_nowMs & (kSlots - 1), due);
+    }
+
+    if (nowMs > m_nowMs) {
+        m_nowMs = nowMs;
+    }
+}
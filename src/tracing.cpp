@@ -0,0 +1,159 @@
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <map>
+#include <time.h>
+
+namespace {
+
+const char *const kPointNames[kTracePointCount] = {
+    "kernel_receive", "receive", "decode_start", "decode_end", "match_start",
+    "match_end", "confirm_enqueue", "send_start", "sent",
+};
+
+// Spans drawn for each order: [from, to) between two trace points
+struct SpanDef {
+    const char *name;
+    TracePoint from;
+    TracePoint to;
+};
+
+const SpanDef kSpans[] = {
+    {"socket buffer", TracePoint::KernelReceive, TracePoint::Receive},
+    {"decode queue", TracePoint::Receive, TracePoint::DecodeStart},
+    {"decode", TracePoint::DecodeStart, TracePoint::DecodeEnd},
+    {"resequence", TracePoint::DecodeEnd, TracePoint::MatchStart},
+    {"match", TracePoint::MatchStart, TracePoint::MatchEnd},
+    {"confirm build", TracePoint::MatchEnd, TracePoint::ConfirmEnqueue},
+    {"confirm queue", TracePoint::ConfirmEnqueue, TracePoint::SendStart},
+    {"send", TracePoint::SendStart, TracePoint::Sent},
+};
+
+struct OrderTrace {
+    std::array<uint64_t, kTracePointCount> timeNs{};
+    std::array<size_t, kTracePointCount> buffer{};
+};
+
+} // namespace
+
+const char* tracePointName(TracePoint point) {
+    size_t i = static_cast<size_t>(point);
+    return (i < kTracePointCount) ? kPointNames[i] : "unknown";
+}
+
+uint64_t traceNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+TraceBuffer* Tracer::registerThread(const std::string &name) {
+    if (!enabled()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers.emplace_back(new TraceBuffer(name, m_bufferCapacity));
+    return m_buffers.back().get();
+}
+
+void Tracer::collect() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TraceRecord r;
+    for (size_t i = 0; i < m_buffers.size(); i++) {
+        while (m_buffers[i]->m_ring.tryPop(r)) {
+            m_collected.push_back(Collected{r, i});
+        }
+    }
+}
+
+size_t Tracer::recordsCollected() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_collected.size();
+}
+
+uint64_t Tracer::recordsDropped() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t dropped = 0;
+    for (const auto &buffer : m_buffers) {
+        dropped += buffer->dropped();
+    }
+    return dropped;
+}
+
+bool Tracer::writeChromeTrace(const std::string &path) {
+    collect();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::map<uint64_t, OrderTrace> orders;
+    uint64_t originNs = UINT64_MAX;
+    for (const Collected &c : m_collected) {
+        OrderTrace &t = orders[c.record.sequence];
+        size_t point = static_cast<size_t>(c.record.point);
+        t.timeNs[point] = c.record.timeNs;
+        t.buffer[point] = c.buffer;
+        originNs = std::min(originNs, c.record.timeNs);
+    }
+
+    FILE *out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        std::perror(path.c_str());
+        return false;
+    }
+
+    // Timestamps are microseconds since the first record; one row per order
+    auto us = [originNs](uint64_t ns) { return static_cast<double>(ns - originNs) / 1000.0; };
+    bool first = true;
+    auto separator = [&]() {
+        std::fputs(first ? "\n" : ",\n", out);
+        first = false;
+    };
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    for (const auto &entry : orders) {
+        uint64_t seq = entry.first;
+        const OrderTrace &t = entry.second;
+
+        separator();
+        std::fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,"
+                          "\"args\":{\"name\":\"order %llu\"}}",
+                     static_cast<unsigned long long>(seq), static_cast<unsigned long long>(seq));
+
+        // Whole lifetime, from the earliest to the latest point recorded
+        uint64_t startNs = UINT64_MAX;
+        uint64_t endNs = 0;
+        for (uint64_t ns : t.timeNs) {
+            if (ns != 0) {
+                startNs = std::min(startNs, ns);
+                endNs = std::max(endNs, ns);
+            }
+        }
+        separator();
+        std::fprintf(out, "{\"name\":\"order\",\"cat\":\"order\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,"
+                          "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"sequence\":%llu}}",
+                     static_cast<unsigned long long>(seq), us(startNs), (endNs - startNs) / 1000.0,
+                     static_cast<unsigned long long>(seq));
+
+        for (const SpanDef &span : kSpans) {
+            uint64_t from = t.timeNs[static_cast<size_t>(span.from)];
+            uint64_t to = t.timeNs[static_cast<size_t>(span.to)];
+            if (from == 0 || to == 0 || to < from) {
+                continue;  // a point was dropped or never reached
+            }
+            const std::string &thread = m_buffers[t.buffer[static_cast<size_t>(span.to)]]->thread();
+            separator();
+            std::fprintf(out, "{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,"
+                              "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"thread\":\"%s\"}}",
+                         span.name, static_cast<unsigned long long>(seq), us(from), (to - from) / 1000.0,
+                         thread.c_str());
+        }
+    }
+    std::fputs("\n]}\n", out);
+
+    bool ok = !std::ferror(out);
+    if (std::fclose(out) != 0) {
+        ok = false;
+    }
+    return ok;
+}
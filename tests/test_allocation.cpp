@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <numeric>
+#include <vector>
+#include "allocation.hpp"
+#include "orderbook.hpp"
+
+namespace {
+
+AllocationRules proRata(uint64_t minAllocation = 0, uint64_t topOrderSlice = 0) {
+    AllocationRules rules;
+    rules.algorithm = MatchingAlgorithm::ProRata;
+    rules.minAllocation = minAllocation;
+    rules.topOrderSlice = topOrderSlice;
+    return rules;
+}
+
+std::vector<uint64_t> allocate(const AllocationRules &rules, uint64_t qty, const std::vector<uint64_t> &resting) {
+    std::vector<uint64_t> out(resting.size());
+    uint64_t total = std::accumulate(resting.begin(), resting.end(), uint64_t(0));
+    uint64_t filled = allocateLevel(rules, qty, resting.data(), resting.size(), total, out.data());
+    EXPECT_EQ(filled, std::min(qty, total));
+    EXPECT_EQ(std::accumulate(out.begin(), out.end(), uint64_t(0)), filled);
+    return out;
+}
+
+// Fills per resting order id, as the listener saw them
+struct FillRecorder : BookEventListener {
+    std::map<uint64_t, uint64_t> fills;
+    void onTrade(const Order &, const Order &resting, double, uint64_t quantity) override {
+        fills[resting.orderId] += quantity;
+    }
+};
+
+} // namespace
+
+TEST(AllocationTest, ParsesAlgorithms) {
+    MatchingAlgorithm algorithm = MatchingAlgorithm::Fifo;
+    EXPECT_TRUE(parseMatchingAlgorithm("pro-rata", algorithm));
+    EXPECT_EQ(algorithm, MatchingAlgorithm::ProRata);
+    EXPECT_TRUE(parseMatchingAlgorithm("price-time-pro-rata", algorithm));
+    EXPECT_EQ(algorithm, MatchingAlgorithm::PriceTimeProRata);
+    EXPECT_TRUE(parseMatchingAlgorithm("fifo", algorithm));
+    EXPECT_EQ(algorithm, MatchingAlgorithm::Fifo);
+    EXPECT_FALSE(parseMatchingAlgorithm("lifo", algorithm));
+}
+
+TEST(AllocationTest, SharesInProportion) {
+    EXPECT_EQ(allocate(proRata(), 50, {100, 200, 200}), (std::vector<uint64_t>{10, 20, 20}));
+}
+
+TEST(AllocationTest, RoundingResidueGoesInTimePriority) {
+    // 10 * 1/3 = 3.33 each; the one unit left goes to the oldest
+    EXPECT_EQ(allocate(proRata(), 10, {1, 1, 1}), (std::vector<uint64_t>{1, 1, 1}));
+    EXPECT_EQ(allocate(proRata(), 10, {10, 10, 10}), (std::vector<uint64_t>{4, 3, 3}));
+}
+
+TEST(AllocationTest, TakingTheWholeLevelFillsEveryOrder) {
+    EXPECT_EQ(allocate(proRata(5, 3), 100, {7, 1, 2}), (std::vector<uint64_t>{7, 1, 2}));
+}
+
+TEST(AllocationTest, SharesUnderTheMinimumAreDropped) {
+    // Shares of 18, 1 and 1; the small ones fall to time priority
+    EXPECT_EQ(allocate(proRata(2), 20, {90, 5, 5}), (std::vector<uint64_t>{20, 0, 0}));
+    EXPECT_EQ(allocate(proRata(), 20, {90, 5, 5}), (std::vector<uint64_t>{18, 1, 1}));
+}
+
+TEST(AllocationTest, TopOrderSliceComesFirst) {
+    // The oldest takes 10, the other 30 is shared 10:20:40 (4, 8, 17) and
+    // the unit left over goes to the oldest
+    EXPECT_EQ(allocate(proRata(0, 10), 40, {20, 20, 40}), (std::vector<uint64_t>{15, 8, 17}));
+}
+
+TEST(AllocationTest, PriceTimeProRataSplitsTheFill) {
+    AllocationRules rules;
+    rules.algorithm = MatchingAlgorithm::PriceTimeProRata;
+    rules.fifoPercent = 40;
+    // 40 of 100 in time priority; the other 60 shared 60:100:100 (13, 23, 23)
+    // with the unit left over to the oldest
+    std::vector<uint64_t> out = allocate(rules, 100, {100, 100, 100});
+    EXPECT_EQ(out, (std::vector<uint64_t>{40 + 13 + 1, 23, 23}));
+}
+
+TEST(AllocationTest, ExactForHugeQuantitiesAndDeepLevels) {
+    std::vector<uint64_t> resting(5000);
+    for (size_t i = 0; i < resting.size(); i++) {
+        resting[i] = (uint64_t(1) << 50) + i * 7919;
+    }
+    std::vector<uint64_t> out = allocate(proRata(), uint64_t(1) << 60, resting);
+    for (size_t i = 0; i < resting.size(); i++) {
+        EXPECT_LE(out[i], resting[i]);
+    }
+}
+
+TEST(AllocationTest, BookSharesALevelProRata) {
+    OrderBook ob;
+    ob.setAllocationRules(proRata());
+    FillRecorder fills;
+    ob.setEventListener(&fills);
+
+    Order a(1, "limit", "sell", 10.0, 10);
+    Order b(2, "limit", "sell", 10.0, 30);
+    Order far(3, "limit", "sell", 11.0, 100);
+    ob.processOrder(a);
+    ob.processOrder(b);
+    ob.processOrder(far);
+
+    Order buy(4, "limit", "buy", 11.0, 20);
+    ob.processOrder(buy);
+    EXPECT_EQ(buy.status, OrderStatus::Executed);
+    EXPECT_EQ(fills.fills[1], 5u);
+    EXPECT_EQ(fills.fills[2], 15u);
+    EXPECT_EQ(fills.fills.count(3), 0u);
+
+    // Sweeping past the level takes it whole, then shares the next one
+    Order sweep(5, "limit", "buy", 11.0, 40);
+    ob.processOrder(sweep);
+    EXPECT_EQ(fills.fills[1], 10u);
+    EXPECT_EQ(fills.fills[2], 30u);
+    EXPECT_EQ(fills.fills[3], 20u);
+    EXPECT_EQ(ob.askDepth(5)[0].quantity, 80u);
+}
+
+TEST(AllocationTest, IcebergsShareOnTheirDisplayedSlice) {
+    OrderBook ob;
+    ob.setAllocationRules(proRata());
+    FillRecorder fills;
+    ob.setEventListener(&fills);
+
+    Order plain(1, "limit", "buy", 10.0, 10);
+    Order iceberg(2, "limit", "buy", 10.0, 100);
+    iceberg.displayQuantity = 10;
+    ob.processOrder(plain);
+    ob.processOrder(iceberg);
+
+    Order sell(3, "limit", "sell", 10.0, 10);
+    ob.processOrder(sell);
+    EXPECT_EQ(fills.fills[1], 5u);
+    EXPECT_EQ(fills.fills[2], 5u);
+
+    // Both slices exhausted: the plain order leaves, the iceberg refills
+    Order more(4, "limit", "sell", 10.0, 25);
+    ob.processOrder(more);
+    EXPECT_EQ(fills.fills[1], 10u);
+    EXPECT_EQ(fills.fills[2], 25u);
+    std::vector<DepthLevel> bids = ob.bidDepth(1);
+    ASSERT_EQ(bids.size(), 1u);
+    EXPECT_EQ(bids[0].quantity, 5u);
+    EXPECT_EQ(ob.bidOrderCount(), 1u);
+}
+
+TEST(AllocationTest, SelfTradesSettledBeforeSharing) {
+    OrderBook ob;
+    ob.setAllocationRules(proRata());
+    ob.setSelfTradePrevention(SelfTradePrevention::CancelOldest);
+    FillRecorder fills;
+    ob.setEventListener(&fills);
+
+    Order other(1, "limit", "sell", 10.0, 10);
+    other.ownerId = 7;
+    Order own(2, "limit", "sell", 10.0, 30);
+    own.ownerId = 9;
+    ob.processOrder(other);
+    ob.processOrder(own);
+
+    Order buy(3, "limit", "buy", 10.0, 4);
+    buy.ownerId = 9;
+    ob.processOrder(buy);
+    EXPECT_EQ(buy.status, OrderStatus::Executed);
+    EXPECT_EQ(fills.fills[1], 4u);
+    EXPECT_EQ(fills.fills.count(2), 0u);
+    EXPECT_EQ(ob.askDepth(1)[0].quantity, 6u);
+
+    OrderBook newest;
+    newest.setAllocationRules(proRata());
+    newest.setSelfTradePrevention(SelfTradePrevention::CancelNewest);
+    Order other2(1, "limit", "sell", 10.0, 10);
+    other2.ownerId = 7;
+    Order own2(2, "limit", "sell", 10.0, 30);
+    own2.ownerId = 9;
+    newest.processOrder(other2);
+    newest.processOrder(own2);
+    Order buy2(3, "limit", "buy", 10.0, 4);
+    buy2.ownerId = 9;
+    newest.processOrder(buy2);
+    EXPECT_EQ(buy2.status, OrderStatus::StpCancelled);
+    EXPECT_EQ(newest.askDepth(1)[0].quantity, 40u);
+}
+
+TEST(AllocationTest, FifoIsTheDefault) {
+    OrderBook ob;
+    EXPECT_EQ(ob.allocationRules().algorithm, MatchingAlgorithm::Fifo);
+    FillRecorder fills;
+    ob.setEventListener(&fills);
+    Order a(1, "limit", "sell", 10.0, 10);
+    Order b(2, "limit", "sell", 10.0, 30);
+    ob.processOrder(a);
+    ob.processOrder(b);
+    Order buy(3, "limit", "buy", 10.0, 20);
+    ob.processOrder(buy);
+    EXPECT_EQ(fills.fills[1], 10u);
+    EXPECT_EQ(fills.fills[2], 10u);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "auction.hpp"
+#include "orderbook.hpp"
+
+namespace {
+
+AuctionEquilibrium solve(const std::vector<AuctionLevel> &bids, const std::vector<AuctionLevel> &asks) {
+    return findEquilibrium(bids.data(), bids.size(), asks.data(), asks.size());
+}
+
+const Order* findFilled(const AuctionResult &r, uint64_t orderId) {
+    for (const Order &o : r.filled) {
+        if (o.orderId == orderId) {
+            return &o;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+TEST(AuctionTest, NoCrossNoTrade) {
+    EXPECT_FALSE(solve({{100, 5}}, {{101, 5}}).crossed);
+    EXPECT_FALSE(solve({}, {{101, 5}}).crossed);
+    EXPECT_FALSE(solve({{100, 5}}, {}).crossed);
+}
+
+TEST(AuctionTest, MaximisesExecutedVolume) {
+    // Demand at >=p: 102:10 101:25 100:45 99:45
+    // Supply at <=p:  99:10 100:30 101:40 102:60
+    AuctionEquilibrium eq = solve({{102, 10}, {101, 15}, {100, 20}},
+                                  {{99, 10}, {100, 20}, {101, 10}, {102, 20}});
+    ASSERT_TRUE(eq.crossed);
+    EXPECT_EQ(eq.ticks, 100);
+    EXPECT_EQ(eq.volume, 30u);
+    EXPECT_EQ(eq.surplus, 15);
+}
+
+TEST(AuctionTest, TiesGoToSmallestSurplusThenPressure) {
+    // Volume 10 at 100 and at 101; surplus +5 at 100, -15 at 101
+    AuctionEquilibrium eq = solve({{101, 10}, {100, 5}}, {{100, 10}, {101, 15}});
+    ASSERT_TRUE(eq.crossed);
+    EXPECT_EQ(eq.volume, 10u);
+    EXPECT_EQ(eq.ticks, 100);
+    EXPECT_EQ(eq.surplus, 5);
+
+    // Same volume and surplus everywhere in [100, 102]: buyers press up
+    eq = solve({{102, 20}}, {{100, 10}});
+    EXPECT_EQ(eq.ticks, 102);
+    // ...and sellers press down
+    eq = solve({{102, 10}}, {{100, 20}});
+    EXPECT_EQ(eq.ticks, 100);
+}
+
+TEST(AuctionTest, OrdersRestDuringCallAndUncrossInOneBatch) {
+    OrderBook ob;
+    ob.beginAuction();
+    EXPECT_EQ(ob.tradingPhase(), TradingPhase::Auction);
+
+    Order orders[] = {
+        Order(1, "limit", "buy", 102.0, 10),
+        Order(2, "limit", "buy", 101.0, 15),
+        Order(3, "limit", "buy", 100.0, 20),
+        Order(4, "limit", "sell", 99.0, 10),
+        Order(5, "limit", "sell", 100.0, 20),
+        Order(6, "limit", "sell", 101.0, 10),
+    };
+    for (Order &o : orders) {
+        ob.processOrder(o);
+        EXPECT_EQ(o.status, OrderStatus::Open);
+        EXPECT_EQ(o.filledQuantity, 0u);
+    }
+    // The call book may be crossed
+    EXPECT_DOUBLE_EQ(ob.bidDepth(1)[0].price, 102.0);
+    EXPECT_DOUBLE_EQ(ob.askDepth(1)[0].price, 99.0);
+
+    Order market(7, "market", "buy", 0.0, 5);
+    ob.processOrder(market);
+    EXPECT_EQ(market.status, OrderStatus::AuctionRejected);
+
+    AuctionResult r = ob.uncross();
+    EXPECT_EQ(ob.tradingPhase(), TradingPhase::Continuous);
+    ASSERT_TRUE(r.crossed);
+    EXPECT_DOUBLE_EQ(r.price, 100.0);
+    EXPECT_EQ(r.volume, 30u);
+
+    // Bids 1 and 2 fill completely and 3 partly; asks 4 and 5 fill; 6 doesn't trade
+    ASSERT_EQ(r.filled.size(), 5u);
+    EXPECT_EQ(findFilled(r, 1)->status, OrderStatus::Executed);
+    EXPECT_EQ(findFilled(r, 2)->status, OrderStatus::Executed);
+    EXPECT_EQ(findFilled(r, 4)->status, OrderStatus::Executed);
+    EXPECT_EQ(findFilled(r, 5)->status, OrderStatus::Executed);
+    EXPECT_EQ(findFilled(r, 6), nullptr);
+    const Order *partial = findFilled(r, 3);
+    ASSERT_NE(partial, nullptr);
+    EXPECT_DOUBLE_EQ(partial->averagePrice(), 100.0);
+    EXPECT_EQ(partial->status, OrderStatus::PartiallyFilled);
+    EXPECT_EQ(partial->filledQuantity, 5u);
+    EXPECT_EQ(partial->remainingQuantity, 15u);
+
+    // Uncrossed, and back to continuous matching
+    EXPECT_DOUBLE_EQ(ob.bidDepth(1)[0].price, 100.0);
+    EXPECT_EQ(ob.bidDepth(1)[0].quantity, 15u);
+    EXPECT_DOUBLE_EQ(ob.askDepth(1)[0].price, 101.0);
+    Order taker(8, "market", "buy", 0.0, 5);
+    ob.processOrder(taker);
+    EXPECT_EQ(taker.status, OrderStatus::Executed);
+}
+
+TEST(AuctionTest, IcebergReserveTakesPart) {
+    OrderBook ob;
+    ob.beginAuction();
+    Order iceberg(1, "limit", "sell", 100.0, 30);
+    iceberg.displayQuantity = 5;
+    ob.processOrder(iceberg);
+    Order bid(2, "limit", "buy", 100.0, 20);
+    ob.processOrder(bid);
+
+    AuctionResult r = ob.uncross();
+    ASSERT_TRUE(r.crossed);
+    EXPECT_EQ(r.volume, 20u);
+    const Order *ice = findFilled(r, 1);
+    ASSERT_NE(ice, nullptr);
+    EXPECT_EQ(ice->filledQuantity, 20u);
+    EXPECT_EQ(ice->remainingQuantity, 10u);
+    EXPECT_EQ(findFilled(r, 2)->status, OrderStatus::Executed);
+}
+
+TEST(AuctionTest, UncrossWithoutOverlapJustReopens) {
+    OrderBook ob;
+    ob.beginAuction();
+    Order bid(1, "limit", "buy", 99.0, 5);
+    Order ask(2, "limit", "sell", 100.0, 5);
+    ob.processOrder(bid);
+    ob.processOrder(ask);
+    AuctionResult r = ob.uncross();
+    EXPECT_FALSE(r.crossed);
+    EXPECT_TRUE(r.filled.empty());
+    EXPECT_EQ(ob.tradingPhase(), TradingPhase::Continuous);
+    EXPECT_EQ(ob.bidOrderCount(), 1u);
+    EXPECT_EQ(ob.askOrderCount(), 1u);
+}
@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audit_log.hpp"
+
+namespace {
+
+// Fresh directory under /tmp, removed with its files at scope exit
+struct TempDir {
+    std::string path;
+    TempDir() {
+        char pattern[] = "/tmp/audit_test_XXXXXX";
+        path = mkdtemp(pattern);
+    }
+    ~TempDir() {
+        for (const std::string &f : files()) {
+            std::remove(f.c_str());
+        }
+        rmdir(path.c_str());
+    }
+    std::vector<std::string> files() const {
+        std::vector<std::string> out;
+        DIR *dir = opendir(path.c_str());
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                out.push_back(path + "/" + name);
+            }
+        }
+        closedir(dir);
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+};
+
+std::vector<AuditEvent> readAll(const std::vector<std::string> &files) {
+    std::vector<AuditEvent> events;
+    for (const std::string &f : files) {
+        AuditReader reader(f);
+        EXPECT_TRUE(reader.ok()) << f;
+        AuditEvent e;
+        while (reader.next(e)) {
+            events.push_back(e);
+        }
+    }
+    return events;
+}
+
+Order limitOrder(uint64_t id, const std::string &action, double price, uint64_t qty) {
+    Order o(id, "limit", action, price, qty);
+    o.sequence = id;
+    return o;
+}
+
+} // namespace
+
+TEST(AuditLogTest, BlockCodecRoundTrips) {
+    std::vector<AuditEvent> events(3);
+    events[0].timestampNs = 1700000000000000000ULL;
+    events[0].orderId = 42;
+    events[0].priceTicks = 101500000;
+    events[0].quantity = 10;
+    events[1] = events[0];
+    events[1].timestampNs -= 5;  // clocks may step back
+    events[1].type = AuditEventType::Trade;
+    events[1].counterpartyId = 7;
+    events[1].priceTicks = -3;
+    events[2].type = AuditEventType::Cancel;
+    events[2].ownerId = UINT32_MAX;
+    events[2].remainingQuantity = UINT64_MAX;
+
+    std::string encoded;
+    encodeAuditBlock(events.data(), events.size(), encoded);
+    EXPECT_LT(encoded.size(), events.size() * sizeof(AuditEvent));
+
+    std::vector<AuditEvent> decoded;
+    ASSERT_TRUE(decodeAuditBlock(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(),
+                                 events.size(), decoded));
+    ASSERT_EQ(decoded.size(), 3u);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_EQ(decoded[i].timestampNs, events[i].timestampNs);
+        EXPECT_EQ(decoded[i].orderId, events[i].orderId);
+        EXPECT_EQ(decoded[i].counterpartyId, events[i].counterpartyId);
+        EXPECT_EQ(decoded[i].priceTicks, events[i].priceTicks);
+        EXPECT_EQ(decoded[i].remainingQuantity, events[i].remainingQuantity);
+        EXPECT_EQ(decoded[i].ownerId, events[i].ownerId);
+        EXPECT_EQ(decoded[i].type, events[i].type);
+    }
+    EXPECT_FALSE(decodeAuditBlock(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size() - 1,
+                                  events.size(), decoded));
+}
+
+TEST(AuditLogTest, RecordsBookActivity) {
+    TempDir dir;
+    AuditConfig config;
+    config.directory = dir.path;
+    AuditWriter writer(config);
+    ASSERT_TRUE(writer.start());
+
+    OrderBook ob;
+    ob.setEventListener(&writer);
+    Order s = limitOrder(1, "sell", 50.0, 10);
+    Order b = limitOrder(2, "buy", 50.0, 4);
+    Order bad;
+    bad.orderId = 3;
+    ob.processOrder(s);
+    ob.processOrder(b);
+    ob.processOrder(bad);
+    writer.stop();
+
+    std::vector<AuditEvent> events = readAll(dir.files());
+    ASSERT_EQ(events.size(), 4u);
+    EXPECT_EQ(events[0].type, AuditEventType::Order);
+    EXPECT_STREQ(auditStatusName(events[0].detail), "open");
+    EXPECT_EQ(events[1].type, AuditEventType::Trade);
+    EXPECT_EQ(events[1].orderId, 2u);
+    EXPECT_EQ(events[1].counterpartyId, 1u);
+    EXPECT_EQ(events[1].quantity, 4u);
+    EXPECT_EQ(events[1].priceTicks, toTicks(50.0));
+    EXPECT_EQ(events[2].type, AuditEventType::Order);
+    EXPECT_STREQ(auditStatusName(events[2].detail), "executed");
+    EXPECT_EQ(events[3].type, AuditEventType::Reject);
+    EXPECT_EQ(writer.eventsWritten(), 4u);
+}
+
+TEST(AuditLogTest, RotatesFiles) {
+    TempDir dir;
+    AuditConfig config;
+    config.directory = dir.path;
+    config.maxFileBytes = 64;
+    AuditWriter writer(config);
+    ASSERT_TRUE(writer.start());
+
+    // Files rotate between blocks, so let each batch of orders reach the disk
+    OrderBook ob;
+    ob.setEventListener(&writer);
+    for (uint64_t id = 1; id <= 200; id++) {
+        Order o = limitOrder(id, "buy", 10.0 + id, 1);
+        ob.processOrder(o);
+        if (id % 50 == 0) {
+            while (writer.eventsWritten() < id) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    writer.stop();
+
+    EXPECT_GT(dir.files().size(), 1u);
+    EXPECT_EQ(dir.files().size(), writer.filesOpened());
+    std::vector<AuditEvent> events = readAll(dir.files());
+    ASSERT_EQ(events.size(), 200u);
+    for (uint64_t i = 0; i < 200; i++) {
+        EXPECT_EQ(events[i].orderId, i + 1);
+    }
+}
+
+TEST(AuditLogTest, BackpressureModes) {
+    // Events pushed before start() pile up in the ring, standing in for a slow disk
+    for (AuditBackpressure mode : {AuditBackpressure::Drop, AuditBackpressure::Spill}) {
+        TempDir dir;
+        AuditConfig config;
+        config.directory = dir.path;
+        config.ringCapacity = 4;
+        config.backpressure = mode;
+        AuditWriter writer(config);
+
+        for (uint64_t id = 1; id <= 10; id++) {
+            writer.onOrder(limitOrder(id, "buy", 10.0, 1));
+        }
+        ASSERT_TRUE(writer.start());
+        writer.stop();
+
+        std::vector<AuditEvent> events = readAll(dir.files());
+        if (mode == AuditBackpressure::Drop) {
+            EXPECT_EQ(events.size(), 4u);
+            EXPECT_EQ(writer.eventsDropped(), 6u);
+        } else {
+            ASSERT_EQ(events.size(), 10u);
+            EXPECT_EQ(events.back().orderId, 10u);
+            EXPECT_EQ(writer.segmentsSpilled(), 2u);
+        }
+    }
+}
+
+TEST(AuditLogTest, SpillReusesItsPreallocatedSegments) {
+    TempDir dir;
+    AuditConfig config;
+    config.directory = dir.path;
+    config.ringCapacity = 4;
+    config.spillSegments = 1;
+    config.backpressure = AuditBackpressure::Spill;
+    AuditWriter writer(config);
+
+    // One spare segment: the first ring and the spare hold 8, the rest are dropped
+    for (uint64_t id = 1; id <= 10; id++) {
+        writer.onOrder(limitOrder(id, "buy", 10.0, 1));
+    }
+    EXPECT_EQ(writer.segmentsSpilled(), 1u);
+    EXPECT_EQ(writer.eventsDropped(), 2u);
+    ASSERT_TRUE(writer.start());
+    writer.stop();
+
+    // The drained first segment is handed back and spilled into again
+    for (uint64_t id = 11; id <= 18; id++) {
+        writer.onOrder(limitOrder(id, "buy", 10.0, 1));
+    }
+    EXPECT_EQ(writer.segmentsSpilled(), 2u);
+    EXPECT_EQ(writer.eventsDropped(), 2u);
+    ASSERT_TRUE(writer.start());
+    writer.stop();
+
+    std::vector<AuditEvent> events = readAll(dir.files());
+    ASSERT_EQ(events.size(), 16u);
+    EXPECT_EQ(events[7].orderId, 8u);
+    EXPECT_EQ(events[8].orderId, 11u);
+    EXPECT_EQ(events.back().orderId, 18u);
+}
+
+TEST(AuditLogTest, ParseBackpressure) {
+    AuditBackpressure mode = AuditBackpressure::Spill;
+    EXPECT_TRUE(parseAuditBackpressure("block", mode));
+    EXPECT_EQ(mode, AuditBackpressure::Block);
+    EXPECT_FALSE(parseAuditBackpressure("fast", mode));
+}
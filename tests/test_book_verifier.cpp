@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "book_verifier.hpp"
+
+namespace {
+
+struct RandomRun {
+    std::vector<VerifierAlert> alerts;
+    uint64_t inputsChecked = 0;
+    uint64_t trades = 0;
+    bool overflowed = false;
+};
+
+// Counts trades so a run is known to have exercised matching
+class TradeCounter : public BookEventListener {
+public:
+    void onTrade(const Order &, const Order &, double, uint64_t) override { trades++; }
+    uint64_t trades = 0;
+};
+
+/**
+ * Drives a book with a random mix of every order type, icebergs,
+ * good-till-date orders, cancels, replaces, kills, clock advances and call
+ * auctions, with a verifier attached, and returns what it raised.
+ */
+RandomRun runRandom(const VerifierConfig &config, unsigned seed, int steps) {
+    SimulatedClock clock(1000);
+    OrderBook book(&clock);
+    book.setSelfTradePrevention(config.stp);
+    book.setAllocationRules(config.allocation);
+    book.setPostOnlyMode(config.postOnly);
+    book.setTickSize(config.tickSize);
+
+    RandomRun run;
+    TradeCounter counter;
+    BookVerifier verifier(config, [&run](const VerifierAlert &a) { run.alerts.push_back(a); }, &counter);
+    book.setEventListener(&verifier);
+    book.setInputJournal(&verifier);
+    verifier.start();
+
+    static const char *const kTypes[] = {"limit", "limit", "limit", "limit", "market",
+                                         "ioc", "fok", "post-only", "stop-loss"};
+    std::mt19937 rng(seed);
+    auto pick = [&rng](uint64_t lo, uint64_t hi) {
+        return std::uniform_int_distribution<uint64_t>(lo, hi)(rng);
+    };
+    uint64_t nextId = 1;
+    uint64_t sequence = 1;
+    for (int step = 0; step < steps; step++) {
+        if (step % 2500 == 1200) {
+            book.beginAuction();
+        } else if (step % 2500 == 1500) {
+            book.uncross();
+        }
+        clock.set(clock.nowMs() + pick(0, 2));
+        if (pick(0, 19) == 0) {
+            book.expireOrders(clock.nowMs());
+        }
+
+        Order o;
+        uint64_t roll = pick(0, 99);
+        if (roll < 10 && nextId > 1) {
+            o = Order(pick(1, nextId - 1), "cancel", "buy", 0.0, 0);
+        } else if (roll < 18 && nextId > 1) {
+            o = Order(pick(1, nextId - 1), "replace", "buy", 99.95 + 0.01 * pick(0, 10), pick(0, 15));
+        } else if (roll < 20) {
+            o = Order(0, "kill", "buy", 0.0, 0);
+            o.ownerId = static_cast<uint32_t>(pick(1, 3));
+        } else {
+            const char *type = kTypes[pick(0, 8)];
+            o = Order(nextId++, type, pick(0, 1) ? "buy" : "sell", 99.95 + 0.01 * pick(0, 10), pick(1, 20));
+            o.stopPrice = 99.95 + 0.01 * pick(0, 10);
+            o.ownerId = static_cast<uint32_t>(pick(0, 3));
+            if (pick(0, 4) == 0) {
+                o.displayQuantity = pick(1, 5);
+            }
+            if (pick(0, 6) == 0) {
+                o.expireTimeMs = clock.nowMs() + pick(0, 40);
+            }
+        }
+        o.sequence = sequence++;
+        book.processOrder(o);
+        book.takeKilled();
+    }
+    book.expireOrders(clock.nowMs() + 100);
+    verifier.stop();
+
+    run.inputsChecked = verifier.inputsChecked();
+    run.trades = counter.trades;
+    run.overflowed = verifier.overflowed();
+    return run;
+}
+
+void expectClean(const RandomRun &run) {
+    EXPECT_FALSE(run.overflowed);
+    EXPECT_GT(run.trades, 1000u);
+    EXPECT_GT(run.inputsChecked, 10000u);
+    EXPECT_TRUE(run.alerts.empty()) << run.alerts.size() << " alerts; first (seq "
+                                    << (run.alerts.empty() ? 0 : run.alerts[0].sequence) << "): "
+                                    << (run.alerts.empty() ? "" : run.alerts[0].message);
+}
+
+// Synthetic events for feeding a ShadowMatcher directly
+constexpr int64_t kPx100 = 100000000;  // 100.00 in ticks
+constexpr int64_t kPx99 = 99000000;
+
+VerifierEvent input(uint64_t seq, uint64_t id, OrderKind kind, Side side, int64_t ticks, uint64_t qty) {
+    VerifierEvent e;
+    e.type = VerifierEventType::OrderInput;
+    e.sequence = seq;
+    e.orderId = id;
+    e.kind = kind;
+    e.side = side;
+    e.priceTicks = ticks;
+    e.quantity = qty;
+    e.remainingQuantity = qty;
+    e.nowMs = 1000;
+    return e;
+}
+
+VerifierEvent rest(uint64_t id, Side side, int64_t ticks, uint64_t qty) {
+    VerifierEvent e;
+    e.type = VerifierEventType::Rest;
+    e.orderId = id;
+    e.kind = OrderKind::Limit;
+    e.side = side;
+    e.priceTicks = ticks;
+    e.remainingQuantity = qty;
+    return e;
+}
+
+VerifierEvent trade(uint64_t id, uint64_t restingId, int64_t ticks, uint64_t qty) {
+    VerifierEvent e;
+    e.type = VerifierEventType::Trade;
+    e.orderId = id;
+    e.otherId = restingId;
+    e.priceTicks = ticks;
+    e.quantity = qty;
+    return e;
+}
+
+VerifierEvent outcome(uint64_t id, OrderStatus status, uint64_t filled, uint64_t remaining) {
+    VerifierEvent e;
+    e.type = VerifierEventType::Outcome;
+    e.orderId = id;
+    e.filledQuantity = filled;
+    e.remainingQuantity = remaining;
+    e.detail = orderStatusCode(status);
+    return e;
+}
+
+// Two bids of 10 at 100, ids 1 and 2
+void restTwoBids(ShadowMatcher &shadow) {
+    for (uint64_t id : {1, 2}) {
+        shadow.process(input(id, id, OrderKind::Limit, Side::Buy, kPx100, 10));
+        shadow.process(rest(id, Side::Buy, kPx100, 10));
+        shadow.process(outcome(id, OrderStatus::Open, 0, 10));
+    }
+}
+
+bool anyAlert(const std::vector<VerifierAlert> &alerts, uint64_t sequence, const std::string &text) {
+    for (const VerifierAlert &a : alerts) {
+        if (a.sequence == sequence && a.message.find(text) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+TEST(BookVerifierTest, RandomFifoFlowMatchesReference) {
+    VerifierConfig config;
+    config.ringCapacity = 1 << 20;
+    expectClean(runRandom(config, 7, 20000));
+}
+
+TEST(BookVerifierTest, RandomRepricedPostOnlyFlowMatchesReference) {
+    VerifierConfig config;
+    config.ringCapacity = 1 << 20;
+    config.postOnly = PostOnlyMode::Reprice;
+    expectClean(runRandom(config, 11, 20000));
+}
+
+TEST(BookVerifierTest, RandomProRataAndSelfTradeFlowKeepsInvariants) {
+    VerifierConfig config;
+    config.ringCapacity = 1 << 20;
+    config.allocation.algorithm = MatchingAlgorithm::PriceTimeProRata;
+    config.allocation.topOrderSlice = 3;
+    config.stp = SelfTradePrevention::Decrement;
+    expectClean(runRandom(config, 13, 20000));
+
+    config.allocation = AllocationRules();
+    config.stp = SelfTradePrevention::CancelOldest;
+    expectClean(runRandom(config, 17, 20000));
+}
+
+TEST(BookVerifierTest, MatchingOutcomeAgreesWithReference) {
+    std::vector<VerifierAlert> alerts;
+    ShadowMatcher shadow(VerifierConfig(), [&alerts](const VerifierAlert &a) { alerts.push_back(a); });
+    restTwoBids(shadow);
+
+    // Sell 15 at 100: all of 1, then 5 of 2
+    shadow.process(input(3, 3, OrderKind::Limit, Side::Sell, kPx100, 15));
+    shadow.process(trade(3, 1, kPx100, 10));
+    shadow.process(trade(3, 2, kPx100, 5));
+    shadow.process(outcome(3, OrderStatus::Executed, 15, 0));
+    shadow.finish();
+
+    EXPECT_TRUE(alerts.empty()) << alerts[0].message;
+    EXPECT_EQ(shadow.inputsChecked(), 3u);
+    EXPECT_EQ(shadow.restingOrders(), 1u);
+}
+
+TEST(BookVerifierTest, CrossedBookIsFlagged) {
+    std::vector<VerifierAlert> alerts;
+    ShadowMatcher shadow(VerifierConfig(), [&alerts](const VerifierAlert &a) { alerts.push_back(a); });
+    restTwoBids(shadow);
+
+    // A sell at 99 that rests instead of trading
+    shadow.process(input(3, 3, OrderKind::Limit, Side::Sell, kPx99, 5));
+    shadow.process(rest(3, Side::Sell, kPx99, 5));
+    shadow.process(outcome(3, OrderStatus::Open, 0, 5));
+
+    EXPECT_TRUE(anyAlert(alerts, 3, "book crossed"));
+    EXPECT_TRUE(anyAlert(alerts, 3, "made 0 trades, expected 1"));
+}
+
+TEST(BookVerifierTest, TradeOutOfTimePriorityIsFlagged) {
+    std::vector<VerifierAlert> alerts;
+    ShadowMatcher shadow(VerifierConfig(), [&alerts](const VerifierAlert &a) { alerts.push_back(a); });
+    restTwoBids(shadow);
+
+    shadow.process(input(3, 3, OrderKind::Limit, Side::Sell, kPx100, 5));
+    shadow.process(trade(3, 2, kPx100, 5));
+    shadow.process(outcome(3, OrderStatus::Executed, 5, 0));
+
+    EXPECT_TRUE(anyAlert(alerts, 3, "ahead of 1"));
+    EXPECT_TRUE(anyAlert(alerts, 3, "expected 5 with 1"));
+    EXPECT_EQ(alerts[0].input, 2u);
+}
+
+TEST(BookVerifierTest, UnconservedQuantityIsFlagged) {
+    std::vector<VerifierAlert> alerts;
+    ShadowMatcher shadow(VerifierConfig(), [&alerts](const VerifierAlert &a) { alerts.push_back(a); });
+    restTwoBids(shadow);
+
+    // An IOC that trades 10 but reports its remainder as filled too
+    shadow.process(input(3, 3, OrderKind::IOC, Side::Sell, kPx100, 25));
+    shadow.process(trade(3, 1, kPx100, 10));
+    shadow.process(trade(3, 2, kPx100, 10));
+    shadow.process(outcome(3, OrderStatus::PartiallyFilled, 25, 0));
+
+    EXPECT_TRUE(anyAlert(alerts, 3, "reports 25 filled but traded 20"));
+}
+
+TEST(BookVerifierTest, OrderLeftPastItsExpiryIsFlagged) {
+    std::vector<VerifierAlert> alerts;
+    ShadowMatcher shadow(VerifierConfig(), [&alerts](const VerifierAlert &a) { alerts.push_back(a); });
+
+    VerifierEvent gtd = input(1, 1, OrderKind::Limit, Side::Buy, kPx100, 10);
+    gtd.expireTimeMs = 1500;
+    VerifierEvent rested = rest(1, Side::Buy, kPx100, 10);
+    rested.expireTimeMs = 1500;
+    shadow.process(gtd);
+    shadow.process(rested);
+    shadow.process(outcome(1, OrderStatus::Open, 0, 10));
+
+    VerifierEvent late = input(2, 2, OrderKind::Cancel, Side::Buy, 0, 0);
+    late.orderId = 9;
+    late.nowMs = 2000;
+    shadow.process(late);
+    shadow.process(outcome(9, OrderStatus::CancelRejected, 0, 0));
+
+    EXPECT_TRUE(anyAlert(alerts, 2, "still resting after expiring at 1500"));
+}
+
+TEST(BookVerifierTest, RingOverflowSuspendsChecking) {
+    VerifierConfig config;
+    config.ringCapacity = 8;
+    std::vector<VerifierAlert> alerts;
+    BookVerifier verifier(config, [&alerts](const VerifierAlert &a) { alerts.push_back(a); });
+
+    OrderBook book;
+    book.setEventListener(&verifier);
+    book.setInputJournal(&verifier);
+    for (uint64_t id = 1; id <= 20; id++) {
+        Order o(id, "limit", "buy", 100.0, 1);
+        o.sequence = id;
+        book.processOrder(o);
+    }
+    EXPECT_TRUE(verifier.overflowed());
+
+    // The checker starts late: what fit is checked, then it stops quietly
+    verifier.start();
+    verifier.stop();
+    ASSERT_EQ(alerts.size(), 1u);
+    EXPECT_NE(alerts[0].message.find("suspended"), std::string::npos);
+    EXPECT_EQ(verifier.alertsRaised(), 1u);
+    EXPECT_LT(verifier.inputsChecked(), 20u);
+    EXPECT_EQ(book.bidOrderCount(), 20u);
+}
@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "book_view.hpp"
+#include "json_utils.hpp"
+#include "order_codec.hpp"
+#include "orderbook.hpp"
+
+namespace {
+
+DepthQuery query(DepthQueryType type, size_t levels = 0, const std::string &requestId = "") {
+    DepthQuery q;
+    q.type = type;
+    q.levels = levels;
+    q.requestId = requestId;
+    return q;
+}
+
+size_t countOf(const std::string &text, const std::string &needle) {
+    size_t n = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+} // namespace
+
+TEST(BookViewTest, PublishesDepthAfterEveryChange) {
+    OrderBook ob;
+    uint64_t before = ob.depthView().version;
+    Order b1(1, "limit", "buy", 99.0, 5);
+    Order b2(2, "limit", "buy", 98.0, 7);
+    Order a1(3, "limit", "sell", 101.0, 4);
+    ob.processOrder(b1);
+    ob.processOrder(b2);
+    ob.processOrder(a1);
+
+    BookDepthView view = ob.depthView();
+    EXPECT_EQ(view.version, before + 3);
+    ASSERT_EQ(view.bidLevels, 2u);
+    ASSERT_EQ(view.askLevels, 1u);
+    EXPECT_DOUBLE_EQ(view.bids[0].price, 99.0);
+    EXPECT_EQ(view.bids[0].quantity, 5u);
+    EXPECT_EQ(view.bids[1].cumulativeQuantity, 12u);
+    EXPECT_DOUBLE_EQ(view.asks[0].price, 101.0);
+}
+
+TEST(BookViewTest, ViewDepthIsConfigurable) {
+    OrderBook ob;
+    ob.setDepthViewLevels(1);
+    Order b1(1, "limit", "buy", 99.0, 5);
+    Order b2(2, "limit", "buy", 98.0, 7);
+    ob.processOrder(b1);
+    ob.processOrder(b2);
+    EXPECT_EQ(ob.depthView().bidLevels, 1u);
+
+    ob.setDepthViewLevels(1000);
+    EXPECT_EQ(ob.depthViewLevels(), kBookViewLevels);
+}
+
+TEST(BookViewTest, TopOfBookAnswer) {
+    OrderBook ob;
+    Order b1(1, "limit", "buy", 99.0, 5);
+    Order b2(2, "limit", "buy", 99.0, 3);
+    ob.processOrder(b1);
+    ob.processOrder(b2);
+
+    std::vector<std::string> answer = answerDepthQuery(ob, query(DepthQueryType::TopOfBook, 0, "q1"));
+    ASSERT_EQ(answer.size(), 1u);
+    auto fields = parseJsonString(answer[0]);
+    EXPECT_EQ(fields["type"], "top_of_book");
+    EXPECT_EQ(fields["request_id"], "q1");
+    EXPECT_DOUBLE_EQ(std::stod(fields["bid_price"]), 99.0);
+    EXPECT_EQ(fields["bid_quantity"], "8");
+    EXPECT_EQ(fields.count("ask_price"), 0u);
+}
+
+TEST(BookViewTest, TopOfBookWithoutView) {
+    OrderBook ob;
+    ob.setDepthViewLevels(0);
+    Order a1(1, "limit", "sell", 101.0, 4);
+    ob.processOrder(a1);
+
+    std::vector<std::string> answer = answerDepthQuery(ob, query(DepthQueryType::TopOfBook));
+    ASSERT_EQ(answer.size(), 1u);
+    auto fields = parseJsonString(answer[0]);
+    EXPECT_DOUBLE_EQ(std::stod(fields["ask_price"]), 101.0);
+    EXPECT_EQ(fields["ask_quantity"], "4");
+}
+
+TEST(BookViewTest, LevelsBeyondTheViewComeFromASnapshot) {
+    OrderBook ob;
+    ob.setDepthViewLevels(2);
+    for (uint64_t i = 0; i < 5; i++) {
+        Order b(i + 1, "limit", "buy", 99.0 - static_cast<double>(i), 10);
+        ob.processOrder(b);
+    }
+
+    std::vector<std::string> shallow = answerDepthQuery(ob, query(DepthQueryType::Levels, 2));
+    ASSERT_EQ(shallow.size(), 1u);
+    EXPECT_EQ(countOf(shallow[0], "\"price\""), 2u);
+
+    std::vector<std::string> deep = answerDepthQuery(ob, query(DepthQueryType::Levels, 4, "r\"7"));
+    ASSERT_EQ(deep.size(), 1u);
+    EXPECT_NE(deep[0].find("\"request_id\":\"r\\\"7\","), std::string::npos);
+    EXPECT_EQ(countOf(deep[0], "\"price\""), 4u);
+    EXPECT_NE(deep[0].find("\"type\":\"l2\""), std::string::npos);
+    EXPECT_NE(deep[0].find("\"asks\":[]"), std::string::npos);
+}
+
+TEST(BookViewTest, OrdersInPriorityWithoutHiddenQuantity) {
+    OrderBook ob;
+    Order first(1, "limit", "sell", 101.0, 4);
+    Order iceberg(2, "limit", "sell", 101.0, 50);
+    iceberg.displayQuantity = 5;
+    Order better(3, "limit", "sell", 100.5, 2);
+    ob.processOrder(first);
+    ob.processOrder(iceberg);
+    ob.processOrder(better);
+
+    std::shared_ptr<const BookSnapshot> snap = ob.orderSnapshot();
+    ASSERT_EQ(snap->asks.size(), 3u);
+    EXPECT_EQ(snap->asks[0].orderId, 3u);
+    EXPECT_EQ(snap->asks[1].orderId, 1u);
+    EXPECT_EQ(snap->asks[2].orderId, 2u);
+    EXPECT_EQ(snap->asks[2].quantity, 5u);
+    EXPECT_EQ(snap->asks[2].hiddenQuantity, 45u);
+
+    std::vector<std::string> answer = answerDepthQuery(ob, query(DepthQueryType::Orders));
+    ASSERT_EQ(answer.size(), 1u);
+    EXPECT_LT(answer[0].find("\"order_id\":\"3\""), answer[0].find("\"order_id\":\"1\""));
+    EXPECT_NE(answer[0].find("\"quantity\":\"5\""), std::string::npos);
+    EXPECT_EQ(answer[0].find("45"), std::string::npos);
+    EXPECT_EQ(answer[0].find("hidden"), std::string::npos);
+}
+
+TEST(BookViewTest, LongAnswersAreSplitIntoParts) {
+    OrderBook ob;
+    for (uint64_t i = 0; i < 100; i++) {
+        Order b(i + 1, "limit", "buy", 50.0, 1);
+        ob.processOrder(b);
+    }
+
+    std::vector<std::string> parts = answerDepthQuery(ob, query(DepthQueryType::Orders), 600);
+    ASSERT_GT(parts.size(), 1u);
+    size_t orders = 0;
+    for (size_t i = 0; i < parts.size(); i++) {
+        EXPECT_LE(parts[i].size(), 600u);
+        EXPECT_NE(parts[i].find("\"part\":\"" + std::to_string(i + 1) + "\""), std::string::npos);
+        EXPECT_NE(parts[i].find("\"parts\":\"" + std::to_string(parts.size()) + "\""), std::string::npos);
+        orders += countOf(parts[i], "\"order_id\"");
+    }
+    EXPECT_EQ(orders, 100u);
+
+    // The longest request_id, escaped in every part, still fits the budget
+    std::string requestId(DepthQuery::kMaxRequestIdBytes, '"');
+    std::vector<std::string> tagged = answerDepthQuery(ob, query(DepthQueryType::Orders, 0, requestId), 600);
+    ASSERT_GT(tagged.size(), parts.size());
+    for (const std::string &part : tagged) {
+        EXPECT_LE(part.size(), 600u);
+    }
+}
+
+TEST(BookViewTest, SnapshotIsBuiltByTheMatchingThread) {
+    OrderBook ob;
+    Order resting(1, "limit", "buy", 90.0, 1);
+    ob.processOrder(resting);
+
+    std::atomic<bool> running{true};
+    std::thread matcher([&] {
+        uint64_t id = 100;
+        while (running.load()) {
+            Order o(id++, "limit", "sell", 120.0, 1);
+            ob.processOrder(o);
+        }
+    });
+    for (int i = 0; i < 20; i++) {
+        std::shared_ptr<const BookSnapshot> snap = ob.orderSnapshot();
+        ASSERT_TRUE(snap);
+        ASSERT_EQ(snap->bids.size(), 1u);
+        EXPECT_EQ(snap->bids[0].orderId, 1u);
+    }
+    running.store(false);
+    matcher.join();
+}
+
+TEST(BookViewTest, IdleBookStillAnswersSnapshots) {
+    OrderBook ob;
+    Order b(1, "limit", "buy", 90.0, 1);
+    ob.processOrder(b);
+
+    std::shared_ptr<const BookSnapshot> snap = ob.orderSnapshot(std::chrono::milliseconds(1));
+    ASSERT_TRUE(snap);
+    EXPECT_EQ(snap->bids.size(), 1u);
+    EXPECT_EQ(snap->version, ob.depthView().version);
+}
+
+TEST(BookViewTest, CodecRecognisesQueries) {
+    Order o;
+    DepthQuery q;
+    EXPECT_TRUE(decodeInboundMessage(R"({"type":"l2","levels":"5","request_id":"abc"})", o, q));
+    EXPECT_EQ(o.kind, OrderKind::Query);
+    EXPECT_EQ(q.type, DepthQueryType::Levels);
+    EXPECT_EQ(q.levels, 5u);
+    EXPECT_EQ(q.requestId, "abc");
+
+    Order top;
+    EXPECT_TRUE(decodeInboundMessage(R"({"type":"top_of_book"})", top, q));
+    EXPECT_EQ(q.type, DepthQueryType::TopOfBook);
+
+    Order longId;
+    std::string error;
+    std::string tooLong = R"({"type":"l3","request_id":")" +
+                          std::string(DepthQuery::kMaxRequestIdBytes + 1, 'x') + R"("})";
+    EXPECT_FALSE(decodeInboundMessage(tooLong, longId, q, &error));
+    EXPECT_EQ(error, "request_id too long");
+
+    Order bad;
+    EXPECT_FALSE(decodeInboundMessage(R"({"type":"l2"})", bad, q, &error));
+    EXPECT_EQ(bad.kind, OrderKind::Unknown);
+    EXPECT_FALSE(error.empty());
+
+    Order order;
+    EXPECT_TRUE(decodeInboundMessage(
+        R"({"order_id":"7","type":"limit","action":"buy","price":"10","quantity":"3"})", order, q));
+    EXPECT_EQ(order.kind, OrderKind::Limit);
+
+    // Plain order decoding does not take queries
+    Order plain;
+    EXPECT_FALSE(decodeOrderMessage(R"({"type":"l3"})", plain));
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <string>
+#include <vector>
+#include "confirmation_coalescer.hpp"
+
+namespace {
+
+using SendResult = ConfirmationCoalescer::SendResult;
+
+sockaddr_in clientAddr(uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    return addr;
+}
+
+Confirmation confirmationFor(uint16_t port, const std::string &message) {
+    Confirmation c;
+    c.clientAddr = clientAddr(port);
+    c.clientAddrLen = sizeof(sockaddr_in);
+    c.message = message;
+    return c;
+}
+
+struct Capture {
+    std::vector<std::pair<uint16_t, std::string>> datagrams;
+    SendResult result = SendResult::Sent;
+
+    ConfirmationCoalescer::SendFn fn() {
+        return [this](const sockaddr_in &addr, socklen_t, const std::string &datagram) {
+            if (result == SendResult::Sent) {
+                datagrams.emplace_back(ntohs(addr.sin_port), datagram);
+            }
+            return result;
+        };
+    }
+};
+
+} // namespace
+
+TEST(ConfirmationCoalescerTest, IdleFlushSendsAtOnce) {
+    Capture out;
+    ConfirmationCoalescer coalescer(CoalescerConfig{}, out.fn());
+
+    coalescer.add(confirmationFor(9000, "{\"a\":\"1\"}"), 0);
+    coalescer.add(confirmationFor(9000, "{\"a\":\"2\"}"), 0);
+    coalescer.add(confirmationFor(9001, "{\"b\":\"1\"}"), 0);
+    EXPECT_TRUE(coalescer.pending());
+
+    coalescer.flush(0, true);
+    ASSERT_EQ(out.datagrams.size(), 2u);
+    EXPECT_EQ(out.datagrams[0].first, 9000);
+    EXPECT_EQ(out.datagrams[0].second, "{\"a\":\"1\"}\n{\"a\":\"2\"}");
+    EXPECT_EQ(out.datagrams[1].second, "{\"b\":\"1\"}");
+    EXPECT_FALSE(coalescer.pending());
+    EXPECT_EQ(coalescer.datagramsSent(), 2u);
+    EXPECT_EQ(coalescer.confirmationsSent(), 3u);
+}
+
+TEST(ConfirmationCoalescerTest, BusySenderWaitsForFlushDelay) {
+    CoalescerConfig config;
+    config.flushDelayNs = 1000;
+    Capture out;
+    ConfirmationCoalescer coalescer(config, out.fn());
+
+    coalescer.add(confirmationFor(9000, "x"), 100);
+    coalescer.flush(500, false);
+    EXPECT_TRUE(out.datagrams.empty());
+    EXPECT_EQ(coalescer.nextDeadlineNs(), 1100u);
+
+    coalescer.add(confirmationFor(9000, "y"), 600);
+    coalescer.flush(1100, false);
+    ASSERT_EQ(out.datagrams.size(), 1u);
+    EXPECT_EQ(out.datagrams[0].second, "x\ny");
+    EXPECT_EQ(coalescer.nextDeadlineNs(), UINT64_MAX);
+}
+
+TEST(ConfirmationCoalescerTest, PacksUpToDatagramLimit) {
+    CoalescerConfig config;
+    config.maxDatagramBytes = 10;
+    Capture out;
+    ConfirmationCoalescer coalescer(config, out.fn());
+
+    // "aaa\nbbb" is 7 bytes; adding "\nccc" would make 11
+    for (const char *msg : {"aaa", "bbb", "ccc", "ddddddddddddd"}) {
+        coalescer.add(confirmationFor(9000, msg), 0);
+    }
+    // Full buffers go out even while the sender is busy
+    coalescer.flush(0, false);
+    ASSERT_EQ(out.datagrams.size(), 2u);
+    EXPECT_EQ(out.datagrams[0].second, "aaa\nbbb");
+    EXPECT_EQ(out.datagrams[1].second, "ccc");
+
+    // An oversized confirmation still goes, on its own
+    coalescer.flush(0, true);
+    ASSERT_EQ(out.datagrams.size(), 3u);
+    EXPECT_EQ(out.datagrams[2].second, "ddddddddddddd");
+}
+
+TEST(ConfirmationCoalescerTest, SlowClientIsConflatedIntoThrottleNotice) {
+    CoalescerConfig config;
+    config.clientQueueLimit = 2;
+    Capture out;
+    ConfirmationCoalescer coalescer(config, out.fn());
+
+    EXPECT_TRUE(coalescer.add(confirmationFor(9000, "1"), 0));
+    EXPECT_TRUE(coalescer.add(confirmationFor(9000, "2"), 0));
+    EXPECT_FALSE(coalescer.add(confirmationFor(9000, "3"), 0));
+    EXPECT_FALSE(coalescer.add(confirmationFor(9000, "4"), 0));
+    // Another client is unaffected
+    EXPECT_TRUE(coalescer.add(confirmationFor(9001, "5"), 0));
+
+    coalescer.flush(0, true);
+    ASSERT_EQ(out.datagrams.size(), 2u);
+    EXPECT_EQ(out.datagrams[0].second, "{\"dropped_confirmations\":\"2\",\"status\":\"throttled\"}\n1\n2");
+    EXPECT_EQ(out.datagrams[1].second, "5");
+    EXPECT_EQ(coalescer.confirmationsConflated(), 2u);
+    EXPECT_EQ(coalescer.throttleNotices(), 1u);
+}
+
+TEST(ConfirmationCoalescerTest, RateLimitSpreadsSendsOverTime) {
+    CoalescerConfig config;
+    config.clientRatePerSec = 2;
+    Capture out;
+    ConfirmationCoalescer coalescer(config, out.fn());
+
+    for (const char *msg : {"1", "2", "3"}) {
+        coalescer.add(confirmationFor(9000, msg), 0);
+    }
+    coalescer.flush(0, true);
+    ASSERT_EQ(out.datagrams.size(), 1u);
+    EXPECT_EQ(out.datagrams[0].second, "1\n2");
+    EXPECT_TRUE(coalescer.pending());
+
+    // One token per half second
+    uint64_t next = coalescer.nextDeadlineNs();
+    EXPECT_GT(next, 0u);
+    EXPECT_LE(next, 500000001u);
+    coalescer.flush(next, true);
+    ASSERT_EQ(out.datagrams.size(), 2u);
+    EXPECT_EQ(out.datagrams[1].second, "3");
+}
+
+TEST(ConfirmationCoalescerTest, WouldBlockKeepsConfirmationsForRetry) {
+    Capture out;
+    std::vector<std::string> reported;
+    ConfirmationCoalescer coalescer(CoalescerConfig{}, out.fn(),
+        [&](const Confirmation &c, uint64_t, bool ok) {
+            reported.push_back(c.message + (ok ? "+" : "-"));
+        });
+
+    coalescer.add(confirmationFor(9000, "a"), 0);
+    out.result = SendResult::WouldBlock;
+    coalescer.flush(0, true);
+    EXPECT_TRUE(coalescer.pending());
+    EXPECT_TRUE(reported.empty());
+
+    // Backs off before retrying
+    out.result = SendResult::Sent;
+    coalescer.flush(1, true);
+    EXPECT_TRUE(out.datagrams.empty());
+    coalescer.flush(coalescer.nextDeadlineNs(), true);
+    ASSERT_EQ(out.datagrams.size(), 1u);
+    EXPECT_EQ(out.datagrams[0].second, "a");
+
+    coalescer.add(confirmationFor(9000, "b"), 1000000);
+    out.result = SendResult::Failed;
+    coalescer.flush(1000000, true);
+    EXPECT_FALSE(coalescer.pending());
+    EXPECT_EQ(reported, (std::vector<std::string>{"a+", "b-"}));
+}
+
+TEST(ConfirmationCoalescerTest, RendersExecutionReports) {
+    CoalescerConfig config;
+    config.maxDatagramBytes = 200;
+    Capture out;
+    ConfirmationCoalescer coalescer(config, out.fn());
+
+    for (uint64_t id = 1; id <= 3; id++) {
+        Confirmation c = confirmationFor(9000, "");
+        c.report.orderId = id;
+        c.report.remainingQuantity = 5;
+        c.report.status = orderStatusCode(OrderStatus::Open);
+        coalescer.add(c, 0);
+    }
+    coalescer.flush(0, true);
+
+    // About 110 bytes each: one report per datagram, none split or lost
+    ASSERT_EQ(out.datagrams.size(), 3u);
+    for (size_t i = 0; i < 3; i++) {
+        std::string expected;
+        appendExecutionReportJson(expected, ExecutionReport{i + 1, 0, 5, 0.0, orderStatusCode(OrderStatus::Open)});
+        EXPECT_EQ(out.datagrams[i].second, expected);
+        EXPECT_NE(expected.find("\"status\":\"open\""), std::string::npos);
+    }
+}
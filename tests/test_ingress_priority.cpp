@@ -0,0 +1,104 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include "ingress_priority.hpp"
+
+namespace {
+
+bool priority(const char *text) {
+    return isPriorityMessage(text, std::strlen(text));
+}
+
+Order message(uint64_t sequence, uint64_t orderId, const char *type) {
+    Order o(orderId, type, "", 0.0, 0);
+    o.sequence = sequence;
+    return o;
+}
+
+} // namespace
+
+TEST(IngressPriorityTest, ClassifiesByTypeField) {
+    EXPECT_TRUE(priority(R"({"order_id":"9","type":"cancel"})"));
+    EXPECT_TRUE(priority(R"({"order_id":"9","price":"10.5","quantity":"3","type":"replace"})"));
+    EXPECT_TRUE(priority(R"({ "type" : "kill", "owner_id": "4" })"));
+
+    EXPECT_FALSE(priority(R"({"order_id":"9","type":"limit","action":"buy"})"));
+    EXPECT_FALSE(priority(R"({"order_id":"9","type":"cancels"})"));
+    EXPECT_FALSE(priority(R"({"note":"type","type":"market"})"));
+    EXPECT_FALSE(priority(R"({"order_id":"9"})"));
+    EXPECT_FALSE(priority(R"({"type":"cancel)"));
+}
+
+TEST(IngressPriorityTest, OnlyNewOrdersAreShed) {
+    LoadShedConfig off;
+    EXPECT_FALSE(off.shedOnArrival(OrderKind::Limit, 1000000));
+    EXPECT_FALSE(off.shedOnSojourn(OrderKind::Limit, 1000000000));
+
+    LoadShedConfig config;
+    config.maxQueuedMessages = 100;
+    config.maxSojournNs = 50000;
+    EXPECT_FALSE(config.shedOnArrival(OrderKind::Limit, 99));
+    EXPECT_TRUE(config.shedOnArrival(OrderKind::Limit, 100));
+    EXPECT_TRUE(config.shedOnSojourn(OrderKind::Market, 50001));
+    EXPECT_FALSE(config.shedOnSojourn(OrderKind::Market, 50000));
+    for (OrderKind kind : {OrderKind::Cancel, OrderKind::Replace, OrderKind::Kill, OrderKind::Query}) {
+        EXPECT_FALSE(config.shedOnArrival(kind, 1000));
+        EXPECT_FALSE(config.shedOnSojourn(kind, 1000000));
+    }
+}
+
+TEST(IngressPriorityTest, EarlyCopyReplacesTheInSequenceOne) {
+    EarlyApplyLedger ledger(8);
+    ledger.takeInSequence(message(0, 1, "limit"));
+
+    Order cancel = message(3, 1, "cancel");
+    ASSERT_TRUE(ledger.mayApplyEarly(cancel));
+    ledger.markApplied(cancel);
+
+    EXPECT_FALSE(ledger.takeInSequence(message(1, 2, "limit")));
+    EXPECT_FALSE(ledger.takeInSequence(message(2, 3, "limit")));
+    EXPECT_TRUE(ledger.takeInSequence(cancel));
+    // The mark is gone once consumed, so the slot can be reused
+    EXPECT_FALSE(ledger.takeInSequence(message(11, 4, "limit")));
+    EXPECT_EQ(ledger.nextSequence(), 12u);
+}
+
+TEST(IngressPriorityTest, DeferredOrderKeepsLaterMessagesInSequence) {
+    EarlyApplyLedger ledger(8);
+
+    // The cancel's order has not rested yet: it waits, and so does the
+    // replace behind it, or the two would swap
+    Order cancel = message(2, 1, "cancel");
+    ASSERT_TRUE(ledger.mayApplyEarly(cancel));
+    ledger.defer(cancel);
+    Order replace = message(4, 1, "replace");
+    EXPECT_FALSE(ledger.mayApplyEarly(replace));
+    ledger.defer(replace);
+    EXPECT_TRUE(ledger.mayApplyEarly(message(5, 2, "cancel")));
+
+    // Kills act on owners, not on the order their id names
+    Order kill = message(6, 1, "kill");
+    EXPECT_TRUE(ledger.mayApplyEarly(kill));
+    ledger.defer(kill);
+
+    for (uint64_t seq = 0; seq < 4; seq++) {
+        EXPECT_FALSE(ledger.takeInSequence(seq == 2 ? cancel : message(seq, 10 + seq, "limit")));
+    }
+    EXPECT_EQ(ledger.deferredOrders(), 1u);
+    EXPECT_FALSE(ledger.takeInSequence(replace));
+    EXPECT_EQ(ledger.deferredOrders(), 0u);
+    EXPECT_TRUE(ledger.mayApplyEarly(message(7, 1, "cancel")));
+}
+
+TEST(IngressPriorityTest, StaleOrFarAheadCopiesWait) {
+    EarlyApplyLedger ledger(4);
+    for (uint64_t seq = 0; seq < 3; seq++) {
+        ledger.takeInSequence(message(seq, seq, "limit"));
+    }
+    Order stale = message(1, 1, "cancel");
+    EXPECT_FALSE(ledger.mayApplyEarly(stale));
+    ledger.defer(stale);
+    EXPECT_EQ(ledger.deferredOrders(), 0u);
+
+    EXPECT_TRUE(ledger.mayApplyEarly(message(6, 1, "cancel")));
+    EXPECT_FALSE(ledger.mayApplyEarly(message(7, 1, "cancel")));
+}
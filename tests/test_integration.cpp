@@ -92,3 +92,189 @@ TEST(IntegrationTest, FOKOrder) {
     // The FOK cannot fill fully -> kill
     EXPECT_EQ(ob.ordersProcessed(), (uint64_t)2);
 }
+
+TEST(IntegrationTest, DepthSnapshotAfterSweep) {
+    OrderBook ob;
+    for (uint64_t i = 0; i < 5; i++) {
+        Order s(50 + i, "limit", "sell", 50.0 + i, 10);
+        s.recvTimestamp = std::chrono::high_resolution_clock::now();
+        ob.processOrder(s);
+    }
+
+    // Market buy for 25 sweeps two levels and half of the third
+    Order b(60, "market", "buy", 0.0, 25);
+    b.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(b);
+    EXPECT_EQ(b.remainingQuantity, 0u);
+    EXPECT_EQ(b.status, OrderStatus::Executed);
+
+    auto asks = ob.askDepth(2);
+    ASSERT_EQ(asks.size(), 2u);
+    EXPECT_DOUBLE_EQ(asks[0].price, 52.0);
+    EXPECT_EQ(asks[0].quantity, 5u);
+    EXPECT_EQ(asks[1].cumulativeQuantity, 15u);
+    EXPECT_TRUE(ob.bidDepth(5).empty());
+}
+
+TEST(IntegrationTest, FOKFillsAcrossLevels) {
+    OrderBook ob;
+    Order s1(70, "limit", "sell", 50.0, 10);
+    Order s2(71, "limit", "sell", 51.0, 10);
+    s1.recvTimestamp = s2.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(s1);
+    ob.processOrder(s2);
+
+    // 51.0 limit reaches both levels, which together hold exactly 20
+    Order b(72, "fok", "buy", 51.0, 20);
+    b.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(b);
+    EXPECT_EQ(b.remainingQuantity, 0u);
+    EXPECT_TRUE(ob.askDepth(5).empty());
+}
+
+TEST(IntegrationTest, IOCPartialFillReportsRemainder) {
+    OrderBook ob;
+    Order s1(80, "limit", "sell", 50.0, 10);
+    s1.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(s1);
+
+    Order b1(81, "ioc", "buy", 50.0, 25);
+    b1.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(b1);
+
+    // 10 fill, 15 are cancelled rather than resting
+    EXPECT_EQ(b1.filledQuantity, 10u);
+    EXPECT_EQ(b1.remainingQuantity, 15u);
+    EXPECT_EQ(b1.status, OrderStatus::PartiallyFilled);
+    EXPECT_EQ(ob.bidOrderCount(), 0u);
+
+    Order b2(82, "ioc", "buy", 50.0, 5);
+    b2.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(b2);
+    EXPECT_EQ(b2.status, OrderStatus::IocNoFill);
+}
+
+TEST(IntegrationTest, PostOnlyRejectsWhenCrossing) {
+    OrderBook ob;
+    Order s1(90, "limit", "sell", 50.0, 10);
+    s1.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(s1);
+
+    Order crossing(91, "post-only", "buy", 50.0, 5);
+    crossing.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(crossing);
+    EXPECT_EQ(crossing.status, OrderStatus::PostOnlyRejected);
+    EXPECT_EQ(ob.askOrderCount(), 1u);
+
+    Order passive(92, "post-only", "buy", 49.0, 5);
+    passive.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(passive);
+    EXPECT_EQ(passive.status, OrderStatus::Open);
+    EXPECT_EQ(ob.bidOrderCount(), 1u);
+}
+
+TEST(IntegrationTest, UnknownTypeRejected) {
+    OrderBook ob;
+    Order o(95, "iceberg?", "buy", 50.0, 5);
+    o.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(o);
+    EXPECT_EQ(o.status, OrderStatus::Rejected);
+
+    Order noSide(96, "limit", "", 50.0, 5);
+    noSide.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(noSide);
+    EXPECT_EQ(noSide.status, OrderStatus::Rejected);
+}
+
+TEST(IntegrationTest, CancelRemovesRestingOrder) {
+    OrderBook ob;
+    Order s1(100, "limit", "sell", 50.0, 10);
+    s1.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(s1);
+
+    Order c(100, "cancel", "sell", 0.0, 0);
+    c.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(c);
+    EXPECT_EQ(c.status, OrderStatus::Cancelled);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+
+    Order again(100, "cancel", "sell", 0.0, 0);
+    again.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(again);
+    EXPECT_EQ(again.status, OrderStatus::CancelRejected);
+}
+
+TEST(IntegrationTest, IcebergReplenishesBehindNewerOrders) {
+    OrderBook ob;
+    // Iceberg of 30 showing 10, then a plain order at the same price
+    Order ice(110, "limit", "sell", 50.0, 30);
+    ice.displayQuantity = 10;
+    ice.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(ice);
+    Order plain(111, "limit", "sell", 50.0, 5);
+    plain.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(plain);
+
+    // Only the displayed slice counts towards the level
+    EXPECT_EQ(ob.askDepth(1)[0].quantity, 15u);
+
+    // Takes the iceberg's slice; it refills behind the plain order
+    Order b1(112, "limit", "buy", 50.0, 10);
+    b1.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(b1);
+    EXPECT_EQ(ob.askDepth(1)[0].quantity, 15u);
+
+    // Next 5 hit the plain order first, then 5 of the refreshed slice
+    Order b2(113, "limit", "buy", 50.0, 10);
+    b2.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(b2);
+    EXPECT_EQ(b2.filledQuantity, 10u);
+    EXPECT_EQ(ob.askOrderCount(), 1u);
+    EXPECT_EQ(ob.askDepth(1)[0].quantity, 5u);
+}
+
+TEST(IntegrationTest, PostOnlyReprice) {
+    OrderBook ob;
+    ob.setPostOnlyMode(PostOnlyMode::Reprice);
+    ob.setTickSize(0.5);
+    Order s1(120, "limit", "sell", 50.0, 10);
+    s1.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(s1);
+
+    Order p(121, "post-only", "buy", 51.0, 5);
+    p.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(p);
+    EXPECT_EQ(p.status, OrderStatus::Repriced);
+    EXPECT_DOUBLE_EQ(p.price, 49.5);
+    EXPECT_EQ(p.filledQuantity, 0u);
+    ASSERT_EQ(ob.bidDepth(1).size(), 1u);
+    EXPECT_DOUBLE_EQ(ob.bidDepth(1)[0].price, 49.5);
+}
+
+TEST(IntegrationTest, GoodTillDateExpiry) {
+    OrderBook ob;
+    uint64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    Order gtd(130, "limit", "buy", 50.0, 10);
+    gtd.expireTimeMs = nowMs + 60000;
+    gtd.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(gtd);
+    EXPECT_EQ(ob.bidOrderCount(), 1u);
+
+    EXPECT_TRUE(ob.expireOrders(nowMs + 59999).empty());
+    auto expired = ob.expireOrders(nowMs + 60000);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0].orderId, 130u);
+    EXPECT_EQ(expired[0].status, OrderStatus::Expired);
+    EXPECT_EQ(expired[0].remainingQuantity, 10u);
+    EXPECT_EQ(ob.bidOrderCount(), 0u);
+
+    // Already past its date on arrival
+    Order stale(131, "limit", "buy", 50.0, 10);
+    stale.expireTimeMs = nowMs - 1;
+    stale.recvTimestamp = std::chrono::high_resolution_clock::now();
+    ob.processOrder(stale);
+    EXPECT_EQ(stale.status, OrderStatus::Expired);
+    EXPECT_EQ(ob.bidOrderCount(), 0u);
+}
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "ipc_transport.hpp"
+#include "orderbook.hpp"
+
+namespace {
+
+std::string segmentName(const std::string &test) {
+    return "orderbook_ipc_test_" + test + "_" + std::to_string(getpid());
+}
+
+IpcOrder makeIpcOrder(uint64_t id, const std::string &type, const std::string &action,
+                      double price, uint64_t qty, uint64_t userData = 0) {
+    return toIpcOrder(Order(id, type, action, price, qty), userData);
+}
+
+} // namespace
+
+TEST(IpcTransportTest, OrderRecordRoundTrip) {
+    Order o(42, "stop-loss", "sell", 99.5, 7);
+    o.classify();
+    o.stopPrice = 98.25;
+    o.ownerId = 9;
+    o.displayQuantity = 3;
+    o.expireTimeMs = 123456;
+
+    IpcOrder msg = toIpcOrder(o, 77);
+    EXPECT_EQ(msg.userData, 77u);
+    Order back = fromIpcOrder(msg);
+    EXPECT_EQ(back.orderId, 42u);
+    EXPECT_EQ(back.type, "stop-loss");
+    EXPECT_EQ(back.action, "sell");
+    EXPECT_EQ(back.kind, OrderKind::StopLoss);
+    EXPECT_EQ(back.side, Side::Sell);
+    EXPECT_TRUE(back.isStopOrder);
+    EXPECT_DOUBLE_EQ(back.price, 99.5);
+    EXPECT_DOUBLE_EQ(back.stopPrice, 98.25);
+    EXPECT_EQ(back.quantity, 7u);
+    EXPECT_EQ(back.remainingQuantity, 7u);
+    EXPECT_EQ(back.ownerId, 9u);
+    EXPECT_EQ(back.displayQuantity, 3u);
+    EXPECT_EQ(back.expireTimeMs, 123456u);
+}
+
+TEST(IpcTransportTest, OrderInReportOut) {
+    IpcServer server(segmentName("basic"), 2);
+    ASSERT_TRUE(server.isOpen());
+
+    IpcClient client;
+    ASSERT_TRUE(client.attach(segmentName("basic")));
+    ASSERT_TRUE(client.submit(makeIpcOrder(1, "limit", "buy", 10.0, 5, 555)));
+
+    uint32_t token = 0;
+    IpcOrder received{};
+    size_t handled = server.poll([&](uint32_t c, const IpcOrder &msg) {
+        token = c;
+        received = msg;
+    });
+    ASSERT_EQ(handled, 1u);
+    EXPECT_NE(token, 0u);
+    EXPECT_EQ(received.orderId, 1u);
+    EXPECT_EQ(received.kind, OrderKind::Limit);
+    EXPECT_EQ(server.attachedClients(), 1u);
+
+    Order o = fromIpcOrder(received);
+    o.status = OrderStatus::Executed;
+    o.remainingQuantity = 0;
+    ASSERT_TRUE(server.sendReport(token, toIpcReport(o, 5, 10.0, received.userData)));
+
+    IpcReport report;
+    ASSERT_TRUE(client.poll(report));
+    EXPECT_EQ(report.orderId, 1u);
+    EXPECT_EQ(report.filledQuantity, 5u);
+    EXPECT_EQ(report.remainingQuantity, 0u);
+    EXPECT_EQ(report.userData, 555u);
+    EXPECT_STREQ(orderStatusName(report.status), "executed");
+    EXPECT_FALSE(client.poll(report));
+}
+
+TEST(IpcTransportTest, DetachedSlotIsReclaimedAndStaleReportsDiscarded) {
+    IpcServer server(segmentName("reclaim"), 1);
+    ASSERT_TRUE(server.isOpen());
+
+    IpcClient first;
+    ASSERT_TRUE(first.attach(segmentName("reclaim")));
+    IpcClient second;
+    EXPECT_FALSE(second.attach(segmentName("reclaim")));  // only one slot
+
+    ASSERT_TRUE(first.submit(makeIpcOrder(1, "limit", "buy", 10.0, 5)));
+    uint32_t oldToken = 0;
+    server.poll([&](uint32_t c, const IpcOrder &) { oldToken = c; });
+    ASSERT_NE(oldToken, 0u);
+
+    first.detach();
+    server.reap();
+    EXPECT_EQ(server.attachedClients(), 0u);
+
+    ASSERT_TRUE(second.attach(segmentName("reclaim")));
+    ASSERT_TRUE(second.submit(makeIpcOrder(2, "limit", "buy", 10.0, 5)));
+    uint32_t newToken = 0;
+    server.poll([&](uint32_t c, const IpcOrder &) { newToken = c; });
+    EXPECT_NE(newToken, oldToken);
+
+    // A report for the first client's resting order must not reach the second
+    Order o(1, "limit", "buy", 10.0, 5);
+    o.status = OrderStatus::Expired;
+    EXPECT_FALSE(server.sendReport(oldToken, toIpcReport(o, 0, 0.0)));
+    IpcReport report;
+    EXPECT_FALSE(second.poll(report));
+}
+
+TEST(IpcTransportTest, FullReportRingDropsAndCounts) {
+    IpcServer server(segmentName("full"), 1);
+    IpcClient client;
+    ASSERT_TRUE(client.attach(segmentName("full")));
+    ASSERT_TRUE(client.submit(makeIpcOrder(1, "limit", "buy", 10.0, 5)));
+    uint32_t token = 0;
+    server.poll([&](uint32_t c, const IpcOrder &) { token = c; });
+
+    Order o(1, "limit", "buy", 10.0, 5);
+    IpcReport r = toIpcReport(o, 0, 0.0);
+    for (size_t i = 0; i < kIpcReportCapacity; i++) {
+        ASSERT_TRUE(server.sendReport(token, r));
+    }
+    EXPECT_FALSE(server.sendReport(token, r));
+    EXPECT_EQ(server.reportsDropped(), 1u);
+    EXPECT_EQ(client.reportsDropped(), 1u);
+}
+
+TEST(IpcTransportTest, ConcurrentRoundTripsAgainstBook) {
+    constexpr uint64_t kOrders = 20000;
+    IpcServer server(segmentName("book"), 4);
+    ASSERT_TRUE(server.isOpen());
+    OrderBook book;
+
+    std::atomic<bool> running{true};
+    std::thread poller([&] {
+        while (running.load()) {
+            server.poll([&](uint32_t client, const IpcOrder &msg) {
+                Order o = fromIpcOrder(msg);
+                o.ipcClient = client;
+                book.processOrder(o);
+                double avgPrice = (o.filledQuantity > 0) ? o.price : 0.0;
+                server.sendReport(client, toIpcReport(o, o.filledQuantity, avgPrice, msg.userData));
+            });
+        }
+    });
+
+    IpcClient client;
+    ASSERT_TRUE(client.attach(segmentName("book")));
+    uint64_t sent = 0, received = 0, filled = 0;
+    IpcReport report;
+    while (received < kOrders) {
+        if (sent < kOrders) {
+            const char *action = (sent % 2 == 0) ? "buy" : "sell";
+            if (client.submit(makeIpcOrder(sent + 1, "limit", action, 10.0, 1, sent))) {
+                sent++;
+            }
+        }
+        while (client.poll(report)) {
+            EXPECT_EQ(report.userData + 1, report.orderId);  // echoed, in order
+            EXPECT_EQ(report.userData, received);
+            filled += report.filledQuantity;
+            received++;
+        }
+    }
+    running.store(false);
+    poller.join();
+
+    // Alternating buys and sells at one price: every sell fills a buy
+    EXPECT_EQ(filled, kOrders / 2);
+    EXPECT_EQ(book.bidOrderCount() + book.askOrderCount(), 0u);
+    EXPECT_EQ(server.ordersReceived(), kOrders);
+    EXPECT_EQ(server.reportsDropped(), 0u);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <list>
+#include <unistd.h>
+#include "memory_plan.hpp"
+#include "orderbook.hpp"
+#include "price_ladder.hpp"
+
+TEST(MemoryPlanTest, ParsesHugePagePolicy) {
+    HugePages policy = HugePages::Off;
+    EXPECT_TRUE(parseHugePages("2m", policy));
+    EXPECT_EQ(policy, HugePages::Huge2M);
+    EXPECT_TRUE(parseHugePages("1g", policy));
+    EXPECT_EQ(policy, HugePages::Huge1G);
+    EXPECT_TRUE(parseHugePages("auto", policy));
+    EXPECT_EQ(policy, HugePages::Auto);
+    EXPECT_FALSE(parseHugePages("4k", policy));
+}
+
+TEST(MemoryPlanTest, ArenaHandsOutAlignedBlocksUntilFull) {
+    MemoryArena arena;
+    ASSERT_TRUE(arena.reserve(10000, HugePages::Off));
+    EXPECT_GE(arena.capacity(), 10000u);
+    EXPECT_EQ(arena.pageSize(), static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+    EXPECT_FALSE(arena.reserve(10000, HugePages::Off));  // once only
+
+    void *a = arena.allocate(10);
+    void *b = arena.allocate(10);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % kCacheLineSize, 0u);
+    EXPECT_TRUE(arena.contains(a));
+    EXPECT_FALSE(arena.contains(&arena));
+    EXPECT_EQ(arena.allocate(arena.capacity()), nullptr);
+}
+
+TEST(MemoryPlanTest, HugePagePolicyFallsBack) {
+    // Without reserved huge pages this still maps, on regular pages
+    MemoryArena arena;
+    ASSERT_TRUE(arena.reserve(4096, HugePages::Huge1G));
+    EXPECT_GE(arena.capacity(), 4096u);
+    EXPECT_NE(arena.allocate(4096), nullptr);
+}
+
+TEST(MemoryPlanTest, PoolRecyclesBlocksAndCountsOverflow) {
+    MemoryArena arena;
+    ASSERT_TRUE(arena.reserve(1 << 20, HugePages::Off));
+    NodePool pool(&arena);
+
+    void *a = pool.allocate(40);
+    pool.deallocate(a, 40);
+    EXPECT_EQ(pool.allocate(40), a);
+    EXPECT_EQ(pool.blocksInUse(), 1u);
+
+    // Blocks too big for a size class come from the heap
+    void *big = pool.allocate(4096);
+    EXPECT_FALSE(arena.contains(big));
+    EXPECT_EQ(pool.heapFallbacks(), 1u);
+    pool.deallocate(big, 4096);
+    pool.deallocate(a, 40);
+    EXPECT_EQ(pool.blocksInUse(), 0u);
+}
+
+TEST(MemoryPlanTest, PoolWithoutArenaUsesTheHeap) {
+    NodePool pool(nullptr);
+    std::list<int, PoolAllocator<int>> values{PoolAllocator<int>(&pool)};
+    for (int i = 0; i < 100; i++) {
+        values.push_back(i);
+    }
+    EXPECT_EQ(pool.heapFallbacks(), 100u);
+    EXPECT_EQ(values.back(), 99);
+}
+
+TEST(MemoryPlanTest, LadderNodesComeFromThePool) {
+    MemoryArena arena;
+    ASSERT_TRUE(arena.reserve(1 << 20, HugePages::Off));
+    NodePool pool(&arena);
+    PriceLadder bids(true);
+    bids.reserve(16, 100, &pool);
+
+    for (uint64_t i = 1; i <= 50; i++) {
+        bids.add(Order(i, "limit", "buy", 100.0 - static_cast<double>(i % 5), 10));
+    }
+    EXPECT_EQ(bids.orderCount(), 50u);
+    // A queue node and an index node each, and a map node for each of the
+    // four levels too far from the touch for the window
+    EXPECT_EQ(bids.windowLevelCount(), 1u);
+    EXPECT_EQ(pool.blocksInUse(), 104u);
+    EXPECT_EQ(pool.heapFallbacks(), 0u);
+    EXPECT_DOUBLE_EQ(bids.bestPrice(), 100.0);
+
+    Order removed;
+    ASSERT_TRUE(bids.remove(25, &removed));
+    EXPECT_EQ(removed.orderId, 25u);
+    while (!bids.empty()) {
+        bids.cancelFront();
+    }
+    EXPECT_EQ(pool.blocksInUse(), 0u);
+}
+
+TEST(MemoryPlanTest, BookReservesAndReportsUsage) {
+    OrderBook ob;
+    MemoryPlan plan;
+    plan.orders = 1000;
+    plan.levels = 64;
+    plan.hugePages = HugePages::Off;
+    ASSERT_TRUE(ob.reserveMemory(plan));
+
+    for (uint64_t i = 1; i <= 20; i++) {
+        Order o(i, "limit", (i % 2) ? "buy" : "sell", (i % 2) ? 99.0 : 101.0, 5);
+        ob.processOrder(o);
+    }
+    Order cross(100, "limit", "buy", 101.0, 5);
+    ob.processOrder(cross);
+    EXPECT_EQ(cross.status, OrderStatus::Executed);
+
+    MemoryUsage usage = ob.memoryUsage();
+    EXPECT_GT(usage.arenaBytes, 1000 * sizeof(Order));
+    EXPECT_GT(usage.arenaUsedBytes, 0u);
+    EXPECT_EQ(usage.nodesInUse, 2 * (ob.bidOrderCount() + ob.askOrderCount()));
+    EXPECT_EQ(usage.heapFallbacks, 0u);
+}
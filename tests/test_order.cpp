@@ -1,3 +1,4 @@
+#include <cstring>
 #include <gtest/gtest.h>
 #include "order.hpp"
 
@@ -10,7 +11,9 @@ TEST(OrderTest, DefaultConstructor) {
     EXPECT_DOUBLE_EQ(o.price, 0.0);
     EXPECT_EQ(o.quantity, 0u);
     EXPECT_EQ(o.remainingQuantity, 0u);
-    EXPECT_EQ(o.status, "open");
+    EXPECT_EQ(o.filledQuantity, 0u);
+    EXPECT_EQ(o.ownerId, 0u);
+    EXPECT_EQ(o.status, OrderStatus::Open);
     EXPECT_FALSE(o.isStopOrder);
     EXPECT_DOUBLE_EQ(o.stopPrice, 0.0);
 }
@@ -23,7 +26,7 @@ TEST(OrderTest, ParamConstructor) {
     EXPECT_DOUBLE_EQ(o.price, 45.67);
     EXPECT_EQ(o.quantity, 100u);
     EXPECT_EQ(o.remainingQuantity, 100u);
-    EXPECT_EQ(o.status, "open");
+    EXPECT_EQ(o.status, OrderStatus::Open);
     EXPECT_FALSE(o.isStopOrder);
 }
 
@@ -35,3 +38,28 @@ TEST(OrderTest, isBuySell) {
     EXPECT_FALSE(sellOrder.isBuy());
     EXPECT_TRUE(sellOrder.isSell());
 }
+
+TEST(OrderTest, ClassifyKindAndSide) {
+    Order o(1, "post-only", "sell", 10.0, 5);
+    EXPECT_EQ(o.kind, OrderKind::PostOnly);
+    EXPECT_EQ(o.side, Side::Sell);
+
+    o.type = "bogus";
+    o.action = "hold";
+    o.classify();
+    EXPECT_EQ(o.kind, OrderKind::Unknown);
+    EXPECT_EQ(o.side, Side::Unknown);
+    EXPECT_FALSE(o.isBuy());
+    EXPECT_FALSE(o.isSell());
+}
+
+TEST(OrderTest, StatusCodesRoundTrip) {
+    for (const char *status : {"open", "executed", "partially_filled", "cancelled", "expired", "rejected"}) {
+        uint8_t code = orderStatusCode(status, std::strlen(status));
+        EXPECT_NE(code, 0u);
+        EXPECT_STREQ(orderStatusName(code), status);
+    }
+    EXPECT_EQ(orderStatusCode("no_such_status", 14), 0u);
+    EXPECT_STREQ(orderStatusName(OrderStatus::PostOnlyRejected), "post_only_rejected");
+    EXPECT_STREQ(orderStatusName(255), "other");
+}
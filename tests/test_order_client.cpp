@@ -0,0 +1,324 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "order_client.hpp"
+#include "order_codec.hpp"
+#include "orderbook.hpp"
+
+namespace {
+
+// A UDP socket on loopback standing in for the server
+struct FakeServer {
+    int sock = -1;
+    int port = 0;
+    sockaddr_in client;
+
+    FakeServer() {
+        sock = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+        timeval timeout{2, 0};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    ~FakeServer() { close(sock); }
+
+    // One datagram, split into its lines
+    std::vector<std::string> receive() {
+        char buffer[4096];
+        socklen_t len = sizeof(client);
+        ssize_t n = recvfrom(sock, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&client), &len);
+        std::vector<std::string> lines;
+        std::string text(buffer, n > 0 ? static_cast<size_t>(n) : 0);
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t stop = text.find('\n', start);
+            if (stop == std::string::npos) stop = text.size();
+            lines.push_back(text.substr(start, stop - start));
+            start = stop + 1;
+        }
+        return lines;
+    }
+
+    void reply(const std::vector<ExecutionReport> &reports, const std::string &extra = "") {
+        std::string text = extra;
+        for (const ExecutionReport &r : reports) {
+            if (!text.empty()) text += '\n';
+            appendExecutionReportJson(text, r);
+        }
+        sendto(sock, text.data(), text.size(), 0, reinterpret_cast<sockaddr*>(&client), sizeof(client));
+    }
+};
+
+ExecutionReport report(uint64_t id, OrderStatus status, uint64_t filled, uint64_t remaining, double avg = 0.0) {
+    ExecutionReport r;
+    r.orderId = id;
+    r.status = orderStatusCode(status);
+    r.filledQuantity = filled;
+    r.remainingQuantity = remaining;
+    r.averagePrice = avg;
+    return r;
+}
+
+// Polls until count reports arrive or a second passes
+std::vector<ClientReport> collect(OrderClient &client, size_t count) {
+    std::vector<ClientReport> out;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (out.size() < count && std::chrono::steady_clock::now() < deadline) {
+        if (client.pollAll([&](const ClientReport &r) { out.push_back(r); }) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return out;
+}
+
+OrderRequest limit(Side side, double price, uint64_t qty) {
+    OrderRequest r;
+    r.side = side;
+    r.price = price;
+    r.quantity = qty;
+    return r;
+}
+
+} // namespace
+
+TEST(OrderClientTest, EncodingsDecodeOnTheServer) {
+    char line[512];
+    OrderRequest r;
+    r.kind = OrderKind::StopLoss;
+    r.side = Side::Sell;
+    r.price = 99.5;
+    r.stopPrice = 100.25;
+    r.quantity = 12;
+    r.expireTimeMs = 1700000000000ull;
+    size_t n = encodeSubmit(line, sizeof(line), 18446744073709551615ull, 7, r);
+    ASSERT_GT(n, 0u);
+
+    Order o;
+    std::string error;
+    ASSERT_TRUE(decodeOrderMessage(std::string(line, n), o, &error)) << error;
+    EXPECT_EQ(o.orderId, 18446744073709551615ull);
+    EXPECT_EQ(o.kind, OrderKind::StopLoss);
+    EXPECT_EQ(o.side, Side::Sell);
+    EXPECT_EQ(o.quantity, 12u);
+    EXPECT_EQ(o.ownerId, 7u);
+    EXPECT_EQ(o.expireTimeMs, 1700000000000ull);
+    EXPECT_DOUBLE_EQ(o.price, 99.5);
+    EXPECT_DOUBLE_EQ(o.stopPrice, 100.25);
+
+    n = encodeCancel(line, sizeof(line), 5);
+    EXPECT_EQ(std::string(line, n), R"({"order_id":"5","type":"cancel"})");
+
+    n = encodeReplace(line, sizeof(line), 5, 10.5, 3);
+    Order replace;
+    ASSERT_TRUE(decodeOrderMessage(std::string(line, n), replace));
+    EXPECT_EQ(replace.kind, OrderKind::Replace);
+    EXPECT_EQ(replace.quantity, 3u);
+
+    // Too small a buffer is refused rather than truncated
+    EXPECT_EQ(encodeSubmit(line, 20, 1, 0, r), 0u);
+}
+
+TEST(OrderClientTest, DecodesServerConfirmations) {
+    std::string json;
+    appendExecutionReportJson(json, report(42, OrderStatus::PartiallyFilled, 3, 7, 10.25));
+    ClientReport r;
+    ASSERT_TRUE(decodeReport(json.data(), json.size(), r));
+    EXPECT_EQ(r.orderId, 42u);
+    EXPECT_EQ(r.status, orderStatusCode(OrderStatus::PartiallyFilled));
+    EXPECT_EQ(r.filledQuantity, 3u);
+    EXPECT_EQ(r.remainingQuantity, 7u);
+    EXPECT_DOUBLE_EQ(r.averagePrice, 10.25);
+    EXPECT_FALSE(r.passive);
+
+    ExecutionReport fill = report(43, OrderStatus::Executed, 5, 0, 10.0);
+    fill.passive = true;
+    json.clear();
+    appendExecutionReportJson(json, fill);
+    ClientReport passive;
+    ASSERT_TRUE(decodeReport(json.data(), json.size(), passive));
+    EXPECT_TRUE(passive.passive);
+    EXPECT_EQ(passive.orderId, 43u);
+
+    const char *throttled = R"({"dropped_confirmations":"5","status":"throttled"})";
+    ClientReport other;
+    EXPECT_FALSE(decodeReport(throttled, std::strlen(throttled), other));
+}
+
+TEST(OrderClientTest, BatchesRequestsAndCorrelatesReports) {
+    FakeServer server;
+    OrderClientConfig config;
+    config.ownerId = 3;
+    config.firstHandle = 100;
+    OrderClient client(config);
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port));
+
+    RequestHandle a = client.submit(limit(Side::Buy, 10.0, 5));
+    RequestHandle b = client.submit(limit(Side::Sell, 11.0, 5));
+    RequestHandle c = client.submit(limit(Side::Buy, 9.0, 5));
+    EXPECT_EQ(a, 100u);
+    EXPECT_EQ(b, 101u);
+    EXPECT_EQ(c, 102u);
+    EXPECT_EQ(client.inFlight(), 3u);
+    EXPECT_GT(client.batchedBytes(), 0u);
+
+    // Nothing leaves until the flush, then all three in one datagram
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(client.batchedBytes(), 0u);
+    std::vector<std::string> lines = server.receive();
+    ASSERT_EQ(lines.size(), 3u);
+    Order decoded;
+    ASSERT_TRUE(decodeOrderMessage(lines[1], decoded));
+    EXPECT_EQ(decoded.orderId, b);
+    EXPECT_EQ(decoded.ownerId, 3u);
+
+    server.reply({report(a, OrderStatus::Open, 0, 5), report(b, OrderStatus::Open, 0, 5), report(c, OrderStatus::Open, 0, 5)},
+                 R"({"dropped_confirmations":"1","status":"throttled"})");
+    std::vector<ClientReport> reports = collect(client, 3);
+    ASSERT_EQ(reports.size(), 3u);
+    EXPECT_EQ(reports[0].request, a);
+    EXPECT_EQ(reports[0].requestType, RequestType::Submit);
+    EXPECT_FALSE(reports[0].done);
+    EXPECT_EQ(client.otherMessages(), 1u);
+    EXPECT_EQ(client.inFlight(), 3u);
+
+    // A cancel is answered only by its own outcome; an expiry while it is
+    // pending is unsolicited
+    RequestHandle cancel = client.cancel(a);
+    RequestHandle replace = client.replace(c, 9.5, 4);
+    EXPECT_EQ(cancel, 103u);
+    EXPECT_EQ(replace, 104u);
+    EXPECT_EQ(client.cancel(999), 0u);
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(server.receive().size(), 2u);
+
+    server.reply({report(a, OrderStatus::Expired, 0, 0), report(a, OrderStatus::CancelRejected, 0, 0),
+                  report(c, OrderStatus::Replaced, 0, 4), report(777, OrderStatus::Cancelled, 0, 0)});
+    reports = collect(client, 4);
+    ASSERT_EQ(reports.size(), 4u);
+    EXPECT_EQ(reports[0].request, 0u);
+    EXPECT_FALSE(reports[0].done);
+    EXPECT_EQ(reports[1].request, cancel);
+    EXPECT_EQ(reports[1].requestType, RequestType::Cancel);
+    EXPECT_TRUE(reports[1].done);
+    EXPECT_EQ(reports[2].request, replace);
+    EXPECT_EQ(reports[2].requestType, RequestType::Replace);
+    EXPECT_FALSE(reports[2].done);
+    EXPECT_TRUE(reports[3].done);
+    EXPECT_EQ(client.unknownReports(), 1u);
+
+    EXPECT_EQ(client.inFlight(), 2u);
+    EXPECT_EQ(client.find(a), nullptr);
+    ASSERT_NE(client.find(c), nullptr);
+    EXPECT_DOUBLE_EQ(client.find(c)->price, 9.5);
+    EXPECT_EQ(client.find(c)->remainingQuantity, 4u);
+}
+
+TEST(OrderClientTest, FullTableRefusesSubmits) {
+    FakeServer server;
+    OrderClientConfig config;
+    config.maxOrders = 2;
+    OrderClient client(config);
+    EXPECT_EQ(client.submit(limit(Side::Buy, 10.0, 5)), 0u);  // not connected
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port));
+
+    EXPECT_EQ(client.submit(limit(Side::Unknown, 10.0, 5)), 0u);
+    RequestHandle a = client.submit(limit(Side::Buy, 10.0, 5));
+    EXPECT_NE(a, 0u);
+    EXPECT_NE(client.submit(limit(Side::Buy, 10.0, 5)), 0u);
+    EXPECT_EQ(client.submit(limit(Side::Buy, 10.0, 5)), 0u);
+    ASSERT_TRUE(client.flush());
+    server.receive();
+
+    // A filled order is done once reported, freeing its slot
+    server.reply({report(a, OrderStatus::Executed, 5, 0, 10.0)});
+    ASSERT_EQ(collect(client, 1).size(), 1u);
+    EXPECT_EQ(client.inFlight(), 1u);
+    EXPECT_NE(client.submit(limit(Side::Buy, 10.0, 5)), 0u);
+}
+
+TEST(OrderClientTest, PassiveFillsReleaseRestingOrders) {
+    FakeServer server;
+    OrderClient client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port));
+    RequestHandle a = client.submit(limit(Side::Sell, 10.0, 5));
+    ASSERT_TRUE(client.flush());
+    server.receive();
+    server.reply({report(a, OrderStatus::Open, 0, 5)});
+    ASSERT_EQ(collect(client, 1).size(), 1u);
+
+    // A replace is pending, but fills while resting answer nothing
+    RequestHandle replace = client.replace(a, 10.5, 5);
+    ASSERT_TRUE(client.flush());
+    server.receive();
+    ExecutionReport partial = report(a, OrderStatus::PartiallyFilled, 2, 3, 10.0);
+    partial.passive = true;
+    ExecutionReport last = report(a, OrderStatus::Executed, 5, 0, 10.0);
+    last.passive = true;
+    server.reply({partial, report(a, OrderStatus::Replaced, 2, 3), last});
+    std::vector<ClientReport> reports = collect(client, 3);
+    ASSERT_EQ(reports.size(), 3u);
+    EXPECT_TRUE(reports[0].passive);
+    EXPECT_EQ(reports[0].request, 0u);
+    EXPECT_FALSE(reports[0].done);
+    EXPECT_EQ(reports[1].request, replace);
+    EXPECT_FALSE(reports[1].done);
+    EXPECT_TRUE(reports[2].passive);
+    EXPECT_TRUE(reports[2].done);
+    EXPECT_EQ(client.inFlight(), 0u);
+}
+
+TEST(OrderClientTest, TableSurvivesChurn) {
+    // Submit, answer and drop orders in an interleaved pattern, so erasing
+    // has to repair probe runs
+    FakeServer server;
+    OrderClientConfig config;
+    config.maxOrders = 64;
+    OrderClient client(config);
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port));
+
+    std::vector<RequestHandle> live;
+    for (int round = 0; round < 20; round++) {
+        std::vector<ExecutionReport> answers;
+        for (int i = 0; i < 30; i++) {
+            RequestHandle h = client.submit(limit(Side::Sell, 10.0, 1));
+            ASSERT_NE(h, 0u);
+            answers.push_back(report(h, (i % 3 == 0) ? OrderStatus::Open : OrderStatus::Executed, 0, 1));
+            if (i % 3 == 0) live.push_back(h);
+        }
+        ASSERT_TRUE(client.flush());
+        server.receive();
+        server.reply(answers);
+        ASSERT_EQ(collect(client, answers.size()).size(), answers.size());
+        ASSERT_EQ(client.inFlight(), live.size());
+        for (RequestHandle h : live) {
+            ASSERT_NE(client.find(h), nullptr) << h;
+        }
+        // Cancel the older half of what rests
+        std::vector<ExecutionReport> cancels;
+        size_t half = live.size() / 2;
+        for (size_t i = 0; i < half; i++) {
+            ASSERT_NE(client.cancel(live[i]), 0u);
+            cancels.push_back(report(live[i], OrderStatus::Cancelled, 0, 0));
+        }
+        ASSERT_TRUE(client.flush());
+        server.receive();
+        server.reply(cancels);
+        ASSERT_EQ(collect(client, cancels.size()).size(), cancels.size());
+        live.erase(live.begin(), live.begin() + half);
+    }
+    EXPECT_EQ(client.inFlight(), live.size());
+    EXPECT_EQ(client.unknownReports(), 0u);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "order_codec.hpp"
+
+TEST(OrderCodecTest, DecodesLimitOrder) {
+    Order o;
+    std::string error;
+    ASSERT_TRUE(decodeOrderMessage(
+        R"({"order_id":"17","type":"limit","action":"sell","quantity":"25","price":"101.5","owner_id":"3"})",
+        o, &error)) << error;
+    EXPECT_EQ(o.orderId, 17u);
+    EXPECT_EQ(o.kind, OrderKind::Limit);
+    EXPECT_EQ(o.side, Side::Sell);
+    EXPECT_EQ(o.quantity, 25u);
+    EXPECT_EQ(o.remainingQuantity, 25u);
+    EXPECT_DOUBLE_EQ(o.price, 101.5);
+    EXPECT_EQ(o.ownerId, 3u);
+}
+
+TEST(OrderCodecTest, CancelNeedsOnlyId) {
+    Order o;
+    EXPECT_TRUE(decodeOrderMessage(R"({"order_id":"9","type":"cancel"})", o));
+    EXPECT_EQ(o.kind, OrderKind::Cancel);
+}
+
+TEST(OrderCodecTest, ReplaceNeedsPriceAndQuantity) {
+    Order o;
+    EXPECT_TRUE(decodeOrderMessage(R"({"order_id":"9","price":"10.5","quantity":"3","type":"replace"})", o));
+    EXPECT_EQ(o.kind, OrderKind::Replace);
+    EXPECT_EQ(o.quantity, 3u);
+    EXPECT_DOUBLE_EQ(o.price, 10.5);
+
+    Order noPrice;
+    EXPECT_FALSE(decodeOrderMessage(R"({"order_id":"9","quantity":"3","type":"replace"})", noPrice));
+    EXPECT_EQ(noPrice.status, OrderStatus::Rejected);
+}
+
+TEST(OrderCodecTest, KillNeedsAnOwner) {
+    Order o;
+    EXPECT_TRUE(decodeOrderMessage(R"({"order_id":"5","owner_id":"12","type":"kill"})", o));
+    EXPECT_EQ(o.kind, OrderKind::Kill);
+    EXPECT_EQ(o.ownerId, 12u);
+
+    Order untagged;
+    EXPECT_FALSE(decodeOrderMessage(R"({"order_id":"5","owner_id":"0","type":"kill"})", untagged));
+    Order missing;
+    EXPECT_FALSE(decodeOrderMessage(R"({"order_id":"5","type":"kill"})", missing));
+}
+
+TEST(OrderCodecTest, MalformedNumbersAreRejectedNotThrown) {
+    const char *messages[] = {
+        R"({"order_id":"abc","type":"limit","action":"buy","quantity":"5","price":"10"})",
+        R"({"order_id":"1","type":"limit","action":"buy","quantity":"-5","price":"10"})",
+        R"({"order_id":"1","type":"limit","action":"buy","quantity":"5x","price":"10"})",
+        R"({"order_id":"1","type":"limit","action":"buy","quantity":"0","price":"10"})",
+        R"({"order_id":"1","type":"limit","action":"buy","quantity":"5","price":"nan"})",
+        R"({"order_id":"1","type":"limit","action":"buy","quantity":"5"})",
+        R"({"order_id":"1","type":"limit","action":"hold","quantity":"5","price":"10"})",
+        R"({"order_id":"1","type":"swap","action":"buy","quantity":"5","price":"10"})",
+        R"({"order_id":"1","type":"stop-loss","action":"buy","quantity":"5","price":"10"})",
+        R"({"order_id":"1","type":"market","action":"buy","quantity":"5","owner_id":"99999999999"})",
+        "garbage",
+    };
+    for (const char *msg : messages) {
+        Order o;
+        std::string error;
+        EXPECT_NO_THROW(EXPECT_FALSE(decodeOrderMessage(msg, o, &error)) << msg);
+        EXPECT_EQ(o.kind, OrderKind::Unknown) << msg;
+        EXPECT_EQ(o.status, OrderStatus::Rejected) << msg;
+        EXPECT_FALSE(error.empty()) << msg;
+    }
+}
+
+TEST(OrderCodecTest, PricesFromTheMaximumAreRejected) {
+    Order o;
+    std::string error;
+    EXPECT_FALSE(decodeOrderMessage(
+        R"({"order_id":"1","type":"limit","action":"sell","quantity":"5","price":"1e13"})", o, &error));
+    EXPECT_EQ(error, "invalid price");
+
+    Order stop;
+    EXPECT_FALSE(decodeOrderMessage(
+        R"({"order_id":"2","type":"stop-loss","action":"buy","quantity":"5","stop_price":"1e9"})", stop, &error));
+    EXPECT_EQ(error, "missing or invalid stop_price");
+
+    Order near;
+    EXPECT_TRUE(decodeOrderMessage(
+        R"({"order_id":"3","type":"limit","action":"buy","quantity":"5","price":"999999999"})", near));
+    EXPECT_DOUBLE_EQ(near.price, 999999999.0);
+}
+
+TEST(OrderCodecTest, ValidatesOrdersBuiltWithoutTheDecoder) {
+    // As a shared-memory order arrives: fields set directly, nothing parsed
+    Order negative(1, "limit", "sell", -5.0, 10);
+    std::string error;
+    EXPECT_FALSE(validateOrder(negative, &error));
+    EXPECT_EQ(error, "invalid price");
+    EXPECT_EQ(negative.kind, OrderKind::Unknown);
+    EXPECT_EQ(negative.status, OrderStatus::Rejected);
+
+    Order empty(2, "limit", "buy", 10.0, 0);
+    EXPECT_FALSE(validateOrder(empty, &error));
+    EXPECT_EQ(error, "missing or invalid quantity");
+
+    Order unpriced(3, "ioc", "buy", 0.0, 10);
+    EXPECT_FALSE(validateOrder(unpriced, &error));
+    EXPECT_EQ(error, "missing price");
+
+    Order stop(4, "stop-loss", "sell", 0.0, 10);
+    stop.isStopOrder = true;
+    EXPECT_FALSE(validateOrder(stop, &error));
+    EXPECT_EQ(error, "missing or invalid stop_price");
+
+    Order nan(5, "limit", "buy", std::nan(""), 10);
+    EXPECT_FALSE(validateOrder(nan, &error));
+
+    Order market(6, "market", "buy", 0.0, 10);
+    EXPECT_TRUE(validateOrder(market));
+    Order cancel(7, "cancel", "", 0.0, 0);
+    EXPECT_TRUE(validateOrder(cancel));
+}
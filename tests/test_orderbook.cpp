@@ -1,27 +1,8 @@
+#include <algorithm>
 #include <gtest/gtest.h>
+#include "json_utils.hpp"
 #include "orderbook.hpp"
 
-// Test the comparators
-TEST(OrderBookTest, BuyOrderComparator) {
-    BuyOrderComparator comp;
-    Order a(1, "limit", "buy", 50.0, 100);
-    Order b(2, "limit", "buy", 60.0, 200);
-
-    // b has higher price, so b < a in the priority queue sense
-    EXPECT_TRUE(comp(a, b));  // means "a < b", i.e. a has lower priority
-    EXPECT_FALSE(comp(b, a));
-}
-
-TEST(OrderBookTest, SellOrderComparator) {
-    SellOrderComparator comp;
-    Order a(1, "limit", "sell", 50.0, 100);
-    Order b(2, "limit", "sell", 60.0, 200);
-
-    // a has lower price, so a < b in the priority queue sense
-    EXPECT_FALSE(comp(a, b)); // means "a" has higher priority
-    EXPECT_TRUE(comp(b, a));
-}
-
 TEST(OrderBookTest, BasicProcessing) {
     OrderBook ob;
     Order o(100, "limit", "buy", 50.0, 100);
@@ -42,3 +23,423 @@ TEST(OrderBookTest, CancelOrder) {
     // Should be processed with "cancelled" status
     EXPECT_EQ(ob.ordersProcessed(), (uint64_t)1);
 }
+
+// Self-trade prevention: owner 7 rests a sell, then sends a crossing buy
+static Order ownedOrder(uint64_t id, const std::string &action, double price, uint64_t qty, uint32_t owner) {
+    Order o(id, "limit", action, price, qty);
+    o.ownerId = owner;
+    o.recvTimestamp = std::chrono::high_resolution_clock::now();
+    return o;
+}
+
+TEST(OrderBookTest, SelfTradeAllowedWhenDisabled) {
+    OrderBook ob;
+    Order s = ownedOrder(1, "sell", 50.0, 10, 7);
+    ob.processOrder(s);
+    Order b = ownedOrder(2, "buy", 50.0, 10, 7);
+    ob.processOrder(b);
+    EXPECT_EQ(b.filledQuantity, 10u);
+    EXPECT_EQ(b.status, OrderStatus::Executed);
+}
+
+TEST(OrderBookTest, SelfTradeCancelNewest) {
+    OrderBook ob;
+    ob.setSelfTradePrevention(SelfTradePrevention::CancelNewest);
+    Order s = ownedOrder(1, "sell", 50.0, 10, 7);
+    ob.processOrder(s);
+    Order b = ownedOrder(2, "buy", 50.0, 10, 7);
+    ob.processOrder(b);
+
+    EXPECT_EQ(b.status, OrderStatus::StpCancelled);
+    EXPECT_EQ(b.filledQuantity, 0u);
+    EXPECT_EQ(ob.askOrderCount(), 1u);
+    EXPECT_EQ(ob.bidOrderCount(), 0u);
+}
+
+TEST(OrderBookTest, SelfTradeCancelOldestKeepsMatching) {
+    OrderBook ob;
+    ob.setSelfTradePrevention(SelfTradePrevention::CancelOldest);
+    Order own = ownedOrder(1, "sell", 50.0, 10, 7);
+    Order other = ownedOrder(2, "sell", 50.0, 10, 8);
+    ob.processOrder(own);
+    ob.processOrder(other);
+
+    Order b = ownedOrder(3, "buy", 50.0, 10, 7);
+    ob.processOrder(b);
+    // The own resting order is cancelled, the buy fills against owner 8
+    EXPECT_EQ(b.filledQuantity, 10u);
+    EXPECT_EQ(b.status, OrderStatus::Executed);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+}
+
+TEST(OrderBookTest, SelfTradeCancelBoth) {
+    OrderBook ob;
+    ob.setSelfTradePrevention(SelfTradePrevention::CancelBoth);
+    Order s = ownedOrder(1, "sell", 50.0, 10, 7);
+    ob.processOrder(s);
+    Order b = ownedOrder(2, "buy", 50.0, 10, 7);
+    ob.processOrder(b);
+
+    EXPECT_EQ(b.status, OrderStatus::StpCancelled);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+    EXPECT_EQ(ob.bidOrderCount(), 0u);
+}
+
+TEST(OrderBookTest, SelfTradeDecrement) {
+    OrderBook ob;
+    ob.setSelfTradePrevention(SelfTradePrevention::Decrement);
+    Order s = ownedOrder(1, "sell", 50.0, 4, 7);
+    ob.processOrder(s);
+    Order b = ownedOrder(2, "buy", 50.0, 10, 7);
+    ob.processOrder(b);
+
+    // Both sides shrink by 4 without a fill; the buy rests with 6
+    EXPECT_EQ(b.filledQuantity, 0u);
+    EXPECT_EQ(b.remainingQuantity, 6u);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+    ASSERT_EQ(ob.bidDepth(1).size(), 1u);
+    EXPECT_EQ(ob.bidDepth(1)[0].quantity, 6u);
+}
+
+TEST(OrderBookTest, FokCountsIcebergReserves) {
+    OrderBook ob;
+    Order iceberg(1, "limit", "sell", 50.0, 100);
+    iceberg.displayQuantity = 10;
+    ob.processOrder(iceberg);
+
+    // Only 10 is displayed, but the reserve refills it within the match
+    Order fok(2, "fok", "buy", 50.0, 100);
+    ob.processOrder(fok);
+    EXPECT_EQ(fok.status, OrderStatus::Executed);
+    EXPECT_EQ(fok.filledQuantity, 100u);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+
+    // Beyond the reserve it is still killed
+    Order again(3, "limit", "sell", 50.0, 100);
+    again.displayQuantity = 10;
+    ob.processOrder(again);
+    Order tooBig(4, "fok", "buy", 50.0, 101);
+    ob.processOrder(tooBig);
+    EXPECT_EQ(tooBig.status, OrderStatus::FokNoFill);
+    EXPECT_EQ(tooBig.filledQuantity, 0u);
+
+    // Under self-trade prevention an own order ahead blocks the refills
+    OrderBook stp;
+    stp.setSelfTradePrevention(SelfTradePrevention::CancelNewest);
+    Order other = ownedOrder(5, "sell", 50.0, 100, 8);
+    other.displayQuantity = 10;
+    Order own = ownedOrder(6, "sell", 50.0, 10, 7);
+    stp.processOrder(other);
+    stp.processOrder(own);
+    Order blocked = ownedOrder(7, "buy", 50.0, 20, 7);
+    blocked.type = "fok";
+    blocked.classify();
+    stp.processOrder(blocked);
+    EXPECT_EQ(blocked.status, OrderStatus::FokNoFill);
+    Order fits = ownedOrder(8, "buy", 50.0, 10, 7);
+    fits.type = "fok";
+    fits.classify();
+    stp.processOrder(fits);
+    EXPECT_EQ(fits.status, OrderStatus::Executed);
+}
+
+TEST(OrderBookTest, FokCountsOnlyOtherOwnersUnderSelfTradePrevention) {
+    for (SelfTradePrevention mode : {SelfTradePrevention::CancelOldest, SelfTradePrevention::Decrement,
+                                     SelfTradePrevention::CancelNewest}) {
+        OrderBook ob;
+        ob.setSelfTradePrevention(mode);
+        Order other = ownedOrder(1, "sell", 50.0, 50, 8);
+        Order own = ownedOrder(2, "sell", 50.5, 50, 7);
+        ob.processOrder(other);
+        ob.processOrder(own);
+
+        // 100 is on offer, but only 50 of it from someone else
+        Order fok = ownedOrder(3, "buy", 51.0, 100, 7);
+        fok.type = "fok";
+        fok.classify();
+        ob.processOrder(fok);
+        EXPECT_EQ(fok.status, OrderStatus::FokNoFill);
+        EXPECT_EQ(fok.filledQuantity, 0u);
+        EXPECT_EQ(ob.askOrderCount(), 2u);
+    }
+
+    // Cancelling the resting order lets it reach liquidity behind its own
+    OrderBook ob;
+    ob.setSelfTradePrevention(SelfTradePrevention::CancelOldest);
+    Order first = ownedOrder(1, "sell", 50.0, 50, 8);
+    Order own = ownedOrder(2, "sell", 50.5, 50, 7);
+    Order second = ownedOrder(3, "sell", 51.0, 50, 9);
+    ob.processOrder(first);
+    ob.processOrder(own);
+    ob.processOrder(second);
+    Order fok = ownedOrder(4, "buy", 51.0, 100, 7);
+    fok.type = "fok";
+    fok.classify();
+    ob.processOrder(fok);
+    EXPECT_EQ(fok.status, OrderStatus::Executed);
+    EXPECT_EQ(fok.filledQuantity, 100u);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+}
+
+TEST(OrderBookTest, ParseSelfTradePrevention) {
+    SelfTradePrevention mode = SelfTradePrevention::None;
+    EXPECT_TRUE(parseSelfTradePrevention("cancel-oldest", mode));
+    EXPECT_EQ(mode, SelfTradePrevention::CancelOldest);
+    EXPECT_FALSE(parseSelfTradePrevention("bogus", mode));
+}
+
+namespace {
+
+struct RecordingListener : BookEventListener {
+    std::vector<std::string> events;
+
+    void onOrder(const Order &o) override {
+        events.push_back("order " + std::to_string(o.orderId) + " " + orderStatusName(o.status));
+    }
+    void onTrade(const Order &incoming, const Order &resting, double price, uint64_t quantity) override {
+        events.push_back("trade " + std::to_string(incoming.orderId) + "x" + std::to_string(resting.orderId) +
+                         " " + std::to_string(quantity) + "@" + std::to_string(static_cast<int>(price)));
+    }
+    void onCancel(const Order &resting, uint64_t quantity, CancelReason reason) override {
+        events.push_back("cancel " + std::to_string(resting.orderId) + " " + std::to_string(quantity) +
+                         (reason == CancelReason::Requested ? " requested" : " other"));
+    }
+};
+
+} // namespace
+
+TEST(OrderBookTest, ListenerSeesTradesAndCancels) {
+    OrderBook ob;
+    RecordingListener listener;
+    ob.setEventListener(&listener);
+
+    Order s1(1, "limit", "sell", 50.0, 5);
+    Order s2(2, "limit", "sell", 51.0, 5);
+    Order b(3, "market", "buy", 0.0, 7);
+    Order c(2, "cancel", "", 0.0, 0);
+    ob.processOrder(s1);
+    ob.processOrder(s2);
+    ob.processOrder(b);
+    ob.processOrder(c);
+
+    std::vector<std::string> expected = {
+        "order 1 open",
+        "order 2 open",
+        "trade 3x1 5@50",
+        "trade 3x2 2@51",
+        "order 3 executed",
+        "cancel 2 3 requested",
+        "order 2 cancelled",
+    };
+    EXPECT_EQ(listener.events, expected);
+}
+
+TEST(OrderBookTest, ExecutionReportRendersAsConfirmationJson) {
+    OrderBook ob;
+    Order s(1, "limit", "sell", 50.25, 10);
+    Order b(2, "limit", "buy", 50.25, 4);
+    ob.processOrder(s);
+    ob.processOrder(b);
+
+    ExecutionReport r = makeExecutionReport(b, b.filledQuantity, 50.25);
+    std::string json;
+    appendExecutionReportJson(json, r);
+
+    std::map<std::string, std::string> fields;
+    fields["order_id"] = "2";
+    fields["status"] = "executed";
+    fields["filled_quantity"] = "4";
+    fields["remaining_quantity"] = "0";
+    fields["average_price"] = std::to_string(50.25);
+    EXPECT_EQ(json, buildJsonString(fields));
+
+    // Ready-made text takes precedence over the report
+    Confirmation c;
+    c.report = r;
+    c.message = "{}";
+    std::string text;
+    appendConfirmationText(text, c);
+    EXPECT_EQ(text, "{}");
+}
+
+TEST(OrderBookTest, ReplaceDownKeepsQueuePosition) {
+    OrderBook ob;
+    Order a(1, "limit", "sell", 10.0, 10);
+    Order b(2, "limit", "sell", 10.0, 10);
+    ob.processOrder(a);
+    ob.processOrder(b);
+
+    Order r(1, "replace", "", 10.0, 4);
+    ob.processOrder(r);
+    EXPECT_EQ(r.status, OrderStatus::Replaced);
+    EXPECT_EQ(r.remainingQuantity, 4u);
+    EXPECT_EQ(ob.askDepth(1)[0].quantity, 14u);
+
+    // Order 1 is still first in the queue
+    Order buy(3, "limit", "buy", 10.0, 4);
+    ob.processOrder(buy);
+    EXPECT_EQ(buy.status, OrderStatus::Executed);
+    EXPECT_EQ(ob.askOrderCount(), 1u);
+    Order gone(1, "cancel", "", 0.0, 0);
+    ob.processOrder(gone);
+    EXPECT_EQ(gone.status, OrderStatus::CancelRejected);
+}
+
+TEST(OrderBookTest, ReplaceUpOrRepricedLosesPriority) {
+    OrderBook ob;
+    Order a(1, "limit", "sell", 10.0, 10);
+    Order b(2, "limit", "sell", 10.0, 10);
+    ob.processOrder(a);
+    ob.processOrder(b);
+
+    Order up(1, "replace", "", 10.0, 15);
+    ob.processOrder(up);
+    EXPECT_EQ(up.status, OrderStatus::Replaced);
+    EXPECT_EQ(ob.askDepth(1)[0].quantity, 25u);
+
+    // Order 2 now trades first
+    Order buy(3, "limit", "buy", 10.0, 10);
+    ob.processOrder(buy);
+    Order second(2, "cancel", "", 0.0, 0);
+    ob.processOrder(second);
+    EXPECT_EQ(second.status, OrderStatus::CancelRejected);
+
+    // Repriced through the bid, it trades like a new order
+    Order bid(4, "limit", "buy", 9.0, 5);
+    ob.processOrder(bid);
+    Order cross(1, "replace", "", 9.0, 15);
+    ob.processOrder(cross);
+    EXPECT_EQ(cross.status, OrderStatus::PartiallyFilled);
+    EXPECT_EQ(cross.remainingQuantity, 10u);
+    EXPECT_EQ(ob.bidOrderCount(), 0u);
+    ASSERT_EQ(ob.askDepth(1).size(), 1u);
+    EXPECT_DOUBLE_EQ(ob.askDepth(1)[0].price, 9.0);
+    EXPECT_EQ(ob.askDepth(1)[0].quantity, 10u);
+}
+
+TEST(OrderBookTest, ReplaceOfUnknownOrderIsRejected) {
+    OrderBook ob;
+    Order r(42, "replace", "", 10.0, 5);
+    ob.processOrder(r);
+    EXPECT_EQ(r.status, OrderStatus::ReplaceRejected);
+    EXPECT_EQ(ob.askOrderCount() + ob.bidOrderCount(), 0u);
+}
+
+TEST(OrderBookTest, KillCancelsEveryOrderOfTheOwner) {
+    OrderBook ob;
+    RecordingListener listener;
+    ob.setEventListener(&listener);
+
+    Order a(1, "limit", "sell", 10.0, 5);
+    Order b(2, "limit", "buy", 9.0, 5);
+    Order other(3, "limit", "sell", 11.0, 5);
+    Order iceberg(4, "limit", "sell", 12.0, 9);
+    a.ownerId = b.ownerId = iceberg.ownerId = 7;
+    other.ownerId = 8;
+    iceberg.displayQuantity = 3;
+    for (Order *o : {&a, &b, &other, &iceberg}) {
+        ob.processOrder(*o);
+    }
+    EXPECT_FALSE(ob.hasResting(99));
+    EXPECT_TRUE(ob.hasResting(4));
+
+    Order kill(100, "kill", "", 0.0, 0);
+    kill.ownerId = 7;
+    ob.processOrder(kill);
+    EXPECT_EQ(kill.status, OrderStatus::Killed);
+    EXPECT_EQ(kill.quantity, 3u);
+    EXPECT_EQ(ob.bidOrderCount(), 0u);
+    EXPECT_EQ(ob.askOrderCount(), 1u);
+    EXPECT_TRUE(ob.hasResting(3));
+    EXPECT_FALSE(ob.hasResting(1));
+
+    std::vector<Order> killed = ob.takeKilled();
+    ASSERT_EQ(killed.size(), 3u);
+    for (const Order &k : killed) {
+        EXPECT_EQ(k.status, OrderStatus::Cancelled);
+        EXPECT_EQ(k.ownerId, 7u);
+        EXPECT_EQ(k.remainingQuantity, k.orderId == 4 ? 9u : 5u);
+    }
+    EXPECT_TRUE(ob.takeKilled().empty());
+    EXPECT_EQ(std::count(listener.events.begin(), listener.events.end(), "cancel 4 9 other"), 1);
+}
+
+TEST(OrderBookTest, KillWithoutOwnerIsRejected) {
+    OrderBook ob;
+    Order a(1, "limit", "sell", 10.0, 5);
+    ob.processOrder(a);
+    Order kill(100, "kill", "", 0.0, 0);
+    ob.processOrder(kill);
+    EXPECT_EQ(kill.status, OrderStatus::Rejected);
+    EXPECT_EQ(ob.askOrderCount(), 1u);
+    EXPECT_TRUE(ob.takeKilled().empty());
+}
+
+TEST(OrderBookTest, OutOfRangePriceIsRejectedAndDoesNotStallMatching) {
+    OrderBook ob;
+    Order far(1, "limit", "sell", 1e13, 5);
+    ob.processOrder(far);
+    EXPECT_EQ(far.status, OrderStatus::Rejected);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+
+    Order s(2, "limit", "sell", 100.0, 10);
+    ob.processOrder(s);
+    Order b(3, "market", "buy", 0.0, 15);
+    ob.processOrder(b);
+    EXPECT_EQ(b.status, OrderStatus::PartiallyFilled);
+    EXPECT_EQ(b.filledQuantity, 10u);
+    EXPECT_EQ(ob.askOrderCount(), 0u);
+}
+
+TEST(OrderBookTest, AveragePriceIsVolumeWeightedAcrossFills) {
+    OrderBook ob;
+    Order s1(1, "limit", "sell", 50.0, 5);
+    Order s2(2, "limit", "sell", 51.0, 15);
+    ob.processOrder(s1);
+    ob.processOrder(s2);
+
+    // Limited at 55 but fills at the resting prices
+    Order b(3, "limit", "buy", 55.0, 10);
+    ob.processOrder(b);
+    EXPECT_EQ(b.status, OrderStatus::Executed);
+    EXPECT_DOUBLE_EQ(b.averagePrice(), 50.5);
+    ExecutionReport r = makeExecutionReport(b, b.filledQuantity, b.averagePrice());
+    EXPECT_DOUBLE_EQ(r.averagePrice, 50.5);
+
+    // Filled entirely at the next level
+    Order b2(4, "market", "buy", 0.0, 10);
+    ob.processOrder(b2);
+    EXPECT_DOUBLE_EQ(b2.averagePrice(), 51.0);
+
+    Order none(5, "limit", "buy", 40.0, 1);
+    ob.processOrder(none);
+    EXPECT_DOUBLE_EQ(none.averagePrice(), 0.0);
+}
+
+TEST(OrderBookTest, PassiveFillsAreKeptForTheirOwners) {
+    OrderBook ob;
+    ob.setReportPassiveFills(true);
+    Order iceberg(1, "limit", "sell", 50.0, 10);
+    iceberg.displayQuantity = 4;
+    Order plain(2, "limit", "sell", 51.0, 3);
+    ob.processOrder(iceberg);
+    ob.processOrder(plain);
+
+    Order b(3, "limit", "buy", 51.0, 12);
+    ob.processOrder(b);
+    std::vector<Order> fills;
+    ob.takePassiveFills(fills);
+    ASSERT_EQ(fills.size(), 4u);  // three slices of the iceberg, then the plain order
+    EXPECT_EQ(fills[0].orderId, 1u);
+    EXPECT_EQ(fills[0].status, OrderStatus::PartiallyFilled);
+    EXPECT_EQ(fills[0].remainingQuantity, 6u);
+    EXPECT_EQ(fills[2].status, OrderStatus::Executed);
+    EXPECT_EQ(fills[2].filledQuantity, 10u);
+    EXPECT_EQ(fills[3].orderId, 2u);
+    EXPECT_EQ(fills[3].filledQuantity, 2u);
+    EXPECT_EQ(fills[3].remainingQuantity, 1u);
+    EXPECT_DOUBLE_EQ(fills[3].averagePrice(), 51.0);
+
+    ob.takePassiveFills(fills);
+    EXPECT_TRUE(fills.empty());
+}
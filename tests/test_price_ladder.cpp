@@ -0,0 +1,269 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <list>
+#include <map>
+#include <random>
+#include "level_scan.hpp"
+#include "price_ladder.hpp"
+
+// Quantities are stored worst level first, best level last
+TEST(LevelScanTest, LevelsToFillFromTheBest) {
+    std::vector<uint64_t> qty = {50, 40, 30, 20, 10};
+    uint64_t cumulative = 0;
+
+    EXPECT_EQ(levelsToFillScalar(qty.data(), qty.size(), 10, &cumulative), 1u);
+    EXPECT_EQ(cumulative, 10u);
+    EXPECT_EQ(levelsToFillScalar(qty.data(), qty.size(), 31, &cumulative), 3u);
+    EXPECT_EQ(cumulative, 60u);
+    // Not enough liquidity: every level is used
+    EXPECT_EQ(levelsToFillScalar(qty.data(), qty.size(), 1000, &cumulative), 5u);
+    EXPECT_EQ(cumulative, 150u);
+}
+
+TEST(LevelScanTest, Avx2MatchesScalar) {
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<uint64_t> qtyDist(0, 500);
+    for (size_t n = 0; n < 40; n++) {
+        std::vector<uint64_t> qty(n);
+        for (auto &q : qty) q = qtyDist(rng);
+
+        for (uint64_t target : {0ULL, 1ULL, 250ULL, 1000ULL, 5000ULL, 100000ULL}) {
+            uint64_t cumScalar = 0, cumSimd = 0;
+            size_t a = levelsToFillScalar(qty.data(), n, target, &cumScalar);
+            size_t b = levelsToFillAvx2(qty.data(), n, target, &cumSimd);
+            EXPECT_EQ(a, b) << "n=" << n << " target=" << target;
+            EXPECT_EQ(cumScalar, cumSimd) << "n=" << n << " target=" << target;
+        }
+
+        std::vector<uint64_t> outScalar(n), outSimd(n);
+        for (size_t levels : {size_t(0), size_t(3), size_t(8), n}) {
+            ASSERT_EQ(cumulativeDepthScalar(qty.data(), n, levels, outScalar.data()),
+                      cumulativeDepthAvx2(qty.data(), n, levels, outSimd.data()));
+            for (size_t i = 0; i < std::min(levels, n); i++) {
+                EXPECT_EQ(outScalar[i], outSimd[i]);
+            }
+        }
+    }
+}
+
+TEST(PriceLadderTest, TicksAreClampedToTheSupportedRange) {
+    EXPECT_EQ(toTicks(100.25), 100250000);
+    EXPECT_EQ(toTicks(kMaxPrice), kMaxPriceTicks);
+    EXPECT_EQ(toTicks(1e13), kMaxPriceTicks);
+    EXPECT_EQ(toTicks(-1e13), -kMaxPriceTicks);
+    EXPECT_EQ(toTicks(std::nan("")), 0);
+    EXPECT_TRUE(priceInRange(kMaxPrice - 1));
+    EXPECT_FALSE(priceInRange(kMaxPrice));
+    EXPECT_FALSE(priceInRange(1e13));
+    EXPECT_FALSE(priceInRange(std::nan("")));
+}
+
+TEST(PriceLadderTest, AggregatesLevelsBestFirst) {
+    PriceLadder asks(false);
+    asks.add(Order(1, "limit", "sell", 51.0, 10));
+    asks.add(Order(2, "limit", "sell", 50.0, 20));
+    asks.add(Order(3, "limit", "sell", 50.0, 5));
+    asks.add(Order(4, "limit", "sell", 52.5, 7));
+
+    EXPECT_EQ(asks.levelCount(), 3u);
+    EXPECT_EQ(asks.orderCount(), 4u);
+    EXPECT_DOUBLE_EQ(asks.bestPrice(), 50.0);
+    EXPECT_EQ(asks.front().orderId, 2u);
+
+    auto depth = asks.depth(10);
+    ASSERT_EQ(depth.size(), 3u);
+    EXPECT_DOUBLE_EQ(depth[0].price, 50.0);
+    EXPECT_EQ(depth[0].quantity, 25u);
+    EXPECT_DOUBLE_EQ(depth[2].price, 52.5);
+    EXPECT_EQ(depth[2].cumulativeQuantity, 42u);
+}
+
+TEST(PriceLadderTest, SweepRespectsLimit) {
+    PriceLadder bids(true);
+    bids.add(Order(1, "limit", "buy", 49.0, 10));
+    bids.add(Order(2, "limit", "buy", 48.0, 10));
+    bids.add(Order(3, "limit", "buy", 47.0, 10));
+
+    uint64_t available = 0;
+    // A sell limited at 48.0 may only reach the two best bids
+    EXPECT_EQ(bids.sweep(25, toTicks(48.0), &available), 2u);
+    EXPECT_EQ(available, 20u);
+    EXPECT_EQ(bids.sweep(25, kNoSellLimit, &available), 3u);
+    EXPECT_EQ(available, 30u);
+    EXPECT_TRUE(bids.crosses(toTicks(49.0)));
+    EXPECT_FALSE(bids.crosses(toTicks(49.5)));
+}
+
+TEST(PriceLadderTest, FillFrontDropsExhaustedLevels) {
+    PriceLadder asks(false);
+    asks.add(Order(1, "limit", "sell", 50.0, 10));
+    asks.add(Order(2, "limit", "sell", 51.0, 10));
+
+    asks.front().remainingQuantity -= 4;
+    asks.fillFront(4);
+    EXPECT_EQ(asks.depth(1)[0].quantity, 6u);
+
+    asks.front().remainingQuantity = 0;
+    asks.fillFront(6);
+    EXPECT_EQ(asks.levelCount(), 1u);
+    EXPECT_DOUBLE_EQ(asks.bestPrice(), 51.0);
+}
+
+TEST(PriceLadderTest, WindowFollowsTheTouch) {
+    PriceLadder bids(true);
+    bids.reserve(64, 100, nullptr);   // 64 slots of 0.01 either side of the touch
+    bids.add(Order(1, "limit", "buy", 100.00, 10));
+    bids.add(Order(2, "limit", "buy", 99.90, 10));
+    bids.add(Order(3, "limit", "buy", 90.00, 10));      // far behind: outlying
+    bids.add(Order(4, "limit", "buy", 99.955555, 10));  // off the grid
+    EXPECT_EQ(bids.levelCount(), 4u);
+    EXPECT_EQ(bids.windowLevelCount(), 2u);
+
+    auto depth = bids.depth(10);
+    ASSERT_EQ(depth.size(), 4u);
+    EXPECT_DOUBLE_EQ(depth[1].price, 99.955555);
+    EXPECT_DOUBLE_EQ(depth[3].price, 90.0);
+    EXPECT_EQ(depth[3].cumulativeQuantity, 40u);
+
+    // Clearing the near levels brings the far one into the window
+    bids.remove(1, nullptr);
+    bids.remove(4, nullptr);
+    bids.remove(2, nullptr);
+    EXPECT_DOUBLE_EQ(bids.bestPrice(), 90.0);
+    EXPECT_EQ(bids.windowLevelCount(), 1u);
+
+    // A new best far above moves the window up and demotes the old levels
+    bids.add(Order(5, "limit", "buy", 150.0, 5));
+    EXPECT_DOUBLE_EQ(bids.bestPrice(), 150.0);
+    EXPECT_EQ(bids.windowLevelCount(), 1u);
+    EXPECT_EQ(bids.levelCount(), 2u);
+    EXPECT_EQ(bids.front().orderId, 5u);
+}
+
+TEST(PriceLadderTest, RejectsLevelsOutsideTheSupportedRange) {
+    PriceLadder asks(false);
+    asks.reserve(64, 100, nullptr);
+    EXPECT_FALSE(asks.add(Order(1, "limit", "sell", 1e13, 5)));
+    EXPECT_TRUE(asks.add(Order(2, "limit", "sell", kMaxPrice - 1, 5)));
+    EXPECT_TRUE(asks.add(Order(3, "limit", "sell", 100.0, 10)));
+    EXPECT_EQ(asks.levelCount(), 2u);
+
+    // Emptying the touch moves the window out to the range's edge
+    asks.remove(3, nullptr);
+    EXPECT_DOUBLE_EQ(asks.bestPrice(), kMaxPrice - 1);
+    EXPECT_EQ(asks.windowLevelCount(), 1u);
+}
+
+TEST(PriceLadderTest, IncrementChangeRegridsTheWindow) {
+    PriceLadder asks(false);
+    asks.add(Order(1, "limit", "sell", 10.05, 10));
+    asks.add(Order(2, "limit", "sell", 10.10, 10));
+    EXPECT_EQ(asks.windowLevelCount(), 2u);
+
+    // On a 0.1 grid only 10.10 has a slot
+    asks.setIncrement(toTicks(0.1));
+    EXPECT_EQ(asks.windowLevelCount(), 1u);
+    EXPECT_DOUBLE_EQ(asks.bestPrice(), 10.05);
+    asks.cancelFront();
+    EXPECT_DOUBLE_EQ(asks.bestPrice(), 10.10);
+    EXPECT_EQ(asks.front().orderId, 2u);
+}
+
+TEST(PriceLadderTest, MatchesReferenceAcrossRecenters) {
+    // Random adds, removes and fills over a price range far wider than
+    // the window, on and off the grid, checked against a sorted map
+    for (bool isBid : {true, false}) {
+        std::mt19937_64 rng(isBid ? 11 : 12);
+        PriceLadder ladder(isBid);
+        ladder.reserve(64, 4096, nullptr);
+        std::map<int64_t, std::list<std::pair<uint64_t, uint64_t>>> reference;   // ticks -> (id, qty)
+        std::map<uint64_t, int64_t> live;                                         // id -> ticks
+        uint64_t nextId = 1;
+        double mid = 100.0;
+
+        auto best = [&]() {
+            return isBid ? std::prev(reference.end()) : reference.begin();
+        };
+
+        for (int step = 0; step < 20000; step++) {
+            int op = static_cast<int>(rng() % 10);
+            if (op < 5 || live.empty()) {
+                // Drift the market so the touch keeps leaving the window
+                mid += static_cast<double>(static_cast<int>(rng() % 41) - 20) * 0.01;
+                double price = mid + static_cast<double>(static_cast<int>(rng() % 400) - 200) * 0.01;
+                if (rng() % 8 == 0) {
+                    price += 0.003;   // off the grid
+                }
+                if (price <= 0.0) continue;
+                uint64_t qty = 1 + rng() % 50;
+                Order o(nextId, "limit", isBid ? "buy" : "sell", price, qty);
+                ladder.add(o);
+                int64_t ticks = toTicks(price);
+                reference[ticks].emplace_back(nextId, qty);
+                live[nextId] = ticks;
+                nextId++;
+            } else if (op < 8) {
+                auto victim = live.begin();
+                std::advance(victim, rng() % live.size());
+                ASSERT_TRUE(ladder.remove(victim->first, nullptr));
+                auto &queue = reference[victim->second];
+                queue.remove_if([&](const std::pair<uint64_t, uint64_t> &e) { return e.first == victim->first; });
+                if (queue.empty()) reference.erase(victim->second);
+                live.erase(victim);
+            } else {
+                auto level = best();
+                auto &front = level->second.front();
+                ASSERT_EQ(ladder.front().orderId, front.first);
+                uint64_t fill = 1 + rng() % front.second;
+                ladder.front().remainingQuantity -= fill;
+                ladder.fillFront(fill);
+                front.second -= fill;
+                if (front.second == 0) {
+                    live.erase(front.first);
+                    level->second.pop_front();
+                    if (level->second.empty()) reference.erase(level);
+                }
+            }
+
+            ASSERT_EQ(ladder.levelCount(), reference.size());
+            ASSERT_EQ(ladder.orderCount(), live.size());
+            if (reference.empty()) {
+                ASSERT_TRUE(ladder.empty());
+                continue;
+            }
+            ASSERT_EQ(ladder.bestTicks(), best()->first);
+            if (step % 97 == 0) {
+                std::vector<DepthLevel> depth = ladder.depth(reference.size());
+                ASSERT_EQ(depth.size(), reference.size());
+                size_t i = 0;
+                auto check = [&](const std::pair<const int64_t, std::list<std::pair<uint64_t, uint64_t>>> &level) {
+                    uint64_t total = 0;
+                    for (const auto &e : level.second) total += e.second;
+                    ASSERT_EQ(toTicks(depth[i].price), level.first) << "level " << i;
+                    ASSERT_EQ(depth[i].quantity, total) << "level " << i;
+                    i++;
+                };
+                if (isBid) {
+                    for (auto it = reference.rbegin(); it != reference.rend(); ++it) check(*it);
+                } else {
+                    for (auto it = reference.begin(); it != reference.end(); ++it) check(*it);
+                }
+
+                // Sweeps agree with the depth they are computed over
+                uint64_t want = 1 + rng() % 500;
+                int64_t limit = toTicks(depth[std::min<size_t>(depth.size() - 1, rng() % 8)].price);
+                uint64_t available = 0;
+                size_t used = ladder.sweep(want, limit, &available);
+                uint64_t expected = 0;
+                size_t expectedLevels = 0;
+                for (const DepthLevel &d : depth) {
+                    if (expected >= want || (isBid ? toTicks(d.price) < limit : toTicks(d.price) > limit)) break;
+                    expected += d.quantity;
+                    expectedLevels++;
+                }
+                ASSERT_EQ(used, expectedLevels);
+                ASSERT_EQ(available, expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include "replication.hpp"
+
+namespace {
+
+Order makeOrder(uint64_t id, const std::string &type, const std::string &action,
+                double price, uint64_t qty, uint64_t expireTimeMs = 0) {
+    Order o(id, type, action, price, qty);
+    o.expireTimeMs = expireTimeMs;
+    return o;
+}
+
+void expectSameDepth(OrderBook &a, OrderBook &b) {
+    std::vector<DepthLevel> aBids = a.bidDepth(10), bBids = b.bidDepth(10);
+    std::vector<DepthLevel> aAsks = a.askDepth(10), bAsks = b.askDepth(10);
+    ASSERT_EQ(aBids.size(), bBids.size());
+    ASSERT_EQ(aAsks.size(), bAsks.size());
+    for (size_t i = 0; i < aBids.size(); i++) {
+        EXPECT_DOUBLE_EQ(aBids[i].price, bBids[i].price);
+        EXPECT_EQ(aBids[i].quantity, bBids[i].quantity);
+    }
+    for (size_t i = 0; i < aAsks.size(); i++) {
+        EXPECT_DOUBLE_EQ(aAsks[i].price, bAsks[i].price);
+        EXPECT_EQ(aAsks[i].quantity, bAsks[i].quantity);
+    }
+    EXPECT_EQ(a.bidOrderCount(), b.bidOrderCount());
+    EXPECT_EQ(a.askOrderCount(), b.askOrderCount());
+}
+
+} // namespace
+
+TEST(ReplicationTest, RecordRoundTrip) {
+    Order o = makeOrder(42, "stop-loss", "sell", 99.5, 7);
+    o.stopPrice = 98.25;
+    o.ownerId = 9;
+    o.displayQuantity = 3;
+    o.expireTimeMs = 123456;
+    o.sequence = 77;
+
+    Order back = fromReplicationRecord(toReplicationRecord(o, 1000));
+    EXPECT_EQ(back.orderId, 42u);
+    EXPECT_EQ(back.type, "stop-loss");
+    EXPECT_EQ(back.action, "sell");
+    EXPECT_EQ(back.kind, OrderKind::StopLoss);
+    EXPECT_EQ(back.side, Side::Sell);
+    EXPECT_TRUE(back.isStopOrder);
+    EXPECT_DOUBLE_EQ(back.price, 99.5);
+    EXPECT_DOUBLE_EQ(back.stopPrice, 98.25);
+    EXPECT_EQ(back.quantity, 7u);
+    EXPECT_EQ(back.remainingQuantity, 7u);
+    EXPECT_EQ(back.ownerId, 9u);
+    EXPECT_EQ(back.displayQuantity, 3u);
+    EXPECT_EQ(back.expireTimeMs, 123456u);
+    EXPECT_EQ(back.sequence, 77u);
+}
+
+TEST(ReplicationTest, StandbyTracksPrimaryIncludingExpiry) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    ReplicationConfig config;
+    config.acks = true;
+    config.takeoverMs = 5000;
+
+    SimulatedClock primaryClock(1000);
+    OrderBook primary(&primaryClock);
+    ReplicationPrimary replicator(fds[0], config);
+    primary.setInputJournal(&replicator);
+    replicator.start();
+
+    // The standby's book is created no later than the primary's
+    FollowerClock standbyClock;
+    standbyClock.follow(1000);
+    OrderBook standby(&standbyClock);
+    ReplicationStandby follower(fds[1], standby, standbyClock, config);
+    ReplicationStandby::Outcome outcome = ReplicationStandby::Outcome::Error;
+    std::thread standbyThread([&] { outcome = follower.run(); });
+
+    Order orders[] = {
+        makeOrder(1, "limit", "sell", 101.0, 10),
+        makeOrder(2, "limit", "sell", 102.0, 5, 1500),   // expires at 1500
+        makeOrder(3, "limit", "buy", 99.0, 8),
+        makeOrder(4, "limit", "buy", 101.0, 4),          // trades with 1
+        makeOrder(5, "limit", "buy", 98.0, 6, 3000),
+        makeOrder(6, "bogus", "buy", 98.0, 6),           // rejected
+    };
+    for (Order &o : orders) {
+        primary.processOrder(o);
+        primaryClock.set(primaryClock.nowMs() + 100);
+    }
+    EXPECT_TRUE(primary.expireOrders(1600).size() == 1);   // clock record
+    primaryClock.set(2000);
+    Order late = makeOrder(7, "market", "sell", 0, 3);      // order 2 already gone
+    primary.processOrder(late);
+
+    // 7 orders + 1 clock advance
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (replicator.ackedSequence() < 8 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(replicator.sentSequence(), 8u);
+    EXPECT_EQ(replicator.ackedSequence(), 8u);
+
+    replicator.stop();
+    standbyThread.join();
+    EXPECT_EQ(outcome, ReplicationStandby::Outcome::Disconnected);
+    EXPECT_EQ(follower.appliedSequence(), 8u);
+    EXPECT_EQ(standbyClock.nowMs(), 2000u);
+    expectSameDepth(primary, standby);
+    EXPECT_EQ(primary.expireOrders(3500).size(), standby.expireOrders(3500).size());
+}
+
+TEST(ReplicationTest, SilentPrimaryTriggersTakeover) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    ReplicationConfig config;
+    config.takeoverMs = 20;
+    FollowerClock clock;
+    OrderBook book(&clock);
+    ReplicationStandby follower(fds[1], book, clock, config);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(follower.run(), ReplicationStandby::Outcome::HeartbeatLost);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    close(fds[0]);
+}
+
+TEST(ReplicationTest, HeartbeatsKeepStandbyWaiting) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    ReplicationConfig config;
+    config.heartbeatMs = 2;
+    config.takeoverMs = 200;
+    ReplicationPrimary replicator(fds[0], config);
+    replicator.start();
+
+    FollowerClock clock;
+    OrderBook book(&clock);
+    ReplicationStandby follower(fds[1], book, clock, config);
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        replicator.stop();
+    });
+    // Idle for longer than takeoverMs, but heartbeats arrive until stop()
+    EXPECT_EQ(follower.run(), ReplicationStandby::Outcome::Disconnected);
+    stopper.join();
+}
+
+TEST(ReplicationTest, StandbyFollowsCallAuction) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    ReplicationConfig config;
+    config.takeoverMs = 5000;
+    SimulatedClock primaryClock(1000);
+    OrderBook primary(&primaryClock);
+    ReplicationPrimary replicator(fds[0], config);
+    primary.setInputJournal(&replicator);
+    replicator.start();
+
+    FollowerClock standbyClock;
+    standbyClock.follow(1000);
+    OrderBook standby(&standbyClock);
+    ReplicationStandby follower(fds[1], standby, standbyClock, config);
+    std::thread standbyThread([&] { follower.run(); });
+
+    primary.beginAuction();
+    Order orders[] = {
+        makeOrder(1, "limit", "buy", 101.0, 10),
+        makeOrder(2, "limit", "sell", 100.0, 4),
+        makeOrder(3, "limit", "sell", 99.0, 3),
+    };
+    for (Order &o : orders) {
+        primary.processOrder(o);
+    }
+    AuctionResult r = primary.uncross();
+    EXPECT_EQ(r.volume, 7u);
+    Order after = makeOrder(4, "limit", "sell", 101.0, 2);  // trades continuously
+    primary.processOrder(after);
+    EXPECT_EQ(after.status, OrderStatus::Executed);
+
+    replicator.stop();
+    standbyThread.join();
+    EXPECT_EQ(follower.appliedSequence(), 6u);
+    EXPECT_EQ(standby.tradingPhase(), TradingPhase::Continuous);
+    expectSameDepth(primary, standby);
+}
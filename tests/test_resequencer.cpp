@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "resequencer.hpp"
+
+TEST(ResequencerTest, PopsInSequenceOrder) {
+    Resequencer<int> reseq(8);
+    reseq.publish(2, 20);
+    reseq.publish(0, 0);
+    reseq.publish(1, 10);
+
+    int value = -1;
+    for (int expected : {0, 10, 20}) {
+        ASSERT_TRUE(reseq.pop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_EQ(reseq.nextSequence(), 3u);
+}
+
+TEST(ResequencerTest, ParallelProducersKeepOrder) {
+    const uint64_t total = 20000;
+    const uint64_t producers = 4;
+    Resequencer<uint64_t> reseq(64);
+
+    std::vector<std::thread> threads;
+    for (uint64_t p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            // Producer p owns every sequence number congruent to p
+            for (uint64_t seq = p; seq < total; seq += producers) {
+                reseq.publish(seq, seq * 3);
+            }
+        });
+    }
+
+    uint64_t value = 0;
+    for (uint64_t seq = 0; seq < total; seq++) {
+        ASSERT_TRUE(reseq.pop(value));
+        ASSERT_EQ(value, seq * 3);
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+TEST(ResequencerTest, CloseStopsAtGap) {
+    Resequencer<int> reseq(8);
+    reseq.publish(0, 1);
+    reseq.publish(2, 3);
+    reseq.close();
+
+    int value = 0;
+    EXPECT_TRUE(reseq.pop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_FALSE(reseq.pop(value));
+}
+
+TEST(ResequencerTest, ExpeditedItemsComeFirst) {
+    Resequencer<int> reseq(4);
+    reseq.publish(0, 0);
+    reseq.publish(1, 10);
+    EXPECT_TRUE(reseq.expedite(11));
+
+    int value = -1;
+    bool expedited = false;
+    ASSERT_TRUE(reseq.pop(value, &expedited));
+    EXPECT_TRUE(expedited);
+    EXPECT_EQ(value, 11);
+    for (int expected : {0, 10}) {
+        ASSERT_TRUE(reseq.pop(value, &expedited));
+        EXPECT_FALSE(expedited);
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_EQ(reseq.nextSequence(), 2u);
+}
+
+TEST(ResequencerTest, ExpediteWakesConsumerAtAGapAndIsBounded) {
+    Resequencer<int> reseq(2);
+    reseq.publish(1, 10);  // 0 still missing
+
+    int value = -1;
+    bool expedited = false;
+    std::thread consumer([&] { reseq.pop(value, &expedited); });
+    EXPECT_TRUE(reseq.expedite(5));
+    consumer.join();
+    EXPECT_TRUE(expedited);
+    EXPECT_EQ(value, 5);
+
+    EXPECT_TRUE(reseq.expedite(6));
+    EXPECT_TRUE(reseq.expedite(7));
+    EXPECT_FALSE(reseq.expedite(8));
+    reseq.close();
+    EXPECT_FALSE(reseq.expedite(9));
+    for (int expected : {6, 7}) {
+        ASSERT_TRUE(reseq.pop(value, &expedited));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_FALSE(reseq.pop(value, &expedited));
+}
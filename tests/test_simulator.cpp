@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "simulator.hpp"
+
+namespace {
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+const char *const kInput =
+    "timestamp_ms,instrument,order_id,type,action,price,quantity,owner_id,display_quantity,expire_time_ms\n"
+    "1000,AAPL,1,limit,sell,100.5,10\n"
+    "1000,MSFT,1,limit,buy,300,5\n"
+    "1001,AAPL,2,limit,buy,100.5,4\n"
+    "1002,MSFT,2,market,sell,,3\n"
+    "1003,AAPL,3,limit,sell,101,5,,,1500\n"
+    "garbage\n"
+    "1004,GOOG,1,limit,buy,abc,1\n"
+    "1005,GOOG,2,limit,sell,1e13,1\n"
+    "2000,AAPL,4,limit,buy,99,1\n";
+
+struct SimDirs {
+    std::string root;
+    explicit SimDirs(const char *input = kInput) {
+        char pattern[] = "/tmp/sim_test_XXXXXX";
+        root = mkdtemp(pattern);
+        std::ofstream(root + "/input.csv") << input;
+    }
+    ~SimDirs() {
+        for (const char *sub : {"/1", "/3"}) {
+            std::remove((root + sub + "/fills.csv").c_str());
+            std::remove((root + sub + "/book.csv").c_str());
+            rmdir((root + sub).c_str());
+        }
+        std::remove((root + "/input.csv").c_str());
+        rmdir(root.c_str());
+    }
+    SimSummary run(unsigned threads, const std::string &sub, SimConfig config = SimConfig()) {
+        std::string out = root + sub;
+        mkdir(out.c_str(), 0755);
+        config.inputPath = root + "/input.csv";
+        config.outputDir = out;
+        config.threads = threads;
+        SimSummary summary;
+        std::string error;
+        EXPECT_TRUE(runSimulation(config, summary, &error)) << error;
+        return summary;
+    }
+};
+
+} // namespace
+
+TEST(SimulatorTest, ReplaysPerInstrumentBooks) {
+    SimDirs dirs;
+    SimSummary summary = dirs.run(1, "/1");
+    EXPECT_EQ(summary.orders, 6u);
+    EXPECT_EQ(summary.badLines, 3u);
+    EXPECT_EQ(summary.fills, 2u);
+    EXPECT_EQ(summary.expired, 1u);
+    EXPECT_EQ(summary.instruments, 2u);
+
+    EXPECT_EQ(readFile(dirs.root + "/1/fills.csv"),
+              "line,timestamp_ms,instrument,order_id,resting_order_id,side,price,quantity\n"
+              "4,1001,AAPL,2,1,buy,100.500000,4\n"
+              "5,1002,MSFT,2,1,sell,300.000000,3\n");
+    EXPECT_EQ(readFile(dirs.root + "/1/book.csv"),
+              "instrument,side,level,price,quantity\n"
+              "AAPL,buy,1,99.000000,1\n"
+              "AAPL,sell,1,100.500000,6\n"
+              "MSFT,buy,1,300.000000,2\n");
+}
+
+TEST(SimulatorTest, OutputIndependentOfThreadCount) {
+    SimDirs dirs;
+    SimSummary one = dirs.run(1, "/1");
+    SimSummary three = dirs.run(3, "/3");
+    EXPECT_EQ(one.fills, three.fills);
+    EXPECT_EQ(one.badLines, three.badLines);
+    EXPECT_EQ(readFile(dirs.root + "/1/fills.csv"), readFile(dirs.root + "/3/fills.csv"));
+    EXPECT_EQ(readFile(dirs.root + "/1/book.csv"), readFile(dirs.root + "/3/book.csv"));
+}
+
+TEST(SimulatorTest, MatchingAlgorithmPerInstrument) {
+    SimDirs dirs("1000,AAA,1,limit,sell,10,30\n"
+                 "1000,AAA,2,limit,sell,10,10\n"
+                 "1000,BBB,1,limit,sell,10,30\n"
+                 "1000,BBB,2,limit,sell,10,10\n"
+                 "1001,AAA,3,limit,buy,10,8\n"
+                 "1001,BBB,3,limit,buy,10,8\n");
+    SimConfig config;
+    config.instrumentAlgorithms["AAA"] = MatchingAlgorithm::ProRata;
+    dirs.run(2, "/1", config);
+
+    std::string fills = readFile(dirs.root + "/1/fills.csv");
+    EXPECT_NE(fills.find("AAA,3,1,buy,10.000000,6\n"), std::string::npos);
+    EXPECT_NE(fills.find("AAA,3,2,buy,10.000000,2\n"), std::string::npos);
+    EXPECT_NE(fills.find("BBB,3,1,buy,10.000000,8\n"), std::string::npos);
+    EXPECT_EQ(fills.find("BBB,3,2"), std::string::npos);
+}
+
+TEST(SimulatorTest, MissingInputFails) {
+    SimConfig config;
+    config.inputPath = "/nonexistent/orders.csv";
+    config.outputDir = "/tmp";
+    SimSummary summary;
+    std::string error;
+    EXPECT_FALSE(runSimulation(config, summary, &error));
+    EXPECT_FALSE(error.empty());
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "spsc_ring.hpp"
+
+TEST(SpscRingTest, FillsToCapacityAndWraps) {
+    SpscRing<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+
+    int value = 0;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 4; i++) {
+            EXPECT_TRUE(ring.tryPush(round * 10 + i));
+        }
+        EXPECT_FALSE(ring.tryPush(99));
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(ring.tryPop(value));
+            EXPECT_EQ(value, round * 10 + i);
+        }
+        EXPECT_FALSE(ring.tryPop(value));
+    }
+}
+
+TEST(SpscRingTest, TransfersAcrossThreadsInOrder) {
+    const uint64_t total = 200000;
+    SpscRing<uint64_t> ring(256);
+
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < total; i++) {
+            while (!ring.tryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint64_t expected = 0;
+    uint64_t value = 0;
+    while (expected < total) {
+        if (ring.tryPop(value)) {
+            ASSERT_EQ(value, expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "stats.hpp"
+
+TEST(StatsTest, HistogramBuckets) {
+    EXPECT_EQ(LatencyHistogram::bucketFor(0), 0u);
+    EXPECT_EQ(LatencyHistogram::bucketFor(1), 0u);
+    EXPECT_EQ(LatencyHistogram::bucketFor(2), 1u);
+    EXPECT_EQ(LatencyHistogram::bucketFor(1023), 9u);
+    EXPECT_EQ(LatencyHistogram::bucketFor(1024), 10u);
+    // Anything past the last bucket is clamped into it
+    EXPECT_EQ(LatencyHistogram::bucketFor(UINT64_MAX), kLatencyBuckets - 1);
+}
+
+TEST(StatsTest, SeqLockRoundTrip) {
+    SeqLock<StatsSnapshot> lock;
+    StatsSnapshot in{};
+    in.bidOrders = 7;
+    in.stages[0].events = 42;
+    lock.store(in);
+
+    StatsSnapshot out = lock.load();
+    EXPECT_EQ(out.bidOrders, 7u);
+    EXPECT_EQ(out.stages[0].events, 42u);
+    EXPECT_EQ(lock.sequence(), 2u);
+}
+
+TEST(StatsTest, RegistryAggregatesSlotsAndQueueDepth) {
+    StatsRegistry registry;
+    StageCounters *rx = registry.registerSlot(Stage::Decode);
+    StageCounters *w1 = registry.registerSlot(Stage::Match);
+    StageCounters *w2 = registry.registerSlot(Stage::Match);
+    ASSERT_NE(rx, nullptr);
+
+    for (int i = 0; i < 10; i++) rx->recordEvent(100);
+    for (int i = 0; i < 3; i++) w1->recordEvent(1000);
+    for (int i = 0; i < 4; i++) w2->recordEvent(3000);
+
+    StatsSnapshot snap;
+    registry.collect(snap);
+    const StageSnapshot &match = snap.stages[static_cast<size_t>(Stage::Match)];
+    EXPECT_EQ(match.events, 7u);
+    EXPECT_EQ(match.queueDepth, 3u);
+    EXPECT_EQ(match.latency.count, 7u);
+    EXPECT_EQ(match.latency.sumNs, 15000u);
+    EXPECT_EQ(match.latency.maxNs, 3000u);
+}
+
+TEST(StatsTest, PrometheusRendering) {
+    StatsSnapshot snap{};
+    snap.askOrders = 5;
+    snap.reservedBytes = 4096;
+    snap.stages[static_cast<size_t>(Stage::Match)].events = 12;
+    snap.stages[static_cast<size_t>(Stage::Match)].latency.count = 12;
+
+    std::string text = renderPrometheus(snap);
+    EXPECT_NE(text.find("orderbook_stage_events_total{stage=\"match\"} 12"), std::string::npos);
+    EXPECT_NE(text.find("orderbook_book_orders{side=\"ask\"} 5"), std::string::npos);
+    EXPECT_NE(text.find("orderbook_reserved_memory_bytes{state=\"reserved\"} 4096"), std::string::npos);
+    EXPECT_NE(text.find("orderbook_stage_latency_seconds_count{stage=\"match\"} 12"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE orderbook_stage_latency_seconds histogram"), std::string::npos);
+}
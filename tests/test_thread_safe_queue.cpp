@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "thread_safe_queue.hpp"
+
+TEST(ThreadSafeQueueTest, PopsInFifoOrder) {
+    ThreadSafeQueue<int> queue;
+    queue.push(1);
+    queue.push(2);
+    EXPECT_EQ(queue.size(), 2u);
+
+    int value = 0;
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 1);
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(ThreadSafeQueueTest, CloseDrainsThenWakesConsumers) {
+    ThreadSafeQueue<int> queue;
+    queue.push(7);
+    queue.close();
+    EXPECT_FALSE(queue.push(8));
+
+    int value = 0;
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 7);
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(ThreadSafeQueueTest, CloseReleasesBlockedConsumers) {
+    ThreadSafeQueue<int> queue;
+    std::vector<std::thread> consumers;
+    std::atomic<int> finished{0};
+    for (int i = 0; i < 3; i++) {
+        consumers.emplace_back([&] {
+            int value = 0;
+            while (queue.pop(value)) {}
+            finished++;
+        });
+    }
+    queue.push(1);
+    queue.close();
+    for (auto &t : consumers) {
+        t.join();
+    }
+    EXPECT_EQ(finished.load(), 3);
+}
+
+TEST(ThreadSafeQueueTest, TimedAndNonBlockingPops) {
+    ThreadSafeQueue<int> queue;
+    int value = 0;
+    EXPECT_FALSE(queue.tryPop(value));
+    EXPECT_FALSE(queue.popFor(value, std::chrono::milliseconds(5)));
+
+    queue.push(3);
+    ASSERT_TRUE(queue.popFor(value, std::chrono::milliseconds(5)));
+    EXPECT_EQ(value, 3);
+    queue.push(4);
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ(value, 4);
+
+    queue.close();
+    EXPECT_TRUE(queue.closed());
+    EXPECT_FALSE(queue.popFor(value, std::chrono::seconds(10)));  // returns at once
+}
+
+TEST(ThreadSafeQueueTest, KeepsOrderAcrossGrowth) {
+    ThreadSafeQueue<int> queue;
+    queue.reserve(4);
+    int value = 0;
+    // Wrap the ring, then grow it while wrapped
+    for (int i = 0; i < 3; i++) {
+        queue.push(i);
+    }
+    ASSERT_TRUE(queue.tryPop(value));
+    ASSERT_TRUE(queue.tryPop(value));
+    for (int i = 3; i < 40; i++) {
+        queue.push(i);
+    }
+    EXPECT_EQ(queue.size(), 38u);
+    for (int expected = 2; expected < 40; expected++) {
+        ASSERT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_TRUE(queue.empty());
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <vector>
+#include "timer_wheel.hpp"
+
+static std::vector<uint64_t> advanceTo(TimerWheel &wheel, uint64_t nowMs) {
+    std::vector<uint64_t> fired;
+    wheel.advance(nowMs, [&](const TimerWheel::Timer &t) { fired.push_back(t.id); });
+    return fired;
+}
+
+TEST(TimerWheelTest, FiresInDeadlineOrder) {
+    TimerWheel wheel(1000);
+    wheel.schedule(1, 1005);
+    wheel.schedule(2, 1003);
+    wheel.schedule(3, 1010);
+    EXPECT_EQ(wheel.size(), 3u);
+
+    EXPECT_TRUE(advanceTo(wheel, 1002).empty());
+    EXPECT_EQ(advanceTo(wheel, 1005), (std::vector<uint64_t>{2, 1}));
+    EXPECT_EQ(advanceTo(wheel, 2000), (std::vector<uint64_t>{3}));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, CascadesFromHigherLevels) {
+    TimerWheel wheel(250);
+    // Crosses the level-0 boundary at 256 and a level-1 boundary at 65536
+    wheel.schedule(1, 300);
+    wheel.schedule(2, 70000);
+    EXPECT_EQ(advanceTo(wheel, 299).size(), 0u);
+    EXPECT_EQ(advanceTo(wheel, 300), (std::vector<uint64_t>{1}));
+    EXPECT_EQ(advanceTo(wheel, 69999).size(), 0u);
+    EXPECT_EQ(advanceTo(wheel, 70000), (std::vector<uint64_t>{2}));
+}
+
+TEST(TimerWheelTest, PastDueFiresOnNextAdvance) {
+    TimerWheel wheel(5000);
+    wheel.schedule(9, 10);
+    EXPECT_EQ(advanceTo(wheel, 5000), (std::vector<uint64_t>{9}));
+}
+
+TEST(TimerWheelTest, IdleWheelJumpsForward) {
+    TimerWheel wheel(0);
+    advanceTo(wheel, 1ULL << 40);
+    EXPECT_EQ(wheel.now(), 1ULL << 40);
+    wheel.schedule(4, (1ULL << 40) + 1);
+    EXPECT_EQ(advanceTo(wheel, (1ULL << 40) + 1), (std::vector<uint64_t>{4}));
+}
+
+TEST(TimerWheelTest, SkipsEmptySpans) {
+    TimerWheel wheel(0);
+    constexpr uint64_t kDayMs = 24ULL * 3600 * 1000;
+    wheel.schedule(1, 30 * kDayMs);
+    wheel.schedule(2, 2 * kDayMs + 7);
+    EXPECT_TRUE(advanceTo(wheel, kDayMs).empty());
+    EXPECT_EQ(advanceTo(wheel, 3 * kDayMs), (std::vector<uint64_t>{2}));
+    EXPECT_TRUE(advanceTo(wheel, 30 * kDayMs - 1).empty());
+    EXPECT_EQ(advanceTo(wheel, 30 * kDayMs), (std::vector<uint64_t>{1}));
+
+    // Past the wheel's range: parked on the top level until it wraps
+    uint64_t far = 30 * kDayMs + (1ULL << 33) + 5;
+    wheel.schedule(3, far);
+    EXPECT_TRUE(advanceTo(wheel, far - 1).empty());
+    EXPECT_EQ(advanceTo(wheel, far), (std::vector<uint64_t>{3}));
+    EXPECT_EQ(wheel.now(), far);
+}
+
+TEST(TimerWheelTest, CancelledTimersNeverFire) {
+    TimerWheel wheel(100);
+    wheel.schedule(1, 150);
+    wheel.schedule(2, 150);
+    wheel.schedule(3, 100000);
+    EXPECT_TRUE(wheel.cancel(1, 150));
+    EXPECT_FALSE(wheel.cancel(1, 150));
+    EXPECT_FALSE(wheel.cancel(2, 151));
+    EXPECT_TRUE(advanceTo(wheel, 120).empty());
+    EXPECT_TRUE(wheel.cancel(3, 100000));
+    EXPECT_EQ(wheel.size(), 1u);
+    EXPECT_EQ(advanceTo(wheel, 200000), (std::vector<uint64_t>{2}));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, MatchesReferenceUnderRandomJumps) {
+    std::mt19937_64 rng(7);
+    TimerWheel wheel(12345);
+    std::multimap<uint64_t, uint64_t> pending;  // deadline -> id
+    uint64_t now = 12345;
+    uint64_t nextId = 1;
+    for (int step = 0; step < 2000; step++) {
+        int scale = static_cast<int>(rng() % 6);
+        uint64_t span = 1ULL << (scale * 7);  // 1 ms up to about 12 days
+        for (int i = static_cast<int>(rng() % 4); i > 0; i--) {
+            uint64_t deadline = now + rng() % (4 * span);
+            wheel.schedule(nextId, deadline);
+            pending.emplace(deadline, nextId++);
+        }
+        if (!pending.empty() && rng() % 4 == 0) {
+            auto victim = std::next(pending.begin(), static_cast<long>(rng() % pending.size()));
+            EXPECT_TRUE(wheel.cancel(victim->second, victim->first));
+            pending.erase(victim);
+        }
+        now += rng() % (2 * span);
+        std::vector<uint64_t> expected;
+        while (!pending.empty() && pending.begin()->first <= now) {
+            expected.push_back(pending.begin()->second);
+            pending.erase(pending.begin());
+        }
+        std::vector<uint64_t> fired = advanceTo(wheel, now);
+        std::sort(fired.begin(), fired.end());
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(fired, expected) << "step " << step;
+        ASSERT_EQ(wheel.size(), pending.size());
+    }
+}
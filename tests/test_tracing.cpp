@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "tracing.hpp"
+
+namespace {
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+size_t countOf(const std::string &text, const std::string &needle) {
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(TracingTest, DisabledTracerHandsOutNoBuffers) {
+    Tracer tracer;
+    EXPECT_FALSE(tracer.enabled());
+    EXPECT_FALSE(tracer.sampled(0));
+    EXPECT_EQ(tracer.registerThread("decoder"), nullptr);
+}
+
+TEST(TracingTest, SamplesOneInN) {
+    Tracer tracer(4);
+    EXPECT_TRUE(tracer.sampled(0));
+    EXPECT_FALSE(tracer.sampled(1));
+    EXPECT_FALSE(tracer.sampled(3));
+    EXPECT_TRUE(tracer.sampled(8));
+}
+
+TEST(TracingTest, FullBufferDropsRecords) {
+    Tracer tracer(1, 4);
+    TraceBuffer *buffer = tracer.registerThread("matcher");
+    ASSERT_NE(buffer, nullptr);
+    for (uint64_t i = 0; i < 6; i++) {
+        buffer->record(i, TracePoint::MatchStart, 1000 + i);
+    }
+    EXPECT_EQ(tracer.recordsDropped(), 2u);
+    tracer.collect();
+    EXPECT_EQ(tracer.recordsCollected(), 4u);
+
+    // Collecting frees the buffer for more
+    buffer->record(7, TracePoint::MatchStart, 2000);
+    tracer.collect();
+    EXPECT_EQ(tracer.recordsCollected(), 5u);
+}
+
+TEST(TracingTest, WritesChromeTraceSpansPerOrder) {
+    Tracer tracer(1);
+    TraceBuffer *receiver = tracer.registerThread("receiver");
+    TraceBuffer *matcher = nullptr;
+    // Buffers may be registered and written from different threads
+    std::thread([&] { matcher = tracer.registerThread("matcher"); }).join();
+
+    receiver->record(5, TracePoint::KernelReceive, 1000000);
+    receiver->record(5, TracePoint::Receive, 1002000);
+    matcher->record(5, TracePoint::MatchStart, 1010000);
+    matcher->record(5, TracePoint::MatchEnd, 1013500);
+    // Order 6 only got as far as the receiver
+    receiver->record(6, TracePoint::Receive, 1020000);
+
+    char path[] = "/tmp/trace_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    ASSERT_TRUE(tracer.writeChromeTrace(path));
+    std::string json = readFile(path);
+    std::remove(path);
+
+    EXPECT_EQ(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0u);
+    EXPECT_EQ(countOf(json, "\"name\":\"thread_name\""), 2u);
+    EXPECT_EQ(countOf(json, "\"name\":\"order\""), 2u);
+    EXPECT_NE(json.find("\"name\":\"socket buffer\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":5,"
+                        "\"ts\":0.000,\"dur\":2.000,\"args\":{\"thread\":\"receiver\"}"),
+              std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"match\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":5,"
+                        "\"ts\":10.000,\"dur\":3.500,\"args\":{\"thread\":\"matcher\"}"),
+              std::string::npos);
+    // Spans with a missing end point are left out
+    EXPECT_EQ(json.find("\"name\":\"decode\""), std::string::npos);
+    EXPECT_EQ(countOf(json, "\"tid\":6"), 2u);
+}